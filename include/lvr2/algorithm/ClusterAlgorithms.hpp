@@ -148,6 +148,11 @@ BoundingRectangle<typename BaseVecT::CoordType> calculateBoundingRectangle(
 /**
  * @brief Algorithm which generates clusters from the given mesh. The given predicate decides which faces will be in
  *        the same clusters.
+ *
+ * The faces are split into one block per thread and the clusters of each block are grown in parallel. Afterwards
+ * touching clusters of different blocks are merged, if the predicate accepts the faces on both sides of the border
+ * for the cluster on the other side. Thus the result only depends on the number of threads and with a single thread
+ * it equals the serial algorithm. The predicate is called from several threads at the same time.
  * @tparam Pred a predicate which decides, which faces will be in the same cluster. It gets the following parameters:
  *         (FaceHandle referenceFaceH, FaceHandle currentFaceH) and returs a bool. The referenceFaceH is the first
  *         FaceHandle, which was added to the current cluster. currentFaceH is the current FaceHandle for which the
@@ -225,6 +230,17 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
     const int num_samples = 10
 );
 
+/// Calcs a regression plane for the given cluster, the samples are drawn with `gen`
+template<typename BaseVecT, typename RandomGenerator>
+Plane<BaseVecT> calcRegressionPlaneRANSAC(
+    const BaseMesh<BaseVecT>& mesh,
+    const Cluster<FaceHandle>& cluster,
+    const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
+    const int num_iterations,
+    const int num_samples,
+    RandomGenerator& gen
+);
+
 /// Calcs a regression plane for the given cluster
 template<typename BaseVecT>
 Plane<BaseVecT> calcRegressionPlanePCA(
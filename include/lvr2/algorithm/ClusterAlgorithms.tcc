@@ -44,12 +44,15 @@
 
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
+#include "lvr2/config/lvropenmp.hpp"
+#include "lvr2/util/UnionFind.hpp"
 
 #include <algorithm>
 #include <complex>
 #include <sstream>
 #include <cmath>
 #include <limits>
+#include <random>
 #include <unordered_set>
 
 using std::unordered_set;
@@ -89,7 +92,7 @@ vector<vector<VertexHandle>> findContours(
     ClusterHandle clusterH
 )
 {
-    auto cluster = clusters[clusterH];
+    auto& cluster = clusters[clusterH];
 
     DenseVertexMap<bool> boundaryVertices(cluster.handles.size() * 3, false);
     vector<vector<VertexHandle>> allContours;
@@ -129,7 +132,7 @@ vector<vector<VertexHandle>> findContours(
             }
 
             contour.clear();
-            calcContourVertices(mesh, edgeH, contour, [clusters, clusterH](auto fH)
+            calcContourVertices(mesh, edgeH, contour, [&clusters, clusterH](auto fH)
             {
                 auto c = clusters.getClusterOf(fH);
 
@@ -383,52 +386,135 @@ BoundingRectangle<typename BaseVecT::CoordType> calculateBoundingRectangle(
 template<typename BaseVecT, typename Pred>
 ClusterBiMap<FaceHandle> clusterGrowing(const BaseMesh<BaseVecT>& mesh, Pred pred)
 {
-    ClusterBiMap<FaceHandle> clusters;
-    DenseFaceMap<bool> visited(mesh.numFaces(), false);
+    vector<FaceHandle> faces;
+    faces.reserve(mesh.numFaces());
+    for (auto faceH: mesh.faces())
+    {
+        faces.push_back(faceH);
+    }
 
-    // This vector is only used later, but in order to avoid heap allocations
-    // we will create this list here to retain the buffer.
-    vector<FaceHandle> faceNeighbours;
+    // The faces are split into one block per thread. Every thread grows the
+    // clusters of its block just like the serial algorithm would, but never
+    // leaves its block. Each face is labeled with the first face (the seed)
+    // of its cluster.
+    const size_t numBlocks = std::max(
+        static_cast<size_t>(1),
+        std::min(faces.size(), static_cast<size_t>(OpenMPConfig::getNumThreads()))
+    );
+    const Index NO_SEED = std::numeric_limits<Index>::max();
+
+    // All keys are inserted up front, so the threads only write existing
+    // values and never resize the maps.
+    DenseFaceMap<Index> seeds;
+    DenseFaceMap<Index> blocks;
+    seeds.reserve(mesh.nextFaceIndex());
+    blocks.reserve(mesh.nextFaceIndex());
+    for (auto faceH: faces)
+    {
+        seeds.insert(faceH, NO_SEED);
+        blocks.insert(faceH, 0);
+    }
 
-    // Iterate over all faces
-    for (auto faceH: mesh.faces())
+    #pragma omp parallel for schedule(static, 1)
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+        const size_t begin = block * faces.size() / numBlocks;
+        const size_t end = (block + 1) * faces.size() / numBlocks;
+        for (size_t i = begin; i < end; i++)
+        {
+            blocks[faces[i]] = block;
+        }
+    }
+
+    #pragma omp parallel for schedule(static, 1)
+    for (size_t block = 0; block < numBlocks; block++)
     {
-        // Check if face is in a cluster (i.e. we have not visited it)
-        if (!visited[faceH])
+        vector<FaceHandle> stack;
+        vector<FaceHandle> faceNeighbours;
+
+        const size_t begin = block * faces.size() / numBlocks;
+        const size_t end = (block + 1) * faces.size() / numBlocks;
+        for (size_t i = begin; i < end; i++)
         {
-            // We found a face yet to be visited. Prepare things for growing.
-            vector<FaceHandle> stack;
-            stack.push_back(faceH);
-            auto cluster = clusters.createCluster();
+            auto seedH = faces[i];
+            if (seeds[seedH] != NO_SEED)
+            {
+                continue;
+            }
 
             // Grow my cluster, groOW!
+            seeds[seedH] = seedH.idx();
+            stack.push_back(seedH);
             while (!stack.empty())
             {
                 auto currentFace = stack.back();
                 stack.pop_back();
 
-                // Check if the last faces from stack and starting face match the criteria to join the same cluster
-                if (!visited[currentFace] && pred(faceH, currentFace))
+                // Add all neighbours which match the criteria to the cluster
+                faceNeighbours.clear();
+                mesh.getNeighboursOfFace(currentFace, faceNeighbours);
+                for (auto neighbour: faceNeighbours)
                 {
-                    // The face matched the criteria => add it to cluster and mark as visited.
-                    clusters.addToCluster(cluster, currentFace);
-                    visited[currentFace] = true;
-
-                    // Find all unvisited neighbours of the current face and them to the stack
-                    faceNeighbours.clear();
-                    mesh.getNeighboursOfFace(currentFace, faceNeighbours);
-                    for (auto neighbour: faceNeighbours)
+                    if (blocks[neighbour] == block && seeds[neighbour] == NO_SEED && pred(seedH, neighbour))
                     {
-                        if (!visited[neighbour])
-                        {
-                            stack.push_back(neighbour);
-                        }
+                        seeds[neighbour] = seedH.idx();
+                        stack.push_back(neighbour);
                     }
                 }
             }
         }
     }
 
+    // Merge clusters of different blocks which touch each other, if the
+    // faces at the border match the criteria of the cluster on the other
+    // side.
+    ConcurrentUnionFind sets(mesh.nextFaceIndex());
+    if (numBlocks > 1)
+    {
+        #pragma omp parallel
+        {
+            vector<FaceHandle> faceNeighbours;
+
+            #pragma omp for schedule(dynamic, 1024)
+            for (size_t i = 0; i < faces.size(); i++)
+            {
+                auto faceH = faces[i];
+                faceNeighbours.clear();
+                mesh.getNeighboursOfFace(faceH, faceNeighbours);
+                for (auto neighbour: faceNeighbours)
+                {
+                    // Visit each pair of faces only once
+                    if (blocks[neighbour] <= blocks[faceH])
+                    {
+                        continue;
+                    }
+
+                    FaceHandle seedH(seeds[faceH]);
+                    FaceHandle neighbourSeedH(seeds[neighbour]);
+                    if (pred(seedH, neighbour) && pred(neighbourSeedH, faceH))
+                    {
+                        sets.unite(seedH.idx(), neighbourSeedH.idx());
+                    }
+                }
+            }
+        }
+    }
+
+    // Create one cluster for each set of seeds
+    ClusterBiMap<FaceHandle> clusters;
+    DenseFaceMap<ClusterHandle> clusterOfSet;
+    for (auto faceH: faces)
+    {
+        FaceHandle setH(sets.find(seeds[faceH]));
+        auto maybeCluster = clusterOfSet.get(setH);
+        if (!maybeCluster)
+        {
+            clusterOfSet.insert(setH, clusters.createCluster());
+            maybeCluster = clusterOfSet.get(setH);
+        }
+        clusters.addToCluster(*maybeCluster, faceH);
+    }
+
     return clusters;
 }
 
@@ -517,29 +603,55 @@ ClusterBiMap<FaceHandle> iterativePlanarClusterGrowingRANSAC(
     return clusters;
 }
 
+/**
+ * @brief Returns all clusters with enough faces to calculate a regression
+ *        plane for them.
+ */
 template<typename BaseVecT>
-DenseClusterMap<Plane<BaseVecT>> calcRegressionPlanes(
+vector<ClusterHandle> bigClusters(
     const BaseMesh<BaseVecT>& mesh,
     const ClusterBiMap<FaceHandle>& clusters,
-    const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
     int minClusterSize
 )
 {
-    DenseClusterMap<Plane<BaseVecT>> planes;
     size_t defaultClusterThreshold = 10 * log(mesh.numFaces());
     size_t minClusterThresholdSize = max(static_cast<size_t>(minClusterSize), defaultClusterThreshold);
 
-    // For all clusters in cluster map
+    vector<ClusterHandle> out;
     for (auto clusterH: clusters)
     {
-        // Get current cluster
-        auto cluster = clusters[clusterH];
-        if (cluster.handles.size() > minClusterThresholdSize)
+        if (clusters[clusterH].handles.size() > minClusterThresholdSize)
         {
-            // Calc regression plane for current cluster and add to cluster map: cluster -> plane
-            planes.insert(clusterH, calcRegressionPlanePCA(mesh, cluster, normals));
+            out.push_back(clusterH);
         }
     }
+    return out;
+}
+
+template<typename BaseVecT>
+DenseClusterMap<Plane<BaseVecT>> calcRegressionPlanes(
+    const BaseMesh<BaseVecT>& mesh,
+    const ClusterBiMap<FaceHandle>& clusters,
+    const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
+    int minClusterSize
+)
+{
+    DenseClusterMap<Plane<BaseVecT>> planes;
+    auto clusterHandles = bigClusters(mesh, clusters, minClusterSize);
+    vector<Plane<BaseVecT>> clusterPlanes(clusterHandles.size());
+
+    // Calc regression plane for all big clusters in parallel
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < clusterHandles.size(); i++)
+    {
+        clusterPlanes[i] = calcRegressionPlanePCA(mesh, clusters[clusterHandles[i]], normals);
+    }
+
+    // Add to cluster map: cluster -> plane
+    for (size_t i = 0; i < clusterHandles.size(); i++)
+    {
+        planes.insert(clusterHandles[i], clusterPlanes[i]);
+    }
 
     return planes;
 }
@@ -555,21 +667,38 @@ DenseClusterMap<Plane<BaseVecT>> calcRegressionPlanesRANSAC(
 )
 {
     DenseClusterMap<Plane<BaseVecT>> planes;
-    size_t defaultClusterThreshold = 10 * log(mesh.numFaces());
-    size_t minClusterThresholdSize = max(static_cast<size_t>(minClusterSize), defaultClusterThreshold);
-
-    // For all clusters in cluster map
-    for (auto clusterH: clusters)
+    auto clusterHandles = bigClusters(mesh, clusters, minClusterSize);
+    vector<Plane<BaseVecT>> clusterPlanes(clusterHandles.size());
+
+    // Calc regression plane for all big clusters in parallel. Each thread
+    // has its own random generator, which is seeded with the cluster handle.
+    // Thus the result does not depend on the order in which the clusters
+    // are processed.
+    #pragma omp parallel
     {
-        // Get current cluster
-        auto cluster = clusters[clusterH];
-        if (cluster.handles.size() > minClusterThresholdSize)
+        std::mt19937 gen;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t i = 0; i < clusterHandles.size(); i++)
         {
-            // Calc regression plane for current cluster and add to cluster map: cluster -> plane
-            planes.insert(clusterH, calcRegressionPlaneRANSAC(mesh, cluster, normals, iterations, samples));
+            gen.seed(clusterHandles[i].idx());
+            clusterPlanes[i] = calcRegressionPlaneRANSAC(
+                mesh,
+                clusters[clusterHandles[i]],
+                normals,
+                iterations,
+                samples,
+                gen
+            );
         }
     }
 
+    // Add to cluster map: cluster -> plane
+    for (size_t i = 0; i < clusterHandles.size(); i++)
+    {
+        planes.insert(clusterHandles[i], clusterPlanes[i]);
+    }
+
     return planes;
 }
 
@@ -667,6 +796,20 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
     const int num_iterations,
     const int num_samples
 )
+{
+    std::mt19937 gen;
+    return calcRegressionPlaneRANSAC(mesh, cluster, normals, num_iterations, num_samples, gen);
+}
+
+template<typename BaseVecT, typename RandomGenerator>
+Plane<BaseVecT> calcRegressionPlaneRANSAC(
+    const BaseMesh<BaseVecT>& mesh,
+    const Cluster<FaceHandle>& cluster,
+    const FaceMap<Normal<typename BaseVecT::CoordType>>& normals,
+    const int num_iterations,
+    const int num_samples,
+    RandomGenerator& gen
+)
 {
     float error_limit = 0.01; // dynamically voxelsize / 100
     Plane<BaseVecT> best_plane;
@@ -707,8 +850,17 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
 
     error_limit *= avg_dist;
     
-    const size_t num_cluster_vertices = vertices.size();
+    // Copy the positions once instead of looking them up in every iteration
+    vector<BaseVecT> positions;
+    positions.reserve(vertices.size());
+    for (auto vertexH: vertices)
+    {
+        positions.push_back(mesh.getVertexPosition(vertexH));
+    }
+
     const size_t num_cluster_faces = cluster.size();
+    std::uniform_int_distribution<size_t> faceDist(0, num_cluster_faces - 1);
+    std::uniform_int_distribution<int> cornerDist(0, 2);
 
     for(int i=0; i<num_iterations; i++)
     {
@@ -723,8 +875,8 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
         // build avg plane of RANSAC samples
         for(int j=0; j<num_samples; j++)
         {
-            const FaceHandle& faceHandle = cluster.handles[rand() % num_cluster_faces];
-            plane.pos += mesh.getVertexPositionsOfFace(faceHandle)[rand() % 3];
+            const FaceHandle& faceHandle = cluster.handles[faceDist(gen)];
+            plane.pos += mesh.getVertexPositionsOfFace(faceHandle)[cornerDist(gen)];
             plane.normal += normals[faceHandle];
         }
 
@@ -734,9 +886,9 @@ Plane<BaseVecT> calcRegressionPlaneRANSAC(
 
         // calulate inlier
         int inlier = 0;
-        for(auto vertexH : vertices)
+        for(const auto& pos : positions)
         {
-            const float current_dist = plane.distance(mesh.getVertexPosition(vertexH));
+            const float current_dist = plane.distance(pos);
             if(fabs(current_dist) < error_limit)
             {
                 inlier++;
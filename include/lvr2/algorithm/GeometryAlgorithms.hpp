@@ -35,7 +35,9 @@
 #include "lvr2/geometry/BaseMesh.hpp"
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/geometry/Handles.hpp"
+#include <limits>
 #include <list>
+#include <vector>
 
 namespace lvr2
 {
@@ -63,6 +65,99 @@ void calcLocalVertexNeighborhood(
 );
 
 
+/**
+ * @brief Buffers for visiting local vertex neighborhoods without heap allocations.
+ *
+ * Visiting a neighborhood needs a stack and a set of the visited vertices. An
+ * instance can be reused for any number of neighborhoods, but it must not be
+ * shared between threads.
+ */
+class LocalNeighborhoodState
+{
+public:
+    LocalNeighborhoodState() : m_table(64, EMPTY), m_mask(63) {}
+
+    /// Forgets all visited vertices.
+    void clear()
+    {
+        for (auto slot: m_usedSlots)
+        {
+            m_table[slot] = EMPTY;
+        }
+        m_usedSlots.clear();
+        stack.clear();
+    }
+
+    /// Marks `vH` as visited. Returns false, if it was visited before.
+    bool visit(VertexHandle vH)
+    {
+        // Keep the load factor below 1/2
+        if (2 * (m_usedSlots.size() + 1) > m_table.size())
+        {
+            grow();
+        }
+
+        size_t slot = hash(vH.idx());
+        while (m_table[slot] != EMPTY)
+        {
+            if (m_table[slot] == vH.idx())
+            {
+                return false;
+            }
+            slot = (slot + 1) & m_mask;
+        }
+        m_table[slot] = vH.idx();
+        m_usedSlots.push_back(slot);
+        return true;
+    }
+
+    /// Vertices which still need to be expanded
+    std::vector<VertexHandle> stack;
+
+    /// Neighbors of the vertex which is currently expanded
+    std::vector<VertexHandle> directNeighbors;
+
+private:
+    static constexpr Index EMPTY = std::numeric_limits<Index>::max();
+
+    size_t hash(Index idx) const
+    {
+        return (static_cast<size_t>(idx) * 0x9E3779B97F4A7C15ull >> 20) & m_mask;
+    }
+
+    /// Doubles the size of the hash table
+    void grow()
+    {
+        std::vector<Index> visited;
+        visited.reserve(m_usedSlots.size());
+        for (auto slot: m_usedSlots)
+        {
+            visited.push_back(m_table[slot]);
+        }
+
+        m_table.assign(m_table.size() * 2, EMPTY);
+        m_mask = m_table.size() - 1;
+        m_usedSlots.clear();
+        for (auto idx: visited)
+        {
+            size_t slot = hash(idx);
+            while (m_table[slot] != EMPTY)
+            {
+                slot = (slot + 1) & m_mask;
+            }
+            m_table[slot] = idx;
+            m_usedSlots.push_back(slot);
+        }
+    }
+
+    /// Open addressing hash set of the visited vertices
+    std::vector<Index> m_table;
+    size_t m_mask;
+
+    /// The occupied slots of the table, to clear it quickly
+    std::vector<size_t> m_usedSlots;
+};
+
 /**
  * @brief Visits every vertex in the local neighborhood of `vH`.
  *
@@ -81,6 +176,71 @@ void visitLocalVertexNeighborhood(
     VisitorF visitor
 );
 
+/**
+ * @brief Like visitLocalVertexNeighborhood() above, but uses the buffers of
+ *        the given state instead of allocating new ones.
+ */
+template <typename BaseVecT, typename VisitorF>
+void visitLocalVertexNeighborhood(
+    const BaseMesh<BaseVecT>& mesh,
+    VertexHandle vH,
+    double radius,
+    VisitorF visitor,
+    LocalNeighborhoodState& state
+);
+
+/**
+ * @brief The local neighborhoods of all vertices of a mesh for one radius.
+ *
+ * The neighborhoods (see visitLocalVertexNeighborhood()) are calculated in
+ * parallel and stored in one contiguous array. Several vertex attributes can
+ * then be calculated without traversing the mesh again. This needs memory for
+ * all neighborhoods, the functions taking a radius instead traverse the mesh
+ * on the fly.
+ */
+class LocalVertexNeighborhoods
+{
+public:
+    /// The neighbors of one vertex
+    struct Neighbors
+    {
+        const VertexHandle* first;
+        const VertexHandle* last;
+
+        const VertexHandle* begin() const { return first; }
+        const VertexHandle* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+    /**
+     * @brief Calculates the local neighborhood of each vertex of the mesh.
+     */
+    template<typename BaseVecT>
+    LocalVertexNeighborhoods(const BaseMesh<BaseVecT>& mesh, double radius);
+
+    /// Returns the neighbors of `vH`, not including `vH` itself.
+    Neighbors operator[](VertexHandle vH) const
+    {
+        return Neighbors{
+            m_neighbors.data() + m_offsets[vH.idx()],
+            m_neighbors.data() + m_offsets[vH.idx() + 1]
+        };
+    }
+
+    /// The radius of the neighborhoods
+    double radius() const
+    {
+        return m_radius;
+    }
+
+private:
+    double m_radius;
+
+    /// The neighbors of vertex i are stored at [m_offsets[i], m_offsets[i + 1])
+    std::vector<size_t> m_offsets;
+    std::vector<VertexHandle> m_neighbors;
+};
+
 /**
  * @brief   Calculate the height difference value for each vertex of the given BaseMesh.
  *
@@ -93,6 +253,16 @@ void visitLocalVertexNeighborhood(
 template<typename BaseVecT>
 DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT>& mesh, double radius);
 
+/**
+ * @brief Like calcVertexHeightDifferences() above, but uses the given
+ *        precalculated neighborhoods.
+ */
+template<typename BaseVecT>
+DenseVertexMap<float> calcVertexHeightDifferences(
+        const BaseMesh<BaseVecT>& mesh,
+        const LocalVertexNeighborhoods& neighborhoods
+);
+
 /**
  * @brief Calculates the roughness for each vertex.
  *
@@ -116,6 +286,17 @@ DenseVertexMap<float> calcVertexRoughness(
         const VertexMap<Normal<typename BaseVecT::CoordType>>& normals
 );
 
+/**
+ * @brief Like calcVertexRoughness() above, but uses the given precalculated
+ *        neighborhoods and average vertex angles (see calcAverageVertexAngles()).
+ */
+template<typename BaseVecT>
+DenseVertexMap<float> calcVertexRoughness(
+        const BaseMesh<BaseVecT>& mesh,
+        const LocalVertexNeighborhoods& neighborhoods,
+        const VertexMap<float>& averageAngles
+);
+
 /**
  * @brief Calculates the average angle for each vertex.
  *
@@ -172,6 +353,19 @@ void calcVertexRoughnessAndHeightDifferences(
         DenseVertexMap<float>& heightDiff
 );
 
+/**
+ * @brief Like calcVertexRoughnessAndHeightDifferences() above, but uses the
+ *        given precalculated neighborhoods and average vertex angles.
+ */
+template<typename BaseVecT>
+void calcVertexRoughnessAndHeightDifferences(
+        const BaseMesh<BaseVecT>& mesh,
+        const LocalVertexNeighborhoods& neighborhoods,
+        const VertexMap<float>& averageAngles,
+        DenseVertexMap<float>& roughness,
+        DenseVertexMap<float>& heightDiff
+);
+
 /**
  * @brief Computes the distances between the vertices and stores them in the given dense edge map.
  *
@@ -184,6 +378,8 @@ DenseEdgeMap<float> calcVertexDistances(const BaseMesh<BaseVecT>& mesh);
 /**
  * @brief  Dijkstra's algorithm
  *
+ * For many queries on the same mesh, `MeshPathFinder` is much faster.
+ *
  * @param mesh        The mesh containing the vertices and edges of interest
  * @param start       Start vertex
  * @param goal        Goal vertex
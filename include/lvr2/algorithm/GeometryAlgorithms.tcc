@@ -31,10 +31,10 @@
 
 #include <algorithm>
 #include <limits>
-#include <queue>
 
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/io/Progress.hpp"
+#include "lvr2/util/DenseMeap.hpp"
 
 namespace lvr2
 {
@@ -61,122 +61,287 @@ void visitLocalVertexNeighborhood(
     double radius,
     VisitorF visitor
 )
+{
+    LocalNeighborhoodState state;
+    visitLocalVertexNeighborhood(mesh, vH, radius, visitor, state);
+}
+
+template <typename BaseVecT, typename VisitorF>
+void visitLocalVertexNeighborhood(
+    const BaseMesh<BaseVecT>& mesh,
+    VertexHandle vH,
+    double radius,
+    VisitorF visitor,
+    LocalNeighborhoodState& state
+)
 {
     // Prepare values for the radius test
     auto vPos = mesh.getVertexPosition(vH);
     const double radiusSquared = radius * radius;
 
-    // Store the vertices we want to expand. We reserve memory for 8 vertices
-    // already, since it's rather likely to have at least that many vertices
-    // in the stack. In the beginning, the stack only contains the original
-    // vertex we were given.
-    vector<VertexHandle> stack;
-    stack.reserve(8);
-    stack.push_back(vH);
-
-    // In this map we store whether or not we have already visited a vertex,
-    // where visiting means: calling the visitor with it and pushing it on
-    // the stack of vertices we still need to expand.
-    //
-    // It would be more appropriate to use a set instead of a map, but there
-    // are no attribute-sets...
-    SparseVertexMap<bool> visited(8, false);
-    visited.insert(vH, true);
-
-    // This vector is later used to store the neighbors of a vertex. It's
-    // created here to reduce the amount of heap allocations.
-    vector<VertexHandle> directNeighbors;
+    // Store the vertices we want to expand. In the beginning, the stack only
+    // contains the original vertex we were given. The set of visited vertices
+    // contains all vertices which were pushed onto the stack.
+    state.clear();
+    state.stack.push_back(vH);
+    state.visit(vH);
 
     // As long as there are vertices we want to expand...
-    while (!stack.empty())
+    while (!state.stack.empty())
     {
         // Get the next vertex and remove it from the stack.
-        auto curVH = stack.back();
-        stack.pop_back();
+        auto curVH = state.stack.back();
+        state.stack.pop_back();
 
         // Expand current vertex: add visit its direct neighbors.
-        directNeighbors.clear();
-        mesh.getNeighboursOfVertex(curVH, directNeighbors);
-        for (auto newVH: directNeighbors)
+        state.directNeighbors.clear();
+        mesh.getNeighboursOfVertex(curVH, state.directNeighbors);
+        for (auto newVH: state.directNeighbors)
         {
             // If this vertex is within the radius of the original vertex, we
             // want to visit it later, thus pushing it onto the stack. But we
-            // only do that if we haven't visited the vertex before. We use
-            // `containsKey` here because we only insert `true` anyway.
+            // only do that if we haven't visited the vertex before.
             auto distSquared = mesh.getVertexPosition(newVH).squaredDistanceFrom(vPos);
-            if (!visited.containsKey(newVH) && distSquared < radiusSquared)
+            if (distSquared < radiusSquared && state.visit(newVH))
             {
                 visitor(newVH);
-                stack.push_back(newVH);
-                visited.insert(newVH, true);
+                state.stack.push_back(newVH);
             }
         }
     }
 }
 
-template <typename BaseVecT>
-DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT>& mesh, double radius)
+template<typename BaseVecT>
+LocalVertexNeighborhoods::LocalVertexNeighborhoods(const BaseMesh<BaseVecT>& mesh, double radius)
+    : m_radius(radius),
+      m_offsets(mesh.nextVertexIndex() + 1, 0)
 {
-    // We create a map to store a height-diff for each vertex. We preallocate
-    // memory for all vertices. This is not only an optimization, but more
-    // importantly to avoid multithreading crashes. The parallelized loop
-    // further down inserts into this data structure; if there is no free
-    // memory left, it will reallocate which will crash horribly when multiple
-    // threads are involved.
-    DenseVertexMap<float> heightDiff;
-    heightDiff.reserve(mesh.nextVertexIndex());
+    // The vertices are split into blocks of consecutive handles. Each block
+    // is collected by one thread, afterwards the blocks are concatenated.
+    const size_t numVertices = mesh.nextVertexIndex();
+    const size_t blockSize = 4096;
+    const size_t numBlocks = (numVertices + blockSize - 1) / blockSize;
+    vector<vector<VertexHandle>> blockNeighbors(numBlocks);
+
+    #pragma omp parallel
+    {
+        LocalNeighborhoodState state;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t block = 0; block < numBlocks; block++)
+        {
+            auto& neighbors = blockNeighbors[block];
+            const size_t end = std::min(numVertices, (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < end; i++)
+            {
+                VertexHandle vH(i);
+                if (mesh.containsVertex(vH))
+                {
+                    visitLocalVertexNeighborhood(mesh, vH, radius, [&](auto neighbor) {
+                        neighbors.push_back(neighbor);
+                    }, state);
+                }
+
+                // Offset relative to the start of the block
+                m_offsets[i + 1] = neighbors.size();
+            }
+        }
+    }
+
+    size_t numNeighbors = 0;
+    for (auto& neighbors: blockNeighbors)
+    {
+        numNeighbors += neighbors.size();
+    }
+    m_neighbors.reserve(numNeighbors);
+
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+        const size_t blockStart = m_neighbors.size();
+        const size_t end = std::min(numVertices, (block + 1) * blockSize);
+        for (size_t i = block * blockSize; i < end; i++)
+        {
+            m_offsets[i + 1] += blockStart;
+        }
+
+        m_neighbors.insert(m_neighbors.end(), blockNeighbors[block].begin(), blockNeighbors[block].end());
+        vector<VertexHandle>().swap(blockNeighbors[block]);
+    }
+}
+
+/**
+ * @brief Fused kernel for the roughness and the height difference.
+ *
+ * Visits the local neighborhood of each vertex once and calculates all
+ * requested values from it. The output maps are filled with all vertices
+ * before the parallel loop, so the threads write into existing entries
+ * without any locks.
+ *
+ * @param visitNeighborhood  called as `visitNeighborhood(vH, state, visitor)`
+ *                           to visit the local neighborhood of `vH`
+ * @param averageAngles      needed for the roughness only
+ * @param roughness          output, can be null
+ * @param heightDiff         output, can be null
+ */
+template<typename BaseVecT, typename VisitNeighborhoodF>
+void calcLocalVertexFeatures(
+    const BaseMesh<BaseVecT>& mesh,
+    VisitNeighborhoodF visitNeighborhood,
+    const VertexMap<float>* averageAngles,
+    DenseVertexMap<float>* roughness,
+    DenseVertexMap<float>* heightDiff,
+    const string& msg
+)
+{
+    vector<VertexHandle> vertices;
+    vertices.reserve(mesh.numVertices());
+    for (auto vH: mesh.vertices())
+    {
+        vertices.push_back(vH);
+    }
+
+    for (auto map: {roughness, heightDiff})
+    {
+        if (map)
+        {
+            map->clear();
+            map->reserve(mesh.nextVertexIndex());
+            for (auto vH: vertices)
+            {
+                map->insert(vH, 0);
+            }
+        }
+    }
 
     // Output
-    string msg = timestamp.getElapsedTime() + "Computing height differences...";
-    ProgressBar progress(mesh.numVertices(), msg);
+    ProgressBar progress(vertices.size() + 1, msg);
     ++progress;
 
-    // Calculate height difference for each vertex
-    #pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
+    #pragma omp parallel
     {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
+        LocalNeighborhoodState state;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (size_t i = 0; i < vertices.size(); i++)
         {
-            continue;
-        }
+            auto vH = vertices[i];
+
+            double sum = 0.0;
+            size_t count = 0;
+            float minHeight = std::numeric_limits<float>::max();
+            float maxHeight = std::numeric_limits<float>::lowest();
+
+            visitNeighborhood(vH, state, [&](auto neighbor) {
+                count += 1;
 
-        float minHeight = std::numeric_limits<float>::max();
-        float maxHeight = std::numeric_limits<float>::lowest();
+                if (roughness)
+                {
+                    sum += (*averageAngles)[neighbor];
+                }
 
-        visitLocalVertexNeighborhood(mesh, vH, radius, [&](auto neighbor) {
-            auto curPos = mesh.getVertexPosition(neighbor);
+                if (heightDiff)
+                {
+                    auto curPos = mesh.getVertexPosition(neighbor);
+                    minHeight = std::min(minHeight, curPos.z);
+                    maxHeight = std::max(maxHeight, curPos.z);
+                }
+            });
 
-            if (curPos.z < minHeight)
+            // Calculate the final roughness
+            if (roughness)
             {
-                minHeight = curPos.z;
+                (*roughness)[vH] = count ? sum / count : 0;
             }
-            if (curPos.z > maxHeight)
+
+            // Calculate the final height difference
+            if (heightDiff)
             {
-                maxHeight = curPos.z;
+                (*heightDiff)[vH] = count ? maxHeight - minHeight : 0;
             }
-        });
 
-        // Calculate the final height difference
-        #pragma omp critical
-        {
-            heightDiff.insert(vH, maxHeight - minHeight);
             ++progress;
         }
     }
+}
 
+/// Returns a neighborhood visitor for calcLocalVertexFeatures(), which traverses the mesh
+template<typename BaseVecT>
+auto traverseLocalNeighborhoods(const BaseMesh<BaseVecT>& mesh, double radius)
+{
+    return [&mesh, radius](VertexHandle vH, LocalNeighborhoodState& state, auto visitor)
+    {
+        visitLocalVertexNeighborhood(mesh, vH, radius, visitor, state);
+    };
+}
+
+/// Returns a neighborhood visitor for calcLocalVertexFeatures(), which uses precalculated neighborhoods
+inline auto cachedLocalNeighborhoods(const LocalVertexNeighborhoods& neighborhoods)
+{
+    return [&neighborhoods](VertexHandle vH, LocalNeighborhoodState& state, auto visitor)
+    {
+        for (auto neighbor: neighborhoods[vH])
+        {
+            visitor(neighbor);
+        }
+    };
+}
+
+template <typename BaseVecT>
+DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT>& mesh, double radius)
+{
+    DenseVertexMap<float> heightDiff;
+    calcLocalVertexFeatures(
+        mesh,
+        traverseLocalNeighborhoods(mesh, radius),
+        nullptr,
+        nullptr,
+        &heightDiff,
+        timestamp.getElapsedTime() + "Computing height differences..."
+    );
+    return heightDiff;
+}
+
+template <typename BaseVecT>
+DenseVertexMap<float> calcVertexHeightDifferences(
+    const BaseMesh<BaseVecT>& mesh,
+    const LocalVertexNeighborhoods& neighborhoods
+)
+{
+    DenseVertexMap<float> heightDiff;
+    calcLocalVertexFeatures(
+        mesh,
+        cachedLocalNeighborhoods(neighborhoods),
+        nullptr,
+        nullptr,
+        &heightDiff,
+        timestamp.getElapsedTime() + "Computing height differences..."
+    );
     return heightDiff;
 }
 
 template<typename BaseVecT>
 DenseEdgeMap<float> calcVertexAngleEdges(const BaseMesh<BaseVecT>& mesh, const VertexMap<Normal<typename BaseVecT::CoordType>>& normals)
 {
-    DenseEdgeMap<float> edgeAngle(mesh.nextEdgeIndex(), 0);
+    vector<EdgeHandle> edges;
+    edges.reserve(mesh.numEdges());
     for (auto eH: mesh.edges())
     {
-        auto vHVector = mesh.getVerticesOfEdge(eH);
-        edgeAngle.insert(eH, acos(normals[vHVector[0]].dot(normals[vHVector[1]])));
-        if(isnan(edgeAngle[eH])) edgeAngle[eH] = 0;
+        edges.push_back(eH);
+    }
+
+    // Insert all edges first, so that the threads only modify existing values
+    DenseEdgeMap<float> edgeAngle(mesh.nextEdgeIndex(), 0);
+    for (auto eH: edges)
+    {
+        edgeAngle.insert(eH, 0);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        auto vHVector = mesh.getVerticesOfEdge(edges[i]);
+        float angle = acos(normals[vHVector[0]].dot(normals[vHVector[1]]));
+        edgeAngle[edges[i]] = isnan(angle) ? 0 : angle;
     }
     return edgeAngle;
 }
@@ -187,19 +352,42 @@ DenseVertexMap<float> calcAverageVertexAngles(
     const VertexMap<Normal<typename BaseVecT::CoordType>>& normals
 )
 {
+    vector<VertexHandle> vertices;
+    vertices.reserve(mesh.numVertices());
+    for (auto vH: mesh.vertices())
+    {
+        vertices.push_back(vH);
+    }
+
+    // Insert all vertices first, so that the threads only modify existing values
     DenseVertexMap<float> vertexAngles(mesh.nextVertexIndex(), 0);
-    auto edgeAngles = calcVertexAngleEdges(mesh, normals);
+    for (auto vH: vertices)
+    {
+        vertexAngles.insert(vH, 0);
+    }
 
-    for (auto vH: mesh.vertices())
+    // The angle of each edge is calculated for both of its vertices instead
+    // of storing the angles of all edges.
+    #pragma omp parallel
     {
-        float angleSum = 0;
-        auto edgeVec = mesh.getEdgesOfVertex(vH);
-        int degree = edgeVec.size();
-        for(auto eH: edgeVec)
+        vector<VertexHandle> neighbors;
+
+        #pragma omp for schedule(static)
+        for (size_t i = 0; i < vertices.size(); i++)
         {
-            angleSum += edgeAngles[eH];
+            auto vH = vertices[i];
+            auto& normal = normals[vH];
+
+            float angleSum = 0;
+            neighbors.clear();
+            mesh.getNeighboursOfVertex(vH, neighbors);
+            for (auto neighbor: neighbors)
+            {
+                float angle = acos(normal.dot(normals[neighbor]));
+                angleSum += isnan(angle) ? 0 : angle;
+            }
+            vertexAngles[vH] = neighbors.empty() ? 0 : angleSum / neighbors.size();
         }
-        vertexAngles.insert(vH, angleSum / degree);
     }
     return vertexAngles;
 }
@@ -212,49 +400,37 @@ DenseVertexMap<float> calcVertexRoughness(
     const VertexMap<Normal<typename BaseVecT::CoordType>>& normals
 )
 {
-    // We create a map to store the roughness for each vertex. We preallocate
-    // memory for all vertices. This is not only an optimization, but more
-    // importantly to avoid multithreading crashes. The parallelized loop
-    // further down inserts into this data structure; if there is no free
-    // memory left, it will reallocate which will crash horribly when multiple
-    // threads are involved.
-    DenseVertexMap<float> roughness;
-    roughness.reserve(mesh.nextVertexIndex());
-
     auto averageAngles = calcAverageVertexAngles(mesh, normals);
 
-    // Output
-    string msg = timestamp.getElapsedTime() + "Computing roughness";
-    ProgressBar progress(mesh.numVertices(), msg);
-    ++progress;
-
-    // Calculate roughness for each vertex
-    #pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
-    {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
-        float sum = 0.0;
-        size_t count = 0;
-
-        visitLocalVertexNeighborhood(mesh, vH, radius, [&](auto neighbor) {
-            sum += averageAngles[neighbor];
-            count += 1;
-        });
-
-        #pragma omp critical
-        {
-            // Calculate the final roughness
-            roughness.insert(vH, count ? sum / count : 0);
-            ++progress;
-        }
-    }
+    DenseVertexMap<float> roughness;
+    calcLocalVertexFeatures(
+        mesh,
+        traverseLocalNeighborhoods(mesh, radius),
+        &averageAngles,
+        &roughness,
+        nullptr,
+        timestamp.getElapsedTime() + "Computing roughness"
+    );
     return roughness;
+}
 
+template<typename BaseVecT>
+DenseVertexMap<float> calcVertexRoughness(
+    const BaseMesh<BaseVecT>& mesh,
+    const LocalVertexNeighborhoods& neighborhoods,
+    const VertexMap<float>& averageAngles
+)
+{
+    DenseVertexMap<float> roughness;
+    calcLocalVertexFeatures(
+        mesh,
+        cachedLocalNeighborhoods(neighborhoods),
+        &averageAngles,
+        &roughness,
+        nullptr,
+        timestamp.getElapsedTime() + "Computing roughness"
+    );
+    return roughness;
 }
 
 template<typename BaseVecT>
@@ -266,51 +442,35 @@ void calcVertexRoughnessAndHeightDifferences(
     DenseVertexMap<float>& heightDiff
 )
 {
-    // Reserving memory in those maps is important to avoid multi threading
-    // related crashes.
-    roughness.clear();
-    roughness.reserve(mesh.nextVertexIndex());
-    heightDiff.clear();
-    heightDiff.reserve(mesh.nextVertexIndex());
-
     auto averageAngles = calcAverageVertexAngles(mesh, normals);
 
-    // Calculate roughness and height difference for each vertex
-    #pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
-    {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
-        double sum = 0.0;
-        uint32_t count = 0;
-        float minHeight = std::numeric_limits<float>::max();
-        float maxHeight = std::numeric_limits<float>::lowest();
-
-        visitLocalVertexNeighborhood(mesh, vH, radius, [&](auto neighbor) {
-            sum += averageAngles[neighbor];
-            count += 1;
-
-            auto curPos = mesh.getVertexPosition(neighbor);
-            if (curPos.z < minHeight)
-            {
-                minHeight = curPos.z;
-            }
-            if (curPos.z > maxHeight)
-            {
-                maxHeight = curPos.z;
-            }
-        });
-
-        // Calculate the final roughness
-        roughness.insert(vH, count ? sum / count : 0);
+    calcLocalVertexFeatures(
+        mesh,
+        traverseLocalNeighborhoods(mesh, radius),
+        &averageAngles,
+        &roughness,
+        &heightDiff,
+        timestamp.getElapsedTime() + "Computing roughness and height differences"
+    );
+}
 
-        // Calculate the final height difference
-        heightDiff.insert(vH, maxHeight - minHeight);
-    }
+template<typename BaseVecT>
+void calcVertexRoughnessAndHeightDifferences(
+    const BaseMesh<BaseVecT>& mesh,
+    const LocalVertexNeighborhoods& neighborhoods,
+    const VertexMap<float>& averageAngles,
+    DenseVertexMap<float>& roughness,
+    DenseVertexMap<float>& heightDiff
+)
+{
+    calcLocalVertexFeatures(
+        mesh,
+        cachedLocalNeighborhoods(neighborhoods),
+        &averageAngles,
+        &roughness,
+        &heightDiff,
+        timestamp.getElapsedTime() + "Computing roughness and height differences"
+    );
 }
 
 template<typename BaseVecT>
@@ -329,15 +489,6 @@ DenseEdgeMap<float> calcVertexDistances(const BaseMesh<BaseVecT>& mesh)
     return distances;
 }
 
-class CompareDist
-{
- public:
-  bool operator()(pair<lvr2::VertexHandle,float> n1,pair<lvr2::VertexHandle,float> n2) {
-      return n1.second>n2.second;
-  }
-};
-
-
 template<typename BaseVecT>
 bool Dijkstra(
     const BaseMesh<BaseVecT>& mesh,
@@ -369,18 +520,14 @@ bool Dijkstra(
         return true;
     }
 
-    std::priority_queue<pair<VertexHandle,float>, vector< pair<VertexHandle,float> >,CompareDist> pq;
-
-    pair<VertexHandle,float> first_pair (start, 0);
-    pq.push(first_pair);
-
+    // Each vertex is in the queue at most once, its distance is lowered
+    // in place when a shorter path is found.
+    DenseMeap<VertexHandle, float> pq(mesh.nextVertexIndex());
+    pq.insert(start, 0);
 
-    while(!pq.empty())
+    while(!pq.isEmpty())
     {
-        pair<VertexHandle, float> pair = pq.top();
-        VertexHandle current_vh = pair.first;
-        float current_dist = pair.second;
-        pq.pop();
+        VertexHandle current_vh = pq.popMin().key();
 
         // Check if the current Vertex was seen already
         if(seen[current_vh])
@@ -406,7 +553,7 @@ bool Dijkstra(
             {
                 distances[neighbour_vh] = tmp_neighbour_cost;
                 predecessors[neighbour_vh] = current_vh;
-                pq.push(std::pair<VertexHandle,float>(neighbour_vh, tmp_neighbour_cost));
+                pq.insert(neighbour_vh, tmp_neighbour_cost);
             }
         }
     }
@@ -36,6 +36,7 @@
 #define LVR2_ALGORITHM_IMAGETEXTURIZER_HPP
 
 #include "lvr2/algorithm/Texturizer.hpp"
+#include "lvr2/algorithm/raycasting/RaycasterBase.hpp"
 #include "lvr2/geometry/Normal.hpp"
 
 #include "lvr2/io/ScanprojectIO.hpp"
@@ -54,6 +55,7 @@ struct ImageData
     cv::Mat data;
     BaseVecT  pos;
     BaseVecT  dir;
+    BaseVecT  mesh_pos;
     Matrix4<BaseVecT> project_to_image_transform;
     float distortion_params[6];
     float intrinsic_params[4];
@@ -63,6 +65,11 @@ struct ImageData
 /**
  * @brief A texturizer that uses images instead of pointcloud colors for creating the textures
  *        for meshes.
+ *
+ * For each texture, the images which can see the bounding rectangle are selected first: the
+ * rectangle has to face the camera, has to be inside the image and must not be hidden by other
+ * parts of the mesh, if a raycaster is given. Each texel then takes its color from the visible
+ * image which sees it at the smallest angle and distance.
  */
 template<typename BaseVecT>
 class ImageTexturizer : public Texturizer<BaseVecT> 
@@ -80,6 +87,7 @@ public:
     ) : Texturizer<BaseVecT>(texelSize, minClusterSize, maxClusterSize)
     {
         image_data_initialized = false;
+        image_data_loaded = false;
     }
 
     /**
@@ -93,7 +101,21 @@ public:
     }
 
     /**
-     * @brief Generates a Texture for a given Rectangle
+     * @brief Sets a raycaster for the mesh, which is used to test whether a texel is hidden
+     *        from a camera. Without a raycaster, occlusions are ignored.
+     */
+    void set_raycaster(RaycasterBasePtr<BaseVecT, Normal<typename BaseVecT::CoordType>> raycaster)
+    {
+        this->raycaster = raycaster;
+    }
+
+    /**
+     * @brief Loads the images of the project
+     */
+    void prepare() override;
+
+    /**
+     * @brief Computes a Texture for a given Rectangle
      *
      * @param index The newly created texture will get this index.
      *
@@ -101,23 +123,50 @@ public:
      *
      * @param boudingRect The texture will be generated for this rectangle
      *
-     * @return Returns a handle for the newly created texture.
+     * @return Returns the newly created texture.
      */
-    TextureHandle generateTexture(
+    Texture computeTexture(
         int index,
         const PointsetSurface<BaseVecT>& surface,
-        const BoundingRectangle<BaseVecT>& boundingRect
-    );
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+    ) override;
 
 private:
     /// @cond internal
     Scanproject project;
 
     bool image_data_initialized;
+
+    // whether loading the images was tried already
+    bool image_data_loaded;
+
     std::vector<ImageData<BaseVecT> > images;
 
+    RaycasterBasePtr<BaseVecT, Normal<typename BaseVecT::CoordType>> raycaster;
+
+    // an image which sees a texture and how well it sees its center
+    struct ImageCandidate
+    {
+        size_t image;
+        float score;
+    };
+
     void init_image_data();
 
+    // the images which can see a part of the rectangle, best first
+    std::vector<ImageCandidate> visible_images(
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+    );
+
+    // projects a point of the mesh into the image, false if it isn't inside the image
+    bool project_to_image(const BaseVecT& point, const ImageData<BaseVecT> &img, int &row, int &col);
+
+    // whether the line of sight from the point to the camera is blocked by the mesh
+    bool occluded(const BaseVecT& point, const ImageData<BaseVecT> &img, float offset);
+
+    // how well the camera sees a point on a surface with the given normal, 0 if not at all
+    float view_score(const BaseVecT& point, const BaseVecT& normal, const ImageData<BaseVecT> &img) const;
+
     template<typename ValueType>
     void undistorted_to_distorted_uv(ValueType &u, ValueType &v, const ImageData<BaseVecT> &img);
 
@@ -25,6 +25,12 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "lvr2/util/Util.hpp"
+
 namespace lvr2
 {
 
@@ -53,97 +59,223 @@ bool ImageTexturizer<BaseVecT>::point_behind_camera(BaseVecT pos, const ImageDat
 }
 
 template<typename BaseVecT>
-TextureHandle ImageTexturizer<BaseVecT>::generateTexture(
-    int index,
-    const PointsetSurface<BaseVecT>& surface,
-    const BoundingRectangle<BaseVecT>& boundingRect
-)
+void ImageTexturizer<BaseVecT>::prepare()
 {
-    // Calculate the texture size
-    unsigned short int sizeX = ceil((boundingRect.m_maxDistA - boundingRect.m_minDistA) / this->m_texelSize);
-    unsigned short int sizeY = ceil((boundingRect.m_maxDistB - boundingRect.m_minDistB) / this->m_texelSize);
-
-    // Create texture
-    Texture texture(index, sizeX, sizeY, 3, 1, this->m_texelSize);
-
-    // load images if not already done
-    if (!image_data_initialized)
+    if (!image_data_loaded)
     {
         this->init_image_data();
+        image_data_loaded = true;
     }
+}
 
-    if (image_data_initialized)
+template<typename BaseVecT>
+float ImageTexturizer<BaseVecT>::view_score(
+    const BaseVecT& point,
+    const BaseVecT& normal,
+    const ImageData<BaseVecT> &img) const
+{
+    BaseVecT to_camera = img.mesh_pos - point;
+    float distance = to_camera.length();
+    if (distance == 0.0f)
     {
-        for (int y = 0; y < sizeY; y++)
-        {
-            for (int x = 0; x < sizeX; x++)
-            {
+        return 0.0f;
+    }
 
-                BaseVecT currentPos =
-                    boundingRect.m_supportVector
-                    + boundingRect.m_vec1 * (x * this->m_texelSize + boundingRect.m_minDistA - this->m_texelSize / 2.0)
-                    + boundingRect.m_vec2 * (y * this->m_texelSize + boundingRect.m_minDistB - this->m_texelSize / 2.0);
+    // surfaces which are seen head-on and from close by get the most texels per image pixel
+    float cos_angle = normal.dot(to_camera) / distance;
+    if (cos_angle <= 0.0f)
+    {
+        return 0.0f;
+    }
+    return cos_angle / distance;
+}
 
-                for (const ImageData<BaseVecT> &img_data : images)
-                {
-                    // transforming from slam6D coords to riegl coords
-                    BaseVecT pos(currentPos.z/100.0, -currentPos.x/100.0, currentPos.y/100.0);
+template<typename BaseVecT>
+bool ImageTexturizer<BaseVecT>::project_to_image(
+    const BaseVecT& point,
+    const ImageData<BaseVecT> &img,
+    int &row,
+    int &col)
+{
+    // transforming from slam6D coords to riegl coords
+    BaseVecT pos(point.z/100.0, -point.x/100.0, point.y/100.0);
 
-                    if (exclude_image(pos, img_data))
-                        continue;
+    if (exclude_image(pos, img))
+    {
+        return false;
+    }
 
-                    pos = img_data.project_to_image_transform * pos;
+    pos = img.project_to_image_transform * pos;
 
-                    float u = (float) img_data.data.rows - pos[0]/pos[2];
-                    float v = pos[1]/pos[2];
+    float u = (float) img.data.rows - pos[0]/pos[2];
+    float v = pos[1]/pos[2];
 
-                    undistorted_to_distorted_uv(u, v, img_data);
+    undistorted_to_distorted_uv(u, v, img);
 
-                    // @TODO option to do bilinear filtering aswell for pixel selection...
-                    int ud = (int) (u + 0.5);
-                    int vd = (int) (v + 0.5);
+    // @TODO option to do bilinear filtering aswell for pixel selection...
+    row = (int) std::floor(u + 0.5);
+    col = (int) std::floor(v + 0.5);
 
-                    if (ud >= 0 && ud < img_data.data.rows && vd >= 0 && vd < img_data.data.cols)
-                    {
-                        // using template keyword because elsewise < would be interpreted as less
-                        // than operator
-                        const cv::Vec3b color = img_data.data.template at<cv::Vec3b>(ud, vd);
+    return row >= 0 && row < img.data.rows && col >= 0 && col < img.data.cols;
+}
 
-                        // this works as well...
-                        //const cv::Vec3b color = ((cv::Mat) (img_data.data)).at<cv::Vec3b>(ud, vd);
+template<typename BaseVecT>
+bool ImageTexturizer<BaseVecT>::occluded(
+    const BaseVecT& point,
+    const ImageData<BaseVecT> &img,
+    float offset)
+{
+    BaseVecT to_camera = img.mesh_pos - point;
+    float distance = to_camera.length();
+    if (distance <= 2 * offset)
+    {
+        return false;
+    }
 
-                        // and this as well...
-                        //const cv::Mat &bla = img_data.data;
-                        //const cv::Vec3b color = bla.at<cv::Vec3b>(ud, vd);
+    // start the ray a bit away from the surface, so it doesn't hit the surface itself
+    BaseVecT dir = to_camera / distance;
+    BaseVecT origin = point + dir * offset;
+    BaseVecT hit;
+    if (!raycaster->castRay(origin, Normal<typename BaseVecT::CoordType>(dir.x, dir.y, dir.z), hit))
+    {
+        return false;
+    }
 
+    return hit.distance(origin) < distance - 2 * offset;
+}
 
-                        // OpenCV saves colors in BGR order
-                        uint8_t r = color[2], g = color[1], b = color[0];
+template<typename BaseVecT>
+std::vector<typename ImageTexturizer<BaseVecT>::ImageCandidate> ImageTexturizer<BaseVecT>::visible_images(
+    const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+)
+{
+    const BoundingRectangle<typename BaseVecT::CoordType>& br = boundingRect;
+    const BaseVecT normal = br.m_normal;
 
-                        texture.m_data[(sizeX * y + x) * 3 + 0] = r;
-                        texture.m_data[(sizeX * y + x) * 3 + 1] = g;
-                        texture.m_data[(sizeX * y + x) * 3 + 2] = b;
-                        break;
-                    }
-                }
-            }
+    // a grid of points on the rectangle, including the corners and the center
+    const int grid = 5;
+    std::vector<BaseVecT> samples;
+    for (int a = 0; a < grid; a++)
+    {
+        for (int b = 0; b < grid; b++)
+        {
+            samples.push_back(
+                br.m_supportVector
+                + br.m_vec1 * (br.m_minDistA + (br.m_maxDistA - br.m_minDistA) * a / (grid - 1))
+                + br.m_vec2 * (br.m_minDistB + (br.m_maxDistB - br.m_minDistB) * b / (grid - 1))
+            );
         }
     }
-    else
+    const BaseVecT& center = samples[samples.size() / 2];
+
+    std::vector<ImageCandidate> candidates;
+    for (size_t i = 0; i < images.size(); i++)
     {
-        for (int y = 0; y < sizeY; y++)
+        const ImageData<BaseVecT>& img = images[i];
+
+        // the image sees the rectangle if it sees any of the samples
+        bool visible = false;
+        for (const BaseVecT& sample : samples)
         {
-            for (int x = 0; x < sizeX; x++)
+            int row, col;
+            if (view_score(sample, normal, img) > 0.0f
+                && project_to_image(sample, img, row, col)
+                && !(raycaster && occluded(sample, img, this->m_texelSize)))
             {
-                texture.m_data[(sizeX * y + x) * 3 + 0] = 0;
-                texture.m_data[(sizeX * y + x) * 3 + 1] = 0;
-                texture.m_data[(sizeX * y + x) * 3 + 2] = 0;
+                visible = true;
+                break;
             }
         }
 
+        if (visible)
+        {
+            candidates.push_back({i, view_score(center, normal, img)});
+        }
     }
 
-    return this->m_textures.push(texture);
+    std::stable_sort(candidates.begin(), candidates.end(), [](const ImageCandidate& a, const ImageCandidate& b) {
+        return a.score > b.score;
+    });
+
+    return candidates;
+}
+
+template<typename BaseVecT>
+Texture ImageTexturizer<BaseVecT>::computeTexture(
+    int index,
+    const PointsetSurface<BaseVecT>& surface,
+    const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+)
+{
+    // Calculate the texture size
+    unsigned short int sizeX = ceil((boundingRect.m_maxDistA - boundingRect.m_minDistA) / this->m_texelSize);
+    unsigned short int sizeY = ceil((boundingRect.m_maxDistB - boundingRect.m_minDistB) / this->m_texelSize);
+
+    // Create texture
+    Texture texture(index, sizeX, sizeY, 3, 1, this->m_texelSize);
+    std::fill(texture.m_data, texture.m_data + sizeX * sizeY * 3, 0);
+
+    // The images are loaded by prepare() before the textures are computed
+    if (!image_data_initialized)
+    {
+        return texture;
+    }
+
+    // Only the images which see the rectangle at all are tested for each texel
+    std::vector<ImageCandidate> candidates = visible_images(boundingRect);
+    const BaseVecT normal = boundingRect.m_normal;
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (int y = 0; y < sizeY; y++)
+    {
+        // the candidates which see the current texel, with their score
+        std::vector<std::pair<float, size_t>> views;
+
+        for (int x = 0; x < sizeX; x++)
+        {
+            BaseVecT currentPos =
+                boundingRect.m_supportVector
+                + boundingRect.m_vec1 * (x * this->m_texelSize + boundingRect.m_minDistA - this->m_texelSize / 2.0)
+                + boundingRect.m_vec2 * (y * this->m_texelSize + boundingRect.m_minDistB - this->m_texelSize / 2.0);
+
+            views.clear();
+            for (const ImageCandidate& candidate : candidates)
+            {
+                float score = view_score(currentPos, normal, images[candidate.image]);
+                if (score > 0.0f)
+                {
+                    views.emplace_back(score, candidate.image);
+                }
+            }
+            std::sort(views.begin(), views.end(), std::greater<std::pair<float, size_t>>());
+
+            // take the best image which isn't occluded
+            for (const auto& view : views)
+            {
+                const ImageData<BaseVecT> &img_data = images[view.second];
+
+                int ud, vd;
+                if (!project_to_image(currentPos, img_data, ud, vd)
+                    || (raycaster && occluded(currentPos, img_data, this->m_texelSize)))
+                {
+                    continue;
+                }
+
+                // using template keyword because elsewise < would be interpreted as less
+                // than operator
+                const cv::Vec3b color = img_data.data.template at<cv::Vec3b>(ud, vd);
+
+                // OpenCV saves colors in BGR order
+                const size_t texel = ((sizeY - y - 1) * sizeX + x) * 3;
+                texture.m_data[texel + 0] = color[2];
+                texture.m_data[texel + 1] = color[1];
+                texture.m_data[texel + 2] = color[0];
+                break;
+            }
+        }
+    }
+
+    return texture;
 }
 
 template<typename BaseVecT>
@@ -195,15 +327,18 @@ void ImageTexturizer<BaseVecT>::init_image_data()
 
             //caluclate cam direction and cam pos for image in project space
             BaseVecT cam_pos = {0.0f, 0.0f, 0.0f};
-            Normal<BaseVecT> cam_dir = {0.0f, 0.0f, 1.0f};
+            Normal<typename BaseVecT::CoordType> cam_dir(0.0f, 0.0f, 1.0f);
             cam_pos = transform_inverse * cam_pos;
             cam_dir = transform_inverse * cam_dir;
 
             image_data.pos = cam_pos;
             image_data.dir = cam_dir;
 
+            // camera position in slam6D coords, like the mesh
+            image_data.mesh_pos = BaseVecT(-cam_pos.y * 100.0, cam_pos.z * 100.0, cam_pos.x * 100.0);
+
             // transform from project space to image space incl orthogonal projection
-            image_data.project_to_image_transform = transform * pro;
+            image_data.project_to_image_transform = Transformd(transform * pro);
             image_data.project_to_image_transform.transpose();
 
             images.push_back(image_data);
@@ -169,6 +169,9 @@ public:
      * the texturizer generate a texture using the bounding rectangle.
      * Then calculate AKAZE keypoints for the texture image and texture coordinates for each vertex in the cluster.
      *
+     * The clusters are processed in parallel. Afterwards, the textures are packed into atlas pages by
+     * `Texturizer::addTextures()` and the texture coordinates are converted to coordinates within the pages.
+     *
      * @return The materializer result, that contains materials and optional texture data
      */
     MaterializerResult<BaseVecT> generateMaterials();
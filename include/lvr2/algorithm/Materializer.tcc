@@ -37,6 +37,11 @@
 #include "lvr2/algorithm/FinalizeAlgorithms.hpp"
 #include <opencv2/features2d.hpp>
 
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
 
 namespace lvr2
 {
@@ -86,18 +91,33 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
     int numClustersTooSmall = 0;
     int numClustersTooLarge = 0;
     int textureCount = 0;
-    int clusterCount = 0;
 
-    // For all clusters ...
+    // Everything computed for one cluster
+    struct ClusterResult
+    {
+        ClusterHandle clusterH = ClusterHandle(0);
+        bool textured = false;
+
+        // Plain color material
+        Rgb8Color color;
+
+        // Texture and its coordinates
+        Texture texture;
+        std::vector<std::pair<VertexHandle, TexCoords>> texCoords;
+        std::vector<BaseVecT> features3d;
+        cv::Mat descriptors;
+    };
+
+    // Decide for each cluster whether it gets a texture
+    std::vector<ClusterResult> results;
+    results.reserve(m_cluster.numCluster());
     for (auto clusterH : m_cluster)
     {
-        ++progress;
-
-
         // Get number of faces in cluster
-        const Cluster<FaceHandle>& cluster = m_cluster.getCluster(clusterH);
-        int numFacesInCluster = cluster.handles.size();
+        int numFacesInCluster = m_cluster.getCluster(clusterH).handles.size();
 
+        ClusterResult result;
+        result.clusterH = clusterH;
 
         if (!m_texturizer
             || (m_texturizer && numFacesInCluster < m_texturizer.get().m_texMinClusterSize
@@ -122,8 +142,41 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
                     numClustersTooLarge++;
                 }
             }
+        }
+        else
+        {
+            result.textured = true;
+        }
+        results.push_back(std::move(result));
+    }
 
+    // The clusters are independent of each other, so they are computed in
+    // parallel. Big clusters are started first, so that no thread is left
+    // with a big cluster at the end.
+    std::vector<size_t> order(results.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return m_cluster.getCluster(results[a].clusterH).handles.size()
+            > m_cluster.getCluster(results[b].clusterH).handles.size();
+    });
+
+    if (m_texturizer)
+    {
+        m_texturizer.get().prepare();
+    }
 
+    #pragma omp parallel for schedule(dynamic,1)
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        ClusterResult& result = results[order[i]];
+        auto clusterH = result.clusterH;
+        const Cluster<FaceHandle>& cluster = m_cluster.getCluster(clusterH);
+
+        if (!result.textured)
+        {
             // Calculate (a sorta-kinda not really) median value
             std::map<Rgb8Color, int> colorMap;
             int maxColorCount = 0;
@@ -147,18 +200,7 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
                     mostUsedColor = color;
                 }
             }
-
-            // Create material and save in map
-            Material material;
-            std::array<unsigned char, 3> arr = {
-                static_cast<uint8_t>(mostUsedColor[0]),
-                static_cast<uint8_t>(mostUsedColor[1]),
-                static_cast<uint8_t>(mostUsedColor[2])
-            };
-
-            material.m_color =  std::move(arr);
-              clusterMaterials.insert(clusterH, material);
-
+            result.color = mostUsedColor;
         }
         else
         {
@@ -181,39 +223,21 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
                 clusterH
             );
 
-
             // Create texture
-            TextureHandle texH = m_texturizer.get().generateTexture(
-                textureCount,
+            result.texture = m_texturizer.get().computeTexture(
+                0,
                 m_surface,
                 boundingRect
             );
 
             std::vector<cv::KeyPoint> keypoints;
-            cv::Mat descriptors;
             cv::Ptr<cv::AKAZE> detector = cv::AKAZE::create();
-            m_texturizer.get().findKeyPointsInTexture(texH,
-                    boundingRect, detector, keypoints, descriptors);
-            std::vector<BaseVecT> features3d =
-                m_texturizer.get().keypoints23d(keypoints, boundingRect, texH);
-
-            // Transform descriptor from matrix row to float vector
-            for (unsigned int row = 0; row < features3d.size(); ++row)
-            {
-                keypoints_map[features3d[row]] =
-                    std::vector<float>(descriptors.ptr(row), descriptors.ptr(row) + descriptors.cols);
-            }
-
-            // Create material with default color and insert into face map
-            Material material;
-            material.m_texture = texH;
-            std::array<unsigned char, 3> arr = {255, 255, 255};
-
-            material.m_color = std::move(arr);            
-              clusterMaterials.insert(clusterH, material);
+            m_texturizer.get().findKeyPointsInTexture(result.texture,
+                    detector, keypoints, result.descriptors);
+            result.features3d =
+                m_texturizer.get().keypoints23d(keypoints, boundingRect, result.texture);
 
             // Calculate tex coords
-            // Insert material into face map for each face
             // Find unique vertices in cluster
             std::unordered_set<VertexHandle> verticesOfCluster;
             for (auto faceH : cluster.handles)
@@ -229,30 +253,93 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
             {
                 // Calculate tex coords
                 TexCoords texCoords = m_texturizer.get().calculateTexCoords(
-                    texH,
+                    result.texture,
                     boundingRect,
                     m_mesh.getVertexPosition(vertexH)
                 );
-
-                // Insert into result map
-                if (vertexTexCoords.get(vertexH))
-                {
-                    vertexTexCoords.get(vertexH).get().push(clusterH, texCoords);
-                }
-                else
-                {
-                    ClusterTexCoordMapping mapping;
-                    mapping.push(clusterH, texCoords);
-                    vertexTexCoords.insert(vertexH, mapping);
-                }
+                result.texCoords.emplace_back(vertexH, texCoords);
             }
-
-            textureCount++;
         }
+
+        ++progress;
     }
 
     cout << endl;
 
+    // Add the textures, packed into atlas pages
+    std::vector<TextureRegion> regions;
+    if (m_texturizer)
+    {
+        std::vector<Texture> textures;
+        textures.reserve(results.size());
+        for (auto& result : results)
+        {
+            if (result.textured)
+            {
+                textures.push_back(std::move(result.texture));
+            }
+        }
+        regions = m_texturizer.get().addTextures(textures);
+    }
+
+    // Collect the results in the order of the clusters
+    for (auto& result : results)
+    {
+        auto clusterH = result.clusterH;
+
+        if (!result.textured)
+        {
+            // Create material and save in map
+            Material material;
+            std::array<unsigned char, 3> arr = {
+                static_cast<uint8_t>(result.color[0]),
+                static_cast<uint8_t>(result.color[1]),
+                static_cast<uint8_t>(result.color[2])
+            };
+
+            material.m_color =  std::move(arr);
+            clusterMaterials.insert(clusterH, material);
+            continue;
+        }
+
+        const TextureRegion& region = regions[textureCount];
+
+        // Transform descriptor from matrix row to float vector
+        for (unsigned int row = 0; row < result.features3d.size(); ++row)
+        {
+            keypoints_map[result.features3d[row]] =
+                std::vector<float>(result.descriptors.ptr(row), result.descriptors.ptr(row) + result.descriptors.cols);
+        }
+
+        // Create material with default color and insert into face map
+        Material material;
+        material.m_texture = region.page;
+        std::array<unsigned char, 3> arr = {255, 255, 255};
+
+        material.m_color = std::move(arr);
+        clusterMaterials.insert(clusterH, material);
+
+        for (auto& vertexTexCoord : result.texCoords)
+        {
+            auto vertexH = vertexTexCoord.first;
+            TexCoords texCoords = region.toPage(vertexTexCoord.second);
+
+            // Insert into result map
+            if (vertexTexCoords.get(vertexH))
+            {
+                vertexTexCoords.get(vertexH).get().push(clusterH, texCoords);
+            }
+            else
+            {
+                ClusterTexCoordMapping mapping;
+                mapping.push(clusterH, texCoords);
+                vertexTexCoords.insert(vertexH, mapping);
+            }
+        }
+
+        textureCount++;
+    }
+
     // Write result
     if (m_texturizer)
     {
@@ -263,7 +350,8 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
         cout << timestamp << "(" << numClustersTooSmall << " below threshold, "
         << numClustersTooLarge << " above limit, " << m_cluster.numCluster() << " total)" << endl;
 
-        cout << timestamp << "Generated " << textureCount << " textures" << endl;
+        cout << timestamp << "Generated " << textureCount << " textures on "
+        << m_texturizer.get().getTextures().numUsed() << " pages" << endl;
 
         return MaterializerResult<BaseVecT>(
             clusterMaterials,
@@ -279,6 +367,4 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
 
 }
 
-
-
 } // namespace lvr2
@@ -0,0 +1,277 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * MeshPathFinder.hpp
+ */
+
+#ifndef LVR2_ALGORITHM_MESHPATHFINDER_H_
+#define LVR2_ALGORITHM_MESHPATHFINDER_H_
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "lvr2/attrmaps/AttrMaps.hpp"
+#include "lvr2/geometry/BaseMesh.hpp"
+#include "lvr2/geometry/Handles.hpp"
+#include "lvr2/util/DenseMeap.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Answers many shortest path queries on the vertex graph of a mesh.
+ *
+ * The vertex graph and the edge costs are copied into a compact adjacency
+ * array on construction, so later changes of the mesh or the cost map are not
+ * seen. Queries are answered with A*. The heuristic is the euclidean distance
+ * to the goal, scaled by the smallest ratio of edge cost to edge length, so
+ * it never overestimates the cost. After `computeLandmarks()` the heuristic
+ * additionally uses the triangle inequality with precomputed distances from
+ * a few landmark vertices (ALT), which is much tighter if the edge costs are
+ * not proportional to the edge lengths.
+ *
+ * All per query memory lives in a `SearchState`, which is reset in constant
+ * time and should be reused for many queries. The finder itself is never
+ * modified by a query, so different threads can search at the same time with
+ * their own states.
+ *
+ * Edge costs must not be negative.
+ */
+template<typename BaseVecT>
+class MeshPathFinder
+{
+public:
+    /// Start and goal of one query
+    struct PathQuery
+    {
+        VertexHandle start;
+        VertexHandle goal;
+    };
+
+    /// Result of one query
+    struct PathResult
+    {
+        /// Whether the goal was reached
+        bool found = false;
+
+        /// Sum of the edge costs along the path, infinity if not found
+        float cost = std::numeric_limits<float>::infinity();
+
+        /// The vertices of the path, from the start to the goal
+        std::vector<VertexHandle> path;
+    };
+
+    /**
+     * @brief Reusable memory of one search.
+     *
+     * A state belongs to one thread at a time. It can be used with different
+     * finders, but is only cheap to reuse for meshes of the same size.
+     */
+    class SearchState
+    {
+    public:
+        SearchState() : m_epoch(0) {}
+
+    private:
+        friend class MeshPathFinder;
+
+        /// Search data of one vertex, only valid if `reached == m_epoch`
+        struct Node
+        {
+            float g;
+            float h;
+            Index pred;
+            Index reached = 0;
+            Index closed = 0;
+        };
+
+        /// Invalidates all nodes of the last search
+        void reset(size_t numVertices);
+
+        /// Returns the node of `i`, initialized if it wasn't reached yet
+        Node& node(Index i);
+
+        bool isClosed(Index i) const
+        {
+            return m_nodes[i].closed == m_epoch;
+        }
+
+        Index m_epoch;
+        std::vector<Node> m_nodes;
+        DenseMeap<VertexHandle, float> m_open;
+    };
+
+    /**
+     * @brief Creates the search graph of the mesh.
+     *
+     * @param mesh the mesh to search paths on
+     * @param edgeCosts cost of each edge. Edges without cost can't be used.
+     */
+    MeshPathFinder(const BaseMesh<BaseVecT>& mesh, const EdgeMap<float>& edgeCosts);
+
+    /**
+     * @brief Like the constructor above, but vertices with a cost of at
+     *        least `lethalCost` can't be entered.
+     *
+     * Such a vertex can still be the start of a path, like in `Dijkstra()`.
+     */
+    MeshPathFinder(
+        const BaseMesh<BaseVecT>& mesh,
+        const EdgeMap<float>& edgeCosts,
+        const VertexMap<float>& vertexCosts,
+        float lethalCost = 1
+    );
+
+    /**
+     * @brief Selects `count` landmarks and calculates the distances from
+     *        each of them to all vertices.
+     *
+     * The landmarks are spread over the largest connected component by
+     * farthest point sampling. This needs `count` full searches over the
+     * graph and `count` floats per vertex, but speeds up all later queries.
+     * Calling this again replaces the previous landmarks.
+     */
+    void computeLandmarks(size_t count);
+
+    /// The number of landmarks used by the heuristic
+    size_t numLandmarks() const
+    {
+        return m_numLandmarks;
+    }
+
+    /**
+     * @brief Finds the cheapest path from `start` to `goal`.
+     *
+     * The search stops as soon as the goal is reached, or when all remaining
+     * paths would cost more than `maxCost`.
+     *
+     * @return true if a path was found
+     */
+    bool findPath(
+        VertexHandle start,
+        VertexHandle goal,
+        SearchState& state,
+        PathResult& result,
+        float maxCost = std::numeric_limits<float>::infinity()
+    ) const;
+
+    /**
+     * @brief Finds the cheapest path from any of the `starts` to `goal`.
+     *
+     * All starts are searched at once, the result begins at the start which
+     * is closest to the goal.
+     */
+    bool findPath(
+        const std::vector<VertexHandle>& starts,
+        VertexHandle goal,
+        SearchState& state,
+        PathResult& result,
+        float maxCost = std::numeric_limits<float>::infinity()
+    ) const;
+
+    /**
+     * @brief Answers all queries in parallel.
+     *
+     * The search states are kept between calls, so repeated batches don't
+     * allocate per vertex memory.
+     *
+     * @return one result per query, in the same order
+     */
+    std::vector<PathResult> findPaths(
+        const std::vector<PathQuery>& queries,
+        float maxCost = std::numeric_limits<float>::infinity()
+    );
+
+private:
+    /// Copies the graph of the mesh, skipping edges into blocked vertices
+    void buildGraph(
+        const BaseMesh<BaseVecT>& mesh,
+        const EdgeMap<float>& edgeCosts,
+        const VertexMap<float>* vertexCosts,
+        float lethalCost
+    );
+
+    /// A* from all starts in [first, last)
+    bool search(
+        const VertexHandle* first,
+        const VertexHandle* last,
+        VertexHandle goal,
+        SearchState& state,
+        PathResult& result,
+        float maxCost
+    ) const;
+
+    /// Lower bound of the cost from `i` to `goal`, infinity if there is no path
+    float heuristic(Index i, Index goal) const;
+
+    /// Dijkstra from `source` over the whole graph
+    void distancesFrom(Index source, std::vector<float>& distances) const;
+
+    /// Takes a state from the pool or creates a new one
+    std::unique_ptr<SearchState> acquireState();
+    void releaseState(std::unique_ptr<SearchState> state);
+
+    /// The edges of vertex i are stored at [m_offsets[i], m_offsets[i + 1])
+    std::vector<size_t> m_offsets;
+    std::vector<Index> m_targets;
+    std::vector<float> m_costs;
+
+    /// Whether a vertex can be entered
+    enum VertexState : uint8_t
+    {
+        FREE,
+        LETHAL,
+        MISSING
+    };
+
+    /// Positions and states of all vertices
+    std::vector<BaseVecT> m_positions;
+    std::vector<VertexState> m_vertexStates;
+
+    /// Scale of the euclidean distance which never exceeds the edge costs
+    float m_heuristicScale;
+
+    /// Distance from landmark l to vertex i at [i * m_numLandmarks + l]
+    size_t m_numLandmarks;
+    std::vector<float> m_landmarkDistances;
+
+    /// States of `findPaths()` which are currently not in use
+    std::mutex m_poolMutex;
+    std::vector<std::unique_ptr<SearchState>> m_statePool;
+};
+
+} // namespace lvr2
+
+#include "lvr2/algorithm/MeshPathFinder.tcc"
+
+#endif /* LVR2_ALGORITHM_MESHPATHFINDER_H_ */
@@ -0,0 +1,509 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+ * MeshPathFinder.tcc
+ */
+
+#include <algorithm>
+#include <cmath>
+
+namespace lvr2
+{
+
+template<typename BaseVecT>
+void MeshPathFinder<BaseVecT>::SearchState::reset(size_t numVertices)
+{
+    if (m_nodes.size() != numVertices)
+    {
+        m_nodes.assign(numVertices, Node());
+        m_open = DenseMeap<VertexHandle, float>(numVertices);
+        m_epoch = 0;
+    }
+    m_open.clear();
+
+    // Nodes of older searches have a smaller epoch and are thus invalid. Only
+    // if the epoch overflows, the nodes have to be reset.
+    if (++m_epoch == 0)
+    {
+        for (auto& node: m_nodes)
+        {
+            node.reached = 0;
+            node.closed = 0;
+        }
+        m_epoch = 1;
+    }
+}
+
+template<typename BaseVecT>
+typename MeshPathFinder<BaseVecT>::SearchState::Node&
+MeshPathFinder<BaseVecT>::SearchState::node(Index i)
+{
+    auto& node = m_nodes[i];
+    if (node.reached != m_epoch)
+    {
+        node.g = std::numeric_limits<float>::infinity();
+        node.h = -1;
+        node.pred = i;
+        node.reached = m_epoch;
+    }
+    return node;
+}
+
+template<typename BaseVecT>
+MeshPathFinder<BaseVecT>::MeshPathFinder(
+    const BaseMesh<BaseVecT>& mesh,
+    const EdgeMap<float>& edgeCosts
+)
+    : m_numLandmarks(0)
+{
+    buildGraph(mesh, edgeCosts, nullptr, 0);
+}
+
+template<typename BaseVecT>
+MeshPathFinder<BaseVecT>::MeshPathFinder(
+    const BaseMesh<BaseVecT>& mesh,
+    const EdgeMap<float>& edgeCosts,
+    const VertexMap<float>& vertexCosts,
+    float lethalCost
+)
+    : m_numLandmarks(0)
+{
+    buildGraph(mesh, edgeCosts, &vertexCosts, lethalCost);
+}
+
+template<typename BaseVecT>
+void MeshPathFinder<BaseVecT>::buildGraph(
+    const BaseMesh<BaseVecT>& mesh,
+    const EdgeMap<float>& edgeCosts,
+    const VertexMap<float>* vertexCosts,
+    float lethalCost
+)
+{
+    const size_t numVertices = mesh.nextVertexIndex();
+    m_positions.assign(numVertices, BaseVecT());
+    m_vertexStates.assign(numVertices, MISSING);
+    m_offsets.assign(numVertices + 1, 0);
+
+    std::vector<VertexHandle> handles;
+    handles.reserve(mesh.numVertices());
+    for (auto vH: mesh.vertices())
+    {
+        handles.push_back(vH);
+        m_positions[vH.idx()] = mesh.getVertexPosition(vH);
+        auto cost = vertexCosts ? vertexCosts->get(vH) : boost::none;
+        m_vertexStates[vH.idx()] = cost && *cost >= lethalCost ? LETHAL : FREE;
+    }
+
+    // Calls `f(target, cost)` for all edges of `vH` which can be used
+    auto forEachEdge = [&](VertexHandle vH, std::vector<EdgeHandle>& edges, auto f)
+    {
+        edges.clear();
+        mesh.getEdgesOfVertex(vH, edges);
+        for (auto eH: edges)
+        {
+            auto cost = edgeCosts.get(eH);
+            auto vertices = mesh.getVerticesOfEdge(eH);
+            auto target = vertices[0] == vH ? vertices[1] : vertices[0];
+            if (cost && m_vertexStates[target.idx()] == FREE)
+            {
+                f(target, *cost);
+            }
+        }
+    };
+
+    // First count the edges of each vertex, then fill them in
+    #pragma omp parallel
+    {
+        std::vector<EdgeHandle> edges;
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (size_t i = 0; i < handles.size(); i++)
+        {
+            size_t degree = 0;
+            forEachEdge(handles[i], edges, [&](VertexHandle, float) { degree++; });
+            m_offsets[handles[i].idx() + 1] = degree;
+        }
+    }
+
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        m_offsets[i + 1] += m_offsets[i];
+    }
+    m_targets.resize(m_offsets.back());
+    m_costs.resize(m_offsets.back());
+
+    float scale = std::numeric_limits<float>::infinity();
+
+    #pragma omp parallel
+    {
+        std::vector<EdgeHandle> edges;
+        float localScale = std::numeric_limits<float>::infinity();
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (size_t i = 0; i < handles.size(); i++)
+        {
+            auto vH = handles[i];
+            auto pos = m_offsets[vH.idx()];
+            forEachEdge(vH, edges, [&](VertexHandle target, float cost) {
+                m_targets[pos] = target.idx();
+                m_costs[pos] = cost;
+                pos++;
+
+                auto length = m_positions[vH.idx()].distance(m_positions[target.idx()]);
+                if (length > 0)
+                {
+                    localScale = std::min(localScale, cost / length);
+                }
+            });
+        }
+
+        #pragma omp critical
+        scale = std::min(scale, localScale);
+    }
+
+    m_heuristicScale = std::isfinite(scale) ? std::max(scale, 0.0f) : 0;
+}
+
+template<typename BaseVecT>
+float MeshPathFinder<BaseVecT>::heuristic(Index i, Index goal) const
+{
+    float h = m_heuristicScale * m_positions[i].distance(m_positions[goal]);
+    if (m_numLandmarks == 0 || m_vertexStates[i] != FREE || m_vertexStates[goal] != FREE)
+    {
+        return h;
+    }
+
+    // By the triangle inequality |d(l, goal) - d(l, i)| <= d(i, goal). If
+    // only one of both is reachable from a landmark, they are not connected.
+    const float* fromI = &m_landmarkDistances[i * m_numLandmarks];
+    const float* fromGoal = &m_landmarkDistances[goal * m_numLandmarks];
+    for (size_t l = 0; l < m_numLandmarks; l++)
+    {
+        if (std::isinf(fromI[l]) || std::isinf(fromGoal[l]))
+        {
+            if (fromI[l] != fromGoal[l])
+            {
+                return std::numeric_limits<float>::infinity();
+            }
+            continue;
+        }
+        h = std::max(h, std::abs(fromGoal[l] - fromI[l]));
+    }
+    return h;
+}
+
+template<typename BaseVecT>
+void MeshPathFinder<BaseVecT>::distancesFrom(Index source, std::vector<float>& distances) const
+{
+    distances.assign(m_positions.size(), std::numeric_limits<float>::infinity());
+    distances[source] = 0;
+
+    DenseMeap<VertexHandle, float> queue(m_positions.size());
+    queue.insert(VertexHandle(source), 0);
+    while (!queue.isEmpty())
+    {
+        auto current = queue.popMin().key().idx();
+        for (size_t e = m_offsets[current]; e < m_offsets[current + 1]; e++)
+        {
+            auto dist = distances[current] + m_costs[e];
+            if (dist < distances[m_targets[e]])
+            {
+                distances[m_targets[e]] = dist;
+                queue.insert(VertexHandle(m_targets[e]), dist);
+            }
+        }
+    }
+}
+
+template<typename BaseVecT>
+void MeshPathFinder<BaseVecT>::computeLandmarks(size_t count)
+{
+    m_numLandmarks = 0;
+    m_landmarkDistances.clear();
+
+    // Find a vertex of the largest connected component
+    const size_t numVertices = m_positions.size();
+    std::vector<bool> labeled(numVertices, false);
+    std::vector<Index> stack;
+    size_t largest = 0;
+    Index seed = 0;
+    for (Index i = 0; i < numVertices; i++)
+    {
+        if (labeled[i] || m_vertexStates[i] != FREE)
+        {
+            continue;
+        }
+
+        size_t size = 0;
+        labeled[i] = true;
+        stack.push_back(i);
+        while (!stack.empty())
+        {
+            auto current = stack.back();
+            stack.pop_back();
+            size++;
+            for (size_t e = m_offsets[current]; e < m_offsets[current + 1]; e++)
+            {
+                if (!labeled[m_targets[e]])
+                {
+                    labeled[m_targets[e]] = true;
+                    stack.push_back(m_targets[e]);
+                }
+            }
+        }
+
+        if (size > largest)
+        {
+            largest = size;
+            seed = i;
+        }
+    }
+
+    if (largest == 0)
+    {
+        return;
+    }
+
+    // Farthest point sampling: each landmark is the vertex farthest from all
+    // previous landmarks. The first one is the farthest from the seed.
+    auto farthest = [&](const std::vector<float>& distances)
+    {
+        Index best = seed;
+        for (Index i = 0; i < numVertices; i++)
+        {
+            if (std::isfinite(distances[i]) && distances[i] > distances[best])
+            {
+                best = i;
+            }
+        }
+        return best;
+    };
+
+    std::vector<float> distances;
+    distancesFrom(seed, distances);
+    std::vector<float> minDistances(numVertices, std::numeric_limits<float>::infinity());
+    std::vector<std::vector<float>> landmarkDistances;
+    Index next = farthest(distances);
+    while (landmarkDistances.size() < count)
+    {
+        distancesFrom(next, distances);
+        for (size_t i = 0; i < numVertices; i++)
+        {
+            minDistances[i] = std::min(minDistances[i], distances[i]);
+        }
+        landmarkDistances.push_back(distances);
+
+        next = farthest(minDistances);
+        if (minDistances[next] == 0)
+        {
+            // Every vertex of the component is a landmark already
+            break;
+        }
+    }
+
+    m_numLandmarks = landmarkDistances.size();
+    m_landmarkDistances.resize(numVertices * m_numLandmarks);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        for (size_t l = 0; l < m_numLandmarks; l++)
+        {
+            m_landmarkDistances[i * m_numLandmarks + l] = landmarkDistances[l][i];
+        }
+    }
+}
+
+template<typename BaseVecT>
+bool MeshPathFinder<BaseVecT>::findPath(
+    VertexHandle start,
+    VertexHandle goal,
+    SearchState& state,
+    PathResult& result,
+    float maxCost
+) const
+{
+    return search(&start, &start + 1, goal, state, result, maxCost);
+}
+
+template<typename BaseVecT>
+bool MeshPathFinder<BaseVecT>::findPath(
+    const std::vector<VertexHandle>& starts,
+    VertexHandle goal,
+    SearchState& state,
+    PathResult& result,
+    float maxCost
+) const
+{
+    return search(starts.data(), starts.data() + starts.size(), goal, state, result, maxCost);
+}
+
+template<typename BaseVecT>
+bool MeshPathFinder<BaseVecT>::search(
+    const VertexHandle* first,
+    const VertexHandle* last,
+    VertexHandle goal,
+    SearchState& state,
+    PathResult& result,
+    float maxCost
+) const
+{
+    result.found = false;
+    result.cost = std::numeric_limits<float>::infinity();
+    result.path.clear();
+
+    const size_t numVertices = m_positions.size();
+    if (goal.idx() >= numVertices || m_vertexStates[goal.idx()] == MISSING)
+    {
+        return false;
+    }
+
+    state.reset(numVertices);
+    auto& open = state.m_open;
+
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->idx() >= numVertices || m_vertexStates[it->idx()] == MISSING)
+        {
+            continue;
+        }
+
+        auto& node = state.node(it->idx());
+        node.g = 0;
+        node.h = heuristic(it->idx(), goal.idx());
+        if (node.h <= maxCost)
+        {
+            open.insert(*it, node.h);
+        }
+    }
+
+    // The heuristic is consistent, so a vertex has its final cost when it is
+    // taken from the queue and never has to be opened again.
+    while (!open.isEmpty())
+    {
+        auto current = open.popMin().key().idx();
+        auto& currentNode = state.m_nodes[current];
+        currentNode.closed = state.m_epoch;
+
+        if (current == goal.idx())
+        {
+            result.found = true;
+            result.cost = currentNode.g;
+            for (auto i = current; ; i = state.m_nodes[i].pred)
+            {
+                result.path.push_back(VertexHandle(i));
+                if (state.m_nodes[i].pred == i)
+                {
+                    break;
+                }
+            }
+            std::reverse(result.path.begin(), result.path.end());
+            return true;
+        }
+
+        for (size_t e = m_offsets[current]; e < m_offsets[current + 1]; e++)
+        {
+            auto target = m_targets[e];
+            if (state.isClosed(target))
+            {
+                continue;
+            }
+
+            auto& node = state.node(target);
+            auto g = currentNode.g + m_costs[e];
+            if (g >= node.g)
+            {
+                continue;
+            }
+
+            if (node.h < 0)
+            {
+                node.h = heuristic(target, goal.idx());
+            }
+            auto f = g + node.h;
+            if (f > maxCost)
+            {
+                continue;
+            }
+
+            node.g = g;
+            node.pred = current;
+            open.insert(VertexHandle(target), f);
+        }
+    }
+
+    return false;
+}
+
+template<typename BaseVecT>
+std::vector<typename MeshPathFinder<BaseVecT>::PathResult> MeshPathFinder<BaseVecT>::findPaths(
+    const std::vector<PathQuery>& queries,
+    float maxCost
+)
+{
+    std::vector<PathResult> results(queries.size());
+
+    #pragma omp parallel
+    {
+        auto state = acquireState();
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t i = 0; i < queries.size(); i++)
+        {
+            findPath(queries[i].start, queries[i].goal, *state, results[i], maxCost);
+        }
+
+        releaseState(std::move(state));
+    }
+
+    return results;
+}
+
+template<typename BaseVecT>
+std::unique_ptr<typename MeshPathFinder<BaseVecT>::SearchState> MeshPathFinder<BaseVecT>::acquireState()
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    if (m_statePool.empty())
+    {
+        return std::unique_ptr<SearchState>(new SearchState());
+    }
+    auto state = std::move(m_statePool.back());
+    m_statePool.pop_back();
+    return state;
+}
+
+template<typename BaseVecT>
+void MeshPathFinder<BaseVecT>::releaseState(std::unique_ptr<SearchState> state)
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    m_statePool.push_back(std::move(state));
+}
+
+} // namespace lvr2
@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The triangulation is a port of earcut (https://github.com/mapbox/earcut.hpp),
+ * which is distributed under the following license:
+ *
+ * ISC License
+ *
+ * Copyright (c) 2015, Mapbox
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose
+ * with or without fee is hereby granted, provided that the above copyright notice
+ * and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+ * THIS SOFTWARE.
+ */
+
+
+/*
+ * PolygonTriangulator.hpp
+ */
+
+#ifndef LVR2_ALGORITHM_POLYGONTRIANGULATOR_H_
+#define LVR2_ALGORITHM_POLYGONTRIANGULATOR_H_
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "lvr2/geometry/Handles.hpp"
+#include "lvr2/geometry/Normal.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Triangulates planar polygons with holes by ear clipping.
+ *
+ * The contours are projected onto the plane of the polygon. Holes are
+ * connected to their outer boundary by bridge edges, then ears are clipped
+ * from the resulting simple polygon. A z-order curve speeds up the ear tests
+ * of big polygons. Polygons that are not simple (e.g. self intersecting
+ * contours) are triangulated by curing local intersections and splitting the
+ * polygon as a last resort. No new points are created. The algorithm is
+ * ported from Mapbox's earcut, see the license notice above.
+ *
+ * All state lives in the instance, so different instances can be used by
+ * different threads at the same time. An instance should be reused for
+ * several polygons to avoid allocations.
+ */
+template<typename BaseVecT>
+class PolygonTriangulator
+{
+public:
+    using CoordT = typename BaseVecT::CoordType;
+
+    /**
+     * @brief Triangulates the polygon bounded by the given contours.
+     *
+     * Contours with the orientation of the contour with the largest area are
+     * outer boundaries, all others are holes. Each hole belongs to the
+     * smallest outer boundary containing it. Holes outside of all outer
+     * boundaries are ignored.
+     *
+     * @param contours the closed contours of the polygon
+     * @param normal normal of the plane of the polygon. All triangles are
+     *               oriented counter clockwise around it.
+     * @return three indices per triangle. The index of a point is its
+     *         position in the concatenation of all contours. The reference
+     *         is valid until the next call.
+     */
+    const std::vector<Index>& triangulate(
+        const std::vector<std::vector<BaseVecT>>& contours,
+        const Normal<CoordT>& normal
+    );
+
+private:
+    /// Vertex of a doubly linked polygon ring
+    struct Node
+    {
+        Node(Index i, double x, double y) : i(i), x(x), y(y) {}
+
+        /// Index of the point
+        Index i;
+
+        /// Projected coordinates
+        double x;
+        double y;
+
+        /// Previous and next vertex of the ring
+        Node* prev = nullptr;
+        Node* next = nullptr;
+
+        /// Position on the z-order curve and neighbours in z-order
+        uint32_t z = 0;
+        Node* prevZ = nullptr;
+        Node* nextZ = nullptr;
+
+        /// Whether the node belongs to a hole with only one point
+        bool steiner = false;
+    };
+
+    /// Triangulates one outer boundary with all its holes
+    void triangulateOuter(size_t outer, const std::vector<size_t>& holes);
+
+    /// Creates a ring for the given contour, counter clockwise or clockwise
+    Node* linkedList(size_t contour, bool counterClockwise);
+
+    /// Removes duplicate and collinear points
+    Node* filterPoints(Node* start, Node* end = nullptr);
+
+    /// Clips the ears of the ring, falling back to more expensive passes
+    void earcutLinked(Node* ear, int pass = 0);
+
+    bool isEar(Node* ear) const;
+    bool isEarHashed(Node* ear) const;
+
+    /// Clips local self intersections of the form a-p-p.next-b
+    Node* cureLocalIntersections(Node* start);
+
+    /// Splits the ring at a valid diagonal and triangulates both halves
+    void splitEarcut(Node* start);
+
+    /// Connects all holes to the outer ring
+    Node* eliminateHoles(const std::vector<size_t>& holes, Node* outerNode);
+    Node* eliminateHole(Node* hole, Node* outerNode);
+    Node* findHoleBridge(Node* hole, Node* outerNode) const;
+
+    /// Sorts the ring in z-order
+    void indexCurve(Node* start) const;
+    Node* sortLinked(Node* list) const;
+    uint32_t zOrder(double x, double y) const;
+
+    Node* getLeftmost(Node* start) const;
+    bool isValidDiagonal(Node* a, Node* b) const;
+    bool intersectsPolygon(const Node* a, const Node* b) const;
+    bool locallyInside(const Node* a, const Node* b) const;
+    bool middleInside(const Node* a, const Node* b) const;
+
+    /// Connects the rings of a and b by duplicating both, returns the copy of b
+    Node* splitPolygon(Node* a, Node* b);
+
+    Node* insertNode(Index i, double x, double y, Node* last);
+    void removeNode(Node* p);
+
+    /// Twice the signed area of the triangle, positive if it is clockwise
+    static double area(const Node* p, const Node* q, const Node* r);
+    static bool equals(const Node* a, const Node* b);
+    static bool intersects(const Node* p1, const Node* q1, const Node* p2, const Node* q2);
+    static bool onSegment(const Node* p, const Node* q, const Node* r);
+    static bool sectorContainsSector(const Node* m, const Node* p);
+    static bool pointInTriangle(
+        double ax, double ay,
+        double bx, double by,
+        double cx, double cy,
+        double px, double py
+    );
+
+    /// Projected points of all contours
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+
+    /// Start of each contour in the point arrays, and the total number of points
+    std::vector<size_t> m_offsets;
+
+    /// All nodes of the current polygon. A deque doesn't move its elements.
+    std::deque<Node> m_nodes;
+
+    /// Three point indices per triangle
+    std::vector<Index> m_triangles;
+
+    /// Transformation of the current outer boundary into the z-order grid
+    bool m_hashing;
+    double m_minX;
+    double m_minY;
+    double m_invSize;
+};
+
+} // namespace lvr2
+
+#include "lvr2/algorithm/PolygonTriangulator.tcc"
+
+#endif /* LVR2_ALGORITHM_POLYGONTRIANGULATOR_H_ */
@@ -0,0 +1,979 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The triangulation is a port of earcut (https://github.com/mapbox/earcut.hpp),
+ * which is distributed under the following license:
+ *
+ * ISC License
+ *
+ * Copyright (c) 2015, Mapbox
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose
+ * with or without fee is hereby granted, provided that the above copyright notice
+ * and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+ * REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF
+ * THIS SOFTWARE.
+ */
+
+
+/*
+ * PolygonTriangulator.tcc
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lvr2
+{
+
+template<typename BaseVecT>
+const std::vector<Index>& PolygonTriangulator<BaseVecT>::triangulate(
+    const std::vector<std::vector<BaseVecT>>& contours,
+    const Normal<CoordT>& normal
+)
+{
+    m_nodes.clear();
+    m_triangles.clear();
+    m_x.clear();
+    m_y.clear();
+    m_offsets.clear();
+
+    // Find a basis (u, v) of the plane with u x v = normal. Thus triangles
+    // which are counter clockwise in the plane are counter clockwise around
+    // the normal.
+    const double nx = normal.x;
+    const double ny = normal.y;
+    const double nz = normal.z;
+    double ux, uy, uz;
+    if (std::abs(nx) > 0.9)
+    {
+        // u = (0, 1, 0) x n
+        ux = nz;
+        uy = 0;
+        uz = -nx;
+    }
+    else
+    {
+        // u = (1, 0, 0) x n
+        ux = 0;
+        uy = -nz;
+        uz = ny;
+    }
+    const double uLength = std::sqrt(ux * ux + uy * uy + uz * uz);
+    ux /= uLength;
+    uy /= uLength;
+    uz /= uLength;
+    const double vx = ny * uz - nz * uy;
+    const double vy = nz * ux - nx * uz;
+    const double vz = nx * uy - ny * ux;
+
+    // Project all points and calculate the signed area of each contour
+    std::vector<double> areas(contours.size());
+    size_t largest = 0;
+    for (size_t c = 0; c < contours.size(); c++)
+    {
+        m_offsets.push_back(m_x.size());
+        for (auto& p: contours[c])
+        {
+            m_x.push_back(p.x * ux + p.y * uy + p.z * uz);
+            m_y.push_back(p.x * vx + p.y * vy + p.z * vz);
+        }
+
+        double sum = 0;
+        const size_t begin = m_offsets[c];
+        const size_t end = m_x.size();
+        for (size_t i = begin, j = end - 1; i < end; j = i++)
+        {
+            sum += (m_x[j] - m_x[i]) * (m_y[i] + m_y[j]);
+        }
+        areas[c] = sum / 2;
+
+        if (std::abs(areas[c]) > std::abs(areas[largest]))
+        {
+            largest = c;
+        }
+    }
+    m_offsets.push_back(m_x.size());
+
+    if (contours.empty() || m_x.size() > std::numeric_limits<Index>::max())
+    {
+        return m_triangles;
+    }
+
+    // Contours oriented like the largest one are outer boundaries
+    std::vector<size_t> outers;
+    std::vector<size_t> holes;
+    for (size_t c = 0; c < contours.size(); c++)
+    {
+        if (contours[c].empty())
+        {
+            continue;
+        }
+        if ((areas[c] > 0) == (areas[largest] > 0))
+        {
+            outers.push_back(c);
+        }
+        else
+        {
+            holes.push_back(c);
+        }
+    }
+
+    if (outers.size() == 1)
+    {
+        triangulateOuter(outers[0], holes);
+        return m_triangles;
+    }
+
+    // Assign each hole to the smallest outer boundary containing its first point
+    std::vector<std::vector<size_t>> holesOfOuter(outers.size());
+    for (auto hole: holes)
+    {
+        const double px = m_x[m_offsets[hole]];
+        const double py = m_y[m_offsets[hole]];
+
+        size_t best = outers.size();
+        for (size_t o = 0; o < outers.size(); o++)
+        {
+            const size_t begin = m_offsets[outers[o]];
+            const size_t end = m_offsets[outers[o] + 1];
+            bool inside = false;
+            for (size_t i = begin, j = end - 1; i < end; j = i++)
+            {
+                if ((m_y[i] > py) != (m_y[j] > py)
+                    && px < (m_x[j] - m_x[i]) * (py - m_y[i]) / (m_y[j] - m_y[i]) + m_x[i])
+                {
+                    inside = !inside;
+                }
+            }
+
+            if (inside && (best == outers.size()
+                || std::abs(areas[outers[o]]) < std::abs(areas[outers[best]])))
+            {
+                best = o;
+            }
+        }
+
+        if (best != outers.size())
+        {
+            holesOfOuter[best].push_back(hole);
+        }
+    }
+
+    for (size_t o = 0; o < outers.size(); o++)
+    {
+        triangulateOuter(outers[o], holesOfOuter[o]);
+    }
+
+    return m_triangles;
+}
+
+template<typename BaseVecT>
+void PolygonTriangulator<BaseVecT>::triangulateOuter(size_t outer, const std::vector<size_t>& holes)
+{
+    Node* outerNode = linkedList(outer, true);
+    if (!outerNode || outerNode->next == outerNode->prev)
+    {
+        return;
+    }
+
+    if (!holes.empty())
+    {
+        outerNode = eliminateHoles(holes, outerNode);
+    }
+
+    // Use the z-order curve for big polygons only
+    size_t numPoints = m_offsets[outer + 1] - m_offsets[outer];
+    for (auto hole: holes)
+    {
+        numPoints += m_offsets[hole + 1] - m_offsets[hole];
+    }
+
+    m_hashing = numPoints > 80;
+    if (m_hashing)
+    {
+        m_minX = std::numeric_limits<double>::infinity();
+        m_minY = std::numeric_limits<double>::infinity();
+        double maxX = -std::numeric_limits<double>::infinity();
+        double maxY = -std::numeric_limits<double>::infinity();
+        auto extend = [&](size_t contour)
+        {
+            for (size_t i = m_offsets[contour]; i < m_offsets[contour + 1]; i++)
+            {
+                m_minX = std::min(m_minX, m_x[i]);
+                m_minY = std::min(m_minY, m_y[i]);
+                maxX = std::max(maxX, m_x[i]);
+                maxY = std::max(maxY, m_y[i]);
+            }
+        };
+        extend(outer);
+        for (auto hole: holes)
+        {
+            extend(hole);
+        }
+
+        // The coordinates are scaled to fit into 15 bit
+        m_invSize = std::max(maxX - m_minX, maxY - m_minY);
+        m_invSize = m_invSize != 0 ? 32767 / m_invSize : 0;
+    }
+
+    earcutLinked(outerNode);
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::linkedList(size_t contour, bool counterClockwise)
+{
+    const size_t begin = m_offsets[contour];
+    const size_t end = m_offsets[contour + 1];
+
+    double sum = 0;
+    for (size_t i = begin, j = end - 1; i < end; j = i++)
+    {
+        sum += (m_x[j] - m_x[i]) * (m_y[i] + m_y[j]);
+    }
+
+    // The sum is positive for counter clockwise contours
+    Node* last = nullptr;
+    if (counterClockwise == (sum > 0))
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            last = insertNode(i, m_x[i], m_y[i], last);
+        }
+    }
+    else
+    {
+        for (size_t i = end; i-- > begin; )
+        {
+            last = insertNode(i, m_x[i], m_y[i], last);
+        }
+    }
+
+    if (last && equals(last, last->next))
+    {
+        removeNode(last);
+        last = last->next;
+    }
+
+    return last;
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::filterPoints(Node* start, Node* end)
+{
+    if (!start)
+    {
+        return start;
+    }
+    if (!end)
+    {
+        end = start;
+    }
+
+    Node* p = start;
+    bool again;
+    do
+    {
+        again = false;
+
+        if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0))
+        {
+            removeNode(p);
+            p = end = p->prev;
+
+            if (p == p->next)
+            {
+                break;
+            }
+            again = true;
+        }
+        else
+        {
+            p = p->next;
+        }
+    } while (again || p != end);
+
+    return end;
+}
+
+template<typename BaseVecT>
+void PolygonTriangulator<BaseVecT>::earcutLinked(Node* ear, int pass)
+{
+    if (!ear)
+    {
+        return;
+    }
+
+    if (!pass && m_hashing)
+    {
+        indexCurve(ear);
+    }
+
+    Node* stop = ear;
+
+    // Iterate through ears, slicing them one by one
+    while (ear->prev != ear->next)
+    {
+        Node* prev = ear->prev;
+        Node* next = ear->next;
+
+        if (m_hashing ? isEarHashed(ear) : isEar(ear))
+        {
+            m_triangles.push_back(prev->i);
+            m_triangles.push_back(ear->i);
+            m_triangles.push_back(next->i);
+
+            removeNode(ear);
+
+            // Skipping the next vertex leads to less sliver triangles
+            ear = next->next;
+            stop = next->next;
+
+            continue;
+        }
+
+        ear = next;
+
+        // If we looped through the whole remaining polygon and can't find any
+        // more ears, try the more expensive passes
+        if (ear == stop)
+        {
+            if (!pass)
+            {
+                earcutLinked(filterPoints(ear), 1);
+            }
+            else if (pass == 1)
+            {
+                ear = cureLocalIntersections(filterPoints(ear));
+                earcutLinked(ear, 2);
+            }
+            else if (pass == 2)
+            {
+                splitEarcut(ear);
+            }
+
+            break;
+        }
+    }
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::isEar(Node* ear) const
+{
+    const Node* a = ear->prev;
+    const Node* b = ear;
+    const Node* c = ear->next;
+
+    // Reflex, can't be an ear
+    if (area(a, b, c) >= 0)
+    {
+        return false;
+    }
+
+    // Now make sure we don't have other points inside the potential ear
+    Node* p = ear->next->next;
+    while (p != ear->prev)
+    {
+        if (pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y)
+            && area(p->prev, p, p->next) >= 0)
+        {
+            return false;
+        }
+        p = p->next;
+    }
+
+    return true;
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::isEarHashed(Node* ear) const
+{
+    const Node* a = ear->prev;
+    const Node* b = ear;
+    const Node* c = ear->next;
+
+    if (area(a, b, c) >= 0)
+    {
+        return false;
+    }
+
+    // Bounding box of the triangle
+    const double minTX = std::min({a->x, b->x, c->x});
+    const double minTY = std::min({a->y, b->y, c->y});
+    const double maxTX = std::max({a->x, b->x, c->x});
+    const double maxTY = std::max({a->y, b->y, c->y});
+
+    // z-order range of the bounding box
+    const uint32_t minZ = zOrder(minTX, minTY);
+    const uint32_t maxZ = zOrder(maxTX, maxTY);
+
+    auto blocks = [&](const Node* p)
+    {
+        return p != ear->prev && p != ear->next
+            && pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y)
+            && area(p->prev, p, p->next) >= 0;
+    };
+
+    // Look for points inside the triangle in both directions
+    const Node* p = ear->prevZ;
+    const Node* n = ear->nextZ;
+    while (p && p->z >= minZ && n && n->z <= maxZ)
+    {
+        if (blocks(p))
+        {
+            return false;
+        }
+        p = p->prevZ;
+
+        if (blocks(n))
+        {
+            return false;
+        }
+        n = n->nextZ;
+    }
+
+    // Look for remaining points in decreasing z-order
+    while (p && p->z >= minZ)
+    {
+        if (blocks(p))
+        {
+            return false;
+        }
+        p = p->prevZ;
+    }
+
+    // Look for remaining points in increasing z-order
+    while (n && n->z <= maxZ)
+    {
+        if (blocks(n))
+        {
+            return false;
+        }
+        n = n->nextZ;
+    }
+
+    return true;
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::cureLocalIntersections(Node* start)
+{
+    Node* p = start;
+    do
+    {
+        Node* a = p->prev;
+        Node* b = p->next->next;
+
+        // a self-intersection where edge (p.prev, p) intersects (p.next, p.next.next)
+        if (!equals(a, b) && intersects(a, p, p->next, b) && locallyInside(a, b) && locallyInside(b, a))
+        {
+            m_triangles.push_back(a->i);
+            m_triangles.push_back(p->i);
+            m_triangles.push_back(b->i);
+
+            // Remove two nodes involved
+            removeNode(p);
+            removeNode(p->next);
+
+            p = start = b;
+        }
+        p = p->next;
+    } while (p != start);
+
+    return filterPoints(p);
+}
+
+template<typename BaseVecT>
+void PolygonTriangulator<BaseVecT>::splitEarcut(Node* start)
+{
+    // Look for a valid diagonal that divides the polygon into two
+    Node* a = start;
+    do
+    {
+        Node* b = a->next->next;
+        while (b != a->prev)
+        {
+            if (a->i != b->i && isValidDiagonal(a, b))
+            {
+                // Split the polygon in two by the diagonal
+                Node* c = splitPolygon(a, b);
+
+                // Filter colinear points around the cuts
+                a = filterPoints(a, a->next);
+                c = filterPoints(c, c->next);
+
+                // Run earcut on each half
+                earcutLinked(a);
+                earcutLinked(c);
+                return;
+            }
+            b = b->next;
+        }
+        a = a->next;
+    } while (a != start);
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::eliminateHoles(const std::vector<size_t>& holes, Node* outerNode)
+{
+    std::vector<Node*> queue;
+    for (auto hole: holes)
+    {
+        Node* list = linkedList(hole, false);
+        if (list)
+        {
+            if (list == list->next)
+            {
+                list->steiner = true;
+            }
+            queue.push_back(getLeftmost(list));
+        }
+    }
+
+    std::sort(queue.begin(), queue.end(), [](const Node* a, const Node* b)
+    {
+        return a->x < b->x;
+    });
+
+    // Process holes from left to right
+    for (auto hole: queue)
+    {
+        outerNode = eliminateHole(hole, outerNode);
+    }
+
+    return outerNode;
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::eliminateHole(Node* hole, Node* outerNode)
+{
+    Node* bridge = findHoleBridge(hole, outerNode);
+    if (!bridge)
+    {
+        return outerNode;
+    }
+
+    Node* bridgeReverse = splitPolygon(bridge, hole);
+
+    // Filter collinear points around the cuts
+    filterPoints(bridgeReverse, bridgeReverse->next);
+    return filterPoints(bridge, bridge->next);
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::findHoleBridge(Node* hole, Node* outerNode) const
+{
+    Node* p = outerNode;
+    const double hx = hole->x;
+    const double hy = hole->y;
+    double qx = -std::numeric_limits<double>::infinity();
+    Node* m = nullptr;
+
+    // Find a segment intersected by a ray from the hole's leftmost point to
+    // the left. The segment's endpoint with lesser x will be the potential
+    // connection point.
+    do
+    {
+        if (hy <= p->y && hy >= p->next->y && p->next->y != p->y)
+        {
+            double x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+            if (x <= hx && x > qx)
+            {
+                qx = x;
+                m = p->x < p->next->x ? p : p->next;
+                if (x == hx)
+                {
+                    // The hole touches the outer segment, pick the leftmost endpoint
+                    return m;
+                }
+            }
+        }
+        p = p->next;
+    } while (p != outerNode);
+
+    if (!m)
+    {
+        return nullptr;
+    }
+
+    // Look for points inside the triangle of the hole point, the segment
+    // intersection and the endpoint. If there are none, the endpoint is
+    // visible. Otherwise choose the point with the minimum angle to the ray
+    // as connection point.
+    const Node* stop = m;
+    const double mx = m->x;
+    const double my = m->y;
+    double tanMin = std::numeric_limits<double>::infinity();
+
+    p = m;
+    do
+    {
+        if (hx >= p->x && p->x >= mx && hx != p->x
+            && pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y))
+        {
+            const double tanCur = std::abs(hy - p->y) / (hx - p->x);
+
+            if (locallyInside(p, hole)
+                && (tanCur < tanMin
+                    || (tanCur == tanMin && (p->x > m->x || (p->x == m->x && sectorContainsSector(m, p))))))
+            {
+                m = p;
+                tanMin = tanCur;
+            }
+        }
+        p = p->next;
+    } while (p != stop);
+
+    return m;
+}
+
+template<typename BaseVecT>
+void PolygonTriangulator<BaseVecT>::indexCurve(Node* start) const
+{
+    Node* p = start;
+    do
+    {
+        p->z = p->z ? p->z : zOrder(p->x, p->y);
+        p->prevZ = p->prev;
+        p->nextZ = p->next;
+        p = p->next;
+    } while (p != start);
+
+    p->prevZ->nextZ = nullptr;
+    p->prevZ = nullptr;
+
+    sortLinked(p);
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::sortLinked(Node* list) const
+{
+    // Bottom up merge sort of the z-order list
+    size_t inSize = 1;
+    size_t numMerges;
+    do
+    {
+        Node* p = list;
+        Node* tail = nullptr;
+        list = nullptr;
+        numMerges = 0;
+
+        while (p)
+        {
+            numMerges++;
+            Node* q = p;
+            size_t pSize = 0;
+            for (size_t i = 0; i < inSize; i++)
+            {
+                pSize++;
+                q = q->nextZ;
+                if (!q)
+                {
+                    break;
+                }
+            }
+
+            size_t qSize = inSize;
+            while (pSize > 0 || (qSize > 0 && q))
+            {
+                Node* e;
+                if (pSize != 0 && (qSize == 0 || !q || p->z <= q->z))
+                {
+                    e = p;
+                    p = p->nextZ;
+                    pSize--;
+                }
+                else
+                {
+                    e = q;
+                    q = q->nextZ;
+                    qSize--;
+                }
+
+                if (tail)
+                {
+                    tail->nextZ = e;
+                }
+                else
+                {
+                    list = e;
+                }
+
+                e->prevZ = tail;
+                tail = e;
+            }
+
+            p = q;
+        }
+
+        tail->nextZ = nullptr;
+        inSize *= 2;
+    } while (numMerges > 1);
+
+    return list;
+}
+
+template<typename BaseVecT>
+uint32_t PolygonTriangulator<BaseVecT>::zOrder(double x, double y) const
+{
+    // Coords are transformed into non-negative 15 bit integer range
+    uint32_t ix = static_cast<uint32_t>((x - m_minX) * m_invSize);
+    uint32_t iy = static_cast<uint32_t>((y - m_minY) * m_invSize);
+
+    // Interleave the bits
+    ix = (ix | (ix << 8)) & 0x00FF00FF;
+    ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+    ix = (ix | (ix << 2)) & 0x33333333;
+    ix = (ix | (ix << 1)) & 0x55555555;
+
+    iy = (iy | (iy << 8)) & 0x00FF00FF;
+    iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+    iy = (iy | (iy << 2)) & 0x33333333;
+    iy = (iy | (iy << 1)) & 0x55555555;
+
+    return ix | (iy << 1);
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::getLeftmost(Node* start) const
+{
+    Node* p = start;
+    Node* leftmost = start;
+    do
+    {
+        if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y))
+        {
+            leftmost = p;
+        }
+        p = p->next;
+    } while (p != start);
+
+    return leftmost;
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::isValidDiagonal(Node* a, Node* b) const
+{
+    // The diagonal doesn't intersect any edge, is locally visible and its
+    // middle is inside of the polygon. Or it connects two equal points of
+    // touching rings.
+    return a->next->i != b->i && a->prev->i != b->i && !intersectsPolygon(a, b)
+        && ((locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b)
+                && (area(a->prev, a, b->prev) != 0 || area(a, b->prev, b) != 0))
+            || (equals(a, b) && area(a->prev, a, a->next) > 0 && area(b->prev, b, b->next) > 0));
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::intersectsPolygon(const Node* a, const Node* b) const
+{
+    const Node* p = a;
+    do
+    {
+        if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i
+            && intersects(p, p->next, a, b))
+        {
+            return true;
+        }
+        p = p->next;
+    } while (p != a);
+
+    return false;
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::locallyInside(const Node* a, const Node* b) const
+{
+    return area(a->prev, a, a->next) < 0
+        ? area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0
+        : area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::middleInside(const Node* a, const Node* b) const
+{
+    const Node* p = a;
+    bool inside = false;
+    const double px = (a->x + b->x) / 2;
+    const double py = (a->y + b->y) / 2;
+    do
+    {
+        if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y
+            && (px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x))
+        {
+            inside = !inside;
+        }
+        p = p->next;
+    } while (p != a);
+
+    return inside;
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::splitPolygon(Node* a, Node* b)
+{
+    m_nodes.emplace_back(a->i, a->x, a->y);
+    Node* a2 = &m_nodes.back();
+    m_nodes.emplace_back(b->i, b->x, b->y);
+    Node* b2 = &m_nodes.back();
+    Node* an = a->next;
+    Node* bp = b->prev;
+
+    a->next = b;
+    b->prev = a;
+
+    a2->next = an;
+    an->prev = a2;
+
+    b2->next = a2;
+    a2->prev = b2;
+
+    bp->next = b2;
+    b2->prev = bp;
+
+    return b2;
+}
+
+template<typename BaseVecT>
+typename PolygonTriangulator<BaseVecT>::Node*
+PolygonTriangulator<BaseVecT>::insertNode(Index i, double x, double y, Node* last)
+{
+    m_nodes.emplace_back(i, x, y);
+    Node* p = &m_nodes.back();
+
+    if (!last)
+    {
+        p->prev = p;
+        p->next = p;
+    }
+    else
+    {
+        p->next = last->next;
+        p->prev = last;
+        last->next->prev = p;
+        last->next = p;
+    }
+    return p;
+}
+
+template<typename BaseVecT>
+void PolygonTriangulator<BaseVecT>::removeNode(Node* p)
+{
+    p->next->prev = p->prev;
+    p->prev->next = p->next;
+
+    if (p->prevZ)
+    {
+        p->prevZ->nextZ = p->nextZ;
+    }
+    if (p->nextZ)
+    {
+        p->nextZ->prevZ = p->prevZ;
+    }
+}
+
+template<typename BaseVecT>
+double PolygonTriangulator<BaseVecT>::area(const Node* p, const Node* q, const Node* r)
+{
+    return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::equals(const Node* a, const Node* b)
+{
+    return a->x == b->x && a->y == b->y;
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::intersects(const Node* p1, const Node* q1, const Node* p2, const Node* q2)
+{
+    auto sign = [](double v)
+    {
+        return (v > 0) - (v < 0);
+    };
+
+    const int o1 = sign(area(p1, q1, p2));
+    const int o2 = sign(area(p1, q1, q2));
+    const int o3 = sign(area(p2, q2, p1));
+    const int o4 = sign(area(p2, q2, q1));
+
+    // General case
+    if (o1 != o2 && o3 != o4)
+    {
+        return true;
+    }
+
+    // Collinear points lying on the other segment
+    return (o1 == 0 && onSegment(p1, p2, q1))
+        || (o2 == 0 && onSegment(p1, q2, q1))
+        || (o3 == 0 && onSegment(p2, p1, q2))
+        || (o4 == 0 && onSegment(p2, q1, q2));
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::onSegment(const Node* p, const Node* q, const Node* r)
+{
+    return q->x <= std::max(p->x, r->x) && q->x >= std::min(p->x, r->x)
+        && q->y <= std::max(p->y, r->y) && q->y >= std::min(p->y, r->y);
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::sectorContainsSector(const Node* m, const Node* p)
+{
+    return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0;
+}
+
+template<typename BaseVecT>
+bool PolygonTriangulator<BaseVecT>::pointInTriangle(
+    double ax, double ay,
+    double bx, double by,
+    double cx, double cy,
+    double px, double py
+)
+{
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py)
+        && (ax - px) * (by - py) >= (bx - px) * (ay - py)
+        && (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+} // namespace lvr2
@@ -88,6 +88,39 @@ size_t simpleMeshReduction(
     FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
 );
 
+/**
+ * @brief Collapses `count` edges of `mesh` guided by quadric error metrics.
+ *
+ * Each vertex stores the quadric of the planes of its adjacent faces. An
+ * edge is collapsed into the point minimizing the error of the sum of the
+ * quadrics of both of its vertices, which is then the quadric of the new
+ * vertex. Boundary edges are not collapsed and boundary vertices are kept on
+ * the boundary by additional planes. Collapses that would flip faces are
+ * rejected. For details see:
+ *
+ * Garland, Michael, and Paul S. Heckbert. "Surface simplification using
+ * quadric error metrics." SIGGRAPH 1997.
+ *
+ * The collapses are done in rounds. Each round takes the cheapest edges from
+ * a queue, as long as none of their vertices is a neighbour of a vertex of an
+ * edge already chosen in this round. These collapses don't influence each
+ * other, so the costs of all edges touched by a round can be recomputed in
+ * parallel afterwards.
+ *
+ * @param[in] count Number of edges to collapse
+ * @param[in, out] faceNormals A face map storing valid normals of all faces in
+ *                             the mesh. This map is altered by this algorithm
+ *                             according to the changes done in the mesh.
+ *
+ * @return The number of edges actually collapsed.
+ */
+template<typename BaseVecT>
+size_t quadricMeshReduction(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
+);
+
 } // namespace lvr2
 
 #include "lvr2/algorithm/ReductionAlgorithms.tcc"
@@ -30,11 +30,14 @@
  */
 
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/algorithm/NormalAlgorithms.hpp"
 #include "lvr2/geometry/Handles.hpp"
+#include "lvr2/geometry/Quadric.hpp"
+#include "lvr2/util/DenseMeap.hpp"
 #include "lvr2/util/Meap.hpp"
 
 using std::unordered_set;
@@ -92,7 +95,7 @@ size_t iterativeEdgeCollapse(
 
     std::cout << timestamp << "Reduce mesh by collapsing " << count << " edges" << std::endl;
 
-    Meap<VertexHandle, float> queue(mesh.nextVertexIndex());
+    DenseMeap<VertexHandle, float> queue(mesh.nextVertexIndex());
     DenseVertexMap<VertexHandle> bestEdge;
     bestEdge.reserve(mesh.nextVertexIndex());
 
@@ -356,4 +359,337 @@ size_t simpleMeshReduction(
     });
 }
 
+template<typename BaseVecT>
+size_t quadricMeshReduction(
+    BaseMesh<BaseVecT>& mesh,
+    const size_t count,
+    FaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals
+)
+{
+    using CostAndPos = boost::optional<std::pair<float, BaseVecT>>;
+
+    // The minimal value of the dot product between the normal of a face
+    // before and after a collapse.
+    const float MIN_NORMAL_DOT = 0.5;
+
+    // Weight of the planes that keep boundary vertices on the boundary
+    const double BOUNDARY_WEIGHT = 1000.0;
+
+    std::cout << timestamp << "Reduce mesh by collapsing " << count << " edges (QEM)" << std::endl;
+
+    const auto& constFaceNormals = faceNormals;
+
+    vector<VertexHandle> vertices;
+    vertices.reserve(mesh.numVertices());
+    for (auto vH: mesh.vertices())
+    {
+        vertices.push_back(vH);
+    }
+
+    // Calculate the quadric of each vertex. The map is filled completely
+    // beforehand, so that the threads only modify existing values.
+    DenseVertexMap<Quadric<BaseVecT>> quadrics;
+    quadrics.reserve(mesh.nextVertexIndex());
+    for (auto vH: vertices)
+    {
+        quadrics.insert(vH, Quadric<BaseVecT>());
+    }
+
+    #pragma omp parallel
+    {
+        vector<FaceHandle> faces;
+        vector<EdgeHandle> edges;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            auto vH = vertices[i];
+            auto& quadric = quadrics[vH];
+
+            faces.clear();
+            mesh.getFacesOfVertex(vH, faces);
+            for (auto fH: faces)
+            {
+                Plane<BaseVecT> plane;
+                plane.normal = constFaceNormals[fH];
+                plane.pos = mesh.getVertexPosition(vH);
+                quadric += Quadric<BaseVecT>(plane);
+            }
+
+            // Add a plane perpendicular to the face for each boundary edge
+            edges.clear();
+            mesh.getEdgesOfVertex(vH, edges);
+            for (auto eH: edges)
+            {
+                auto adjacentFaces = mesh.getFacesOfEdge(eH);
+                if (adjacentFaces[0] && adjacentFaces[1])
+                {
+                    continue;
+                }
+                auto fH = adjacentFaces[0] ? adjacentFaces[0].unwrap() : adjacentFaces[1].unwrap();
+                auto edgeVertices = mesh.getVerticesOfEdge(eH);
+                auto dir = mesh.getVertexPosition(edgeVertices[1]) - mesh.getVertexPosition(edgeVertices[0]);
+                auto normal = dir.cross(constFaceNormals[fH]);
+                if (normal.length2() == 0)
+                {
+                    continue;
+                }
+
+                Plane<BaseVecT> plane;
+                plane.normal = normal.normalized();
+                plane.pos = mesh.getVertexPosition(vH);
+                quadric += Quadric<BaseVecT>(plane, BOUNDARY_WEIGHT);
+            }
+        }
+    }
+
+    // Returns the cost of collapsing the edge and the position of the
+    // remaining vertex, or none if the edge cannot be collapsed. This
+    // only reads from the mesh and thus can be called in parallel.
+    auto evaluate = [&](EdgeHandle eH, vector<FaceHandle>& faces) -> CostAndPos
+    {
+        auto adjacentFaces = mesh.getFacesOfEdge(eH);
+        if (!adjacentFaces[0] || !adjacentFaces[1])
+        {
+            return boost::none;
+        }
+
+        auto edgeVertices = mesh.getVerticesOfEdge(eH);
+        auto quadric = quadrics[edgeVertices[0]] + quadrics[edgeVertices[1]];
+
+        // Use the optimal position if it exists. Otherwise take the best of
+        // both vertices and the midpoint.
+        auto maybePos = quadric.optimum();
+        BaseVecT pos;
+        if (maybePos)
+        {
+            pos = *maybePos;
+        }
+        else
+        {
+            auto p0 = mesh.getVertexPosition(edgeVertices[0]);
+            auto p1 = mesh.getVertexPosition(edgeVertices[1]);
+            auto mid = (p0 + p1) / 2;
+
+            pos = mid;
+            if (quadric.error(p0) < quadric.error(pos))
+            {
+                pos = p0;
+            }
+            if (quadric.error(p1) < quadric.error(pos))
+            {
+                pos = p1;
+            }
+        }
+
+        // Check that the faces which remain after the collapse don't flip
+        for (auto vH: edgeVertices)
+        {
+            faces.clear();
+            mesh.getFacesOfVertex(vH, faces);
+            for (auto fH: faces)
+            {
+                if (fH == adjacentFaces[0].unwrap() || fH == adjacentFaces[1].unwrap())
+                {
+                    continue;
+                }
+
+                auto faceVertices = mesh.getVerticesOfFace(fH);
+                auto positions = mesh.getVertexPositionsOfFace(fH);
+                for (size_t j = 0; j < 3; j++)
+                {
+                    if (faceVertices[j] == vH)
+                    {
+                        positions[j] = pos;
+                    }
+                }
+
+                auto newNormal = getFaceNormal(positions);
+                if (!newNormal || newNormal->dot(constFaceNormals[fH]) < MIN_NORMAL_DOT)
+                {
+                    return boost::none;
+                }
+            }
+        }
+
+        return std::make_pair(static_cast<float>(std::max(quadric.error(pos), 0.0)), pos);
+    };
+
+    DenseMeap<EdgeHandle, float> queue(mesh.nextEdgeIndex());
+    DenseEdgeMap<BaseVecT> bestPos(mesh.nextEdgeIndex(), BaseVecT());
+
+    // Evaluates all given edges in parallel and updates the queue
+    vector<CostAndPos> results;
+    auto updateEdges = [&](const vector<EdgeHandle>& edges)
+    {
+        results.resize(edges.size());
+
+        #pragma omp parallel
+        {
+            vector<FaceHandle> faces;
+
+            #pragma omp for schedule(dynamic, 64)
+            for (size_t i = 0; i < edges.size(); i++)
+            {
+                results[i] = evaluate(edges[i], faces);
+            }
+        }
+
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            if (results[i])
+            {
+                queue.insert(edges[i], results[i]->first);
+                bestPos[edges[i]] = results[i]->second;
+            }
+            else
+            {
+                queue.erase(edges[i]);
+            }
+        }
+    };
+
+    vector<EdgeHandle> dirtyEdges;
+    dirtyEdges.reserve(mesh.numEdges());
+    for (auto eH: mesh.edges())
+    {
+        dirtyEdges.push_back(eH);
+    }
+    updateEdges(dirtyEdges);
+
+    string msg = timestamp.getElapsedTime()
+        + "Collapsing up to "
+        + std::to_string(count)
+        + " of the edges ";
+    ProgressBar progress(count + 1, msg);
+    ++progress;
+
+    // The round in which a vertex was last locked and an edge was last
+    // marked as dirty. Using round numbers avoids clearing the maps.
+    DenseVertexMap<size_t> lockedInRound(mesh.nextVertexIndex(), 0);
+    DenseEdgeMap<size_t> dirtyInRound(mesh.nextEdgeIndex(), 0);
+
+    vector<EdgeHandle> batch;
+    vector<MeapPair<EdgeHandle, float>> deferred;
+    vector<VertexHandle> neighbours;
+    vector<VertexHandle> midpoints;
+    vector<FaceHandle> faces;
+    vector<EdgeHandle> edges;
+
+    size_t collapsedEdgeCount = 0;
+    size_t round = 0;
+    while (collapsedEdgeCount < count && !queue.isEmpty())
+    {
+        round++;
+        batch.clear();
+        deferred.clear();
+
+        // Choose the cheapest edges which are independent of each other. The
+        // round ends early if most edges are blocked, to keep the order of
+        // the collapses close to the order of their costs.
+        while (!queue.isEmpty()
+            && collapsedEdgeCount + batch.size() < count
+            && deferred.size() <= batch.size())
+        {
+            auto candidate = queue.popMin();
+            auto edgeVertices = mesh.getVerticesOfEdge(candidate.key());
+            if (lockedInRound[edgeVertices[0]] == round || lockedInRound[edgeVertices[1]] == round)
+            {
+                deferred.push_back(candidate);
+                continue;
+            }
+
+            // If we can't collapse this edge, we will just ignore it until
+            // its neighbourhood changes.
+            if (!mesh.isCollapsable(candidate.key()))
+            {
+                continue;
+            }
+
+            batch.push_back(candidate.key());
+            for (auto vH: edgeVertices)
+            {
+                lockedInRound[vH] = round;
+                neighbours.clear();
+                mesh.getNeighboursOfVertex(vH, neighbours);
+                for (auto neighbourH: neighbours)
+                {
+                    lockedInRound[neighbourH] = round;
+                }
+            }
+        }
+
+        for (auto& entry: deferred)
+        {
+            queue.insert(entry.key(), entry.value());
+        }
+
+        // Collapse the chosen edges
+        midpoints.clear();
+        for (auto eH: batch)
+        {
+            auto edgeVertices = mesh.getVerticesOfEdge(eH);
+            auto quadric = quadrics[edgeVertices[0]] + quadrics[edgeVertices[1]];
+            auto pos = bestPos[eH];
+
+            auto result = mesh.collapseEdge(eH);
+            ++progress;
+            collapsedEdgeCount++;
+
+            mesh.getVertexPosition(result.midPoint) = pos;
+            quadrics[result.midPoint] = quadric;
+            midpoints.push_back(result.midPoint);
+
+            for (auto neighbor: result.neighbors)
+            {
+                if (neighbor)
+                {
+                    faceNormals.erase(neighbor->removedFace);
+                    queue.erase(neighbor->removedEdges[0]);
+                    queue.erase(neighbor->removedEdges[1]);
+                }
+            }
+        }
+
+        // Update the normals of all faces around the new vertices and collect
+        // all edges whose costs have changed: the edges of the new vertices
+        // and of their neighbours.
+        dirtyEdges.clear();
+        for (auto midH: midpoints)
+        {
+            faces.clear();
+            mesh.getFacesOfVertex(midH, faces);
+            for (auto fH: faces)
+            {
+                auto maybeNormal = getFaceNormal(mesh.getVertexPositionsOfFace(fH));
+                faceNormals[fH] = maybeNormal
+                    ? *maybeNormal
+                    : Normal<typename BaseVecT::CoordType>(0, 0, 1);
+            }
+
+            neighbours.clear();
+            mesh.getNeighboursOfVertex(midH, neighbours);
+            neighbours.push_back(midH);
+            for (auto vH: neighbours)
+            {
+                edges.clear();
+                mesh.getEdgesOfVertex(vH, edges);
+                for (auto eH: edges)
+                {
+                    if (dirtyInRound[eH] != round)
+                    {
+                        dirtyInRound[eH] = round;
+                        dirtyEdges.push_back(eH);
+                    }
+                }
+            }
+        }
+        updateEdges(dirtyEdges);
+    }
+
+    cout << endl << timestamp << "Collapsed " << collapsedEdgeCount << " edges in " << round << " rounds" << endl;
+
+    return collapsedEdgeCount;
+}
+
 } // namespace lvr2
@@ -35,25 +35,15 @@
 #include "lvr2/geometry/Handles.hpp"
 #include "lvr2/util/ClusterBiMap.hpp"
 #include "lvr2/algorithm/NormalAlgorithms.hpp"
+#include "lvr2/algorithm/PolygonTriangulator.hpp"
 
-#if _MSC_VER
-#include <Windows.h>
-#endif
-
-#ifndef __APPLE__
-#include <GL/glu.h>
-#include <GL/glut.h>
-#define CALLBACK
-#else
-#include <OpenGL/glu.h>
-#include <GLUT/glut.h>
-#endif
+#include <vector>
 
 namespace lvr2
 {
 
 /**
-* Tesslation algorithm, utilizing the OpenGL tesselator to ease the reconstructed mesh.
+* Tesslation algorithm, retriangulating the contours of each cluster to ease the reconstructed mesh.
 * This algorithm is destryoing the mesh correlation between clusters, faces and vertices thus
 * it is currently not suitable to run any algorithms requiring an coherent mesh.
 */
@@ -63,7 +53,8 @@ class Tesselator {
 public:
 
     /**
-     * Retesselates the current mesh cluster by cluster.
+     * Retesselates the current mesh cluster by cluster. The clusters are triangulated
+     * in parallel, afterwards all faces are replaced in one pass.
      */
     static void apply(
         BaseMesh<BaseVecT>& mesh,
@@ -75,59 +66,33 @@ public:
 private:
 
     /**
-    * The OpenGL tesselation object
-    */
-    static GLUtesselator* m_tesselator;
-
-    /**
-    * The OpenGL type. This defines how the vertices are tesselated.
-    */
-    static GLenum m_type;
-
-    /**
-    * List of vertices to keep track of until the end of the tesselation.
-    */
-    static std::vector<BaseVecT> m_vertices;
-
-    /**
-    * List of faces to keep track of until the end of the tesselation.
-    */
-    static std::vector<BaseVecT> m_faces;
-
-    /**
-    * OpenGL callback, which is invoked by glBegin() to indicate the start of an primitiv.
-    */
-    static void CALLBACK beginCallback(GLenum type);
-
-    /**
-    * OpenGL callback, which is called for every vertex, adding it to our internal list.
+    * The triangles generated for one cluster.
     */
-    static void CALLBACK vertexCallback(void* data);
+    struct Tesselation
+    {
+        /// Points of all simplified contours of the cluster
+        std::vector<BaseVecT> points;
 
-    /**
-    * OpenGL callback, which is called when the tesselator wants to create an new vertex on an intersection.
-    * This simply takes the coords and adds it as an new vertex to our interal list.
-    */
-    static void CALLBACK combineDataCallback(GLdouble coords[3],
-                                             void *vertex_data[4],
-                                             GLfloat weight[4],
-                                             void **outData,
-                                             void *userData);
+        /// Three indices into points per triangle
+        std::vector<Index> triangles;
 
-    /**
-    * OpenGL callback, which is invoked by glEnd() to indicate the end of an primitiv.
-    */
-    static void CALLBACK endCallback(void);
-    /**
-    * OpenGL callback, which is called on any error occurring while running the tesslation.
-    */
-    static void CALLBACK errorCallback(GLenum errno);
+        /// Average normal of the faces of the cluster
+        Normal<typename BaseVecT::CoordType> normal;
+    };
 
     /**
-    * Initalizes the tesselator object, deleting the old one if one is found and registering all
-    * necessary callbacks.
+    * Triangulates the simplified contours of the given cluster. This only reads the mesh,
+    * so several clusters can be tesselated at the same time.
     */
-    static void init();
+    static void tesselate(
+        BaseMesh<BaseVecT>& mesh,
+        const ClusterBiMap<FaceHandle>& clusters,
+        const DenseFaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+        ClusterHandle clusterH,
+        float lineFusionThreshold,
+        PolygonTriangulator<BaseVecT>& triangulator,
+        Tesselation& tesselation
+    );
 
     /**
     * Adds the tesslated faces to the current cluster. Avoid any errors while adding
@@ -138,7 +103,8 @@ private:
         BaseMesh<BaseVecT>& mesh,
         ClusterBiMap<FaceHandle>& clusters,
         DenseFaceMap<Normal<typename BaseVecT::CoordType>>& faceNormal,
-        ClusterHandle clusterH
+        ClusterHandle clusterH,
+        const Tesselation& tesselation
     );
 };
 
@@ -33,206 +33,106 @@
 #include "lvr2/util/ClusterBiMap.hpp"
 #include "lvr2/algorithm/ClusterAlgorithms.hpp"
 
-// disable deprecation warnings for the Tesselator since GLUT is horrifying outdated.
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-
 #include <iostream>
 
 namespace lvr2
 {
 
 template<typename BaseVecT>
-GLUtesselator* Tesselator<BaseVecT>::m_tesselator;
-
-template<typename BaseVecT>
-std::vector<BaseVecT> Tesselator<BaseVecT>::m_vertices;
-
-template<typename BaseVecT>
-std::vector<BaseVecT> Tesselator<BaseVecT>::m_faces;
-
-template<typename BaseVecT>
-GLenum Tesselator<BaseVecT>::m_type;
-
-template<typename BaseVecT>
-void Tesselator<BaseVecT>::beginCallback(GLenum type)
-{
-    m_type = type;
-    m_vertices.clear();
-}
-
-template<typename BaseVecT>
-void Tesselator<BaseVecT>::combineDataCallback(GLdouble coords[3],
-                                               void *vertex_data[4],
-                                               GLfloat weight[4],
-                                               void **outData,
-                                               void *userData)
-{
-    GLdouble* vertex = new GLdouble[3];
-
-    vertex[0] = coords[0];
-    vertex[1] = coords[1];
-    vertex[2] = coords[2];
-
-    BaseVecT v(vertex[0], vertex[1], vertex[2]);
-    m_vertices.push_back(v);
-
-    *outData = vertex;
-}
-
-template<typename BaseVecT>
-void Tesselator<BaseVecT>::endCallback(void)
+void Tesselator<BaseVecT>::apply(
+    BaseMesh<BaseVecT>& mesh,
+    ClusterBiMap<FaceHandle>& clusters,
+    DenseFaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    float lineFusionThreshold
+)
 {
+    // Status message for mesh generation
+    string comment = timestamp.getElapsedTime() + "Tesselating clusters ";
+    ProgressBar progress(clusters.numCluster(), comment);
 
-    if (m_vertices.size() < 3)
+    vector<ClusterHandle> clusterHandles;
+    clusterHandles.reserve(clusters.numCluster());
+    for (auto clusterH: clusters)
     {
-        m_vertices.clear();
-        return;
+        clusterHandles.push_back(clusterH);
     }
 
-    if (m_type == GL_TRIANGLES)
-    {
-        for (size_t i = 0; i < m_vertices.size() / 3; ++i)
-        {
-            m_faces.push_back(m_vertices[i * 3 + 2]);
-            m_faces.push_back(m_vertices[i * 3 + 1]);
-            m_faces.push_back(m_vertices[i * 3 + 0]);
-        }
-    }
-    else if (m_type == GL_TRIANGLE_FAN)
-    {
-        for(size_t i = 0; i < m_vertices.size() - 2; ++i)
-        {
-            m_faces.push_back(m_vertices[i + 2]);
-            m_faces.push_back(m_vertices[i + 1]);
-            m_faces.push_back(m_vertices[0]);
-        }
-    }
-    else if (m_type == GL_TRIANGLE_STRIP)
+    // Triangulate all clusters in parallel, the mesh is not modified yet
+    vector<Tesselation> tesselations(clusterHandles.size());
+
+    #pragma omp parallel
     {
-        for(size_t i = 0; i < m_vertices.size() - 2; ++i)
+        PolygonTriangulator<BaseVecT> triangulator;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t i = 0; i < clusterHandles.size(); i++)
         {
-            if (i % 2 == 0)
-            {
-                m_faces.push_back(m_vertices[i + 2]);
-                m_faces.push_back(m_vertices[i + 1]);
-                m_faces.push_back(m_vertices[i]);
-            } else
-            {
-                m_faces.push_back(m_vertices[i]);
-                m_faces.push_back(m_vertices[i + 1]);
-                m_faces.push_back(m_vertices[i + 2]);
-            }
+            tesselate(
+                mesh,
+                clusters,
+                faceNormals,
+                clusterHandles[i],
+                lineFusionThreshold,
+                triangulator,
+                tesselations[i]
+            );
+
+            ++progress;
         }
     }
-}
-
-template<typename BaseVecT>
-void Tesselator<BaseVecT>::errorCallback(GLenum errno)
-{
-    std::cerr << "[Tesselator-Error:] "
-              << __FILE__ << " (" << __LINE__ << "): "
-              << gluErrorString(errno) << std::endl;
-}
 
-template<typename BaseVecT>
-void Tesselator<BaseVecT>::vertexCallback(void* data)
-{
-    const GLdouble *ptr = (const GLdouble*)data;
-
-    BaseVecT vertex(*ptr, *(ptr+1), *(ptr+2));
-    m_vertices.push_back(vertex);
-}
-
-template<typename BaseVecT>
-void Tesselator<BaseVecT>::init() {
-    // init tesselator
-    if (m_tesselator)
+    // Replace the faces of all clusters in one pass
+    for (size_t i = 0; i < clusterHandles.size(); i++)
     {
-        gluDeleteTess(m_tesselator);
+        addTesselatedFaces(mesh, clusters, faceNormals, clusterHandles[i], tesselations[i]);
     }
 
-    m_tesselator = gluNewTess();
-
-    gluTessCallback(m_tesselator, GLU_TESS_BEGIN, (GLvoid (CALLBACK*) ()) &beginCallback);
-    gluTessCallback(m_tesselator, GLU_TESS_VERTEX, (GLvoid (CALLBACK*) ()) &vertexCallback);
-    gluTessCallback(m_tesselator, GLU_TESS_COMBINE_DATA, (GLvoid (CALLBACK*) ()) &combineDataCallback);
-    gluTessCallback(m_tesselator, GLU_TESS_END, (GLvoid (CALLBACK*) ()) &endCallback);
-    gluTessCallback(m_tesselator, GLU_TESS_ERROR, (GLvoid (CALLBACK*) ()) &errorCallback);
-
-    gluTessProperty(m_tesselator, GLU_TESS_WINDING_RULE, GLU_TESS_WINDING_NONZERO);
+    if(!timestamp.isQuiet())
+        cout << endl;
 }
 
 template<typename BaseVecT>
-void Tesselator<BaseVecT>::apply(
+void Tesselator<BaseVecT>::tesselate(
     BaseMesh<BaseVecT>& mesh,
-    ClusterBiMap<FaceHandle>& clusters,
-    DenseFaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
-    float lineFusionThreshold
+    const ClusterBiMap<FaceHandle>& clusters,
+    const DenseFaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
+    ClusterHandle clusterH,
+    float lineFusionThreshold,
+    PolygonTriangulator<BaseVecT>& triangulator,
+    Tesselation& tesselation
 )
 {
-    // Status message for mesh generation
-    string comment = timestamp.getElapsedTime() + "Tesselating clusters ";
-    ProgressBar progress(clusters.numCluster(), comment);
-
-    init();
-
-    for (auto clusterH: clusters)
+    // The triangles are oriented like the faces of the cluster
+    BaseVector<typename BaseVecT::CoordType> normalSum(0, 0, 0);
+    for (auto fH: clusters[clusterH].handles)
     {
-        m_vertices.clear();
-        m_faces.clear();
-
-        auto contours = findContours(mesh, clusters, clusterH);
-        // collect garbage GL vertices manually
-        vector<GLdouble*> garbage;
-
-        gluTessBeginPolygon(m_tesselator, 0);
+        normalSum += faceNormals[fH];
+    }
+    if (normalSum.length2() > 0)
+    {
+        tesselation.normal = Normal<typename BaseVecT::CoordType>(normalSum);
+    }
 
-        for (auto contour: contours)
+    vector<vector<BaseVecT>> contourPoints;
+    for (auto contour: findContours(mesh, clusters, clusterH))
+    {
+        if (contour.size() < 3)
         {
-            if (contour.size() < 3)
-            {
-                continue;
-            }
-
-            // subtract lineFusionThreshold of lvr1 by one to avoid conflicts with new implementation
-            auto simpleContour = simplifyContour(mesh, contour, 1 - lineFusionThreshold);
-
-            gluTessBeginContour(m_tesselator);
-
-            for(auto vH: simpleContour)
-            {
-                auto& v = mesh.getVertexPosition(vH);
-
-                GLdouble* tVertex = new GLdouble[3];
-                tVertex[0] = v.x;
-                tVertex[1] = v.y;
-                tVertex[2] = v.z;
-
-                gluTessVertex(m_tesselator, tVertex, tVertex);
-                garbage.push_back(tVertex);
-            }
-
-            gluTessEndContour(m_tesselator);
+            continue;
         }
 
-        gluTessEndPolygon(m_tesselator);
+        // subtract lineFusionThreshold of lvr1 by one to avoid conflicts with new implementation
+        auto simpleContour = simplifyContour(mesh, contour, 1 - lineFusionThreshold);
 
-        for (size_t i = 0; i < garbage.size(); i++)
+        contourPoints.emplace_back();
+        for (auto vH: simpleContour)
         {
-            delete[] garbage[i];
+            contourPoints.back().push_back(mesh.getVertexPosition(vH));
+            tesselation.points.push_back(mesh.getVertexPosition(vH));
         }
-
-        addTesselatedFaces(mesh, clusters, faceNormals, clusterH);
-
-        ++progress;
     }
 
-    gluDeleteTess(m_tesselator);
-    m_tesselator = 0;
-
-    if(!timestamp.isQuiet())
-        cout << endl;
+    tesselation.triangles = triangulator.triangulate(contourPoints, tesselation.normal);
 }
 
 template<typename BaseVecT>
@@ -240,7 +140,8 @@ void Tesselator<BaseVecT>::addTesselatedFaces(
     BaseMesh<BaseVecT>& mesh,
     ClusterBiMap<FaceHandle>& clusters,
     DenseFaceMap<Normal<typename BaseVecT::CoordType>>& faceNormals,
-    ClusterHandle clusterH
+    ClusterHandle clusterH,
+    const Tesselation& tesselation
 )
 {
     // delete all faces of cluster in mesh
@@ -255,15 +156,12 @@ void Tesselator<BaseVecT>::addTesselatedFaces(
     // and than create new one
     auto newClusterH = clusters.createCluster();
 
-    // keep track of the normal before to avoid non-normals on new faces...
-    auto oldNormal = Normal<typename BaseVecT::CoordType>(0, 0, 1);
-
     // then re-add all faces and vertices generated by the tesselator
-    for (size_t i = 0; i < m_faces.size() / 3; ++i)
+    for (size_t i = 0; i < tesselation.triangles.size() / 3; ++i)
     {
-        auto v1 = m_faces[i * 3 + 2];
-        auto v2 = m_faces[i * 3 + 1];
-        auto v3 = m_faces[i * 3 + 0];
+        auto& v1 = tesselation.points[tesselation.triangles[i * 3 + 0]];
+        auto& v2 = tesselation.points[tesselation.triangles[i * 3 + 1]];
+        auto& v3 = tesselation.points[tesselation.triangles[i * 3 + 2]];
 
         // TODO make sure we reuse the added vertices here instead of duplicating everything
         auto v1H = mesh.addVertex(v1);
@@ -278,16 +176,10 @@ void Tesselator<BaseVecT>::addTesselatedFaces(
         auto newFaceH = mesh.addFace(v1H, v2H, v3H);
         clusters.addToCluster(newClusterH, newFaceH);
 
+        // avoid non-normals on degenerated faces
         auto maybeNormal = getFaceNormal(mesh.getVertexPositionsOfFace(newFaceH));
-        if (maybeNormal)
-        {
-            oldNormal = *maybeNormal;
-        }
-
-        faceNormals.insert(newFaceH, Normal<typename BaseVecT::CoordType>(maybeNormal ? *maybeNormal : oldNormal));
+        faceNormals.insert(newFaceH, maybeNormal ? *maybeNormal : tesselation.normal);
     }
 }
 
 } // namespace lvr2
-
-#pragma GCC diagnostic pop
@@ -55,6 +55,52 @@
 namespace lvr2
 {
 
+/**
+ * @brief Position of a texture within an atlas page.
+ *
+ * Converts texture coordinates of the texture into texture coordinates of
+ * the page.
+ */
+struct TextureRegion
+{
+    TextureRegion(
+        TextureHandle page,
+        unsigned short x,
+        unsigned short y,
+        unsigned short width,
+        unsigned short height,
+        unsigned short pageWidth,
+        unsigned short pageHeight
+    ) :
+        page(page),
+        x(x),
+        y(y),
+        width(width),
+        height(height),
+        pageWidth(pageWidth),
+        pageHeight(pageHeight)
+    {}
+
+    /// Texture coordinates within the page. The first image row is v = 1.
+    TexCoords toPage(const TexCoords& coords) const
+    {
+        return TexCoords(
+            (x + coords.u * width) / pageWidth,
+            (pageHeight - y - (1 - coords.v) * height) / pageHeight
+        );
+    }
+
+    /// The page containing the texture
+    TextureHandle page;
+
+    /// First column and row of the texture within the page
+    unsigned short x, y;
+
+    /// Size of the texture and the page
+    unsigned short width, height;
+    unsigned short pageWidth, pageHeight;
+};
+
 /**
  * @class Texturizer
  * @brief Class that performs texture-related tasks
@@ -78,6 +124,8 @@ public:
         int texMaxClusterSize
     );
 
+    virtual ~Texturizer() = default;
+
     /**
      * @brief Get the texture to a given texture handle
      *
@@ -103,6 +151,21 @@ public:
      */
     int getTextureIndex(TextureHandle h);
 
+    /**
+     * @brief Sets the size of the atlas pages created by `addTextures()`.
+     *
+     * @param size the width and height of a page, 0 to store each texture on
+     *             its own
+     */
+    void setAtlasPageSize(unsigned short size);
+
+    /**
+     * @brief Called once before textures are computed in parallel.
+     *
+     * Subclasses can load data which `computeTexture()` needs here.
+     */
+    virtual void prepare() {}
+
     /**
      * @brief Discover keypoints in a texture
      *
@@ -118,6 +181,13 @@ public:
             std::vector<cv::KeyPoint>&
             keypoints, cv::Mat& descriptors);
 
+    /**
+     * @brief Like the method above, but for a texture which wasn't added yet
+     */
+    void findKeyPointsInTexture(const Texture& texture,
+            const cv::Ptr<cv::Feature2D>& detector,
+            std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const;
+
     /**
      * @brief Compute 3D coordinates for texture-relative keypoints
      *
@@ -130,24 +200,62 @@ public:
         keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const TextureHandle& h);
 
     /**
-     * @brief Generates a texture for a given bounding rectangle
+     * @brief Like the method above, but for a texture which wasn't added yet
+     */
+    std::vector<BaseVecT> keypoints23d(const std::vector<cv::KeyPoint>&
+        keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const Texture& texture) const;
+
+    /**
+     * @brief Generates a texture for a given bounding rectangle and adds it
+     *
+     * @param index The index the texture will get
+     * @param surface The point cloud
+     * @param boundingRect The bounding rectangle of the cluster
+     *
+     * @return Texture handle of the generated texture
+     */
+    TextureHandle generateTexture(
+        int index,
+        const PointsetSurface<BaseVecT>& surface,
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+    );
+
+    /**
+     * @brief Computes a texture for a given bounding rectangle
      *
      * Create a grid, based on given information (texel size, bounding rectangle).
      * For each cell in the grid (which represents a texel), let the `PointsetSurface` find the closest point in the
-     * point cloud and use that point's color as color for the texel.
+     * point cloud and use that point's color as color for the texel. The
+     * nearest points of many texels are searched in one batch.
+     *
+     * This doesn't modify the texturizer, so several textures can be computed
+     * in parallel after calling `prepare()`.
      *
      * @param index The index the texture will get
      * @param surface The point cloud
      * @param boundingRect The bounding rectangle of the cluster
      *
-     * @return Texture handle of the generated texture
+     * @return The texture
      */
-    virtual TextureHandle generateTexture(
+    virtual Texture computeTexture(
         int index,
         const PointsetSurface<BaseVecT>& surface,
         const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
     );
 
+    /**
+     * @brief Adds computed textures, packed into atlas pages
+     *
+     * The textures are sorted by height and placed row by row into pages of
+     * the size set with `setAtlasPageSize()`. Each texture is surrounded by a
+     * border of copied edge texels, so filtering doesn't mix neighbouring
+     * textures. Textures which are larger than a page get a page of their
+     * own. The textures are moved from the vector.
+     *
+     * @return the region of each texture within its page
+     */
+    std::vector<TextureRegion> addTextures(std::vector<Texture>& textures);
+
     /**
      * @brief Calculate texture coordinates for a given 3D point in a texture
      *
@@ -163,6 +271,15 @@ public:
         BaseVecT v
     );
 
+    /**
+     * @brief Like the method above, but for a texture which wasn't added yet
+     */
+    TexCoords calculateTexCoords(
+        const Texture& texture,
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect,
+        BaseVecT v
+    ) const;
+
     /**
      * @brief Calculate a global 3D position for given texture coordinates
      *
@@ -178,6 +295,14 @@ public:
         const TexCoords& coords
     );
 
+    /**
+     * @brief Like the method above, which doesn't need the texture handle
+     */
+    BaseVecT calculateTexCoordsInv(
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect,
+        const TexCoords& coords
+    ) const;
+
     /**
      * @brief Calls the save method for each texture
      */
@@ -192,6 +317,9 @@ public:
 
 protected:
 
+    /// Width and height of an atlas page, 0 for no atlas
+    unsigned short m_atlasPageSize;
+
     /// StableVector, that contains all generated textures with texture handles
     StableVector<TextureHandle, Texture> m_textures;
 
@@ -37,6 +37,8 @@
 #include "lvr2/io/Timestamp.hpp"
 #include "lvr2/algorithm/ColorAlgorithms.hpp"
 
+#include <algorithm>
+
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -52,8 +54,15 @@ Texturizer<BaseVecT>::Texturizer(
 ) :
     m_texelSize(texelSize),
     m_texMinClusterSize(texMinClusterSize),
-    m_texMaxClusterSize(texMaxClusterSize)
+    m_texMaxClusterSize(texMaxClusterSize),
+    m_atlasPageSize(0)
+{
+}
+
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::setAtlasPageSize(unsigned short size)
 {
+    m_atlasPageSize = size;
 }
 
 
@@ -96,10 +105,19 @@ TexCoords Texturizer<BaseVecT>::calculateTexCoords(
     BaseVecT point
 )
 {
-    //return m_textures[h].calcTexCoords(boundingRect, v);
-    auto texelSize = m_textures[h].m_texelSize;
-    auto width = m_textures[h].m_width;
-    auto height = m_textures[h].m_height;
+    return calculateTexCoords(m_textures[h], br, point);
+}
+
+template<typename BaseVecT>
+TexCoords Texturizer<BaseVecT>::calculateTexCoords(
+    const Texture& texture,
+    const BoundingRectangle<typename BaseVecT::CoordType>& br,
+    BaseVecT point
+) const
+{
+    auto texelSize = texture.m_texelSize;
+    auto width = texture.m_width;
+    auto height = texture.m_height;
 
     BaseVecT w =  point - ((br.m_vec1 * br.m_minDistA) + (br.m_vec2 * br.m_minDistB)
             + br.m_supportVector);
@@ -115,6 +133,15 @@ BaseVecT Texturizer<BaseVecT>::calculateTexCoordsInv(
     const BoundingRectangle<typename BaseVecT::CoordType>& br,
     const TexCoords& coords
 )
+{
+    return calculateTexCoordsInv(br, coords);
+}
+
+template<typename BaseVecT>
+BaseVecT Texturizer<BaseVecT>::calculateTexCoordsInv(
+    const BoundingRectangle<typename BaseVecT::CoordType>& br,
+    const TexCoords& coords
+) const
 {
     return br.m_supportVector + (br.m_vec1 * br.m_minDistA)
                               + br.m_vec1 * coords.u
@@ -130,6 +157,16 @@ TextureHandle Texturizer<BaseVecT>::generateTexture(
     const PointsetSurface<BaseVecT>& surface,
     const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
 )
+{
+    return m_textures.push(computeTexture(index, surface, boundingRect));
+}
+
+template<typename BaseVecT>
+Texture Texturizer<BaseVecT>::computeTexture(
+    int index,
+    const PointsetSurface<BaseVecT>& surface,
+    const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+)
 {
 
     // Calculate the texture size
@@ -138,65 +175,213 @@ TextureHandle Texturizer<BaseVecT>::generateTexture(
 
     // Create texture
     Texture texture(index, sizeX, sizeY, 3, 1, m_texelSize);
+    std::fill(texture.m_data, texture.m_data + sizeX * sizeY * 3, 0);
 
-    string comment = timestamp.getElapsedTime() + "Computing texture pixels ";
-    ProgressBar progress(sizeX * sizeY, comment);
-
-    if (surface.pointBuffer()->hasColors())
+    if (surface.pointBuffer()->hasColors() && sizeX > 0)
     {
         UCharChannel colors = *(surface.pointBuffer()->getUCharChannel("colors"));
 
-        // For each texel find the color of the nearest point
-        #pragma omp parallel for schedule(dynamic,1) collapse(2)
-        for (int y = 0; y < sizeY; y++)
-        {
-            for (int x = 0; x < sizeX; x++)
-            {
-                int k = 1; // k-nearest-neighbors
-
-                vector<size_t> cv;
+        // For each texel find the color of the nearest point. The nearest
+        // points of a block of rows are searched in a single batch. If
+        // several textures are computed in parallel, the blocks of one
+        // texture are processed serially.
+        const int rowsPerBlock = std::max(1, 65536 / sizeX);
+        const int numBlocks = (sizeY + rowsPerBlock - 1) / rowsPerBlock;
 
-                BaseVecT currentPos =
-                    boundingRect.m_supportVector
-                    + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0)
-                    + boundingRect.m_vec2 * (y * m_texelSize + boundingRect.m_minDistB - m_texelSize / 2.0);
+        #pragma omp parallel for schedule(dynamic,1)
+        for (int block = 0; block < numBlocks; block++)
+        {
+            const int k = 1; // k-nearest-neighbors
+            const int firstRow = block * rowsPerBlock;
+            const int lastRow = std::min<int>(sizeY, firstRow + rowsPerBlock);
+            const size_t numTexels = static_cast<size_t>(lastRow - firstRow) * sizeX;
 
-                surface.searchTree()->kSearch(currentPos, k, cv);
+            vector<BaseVecT> positions(numTexels);
+            for (int y = firstRow; y < lastRow; y++)
+            {
+                for (int x = 0; x < sizeX; x++)
+                {
+                    positions[(y - firstRow) * sizeX + x] =
+                        boundingRect.m_supportVector
+                        + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0)
+                        + boundingRect.m_vec2 * (y * m_texelSize + boundingRect.m_minDistB - m_texelSize / 2.0);
+                }
+            }
 
-                uint8_t r = 0, g = 0, b = 0;
+            vector<size_t> cv(numTexels * k);
+            vector<typename BaseVecT::CoordType> distances(numTexels * k);
+            surface.searchTree()->kSearchMany(positions.data(), numTexels, k, cv.data(), distances.data());
 
-                for (size_t pointIdx : cv)
+            for (int y = firstRow; y < lastRow; y++)
+            {
+                for (int x = 0; x < sizeX; x++)
                 {
-                    auto cur_color = colors[pointIdx];
-                    r += cur_color[0];
-                    g += cur_color[1];
-                    b += cur_color[2];
+                    const size_t texel = (y - firstRow) * sizeX + x;
+                    uint8_t r = 0, g = 0, b = 0;
+
+                    for (int j = 0; j < k; j++)
+                    {
+                        if (cv[texel * k + j] >= colors.numElements())
+                        {
+                            continue;
+                        }
+                        auto cur_color = colors[cv[texel * k + j]];
+                        r += cur_color[0];
+                        g += cur_color[1];
+                        b += cur_color[2];
+                    }
+
+                    r /= k;
+                    g /= k;
+                    b /= k;
+
+                    texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 0] = r;
+                    texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 1] = g;
+                    texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 2] = b;
                 }
+            }
+        }
+    }
 
-                r /= k;
-                g /= k;
-                b /= k;
+    return texture;
+}
 
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 0] = r;
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 1] = g;
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 2] = b;
+template<typename BaseVecT>
+std::vector<TextureRegion> Texturizer<BaseVecT>::addTextures(std::vector<Texture>& textures)
+{
+    // Position of a texture within its page, before the pages are created
+    struct Placement
+    {
+        size_t page;
+        unsigned short x, y;
+    };
 
-                ++progress;
-            }
+    // Sort the textures by height, so the rows of a page are filled evenly
+    std::vector<size_t> order(textures.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return textures[a].m_height > textures[b].m_height;
+    });
+
+    // Textures on a page get a border of one texel on each side
+    const int border = 1;
+    std::vector<Placement> placements(textures.size());
+    std::vector<std::pair<int, int>> pageSizes;
+    std::vector<bool> ownPage(textures.size(), false);
+    int rowX = 0, rowY = 0, rowHeight = 0;
+    bool pageOpen = false;
+
+    for (auto i: order)
+    {
+        const int width = textures[i].m_width + 2 * border;
+        const int height = textures[i].m_height + 2 * border;
+        // Textures that don't fit on a page and empty textures, which have
+        // no edge texels to repeat in a border, get a page of their own
+        const bool empty = textures[i].m_width == 0 || textures[i].m_height == 0;
+        if (empty || width > m_atlasPageSize || height > m_atlasPageSize)
+        {
+            ownPage[i] = true;
+            placements[i] = { pageSizes.size(), 0, 0 };
+            pageSizes.emplace_back(textures[i].m_width, textures[i].m_height);
+            pageOpen = false;
+            continue;
+        }
+
+        // Start a new row if this one is full, a new page if there is no
+        // space for another row
+        if (pageOpen && rowX + width > m_atlasPageSize)
+        {
+            rowX = 0;
+            rowY += rowHeight;
+            rowHeight = 0;
+        }
+        if (!pageOpen || rowY + height > m_atlasPageSize)
+        {
+            pageSizes.emplace_back(0, 0);
+            rowX = 0;
+            rowY = 0;
+            rowHeight = 0;
+            pageOpen = true;
         }
-        std::cout << std::endl;
+
+        placements[i] = {
+            pageSizes.size() - 1,
+            static_cast<unsigned short>(rowX + border),
+            static_cast<unsigned short>(rowY + border)
+        };
+        rowX += width;
+        rowHeight = std::max(rowHeight, height);
+
+        // Pages are only as large as needed
+        auto& size = pageSizes.back();
+        size.first = std::max(size.first, rowX);
+        size.second = std::max(size.second, rowY + rowHeight);
+    }
+
+    // Copy the textures into their pages, repeating the edge texels in the
+    // border
+    std::vector<Texture> pages;
+    pages.reserve(pageSizes.size());
+    for (auto& size: pageSizes)
+    {
+        pages.emplace_back(0, size.first, size.second, 3, 1, m_texelSize);
+    }
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (size_t page = 0; page < pages.size(); page++)
+    {
+        std::fill(pages[page].m_data, pages[page].m_data + pages[page].m_width * pages[page].m_height * 3, 0);
     }
-    else
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (size_t i = 0; i < textures.size(); i++)
     {
-        for (int i = 0; i < sizeX * sizeY; i++)
+        const Texture& texture = textures[i];
+        Texture& page = pages[placements[i].page];
+        const int b = ownPage[i] ? 0 : border;
+        for (int y = -b; y < texture.m_height + b; y++)
         {
-            texture.m_data[i] = 0;
+            const int srcY = std::min(std::max(y, 0), texture.m_height - 1);
+            for (int x = -b; x < texture.m_width + b; x++)
+            {
+                const int srcX = std::min(std::max(x, 0), texture.m_width - 1);
+                const size_t src = (static_cast<size_t>(srcY) * texture.m_width + srcX) * 3;
+                const size_t dst = (static_cast<size_t>(placements[i].y + y) * page.m_width + placements[i].x + x) * 3;
+                std::copy(texture.m_data + src, texture.m_data + src + 3, page.m_data + dst);
+            }
         }
     }
 
-    return m_textures.push(texture);
-}
+    // Add the pages and free the textures
+    std::vector<TextureHandle> pageHandles;
+    for (auto& page: pages)
+    {
+        page.m_index = m_textures.nextHandle().idx();
+        pageHandles.push_back(m_textures.push(std::move(page)));
+    }
 
+    std::vector<TextureRegion> regions;
+    regions.reserve(textures.size());
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        const auto& page = pageSizes[placements[i].page];
+        regions.emplace_back(
+            pageHandles[placements[i].page],
+            placements[i].x,
+            placements[i].y,
+            textures[i].m_width,
+            textures[i].m_height,
+            page.first,
+            page.second
+        );
+        textures[i] = Texture();
+    }
+
+    return regions;
+}
 
 template<typename BaseVecT>
 void Texturizer<BaseVecT>::findKeyPointsInTexture(const TextureHandle texH,
@@ -204,7 +389,14 @@ void Texturizer<BaseVecT>::findKeyPointsInTexture(const TextureHandle texH,
         const cv::Ptr<cv::Feature2D>& detector,
         std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors)
 {
-    const Texture texture = m_textures[texH];
+    findKeyPointsInTexture(m_textures[texH], detector, keypoints, descriptors);
+}
+
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::findKeyPointsInTexture(const Texture& texture,
+        const cv::Ptr<cv::Feature2D>& detector,
+        std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const
+{
     if (texture.m_height <= 32 && texture.m_width <= 32)
     {
         return;
@@ -219,11 +411,18 @@ void Texturizer<BaseVecT>::findKeyPointsInTexture(const TextureHandle texH,
 template<typename BaseVecT>
 std::vector<BaseVecT> Texturizer<BaseVecT>::keypoints23d(const std::vector<cv::KeyPoint>&
         keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const TextureHandle& h)
+{
+    return keypoints23d(keypoints, boundingRect, m_textures[h]);
+}
+
+template<typename BaseVecT>
+std::vector<BaseVecT> Texturizer<BaseVecT>::keypoints23d(const std::vector<cv::KeyPoint>&
+        keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const Texture& texture) const
 {
     const size_t N = keypoints.size();
     std::vector<BaseVecT> keypoints3d(N);
-    const int width            = m_textures[h].m_width;
-    const int height           = m_textures[h].m_height;
+    const int width            = texture.m_width;
+    const int height           = texture.m_height;
 
     for (size_t p_idx = 0; p_idx < N; ++p_idx)
     {
@@ -234,7 +433,7 @@ std::vector<BaseVecT> Texturizer<BaseVecT>::keypoints23d(const std::vector<cv::K
         // I'm not sure why we need to mirror this coordinate, but it works like
         // this
         const float v      = 1 - keypoint.y / height;
-        BaseVecT location  = calculateTexCoordsInv(h, boundingRect, TexCoords(u, v));
+        BaseVecT location  = calculateTexCoordsInv(boundingRect, TexCoords(u, v));
         keypoints3d[p_idx] = location;
     }
     return keypoints3d;
@@ -40,6 +40,7 @@
 
 #include <memory>
 #include "lvr2/util/BaseHandle.hpp"
+#include "lvr2/attrmaps/HandleRemap.hpp"
 
 namespace lvr2
 {
@@ -157,6 +158,17 @@ public:
      */
     virtual AttributeMapHandleIteratorPtr<HandleT> end() const = 0;
 
+    /**
+     * @brief Moves all values to the new handles given by the remapping.
+     *        Values of handles that are not contained in the remapping are
+     *        removed.
+     *
+     * This has to be called for every map that refers to a mesh after the
+     * mesh was compacted. The default implementation rebuilds the map,
+     * implementations may override it with something faster.
+     */
+    virtual void remap(const HandleRemap<HandleT>& remap);
+
     /**
      * @brief Returns the value associated with the given key or panics
      *        if there is no associated value.
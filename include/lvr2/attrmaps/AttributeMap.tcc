@@ -31,6 +31,9 @@
  *  @date 26.07.2017
  */
 
+#include <utility>
+#include <vector>
+
 #include "lvr2/util/Panic.hpp"
 
 namespace lvr2
@@ -58,6 +61,26 @@ const ValueT& AttributeMap<HandleT, ValueT>::operator[](HandleT key) const
     return *elem;
 }
 
+template<typename HandleT, typename ValueT>
+void AttributeMap<HandleT, ValueT>::remap(const HandleRemap<HandleT>& remap)
+{
+    std::vector<std::pair<HandleT, ValueT>> values;
+    values.reserve(numValues());
+    for (auto handle: *this)
+    {
+        if (remap.contains(handle))
+        {
+            values.emplace_back(remap[handle], *get(handle));
+        }
+    }
+
+    clear();
+    for (auto& entry: values)
+    {
+        insert(entry.first, std::move(entry.second));
+    }
+}
+
 template<typename HandleT>
 AttributeMapHandleIteratorPtr<HandleT>& AttributeMapHandleIteratorPtr<HandleT>::operator++()
 {
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * HandleRemap.hpp
+ */
+
+#ifndef LVR2_ATTRMAPS_HANDLEREMAP_H_
+#define LVR2_ATTRMAPS_HANDLEREMAP_H_
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "lvr2/geometry/Handles.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Maps the handles of a container to new handles, e.g. after the
+ *        container was compacted with `StableVector::compact()`.
+ *
+ * Handles of deleted elements are not contained in the remapping.
+ */
+template<typename HandleT>
+class HandleRemap
+{
+public:
+    /// New index of handles that are not contained in the remapping
+    static constexpr Index INVALID = std::numeric_limits<Index>::max();
+
+    /**
+     * @brief Creates an empty remapping.
+     */
+    HandleRemap() : m_newSize(0) {}
+
+    /**
+     * @brief Creates a remapping from the new index of each old index.
+     *
+     * @param newIndices    New index of the handle with the old index i or
+     *                      INVALID
+     * @param newSize       Number of handles after remapping
+     */
+    HandleRemap(std::vector<Index> newIndices, size_t newSize)
+        : m_newIndices(std::move(newIndices)), m_newSize(newSize) {}
+
+    /**
+     * @brief Returns true if the given old handle has a new handle.
+     */
+    bool contains(HandleT oldH) const
+    {
+        return oldH.idx() < m_newIndices.size() && m_newIndices[oldH.idx()] != INVALID;
+    }
+
+    /**
+     * @brief Returns the new handle of the given old handle. The handle has
+     *        to be contained in the remapping.
+     */
+    HandleT operator[](HandleT oldH) const
+    {
+        return HandleT(m_newIndices[oldH.idx()]);
+    }
+
+    /// Number of handles before remapping
+    size_t oldSize() const { return m_newIndices.size(); }
+
+    /// Number of handles after remapping
+    size_t newSize() const { return m_newSize; }
+
+    /// The new index of each old index
+    const std::vector<Index>& newIndices() const { return m_newIndices; }
+
+private:
+    std::vector<Index> m_newIndices;
+    size_t m_newSize;
+};
+
+/**
+ * @brief Applies the given remapping to all given attribute maps. The maps
+ *        are processed in parallel.
+ *
+ * Usage: `remapAttributeMaps(result.faces, faceNormals, faceColors);`
+ */
+template<typename HandleT, typename... MapTs>
+void remapAttributeMaps(const HandleRemap<HandleT>& remap, MapTs&... maps)
+{
+    std::array<std::function<void()>, sizeof...(MapTs)> tasks = {{
+        [&remap, &maps]() { maps.remap(remap); }...
+    }};
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        tasks[i]();
+    }
+}
+
+} // namespace lvr2
+
+#endif /* LVR2_ATTRMAPS_HANDLEREMAP_H_ */
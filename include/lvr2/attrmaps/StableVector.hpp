@@ -46,11 +46,15 @@ using std::vector;
 
 #include "lvr2/util/BaseHandle.hpp"
 #include "lvr2/geometry/Handles.hpp"
+#include "lvr2/attrmaps/HandleRemap.hpp"
 
 
 namespace lvr2
 {
 
+// Forward declaration
+template<typename HandleT, typename ElemT> class StableVector;
+
 /**
  * @brief Iterator over handles in this vector, which skips deleted elements
  *
@@ -61,13 +65,13 @@ template<typename HandleT, typename ElemT>
 class StableVectorIterator
 {
 private:
-    /// Reference to the deleted marker array this iterator belongs to
-    const vector<boost::optional<ElemT>>* m_elements;
+    /// Reference to the vector this iterator belongs to
+    const StableVector<HandleT, ElemT>* m_vector;
 
     /// Current position in the vector
     size_t m_pos;
 public:
-    StableVectorIterator(const vector<boost::optional<ElemT>>* deleted, bool startAtEnd = false);
+    StableVectorIterator(const StableVector<HandleT, ElemT>* vector, bool startAtEnd = false);
 
     StableVectorIterator& operator=(const StableVectorIterator& other);
     bool operator==(const StableVectorIterator& other) const;
@@ -248,6 +252,37 @@ public:
      */
     size_t numUsed() const;
 
+    /**
+     * @brief Returns the index of the first non-deleted element at or after
+     *        `pos`, or `size()` if there is no such element.
+     *
+     * This is constant time if the vector does not contain deleted elements.
+     * Otherwise, the deletion bitmap is scanned 64 elements at a time.
+     */
+    size_t nextUsedIndex(size_t pos) const;
+
+    /**
+     * @brief Removes all deleted elements by moving the remaining elements
+     *        to the front and frees the unused memory.
+     *
+     * The order of the elements is preserved. All handles to this vector
+     * are invalidated, use the returned remapping to translate them.
+     *
+     * @return The new handle of each element
+     */
+    HandleRemap<HandleType> compact();
+
+    /**
+     * @brief Moves each element to its new handle and drops all elements
+     *        that are not contained in the remapping.
+     *
+     * Use this to apply the result of `compact()` to a vector that stores
+     * values for the handles of the compacted vector. The remapping has to
+     * preserve the order of the handles, like the ones returned by
+     * `compact()` do. This is done in place.
+     */
+    void remap(const HandleRemap<HandleType>& remap);
+
     /**
      * @brief Returns an iterator to the first element of this vector.
      *
@@ -280,6 +315,20 @@ private:
     /// Vector for stored elements
     vector<boost::optional<ElementType>> m_elements;
 
+    /// One bit per element, set if the element is not deleted
+    vector<uint64_t> m_usedBits;
+
+    /**
+     * @brief Marks the element at `idx` as used or deleted in the bitmap.
+     */
+    void setUsedBit(size_t idx, bool used);
+
+    /**
+     * @brief Resizes the bitmap from `oldSize` to `newSize` elements. New
+     *        elements are marked as used if `used` is true.
+     */
+    void resizeUsedBits(size_t oldSize, size_t newSize, bool used);
+
     /**
      * @brief Assert that the requested handle is not deleted or throw an
      *        exception otherwise.
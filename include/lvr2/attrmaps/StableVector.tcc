@@ -35,6 +35,7 @@
 #include "lvr2/util/Panic.hpp"
 #include <boost/shared_array.hpp>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 
@@ -67,13 +68,16 @@ template<typename HandleT, typename ElemT>
 StableVector<HandleT, ElemT>::StableVector(size_t countElements, const ElementType& defaultValue)
     : m_elements(countElements, defaultValue),
       m_usedCount(countElements)
-{}
+{
+    resizeUsedBits(0, countElements, true);
+}
 
 template<typename HandleT, typename ElemT>
 StableVector<HandleT, ElemT>::StableVector(size_t countElements, const boost::shared_array<ElementType>& sharedArray)
     : m_usedCount(countElements)
 {
-    m_elements.reserve(countElements);
+    m_elements.resize(countElements);
+    resizeUsedBits(0, countElements, true);
     #pragma omp parallel for
     for(size_t i=0; i<countElements; i++)
     {
@@ -86,14 +90,16 @@ HandleT StableVector<HandleT, ElemT>::push(const ElementType& elem)
 {
     m_elements.emplace_back(elem);
     ++m_usedCount;
+    resizeUsedBits(size() - 1, size(), true);
     return HandleT(size() - 1);
 }
 
 template<typename HandleT, typename ElemT>
 HandleT StableVector<HandleT, ElemT>::push(ElementType&& elem)
 {
-    m_elements.emplace_back(move(elem));
+    m_elements.emplace_back(std::move(elem));
     ++m_usedCount;
+    resizeUsedBits(size() - 1, size(), true);
     return HandleT(size() - 1);
 }
 
@@ -105,6 +111,7 @@ void StableVector<HandleT, ElemT>::increaseSize(HandleType upTo)
         panic("call to increaseSize() with a valid handle!");
     }
 
+    resizeUsedBits(size(), upTo.idx(), false);
     m_elements.resize(upTo.idx(), boost::none);
 }
 
@@ -116,6 +123,8 @@ void StableVector<HandleT, ElemT>::increaseSize(HandleType upTo, const ElementTy
         panic("call to increaseSize() with a valid handle!");
     }
 
+    m_usedCount += upTo.idx() - size();
+    resizeUsedBits(size(), upTo.idx(), true);
     m_elements.resize(upTo.idx(), elem);
 }
 
@@ -132,12 +141,15 @@ void StableVector<HandleT, ElemT>::erase(HandleType handle)
 
     m_elements[handle.idx()] = boost::none;
     --m_usedCount;
+    setUsedBit(handle.idx(), false);
 }
 
 template<typename HandleT, typename ElemT>
 void StableVector<HandleT, ElemT>::clear()
 {
     m_elements.clear();
+    m_usedBits.clear();
+    m_usedCount = 0;
 }
 
 template<typename HandleT, typename ElemT>
@@ -199,6 +211,7 @@ void StableVector<HandleT, ElemT>::set(HandleType handle, const ElementType& ele
     if (!m_elements[handle.idx()])
     {
         ++m_usedCount;
+        setUsedBit(handle.idx(), true);
     }
     m_elements[handle.idx()] = elem;
 };
@@ -216,6 +229,7 @@ void StableVector<HandleT, ElemT>::set(HandleType handle, ElementType&& elem)
     if (!m_elements[handle.idx()])
     {
         ++m_usedCount;
+        setUsedBit(handle.idx(), true);
     }
     m_elements[handle.idx()] = elem;
 };
@@ -226,29 +240,151 @@ void StableVector<HandleT, ElemT>::reserve(size_t newCap)
     m_elements.reserve(newCap);
 };
 
+template<typename HandleT, typename ElemT>
+size_t StableVector<HandleT, ElemT>::nextUsedIndex(size_t pos) const
+{
+    // Without deleted elements, every index is used
+    if (m_usedCount == m_elements.size())
+    {
+        return std::min(pos, m_elements.size());
+    }
+
+    // Scan the bitmap for the next set bit
+    size_t word = pos / 64;
+    if (word >= m_usedBits.size())
+    {
+        return m_elements.size();
+    }
+
+    uint64_t bits = m_usedBits[word] & (~uint64_t(0) << (pos % 64));
+    while (bits == 0)
+    {
+        if (++word == m_usedBits.size())
+        {
+            return m_elements.size();
+        }
+        bits = m_usedBits[word];
+    }
+    return std::min(word * 64 + __builtin_ctzll(bits), m_elements.size());
+}
+
+template<typename HandleT, typename ElemT>
+void StableVector<HandleT, ElemT>::setUsedBit(size_t idx, bool used)
+{
+    if (used)
+    {
+        m_usedBits[idx / 64] |= uint64_t(1) << (idx % 64);
+    }
+    else
+    {
+        m_usedBits[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+    }
+}
+
+template<typename HandleT, typename ElemT>
+void StableVector<HandleT, ElemT>::resizeUsedBits(size_t oldSize, size_t newSize, bool used)
+{
+    // Bits behind the last element are always zero
+    m_usedBits.resize((newSize + 63) / 64, 0);
+    if (used)
+    {
+        for (size_t i = oldSize; i < newSize; i++)
+        {
+            setUsedBit(i, true);
+        }
+    }
+    if (newSize % 64 != 0)
+    {
+        m_usedBits.back() &= (uint64_t(1) << (newSize % 64)) - 1;
+    }
+}
+
+template<typename HandleT, typename ElemT>
+HandleRemap<HandleT> StableVector<HandleT, ElemT>::compact()
+{
+    vector<Index> newIndices(size(), HandleRemap<HandleT>::INVALID);
+
+    size_t next = 0;
+    for (size_t i = nextUsedIndex(0); i < size(); i = nextUsedIndex(i + 1))
+    {
+        if (i != next)
+        {
+            m_elements[next] = std::move(m_elements[i]);
+        }
+        newIndices[i] = next;
+        next++;
+    }
+
+    m_elements.erase(m_elements.begin() + next, m_elements.end());
+    m_elements.shrink_to_fit();
+    m_usedBits.clear();
+    resizeUsedBits(0, next, true);
+    m_usedBits.shrink_to_fit();
+    m_usedCount = next;
+
+    return HandleRemap<HandleT>(std::move(newIndices), next);
+}
+
+template<typename HandleT, typename ElemT>
+void StableVector<HandleT, ElemT>::remap(const HandleRemap<HandleType>& remap)
+{
+    // Elements are only moved to the front, so this can be done in place
+    size_t newSize = 0;
+    size_t end = std::min(size(), remap.oldSize());
+    for (size_t i = 0; i < end; i++)
+    {
+        Index newIdx = remap.newIndices()[i];
+        if (newIdx == HandleRemap<HandleT>::INVALID)
+        {
+            m_elements[i] = boost::none;
+            continue;
+        }
+        if (newIdx > i)
+        {
+            panic("StableVector::remap() called with a remapping that does not preserve the order");
+        }
+        if (newIdx != i)
+        {
+            m_elements[newIdx] = std::move(m_elements[i]);
+            m_elements[i] = boost::none;
+        }
+        newSize = newIdx + 1;
+    }
+
+    m_elements.resize(std::max(newSize, remap.newSize()));
+    m_elements.shrink_to_fit();
+
+    m_usedBits.assign((m_elements.size() + 63) / 64, 0);
+    m_usedCount = 0;
+    for (size_t i = 0; i < m_elements.size(); i++)
+    {
+        if (m_elements[i])
+        {
+            setUsedBit(i, true);
+            m_usedCount++;
+        }
+    }
+}
+
 template<typename HandleT, typename ElemT>
 StableVectorIterator<HandleT, ElemT> StableVector<HandleT, ElemT>::begin() const
 {
-    return StableVectorIterator<HandleT, ElemT>(&this->m_elements);
+    return StableVectorIterator<HandleT, ElemT>(this);
 }
 
 template<typename HandleT, typename ElemT>
 StableVectorIterator<HandleT, ElemT> StableVector<HandleT, ElemT>::end() const
 {
-    return StableVectorIterator<HandleT, ElemT>(&this->m_elements, true);
+    return StableVectorIterator<HandleT, ElemT>(this, true);
 }
 
 template<typename HandleT, typename ElemT>
 StableVectorIterator<HandleT, ElemT>::StableVectorIterator(
-    const vector<boost::optional<ElemT>>* deleted,
+    const StableVector<HandleT, ElemT>* vector,
     bool startAtEnd
 )
-    : m_elements(deleted), m_pos(startAtEnd ? deleted->size() : 0)
+    : m_vector(vector), m_pos(startAtEnd ? vector->size() : vector->nextUsedIndex(0))
 {
-    if (m_pos == 0 && !m_elements->empty() && !(*m_elements)[0])
-    {
-        ++(*this);
-    }
 }
 
 template<typename HandleT, typename ElemT>
@@ -261,7 +397,7 @@ StableVectorIterator<HandleT, ElemT>& StableVectorIterator<HandleT, ElemT>::oper
         return *this;
     }
     m_pos = other.m_pos;
-    m_elements = other.m_elements;
+    m_vector = other.m_vector;
 
     return *this;
 }
@@ -271,7 +407,7 @@ bool StableVectorIterator<HandleT, ElemT>::operator==(
     const StableVectorIterator<HandleT, ElemT>& other
 ) const
 {
-    return m_pos == other.m_pos && m_elements == other.m_elements;
+    return m_pos == other.m_pos && m_vector == other.m_vector;
 }
 
 template<typename HandleT, typename ElemT>
@@ -285,18 +421,9 @@ bool StableVectorIterator<HandleT, ElemT>::operator!=(
 template<typename HandleT, typename ElemT>
 StableVectorIterator<HandleT, ElemT>& StableVectorIterator<HandleT, ElemT>::operator++()
 {
-    // If not at the end, advance by one element
-    if (m_pos < m_elements->size())
-    {
-        m_pos++;
-    }
-
-    // Advance until the next element, at most 1 element behind the vector, to
+    // Advance to the next element, at most 1 element behind the vector, to
     // indicate the end of iteration.
-    while (m_pos < m_elements->size() && !(*m_elements)[m_pos])
-    {
-        m_pos++;
-    }
+    m_pos = m_vector->nextUsedIndex(m_pos + 1);
 
     return *this;
 }
@@ -304,7 +431,7 @@ StableVectorIterator<HandleT, ElemT>& StableVectorIterator<HandleT, ElemT>::oper
 template<typename HandleT, typename ElemT>
 bool StableVectorIterator<HandleT, ElemT>::isAtEnd() const
 {
-    return m_pos == m_elements->size();
+    return m_pos == m_vector->size();
 }
 
 template<typename HandleT, typename ElemT>
@@ -105,6 +105,12 @@ public:
     AttributeMapHandleIteratorPtr<HandleT> begin() const final;
     AttributeMapHandleIteratorPtr<HandleT> end() const final;
 
+    /**
+     * @brief Remaps the values in place, without rebuilding the map.
+     *
+     * @see StableVector::remap()
+     */
+    void remap(const HandleRemap<HandleT>& remap) final;
 
     /**
      * @see StableVector::reserve(size_t)
@@ -125,6 +125,12 @@ boost::optional<const ValueT&> VectorMap<HandleT, ValueT>::get(HandleT key) cons
     return (!m_vec.get(key) && m_default) ? *m_default : res;
 }
 
+template<typename HandleT, typename ValueT>
+void VectorMap<HandleT, ValueT>::remap(const HandleRemap<HandleT>& remap)
+{
+    m_vec.remap(remap);
+}
+
 template<typename HandleT, typename ValueT>
 size_t VectorMap<HandleT, ValueT>::numValues() const
 {
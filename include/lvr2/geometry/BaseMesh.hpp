@@ -74,12 +74,36 @@ public:
     using HandleType = HandleT;
 };
 
-/// A wrapper for the MeshHandleIterator to save beloved future programmers from dereferencing too much <3
+/**
+ * @brief A wrapper for the MeshHandleIterator to save beloved future programmers from dereferencing too much <3
+ *
+ * Besides wrapping a MeshHandleIterator, this class can work as a plain
+ * cursor over the handle indices of a mesh. In that mode no iterator object
+ * is allocated and only advancing the cursor calls into the mesh
+ * implementation.
+ */
 template<typename HandleT>
 class MeshHandleIteratorPtr
 {
 public:
+    /**
+     * @brief Returns the index of the next handle after `pos` in the given
+     *        container. The container is passed to the cursor constructor.
+     */
+    using AdvanceFunc = size_t (*)(const void* container, size_t pos);
+
     MeshHandleIteratorPtr(std::unique_ptr<MeshHandleIterator<HandleT>> iter) : m_iter(std::move(iter)) {};
+
+    /**
+     * @brief Creates a cursor at the handle index `pos`.
+     *
+     * @param container     The storage that is iterated, passed to `advance`
+     * @param pos           Index of the current handle
+     * @param advance       Returns the index of the next handle
+     */
+    MeshHandleIteratorPtr(const void* container, size_t pos, AdvanceFunc advance)
+        : m_container(container), m_pos(pos), m_advance(advance) {};
+
     MeshHandleIteratorPtr& operator++();
     bool operator==(const MeshHandleIteratorPtr& other) const;
     bool operator!=(const MeshHandleIteratorPtr& other) const;
@@ -88,6 +112,11 @@ public:
     using HandleType = HandleT;
 private:
     std::unique_ptr<MeshHandleIterator<HandleT>> m_iter;
+
+    /// Cursor state, only used if `m_advance` is set
+    const void* m_container = nullptr;
+    size_t m_pos = 0;
+    AdvanceFunc m_advance = nullptr;
 };
 
 // Forward declaration
@@ -43,25 +43,44 @@ namespace lvr2
 template<typename HandleT>
 MeshHandleIteratorPtr<HandleT>& MeshHandleIteratorPtr<HandleT>::operator++()
 {
-    ++(*m_iter);
+    if (m_advance)
+    {
+        m_pos = m_advance(m_container, m_pos);
+    }
+    else
+    {
+        ++(*m_iter);
+    }
     return *this;
 }
 
 template<typename HandleT>
 bool MeshHandleIteratorPtr<HandleT>::operator==(const MeshHandleIteratorPtr<HandleT>& other) const
 {
+    if (m_advance || other.m_advance)
+    {
+        return m_pos == other.m_pos && m_container == other.m_container && !m_iter && !other.m_iter;
+    }
     return *m_iter == *other.m_iter;
 }
 
 template<typename HandleT>
 bool MeshHandleIteratorPtr<HandleT>::operator!=(const MeshHandleIteratorPtr<HandleT>& other) const
 {
+    if (m_advance || other.m_advance)
+    {
+        return !(*this == other);
+    }
     return *m_iter != *other.m_iter;
 }
 
 template<typename HandleT>
 HandleT MeshHandleIteratorPtr<HandleT>::operator*() const
 {
+    if (m_advance)
+    {
+        return HandleT(m_pos);
+    }
     return **m_iter;
 }
 
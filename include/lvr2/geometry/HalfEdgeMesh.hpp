@@ -57,6 +57,21 @@ using std::min;
 namespace lvr2
 {
 
+// Forward declarations
+template<typename, typename> class HemHandleIterator;
+template<typename> class HemEdgeHandleIterator;
+template<typename> class HemHandleRange;
+
+/**
+ * @brief Handle remappings returned by `HalfEdgeMesh::compact()`.
+ */
+struct MeshCompactionResult
+{
+    HandleRemap<VertexHandle> vertices;
+    HandleRemap<FaceHandle> faces;
+    HandleRemap<EdgeHandle> edges;
+};
+
 /**
  * @brief Half-edge data structure implementing the `BaseMesh` interface.
  *
@@ -139,12 +154,71 @@ public:
     MeshHandleIteratorPtr<EdgeHandle> edgesEnd() const final;
 
 
+    // ========================================================================
+    // = Non-virtual iteration
+    // ========================================================================
+
+    /**
+     * @brief Returns a range over all vertex handles.
+     *
+     * In contrast to `vertices()`, the range and its iterators are plain
+     * value types without virtual calls, so loops over them can be inlined
+     * completely. The same rules as for `vertices()` apply: elements must
+     * not be added while iterating, removing elements is fine.
+     */
+    HemHandleRange<HemHandleIterator<VertexHandle, Vertex>> vertexHandles() const;
+
+    /// See `vertexHandles()`
+    HemHandleRange<HemHandleIterator<FaceHandle, Face>> faceHandles() const;
+
+    /// See `vertexHandles()`
+    HemHandleRange<HemEdgeHandleIterator<BaseVecT>> edgeHandles() const;
+
+    /**
+     * @brief Calls `visitor(FaceHandle)` for each face adjacent to the given
+     *        vertex. Unlike `getFacesOfVertex()` no vector is filled.
+     */
+    template <typename Visitor>
+    void forEachFaceOfVertex(VertexHandle handle, Visitor visitor) const;
+
+    /**
+     * @brief Calls `visitor(EdgeHandle)` for each edge adjacent to the given
+     *        vertex.
+     */
+    template <typename Visitor>
+    void forEachEdgeOfVertex(VertexHandle handle, Visitor visitor) const;
+
+    /**
+     * @brief Calls `visitor(VertexHandle)` for each vertex connected to the
+     *        given vertex by an edge.
+     */
+    template <typename Visitor>
+    void forEachNeighbourOfVertex(VertexHandle handle, Visitor visitor) const;
+
+    /**
+     * @brief Calls `visitor(FaceHandle)` for each face that shares an edge
+     *        with the given face.
+     */
+    template <typename Visitor>
+    void forEachNeighbourOfFace(FaceHandle handle, Visitor visitor) const;
+
     // ========================================================================
     // = Other public methods
     // ========================================================================
 
     bool debugCheckMeshIntegrity() const;
 
+    /**
+     * @brief Removes the holes that deleted elements left in the internal
+     *        storage, so that handles are dense again.
+     *
+     * This invalidates all handles! The relative order of the elements is
+     * preserved. All attribute maps referring to this mesh have to be
+     * updated with the returned remappings, e.g. with
+     * `remapAttributeMaps(result.faces, faceNormals, ...)`.
+     */
+    MeshCompactionResult compact();
+
 private:
     StableVector<HalfEdgeHandle, Edge> m_edges;
     StableVector<FaceHandle, Face> m_faces;
@@ -246,10 +320,24 @@ private:
      */
     array<HalfEdgeHandle, 3> getInnerEdges(FaceHandle handle) const;
 
+    /**
+     * @brief Returns the index of the first full edge at or after the half
+     *        edge index `pos`, or `m_edges.size()` if there is none.
+     */
+    size_t nextFullEdgeIndex(size_t pos) const;
+
+    /// Advances the cursors returned by `verticesBegin()` and `facesBegin()`
+    template<typename HandleT, typename ElemT>
+    static size_t advanceFevCursor(const void* elements, size_t pos);
+
+    /// Advances the cursors returned by `edgesBegin()`
+    static size_t advanceEdgeCursor(const void* mesh, size_t pos);
+
     // ========================================================================
     // = Friends
     // ========================================================================
     template<typename> friend class HemEdgeIterator;
+    template<typename> friend class HemEdgeHandleIterator;
 };
 
 /// Implementation of the MeshHandleIterator for the HalfEdgeMesh
@@ -286,6 +374,71 @@ private:
     const HalfEdgeMesh<BaseVecT>& m_mesh;
 };
 
+/**
+ * @brief Non-virtual iterator over the vertex or face handles of a
+ *        HalfEdgeMesh, see `HalfEdgeMesh::vertexHandles()`.
+ */
+template<typename HandleT, typename ElemT>
+class HemHandleIterator
+{
+public:
+    HemHandleIterator(const StableVector<HandleT, ElemT>* elements, size_t pos)
+        : m_elements(elements), m_pos(pos) {};
+
+    HemHandleIterator& operator++()
+    {
+        m_pos = m_elements->nextUsedIndex(m_pos + 1);
+        return *this;
+    }
+    bool operator==(const HemHandleIterator& other) const { return m_pos == other.m_pos; }
+    bool operator!=(const HemHandleIterator& other) const { return m_pos != other.m_pos; }
+    HandleT operator*() const { return HandleT(m_pos); }
+
+private:
+    const StableVector<HandleT, ElemT>* m_elements;
+    size_t m_pos;
+};
+
+/**
+ * @brief Non-virtual iterator over the edge handles of a HalfEdgeMesh, see
+ *        `HalfEdgeMesh::edgeHandles()`.
+ */
+template<typename BaseVecT>
+class HemEdgeHandleIterator
+{
+public:
+    HemEdgeHandleIterator(const HalfEdgeMesh<BaseVecT>* mesh, size_t pos)
+        : m_mesh(mesh), m_pos(pos) {};
+
+    HemEdgeHandleIterator& operator++()
+    {
+        m_pos = m_mesh->nextFullEdgeIndex(m_pos + 1);
+        return *this;
+    }
+    bool operator==(const HemEdgeHandleIterator& other) const { return m_pos == other.m_pos; }
+    bool operator!=(const HemEdgeHandleIterator& other) const { return m_pos != other.m_pos; }
+    EdgeHandle operator*() const { return EdgeHandle(m_pos); }
+
+private:
+    const HalfEdgeMesh<BaseVecT>* m_mesh;
+    size_t m_pos;
+};
+
+/// A pair of iterators that can be used in range based for loops
+template<typename IteratorT>
+class HemHandleRange
+{
+public:
+    HemHandleRange(IteratorT begin, IteratorT end) : m_begin(begin), m_end(end) {};
+
+    IteratorT begin() const { return m_begin; }
+    IteratorT end() const { return m_end; }
+
+private:
+    IteratorT m_begin;
+    IteratorT m_end;
+};
+
 } // namespace lvr2
 
 #include "lvr2/geometry/HalfEdgeMesh.tcc"
@@ -636,31 +636,10 @@ void HalfEdgeMesh<BaseVecT>::getNeighboursOfFace(
     vector<FaceHandle>& facesOut
 ) const
 {
-    auto face = getF(handle);
-
-    // Get inner edges in counter clockwise order
-    auto e1 = getE(face.edge);
-    auto e2 = getE(e1.next);
-    auto e3 = getE(e2.next);
-
-    // Get twins of inner edges
-    auto e1t = getE(e1.twin);
-    auto e2t = getE(e2.twin);
-    auto e3t = getE(e3.twin);
-
-    // Get neighbour faces
-    if (e1t.face)
+    forEachNeighbourOfFace(handle, [&facesOut](FaceHandle fH)
     {
-        facesOut.push_back(e1t.face.unwrap());
-    }
-    if (e2t.face)
-    {
-        facesOut.push_back(e2t.face.unwrap());
-    }
-    if (e3t.face)
-    {
-        facesOut.push_back(e3t.face.unwrap());
-    }
+        facesOut.push_back(fH);
+    });
 }
 
 template<typename BaseVecT>
@@ -703,14 +682,9 @@ void HalfEdgeMesh<BaseVecT>::getFacesOfVertex(
     vector<FaceHandle>& facesOut
 ) const
 {
-    circulateAroundVertex(handle, [&facesOut, this](auto eH)
+    forEachFaceOfVertex(handle, [&facesOut](FaceHandle fH)
     {
-        auto edge = getE(eH);
-        if (edge.face)
-        {
-            facesOut.push_back(edge.face.unwrap());
-        }
-        return true;
+        facesOut.push_back(fH);
     });
 }
 
@@ -742,13 +716,66 @@ void HalfEdgeMesh<BaseVecT>::getNeighboursOfVertex(
     vector<VertexHandle>& verticesOut
 ) const
 {
-    circulateAroundVertex(handle, [&verticesOut, this](auto eH)
+    forEachNeighbourOfVertex(handle, [&verticesOut](VertexHandle vH)
+    {
+        verticesOut.push_back(vH);
+    });
+}
+
+template <typename BaseVecT>
+template <typename Visitor>
+void HalfEdgeMesh<BaseVecT>::forEachFaceOfVertex(VertexHandle handle, Visitor visitor) const
+{
+    circulateAroundVertex(handle, [&visitor, this](auto eH)
     {
-        verticesOut.push_back(getE(getE(eH).twin).target);
+        const auto& edge = getE(eH);
+        if (edge.face)
+        {
+            visitor(edge.face.unwrap());
+        }
         return true;
     });
 }
 
+template <typename BaseVecT>
+template <typename Visitor>
+void HalfEdgeMesh<BaseVecT>::forEachEdgeOfVertex(VertexHandle handle, Visitor visitor) const
+{
+    circulateAroundVertex(handle, [&visitor, this](auto eH)
+    {
+        visitor(halfToFullEdgeHandle(eH));
+        return true;
+    });
+}
+
+template <typename BaseVecT>
+template <typename Visitor>
+void HalfEdgeMesh<BaseVecT>::forEachNeighbourOfVertex(VertexHandle handle, Visitor visitor) const
+{
+    circulateAroundVertex(handle, [&visitor, this](auto eH)
+    {
+        visitor(getE(getE(eH).twin).target);
+        return true;
+    });
+}
+
+template <typename BaseVecT>
+template <typename Visitor>
+void HalfEdgeMesh<BaseVecT>::forEachNeighbourOfFace(FaceHandle handle, Visitor visitor) const
+{
+    auto eH = getF(handle).edge;
+    for (int i = 0; i < 3; i++)
+    {
+        const auto& edge = getE(eH);
+        const auto& twin = getE(edge.twin);
+        if (twin.face)
+        {
+            visitor(twin.face.unwrap());
+        }
+        eH = edge.next;
+    }
+}
+
 /**
  * finds the common neighbors of two vertices
  * @tparam BaseVecT
@@ -1693,6 +1720,68 @@ EdgeHandle HalfEdgeMesh<BaseVecT>::halfToFullEdgeHandle(HalfEdgeHandle handle) c
 // ========================================================================
 // = Other public methods
 // ========================================================================
+template <typename BaseVecT>
+MeshCompactionResult HalfEdgeMesh<BaseVecT>::compact()
+{
+    auto vertexRemap = m_vertices.compact();
+    auto faceRemap = m_faces.compact();
+    auto halfEdgeRemap = m_edges.compact();
+
+    const auto& newV = vertexRemap.newIndices();
+    const auto& newF = faceRemap.newIndices();
+    const auto& newE = halfEdgeRemap.newIndices();
+
+    // After compacting, all elements are stored without holes and only the
+    // handles stored inside of them have to be rewritten
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < m_edges.size(); i++)
+    {
+        auto& edge = m_edges[HalfEdgeHandle(i)];
+        edge.target = VertexHandle(newV[edge.target.idx()]);
+        edge.next = HalfEdgeHandle(newE[edge.next.idx()]);
+        edge.twin = HalfEdgeHandle(newE[edge.twin.idx()]);
+        if (edge.face)
+        {
+            edge.face = FaceHandle(newF[edge.face.unwrap().idx()]);
+        }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < m_faces.size(); i++)
+    {
+        auto& face = m_faces[FaceHandle(i)];
+        face.edge = HalfEdgeHandle(newE[face.edge.idx()]);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < m_vertices.size(); i++)
+    {
+        auto& vertex = m_vertices[VertexHandle(i)];
+        if (vertex.outgoing)
+        {
+            vertex.outgoing = HalfEdgeHandle(newE[vertex.outgoing.unwrap().idx()]);
+        }
+    }
+
+    // A full edge is represented by the half edge with the smaller index.
+    // Since compacting preserves the order, this is still the same half edge.
+    vector<Index> newEdgeIndices(newE.size(), HandleRemap<EdgeHandle>::INVALID);
+    for (size_t i = 0; i < newE.size(); i++)
+    {
+        auto newIdx = newE[i];
+        if (newIdx != HandleRemap<HalfEdgeHandle>::INVALID && newIdx < m_edges[HalfEdgeHandle(newIdx)].twin.idx())
+        {
+            newEdgeIndices[i] = newIdx;
+        }
+    }
+
+    return MeshCompactionResult{
+        std::move(vertexRemap),
+        std::move(faceRemap),
+        HandleRemap<EdgeHandle>(std::move(newEdgeIndices), m_edges.size())
+    };
+}
+
 template <typename BaseVecT>
 bool HalfEdgeMesh<BaseVecT>::debugCheckMeshIntegrity() const
 {
@@ -2089,11 +2178,40 @@ EdgeHandle HemEdgeIterator<BaseVecT>::operator*() const
     return m_mesh.halfToFullEdgeHandle(*m_iterator);
 }
 
+template <typename BaseVecT>
+template <typename HandleT, typename ElemT>
+size_t HalfEdgeMesh<BaseVecT>::advanceFevCursor(const void* elements, size_t pos)
+{
+    return static_cast<const StableVector<HandleT, ElemT>*>(elements)->nextUsedIndex(pos + 1);
+}
+
+template <typename BaseVecT>
+size_t HalfEdgeMesh<BaseVecT>::advanceEdgeCursor(const void* mesh, size_t pos)
+{
+    return static_cast<const HalfEdgeMesh<BaseVecT>*>(mesh)->nextFullEdgeIndex(pos + 1);
+}
+
+template <typename BaseVecT>
+size_t HalfEdgeMesh<BaseVecT>::nextFullEdgeIndex(size_t pos) const
+{
+    // Only the half edge with the smaller index represents the full edge.
+    // Half edges are always created in pairs by `addEdgePair()`, so these
+    // are the even indices. Odd indices are checked to be on the safe side.
+    pos = m_edges.nextUsedIndex(pos + (pos & 1));
+    while (pos < m_edges.size() && (pos & 1) && m_edges[HalfEdgeHandle(pos)].twin.idx() < pos)
+    {
+        pos = m_edges.nextUsedIndex(pos + 1);
+    }
+    return pos;
+}
+
 template <typename BaseVecT>
 MeshHandleIteratorPtr<VertexHandle> HalfEdgeMesh<BaseVecT>::verticesBegin() const
 {
     return MeshHandleIteratorPtr<VertexHandle>(
-        std::make_unique<HemFevIterator<VertexHandle, Vertex>>(this->m_vertices.begin())
+        &this->m_vertices,
+        this->m_vertices.nextUsedIndex(0),
+        &advanceFevCursor<VertexHandle, Vertex>
     );
 }
 
@@ -2101,7 +2219,9 @@ template <typename BaseVecT>
 MeshHandleIteratorPtr<VertexHandle> HalfEdgeMesh<BaseVecT>::verticesEnd() const
 {
     return MeshHandleIteratorPtr<VertexHandle>(
-        std::make_unique<HemFevIterator<VertexHandle, Vertex>>(this->m_vertices.end())
+        &this->m_vertices,
+        this->m_vertices.size(),
+        &advanceFevCursor<VertexHandle, Vertex>
     );
 }
 
@@ -2109,7 +2229,9 @@ template <typename BaseVecT>
 MeshHandleIteratorPtr<FaceHandle> HalfEdgeMesh<BaseVecT>::facesBegin() const
 {
     return MeshHandleIteratorPtr<FaceHandle>(
-        std::make_unique<HemFevIterator<FaceHandle, Face>>(this->m_faces.begin())
+        &this->m_faces,
+        this->m_faces.nextUsedIndex(0),
+        &advanceFevCursor<FaceHandle, Face>
     );
 }
 
@@ -2117,24 +2239,51 @@ template <typename BaseVecT>
 MeshHandleIteratorPtr<FaceHandle> HalfEdgeMesh<BaseVecT>::facesEnd() const
 {
     return MeshHandleIteratorPtr<FaceHandle>(
-        std::make_unique<HemFevIterator<FaceHandle, Face>>(this->m_faces.end())
+        &this->m_faces,
+        this->m_faces.size(),
+        &advanceFevCursor<FaceHandle, Face>
     );
 }
 
 template <typename BaseVecT>
 MeshHandleIteratorPtr<EdgeHandle> HalfEdgeMesh<BaseVecT>::edgesBegin() const
 {
-    return MeshHandleIteratorPtr<EdgeHandle>(
-        std::make_unique<HemEdgeIterator<BaseVecT>>(this->m_edges.begin(), *this)
-    );
+    return MeshHandleIteratorPtr<EdgeHandle>(this, nextFullEdgeIndex(0), &advanceEdgeCursor);
 }
 
 template <typename BaseVecT>
 MeshHandleIteratorPtr<EdgeHandle> HalfEdgeMesh<BaseVecT>::edgesEnd() const
 {
-    return MeshHandleIteratorPtr<EdgeHandle>(
-        std::make_unique<HemEdgeIterator<BaseVecT>>(this->m_edges.end(), *this)
-    );
+    return MeshHandleIteratorPtr<EdgeHandle>(this, this->m_edges.size(), &advanceEdgeCursor);
+}
+
+template <typename BaseVecT>
+HemHandleRange<HemHandleIterator<VertexHandle, typename HalfEdgeMesh<BaseVecT>::Vertex>>
+    HalfEdgeMesh<BaseVecT>::vertexHandles() const
+{
+    return {
+        HemHandleIterator<VertexHandle, Vertex>(&m_vertices, m_vertices.nextUsedIndex(0)),
+        HemHandleIterator<VertexHandle, Vertex>(&m_vertices, m_vertices.size())
+    };
+}
+
+template <typename BaseVecT>
+HemHandleRange<HemHandleIterator<FaceHandle, typename HalfEdgeMesh<BaseVecT>::Face>>
+    HalfEdgeMesh<BaseVecT>::faceHandles() const
+{
+    return {
+        HemHandleIterator<FaceHandle, Face>(&m_faces, m_faces.nextUsedIndex(0)),
+        HemHandleIterator<FaceHandle, Face>(&m_faces, m_faces.size())
+    };
+}
+
+template <typename BaseVecT>
+HemHandleRange<HemEdgeHandleIterator<BaseVecT>> HalfEdgeMesh<BaseVecT>::edgeHandles() const
+{
+    return {
+        HemEdgeHandleIterator<BaseVecT>(this, nextFullEdgeIndex(0)),
+        HemEdgeHandleIterator<BaseVecT>(this, m_edges.size())
+    };
 }
 
 } // namespace lvr2
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Quadric.hpp
+ */
+
+#ifndef LVR2_GEOMETRY_QUADRIC_H_
+#define LVR2_GEOMETRY_QUADRIC_H_
+
+#include <array>
+
+#include <boost/optional.hpp>
+
+#include "lvr2/geometry/Plane.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Error quadric of a set of planes.
+ *
+ * The quadric is a symmetric 4x4 matrix Q, such that v^T Q v is the sum of
+ * the squared distances of the point v to all planes. Quadrics of different
+ * sets of planes can simply be added. See: Garland, Heckbert. "Surface
+ * simplification using quadric error metrics." SIGGRAPH 1997.
+ */
+template<typename BaseVecT>
+struct Quadric
+{
+    /// Creates a zero quadric (an empty set of planes).
+    Quadric();
+
+    /// Creates the quadric of a single plane, scaled by `weight`.
+    Quadric(const Plane<BaseVecT>& plane, double weight = 1.0);
+
+    Quadric& operator+=(const Quadric& other);
+
+    Quadric operator+(const Quadric& other) const;
+
+    /// Returns the sum of squared distances of `pos` to all planes.
+    double error(const BaseVecT& pos) const;
+
+    /**
+     * @brief Returns the point with the smallest error or none, if that
+     *        point is not unique (e.g. all planes are parallel).
+     */
+    boost::optional<BaseVecT> optimum() const;
+
+    /// Upper triangle of the matrix, row by row
+    std::array<double, 10> m;
+};
+
+} // namespace lvr2
+
+#include "lvr2/geometry/Quadric.tcc"
+
+#endif /* LVR2_GEOMETRY_QUADRIC_H_ */
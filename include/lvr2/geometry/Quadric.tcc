@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Quadric.tcc
+ */
+
+#include <cmath>
+
+namespace lvr2
+{
+
+template<typename BaseVecT>
+Quadric<BaseVecT>::Quadric()
+{
+    m.fill(0);
+}
+
+template<typename BaseVecT>
+Quadric<BaseVecT>::Quadric(const Plane<BaseVecT>& plane, double weight)
+{
+    // Plane equation ax + by + cz + d = 0
+    double a = plane.normal.x;
+    double b = plane.normal.y;
+    double c = plane.normal.z;
+    double d = -plane.normal.dot(plane.pos);
+
+    m = {
+        a * a, a * b, a * c, a * d,
+               b * b, b * c, b * d,
+                      c * c, c * d,
+                             d * d
+    };
+    for (auto& value: m)
+    {
+        value *= weight;
+    }
+}
+
+template<typename BaseVecT>
+Quadric<BaseVecT>& Quadric<BaseVecT>::operator+=(const Quadric& other)
+{
+    for (size_t i = 0; i < m.size(); i++)
+    {
+        m[i] += other.m[i];
+    }
+    return *this;
+}
+
+template<typename BaseVecT>
+Quadric<BaseVecT> Quadric<BaseVecT>::operator+(const Quadric& other) const
+{
+    Quadric out = *this;
+    out += other;
+    return out;
+}
+
+template<typename BaseVecT>
+double Quadric<BaseVecT>::error(const BaseVecT& pos) const
+{
+    double x = pos.x;
+    double y = pos.y;
+    double z = pos.z;
+
+    return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+         + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+         + m[7] * z * z + 2 * m[8] * z
+         + m[9];
+}
+
+template<typename BaseVecT>
+boost::optional<BaseVecT> Quadric<BaseVecT>::optimum() const
+{
+    // Solve the 3x3 system A * v = -b with Cramer's rule, where A is the
+    // upper left block of the matrix and b the upper part of the last column
+    double c00 = m[4] * m[7] - m[5] * m[5];
+    double c01 = m[2] * m[5] - m[1] * m[7];
+    double c02 = m[1] * m[5] - m[2] * m[4];
+    double det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+
+    // Relative threshold, so that the result does not depend on the scale
+    // of the mesh.
+    double scale = m[0] + m[4] + m[7];
+    if (std::abs(det) <= 1e-9 * scale * scale * scale)
+    {
+        return boost::none;
+    }
+
+    double c11 = m[0] * m[7] - m[2] * m[2];
+    double c12 = m[1] * m[2] - m[0] * m[5];
+    double c22 = m[0] * m[4] - m[1] * m[1];
+
+    double bx = -m[3];
+    double by = -m[6];
+    double bz = -m[8];
+
+    return BaseVecT(
+        (c00 * bx + c01 * by + c02 * bz) / det,
+        (c01 * bx + c11 * by + c12 * bz) / det,
+        (c02 * bx + c12 * by + c22 * bz) / det
+    );
+}
+
+} // namespace lvr2
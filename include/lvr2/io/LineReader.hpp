@@ -39,7 +39,9 @@
 
 #include <boost/shared_array.hpp>
 #include <exception>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace lvr2
 {
@@ -62,6 +64,12 @@ struct fileAttribut
     bool m_ply;
     bool m_binary;
     size_t m_line_element_amount;
+
+    // Position of the first coordinate, normal and color component within
+    // a point, as byte offset for binary PLY files and as column otherwise
+    size_t m_pointOffset;
+    size_t m_normalOffset;
+    size_t m_colorOffset;
 };
 
 struct __attribute__((packed)) xyz
@@ -83,6 +91,27 @@ struct __attribute__((packed)) xyzc : xyz
     lvr2::color<unsigned char> color;
 };
 
+/**
+ * @brief Points of a consecutive part of an input file, decoded by
+ *        LineReader::readBatches(). normals and colors are empty if the
+ *        file has none.
+ */
+struct PointBatch
+{
+    /// Index of the input file
+    size_t file;
+
+    /// Interleaved x, y, z coordinates
+    std::vector<float> points;
+
+    /// Interleaved x, y, z normal components
+    std::vector<float> normals;
+
+    /// Interleaved r, g, b colors
+    std::vector<unsigned char> colors;
+
+    size_t size() const { return points.size() / 3; }
+};
 
 class LineReader
 {
@@ -106,6 +135,30 @@ public:
   bool ok();
   bool isPly() { return m_ply; }
 
+  /// Receives a decoded batch and the index of the calling thread
+  using BatchConsumer = std::function<void(const PointBatch&, int)>;
+
+  /**
+   * @brief Decodes all files concurrently. The files are split into chunks
+   *        that are parsed by up to \ref threads threads, ASCII files with a
+   *        fast number parser and binary PLY files by direct reads. Does not
+   *        change the position of getNextPoints().
+   *
+   * @param consumer    Called once per decoded chunk. If \ref ordered is
+   *                    true, the batches are passed one at a time in file
+   *                    order from the calling thread (thread index 0).
+   *                    Otherwise the consumer is called concurrently by the
+   *                    parsing threads with their index in [0, threads).
+   * @param ordered     Deliver the batches in file order
+   * @param threads     Number of parsing threads, OpenMPConfig::getNumThreads()
+   *                    if 0
+   * @param chunkSize   Approximate size of a chunk in bytes
+   */
+  void readBatches(const BatchConsumer& consumer,
+                   bool ordered,
+                   int threads = 0,
+                   size_t chunkSize = 1 << 26);
+
   class readException : public std::exception
   {
   public:
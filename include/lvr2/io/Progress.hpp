@@ -38,6 +38,10 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
 using std::stringstream;
 using std::cout;
@@ -65,6 +69,26 @@ namespace lvr2
 typedef void(*ProgressCallbackPtr)(int);
 typedef void(*ProgressTitleCallbackPtr)(string);
 
+/**
+ * @brief   Elapsed time and throughput of a progress bar phase
+ */
+struct ProgressTiming
+{
+    /// The prefix of the progress bar without time stamp
+    string      phase;
+
+    /// The number of performed iterations
+    size_t      iterations;
+
+    /// Time between the creation of the progress bar and its completion
+    double      seconds;
+
+    /// Performed iterations per second
+    double throughput() const { return seconds > 0 ? iterations / seconds : 0; }
+};
+
+typedef void(*ProgressTimingCallbackPtr)(const ProgressTiming&);
+
 class ProgressBar
 {
 
@@ -106,25 +130,67 @@ public:
      */
     static void setProgressTitleCallback(ProgressTitleCallbackPtr);
 
+    /**
+     * @brief   Registers a callback that is called with the elapsed time
+     *          of a progress bar once all iterations are performed, or
+     *          when it is destroyed before.
+     */
+    static void setTimingCallback(ProgressTimingCallbackPtr);
+
+    /// The number of counters the iterations are distributed over
+    static constexpr size_t NUM_COUNTERS = 64;
+
 protected:
 
+    /// Iteration counter of a group of threads on its own cache line
+    struct alignas(64) Counter
+    {
+        std::atomic<size_t> value;
+    };
+
+    /// Adds n iterations to the counter of the calling thread
+    void add(size_t n);
+
+    /// Sums up all counters and prints the progress if it changed
+    void update();
+
     /// Prints the output
     void print_bar();
 
+    /// Reports the elapsed time to the timing callback
+    void report_timing(size_t iterations);
+
     /// The prefix string
     string 			m_prefix;
 
     /// The number of iterations
     size_t			m_maxVal;
 
-        /// The current counter
-    size_t	 		m_currentVal;
+    /// The iterations performed by each thread. A thread only touches its
+    /// own counter, so increments in parallel loops do not contend.
+    std::array<Counter, NUM_COUNTERS>   m_counters;
+
+    /// The progress is updated after 2^m_updateShift iterations of a counter
+    unsigned int    m_updateShift;
+
+    /// If less iterations than this are left, the progress is updated
+    /// after every iteration to detect the completion
+    size_t          m_finalIterations;
 
-    /// A mutex object for counter increment (for parallel executions)
-    boost::mutex 	m_mutex;
+    /// True if the progress is updated after every iteration
+    std::atomic<bool>   m_final;
 
     /// The current progress in percent
-    int			m_percent;
+    std::atomic<int>	m_percent;
+
+    /// Serializes output and callbacks
+    std::mutex 	    m_mutex;
+
+    /// True if the timing of this progress bar was already reported
+    bool            m_timingReported;
+
+    /// Creation time of the progress bar
+    std::chrono::steady_clock::time_point m_start;
 
     /// A string stream for output generation
     stringstream	m_stream;
@@ -134,6 +200,7 @@ protected:
 
     static ProgressCallbackPtr 			m_progressCallback;
     static ProgressTitleCallbackPtr		m_titleCallback;
+    static ProgressTimingCallbackPtr    m_timingCallback;
 };
 
 
@@ -163,8 +230,8 @@ public:
 
 protected:
 
-    /// Prints the current state
-    void print_progress();
+    /// Prints the given counter value
+    void print_progress(size_t value);
 
     /// The prefix string
     string 			m_prefix;
@@ -173,10 +240,10 @@ protected:
     size_t			m_stepVal;
 
     /// The current counter value
-    size_t			m_currentVal;
+    std::atomic<size_t>	m_currentVal;
 
-    /// A mutex object for counter increment (for parallel executions)
-    boost::mutex 	m_mutex;
+    /// Serializes output
+    std::mutex 	    m_mutex;
 
     /// A string stream for output generation
     stringstream	m_stream;
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * TimingReport.hpp
+ */
+
+#ifndef LVR2_IO_TIMINGREPORT_HPP_
+#define LVR2_IO_TIMINGREPORT_HPP_
+
+#include "lvr2/io/Progress.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief   Collects the elapsed time and throughput of all progress bar
+ *          phases of a program run. The report is written as CSV file
+ *          with one line per phase, so that processing pipelines can log
+ *          per stage metrics without parsing the console output.
+ */
+class TimingReport
+{
+public:
+
+    /**
+     * @brief   Starts collecting the timings of all progress bars that
+     *          complete or are destroyed from now on.
+     */
+    static void enable();
+
+    /**
+     * @brief   Stops collecting timings. Collected entries are kept.
+     */
+    static void disable();
+
+    /**
+     * @brief   Adds a timing to the report. Thread safe.
+     */
+    static void add(const ProgressTiming& timing);
+
+    /**
+     * @brief   Returns all collected timings in the order of completion.
+     */
+    static std::vector<ProgressTiming> entries();
+
+    /**
+     * @brief   Removes all collected timings.
+     */
+    static void clear();
+
+    /**
+     * @brief   Writes the collected timings as CSV with the columns
+     *          phase, iterations, seconds and iterations_per_second.
+     */
+    static void write(std::ostream& os);
+
+    /**
+     * @brief   Writes the collected timings as CSV to the given file.
+     *
+     * @return  False if the file could not be written
+     */
+    static bool write(const std::string& filename);
+};
+
+} // namespace lvr2
+
+#endif /* LVR2_IO_TIMINGREPORT_HPP_ */
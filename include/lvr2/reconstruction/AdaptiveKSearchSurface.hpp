@@ -60,7 +60,7 @@
 // #include "SearchTreeStann.hpp"
 // #endif
 
-// #include "SearchTreeNanoflann.hpp"
+#include "SearchTreeNanoflann.hpp"
 #include "SearchTreeFlann.hpp"
 
 // // SearchTreePCL
@@ -144,6 +144,21 @@ public:
     virtual pair<typename BaseVecT::CoordType, typename BaseVecT::CoordType>
         distance(BaseVecT v) const;
 
+    /**
+     * @brief Batched version of @ref distance. A single k-search with a
+     *        larger k around the centroid of the block yields a candidate
+     *        set. For each query point the k nearest candidates are used if
+     *        the candidate ball provably contains its exact k-neighborhood,
+     *        otherwise a separate k-search is done. The results are therefore
+     *        identical to @ref distance.
+     */
+    virtual void distances(
+        const BaseVecT* queries,
+        size_t n,
+        typename BaseVecT::CoordType* projected,
+        typename BaseVecT::CoordType* euklidean
+    ) const;
+
     /**
      * @brief Calculates initial point normals using a least squares fit to
      *        the \ref m_kn nearest points
@@ -174,138 +174,165 @@ void AdaptiveKSearchSurface<BaseVecT>::calculateSurfaceNormals()
     string comment = timestamp.getElapsedTime() + "Estimating normals ";
     lvr2::ProgressBar progress(numPoints, comment);
 
-    #pragma omp parallel for schedule(static)
-    for(size_t i = 0; i < numPoints; i++) {
-        // We have to fit these vector to have the
-        // correct return values when performing the
-        // search on the stann kd tree. So we don't use
-        // the template parameter T for di
-        vector<size_t> id;
-        vector<float> di;
-
-        int n = 0;
-        size_t k = k_0;
-
-        while(n < 5)
+    // The neighborhoods are searched in blocks of points through the batch
+    // interface of the search tree. Points whose neighborhood is degenerated
+    // are searched again with twice the number of neighbors, at most five
+    // times.
+    const size_t blockSize = 1024;
+    const size_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+
+    #pragma omp parallel for schedule(dynamic)
+    for(size_t block = 0; block < numBlocks; block++)
+    {
+        size_t first = block * blockSize;
+        size_t last  = std::min(numPoints, first + blockSize);
+
+        vector<vector<size_t>> neighbors(last - first);
+        vector<size_t> pending(last - first);
+        for(size_t i = 0; i < pending.size(); i++)
+        {
+            pending[i] = i;
+        }
+
+        vector<BaseVecT> queries;
+        vector<size_t> ids;
+        vector<typename BaseVecT::CoordType> dists;
+        vector<size_t> remaining;
+        size_t kn = k_0;
+
+        for(int n = 1; n <= 5 && !pending.empty(); n++)
         {
-            n++;
             /**
              *  @todo Maybe this should be done at the end of the loop
              *        after the bounding box check
              */
-            k = k * 2;
-
-            //T* point = this->m_points[i];
+            kn = std::min<size_t>(kn * 2, numPoints);
 
-            id.clear();
-            di.clear();
-
-            this->m_searchTree->kSearch(pts[i], k, id, di);
+            queries.resize(pending.size());
+            for(size_t j = 0; j < pending.size(); j++)
+            {
+                queries[j] = pts[first + pending[j]];
+            }
 
-            float min_x = 1e15f;
-            float min_y = 1e15f;
-            float min_z = 1e15f;
-            float max_x = - min_x;
-            float max_y = - min_y;
-            float max_z = - min_z;
+            ids.resize(pending.size() * kn);
+            dists.resize(pending.size() * kn);
+            this->m_searchTree->kSearchMany(queries.data(), pending.size(), kn, ids.data(), dists.data());
 
-            float dx, dy, dz;
-            dx = dy = dz = 0;
+            remaining.clear();
+            for(size_t j = 0; j < pending.size(); j++)
+            {
+                const size_t* id = ids.data() + j * kn;
+
+                float min_x = 1e15f;
+                float min_y = 1e15f;
+                float min_z = 1e15f;
+                float max_x = - min_x;
+                float max_y = - min_y;
+                float max_z = - min_z;
+
+                // Calculate the bounding box of found point set
+                /**
+                 * @todo Use the bounding box object from the old model3d
+                 *       library for bounding box calculation...
+                 */
+                for(size_t l = 0; l < kn; l++)
+                {
+                    min_x = std::min(min_x, pts[id[l]][0]);
+                    min_y = std::min(min_y, pts[id[l]][1]);
+                    min_z = std::min(min_z, pts[id[l]][2]);
 
-            // Calculate the bounding box of found point set
-            /**
-             * @todo Use the bounding box object from the old model3d
-             *       library for bounding box calculation...
-             */
-            for(size_t j = 0; j < k; j++) {
-                min_x = std::min(min_x, pts[id[j]][0]);
-                min_y = std::min(min_y, pts[id[j]][1]);
-                min_z = std::min(min_z, pts[id[j]][2]);
-
-                max_x = std::max(max_x, pts[id[j]][0]);
-                max_y = std::max(max_y, pts[id[j]][1]);
-                max_z = std::max(max_z, pts[id[j]][2]);
-
-                dx = max_x - min_x;
-                dy = max_y - min_y;
-                dz = max_z - min_z;
-            }
+                    max_x = std::max(max_x, pts[id[l]][0]);
+                    max_y = std::max(max_y, pts[id[l]][1]);
+                    max_z = std::max(max_z, pts[id[l]][2]);
+                }
 
-            if(boundingBoxOK(dx, dy, dz))
-            {
-                break;
+                if(n < 5 && !boundingBoxOK(max_x - min_x, max_y - min_y, max_z - min_z))
+                {
+                    remaining.push_back(pending[j]);
+                }
+                else
+                {
+                    neighbors[pending[j]].assign(id, id + kn);
+                }
             }
+            pending.swap(remaining);
         }
 
-        // Create a query point for the current point
-        auto queryPoint = pts[i];
+        for(size_t i = first; i < last; i++)
+        {
+            const vector<size_t>& id = neighbors[i - first];
+            size_t k = id.size();
 
-        // Interpolate a plane based on the k-neighborhood
-        Plane<BaseVecT> p;
-        bool ransac_ok;
+            // Create a query point for the current point
+            auto queryPoint = pts[i];
 
-        if(m_calcMethod == 1)
-        {
-            p = calcPlaneRANSAC(queryPoint, k, id, ransac_ok);
-            // Fallback if RANSAC failed
-            if(!ransac_ok)
+            // Interpolate a plane based on the k-neighborhood
+            Plane<BaseVecT> p;
+            bool ransac_ok;
+
+            if(m_calcMethod == 1)
+            {
+                p = calcPlaneRANSAC(queryPoint, k, id, ransac_ok);
+                // Fallback if RANSAC failed
+                if(!ransac_ok)
+                {
+                    // compare speed
+                    p = calcPlane(queryPoint, k, id);
+                }
+            }
+            else if(m_calcMethod == 2)
+            {
+                p = calcPlaneIterative(queryPoint, k, id);
+            }
+            else
             {
-                // compare speed
                 p = calcPlane(queryPoint, k, id);
             }
-        }
-        else if(m_calcMethod == 2)
-        {
-            p = calcPlaneIterative(queryPoint, k, id);
-        }
-        else
-        {
-            p = calcPlane(queryPoint, k, id);
-        }
-        // Get the mean distance to the tangent plane
-        //mean_distance = meanDistance(p, id, k);
-        Normal<typename BaseVecT::CoordType> normal(0, 0, 1);
-        normal = p.normal;
+            // Get the mean distance to the tangent plane
+            //mean_distance = meanDistance(p, id, k);
+            Normal<typename BaseVecT::CoordType> normal(0, 0, 1);
+            normal = p.normal;
 
-        // Flip normals towards the center of the scene or nearest scan pose
-        if(m_poseTree)
-        {
-            vector<size_t> nearestPoseIds;
-            m_poseTree->kSearch(queryPoint, 1, nearestPoseIds);
-            if(nearestPoseIds.size() == 1)
+            // Flip normals towards the center of the scene or nearest scan pose
+            if(m_poseTree)
             {
-                BaseVecT nearest = pts[nearestPoseIds[0]];
-                Normal<typename BaseVecT::CoordType> dir(queryPoint - nearest);
-                if(normal.dot(dir) < 0)
+                vector<size_t> nearestPoseIds;
+                m_poseTree->kSearch(queryPoint, 1, nearestPoseIds);
+                if(nearestPoseIds.size() == 1)
                 {
-                    normal = -normal;
+                    BaseVecT nearest = pts[nearestPoseIds[0]];
+                    Normal<typename BaseVecT::CoordType> dir(queryPoint - nearest);
+                    if(normal.dot(dir) < 0)
+                    {
+                        normal = -normal;
+                    }
+                }
+                else
+                {
+                    cout << timestamp.getElapsedTime() << "Could not get nearest scan pose. Defaulting to centroid." << endl;
+                    Normal<typename BaseVecT::CoordType> dir(queryPoint - m_centroid);
+                    if(normal.dot(dir) < 0)
+                    {
+                        normal = -normal;
+                    }
                 }
             }
             else
             {
-                cout << timestamp.getElapsedTime() << "Could not get nearest scan pose. Defaulting to centroid." << endl;
                 Normal<typename BaseVecT::CoordType> dir(queryPoint - m_centroid);
                 if(normal.dot(dir) < 0)
                 {
                     normal = -normal;
                 }
             }
-        }
-        else
-        {
-            Normal<typename BaseVecT::CoordType> dir(queryPoint - m_centroid);
-            if(normal.dot(dir) < 0)
-            {
-                normal = -normal;
-            }
-        }
 
-        // Save result in normal array
-        normals[i*3 + 0] = normal.x;
-        normals[i*3 + 1] = normal.y;
-        normals[i*3 + 2] = normal.z;
+            // Save result in normal array
+            normals[i*3 + 0] = normal.x;
+            normals[i*3 + 1] = normal.y;
+            normals[i*3 + 2] = normal.z;
 
-        ++progress;
+            ++progress;
+        }
     }
     cout << endl;
 
@@ -322,6 +349,8 @@ void AdaptiveKSearchSurface<BaseVecT>::interpolateSurfaceNormals()
     size_t numPoints     = this->m_pointBuffer->numPoints();
     FloatChannel pts     = *(this->m_pointBuffer->getFloatChannel("points"));
     FloatChannel normals = *(this->m_pointBuffer->getFloatChannel("normals"));
+    // kSearchMany pads the neighborhoods of small point sets with invalid ids
+    size_t ki            = std::min<size_t>(this->m_ki, numPoints);
     // Create a temporal normal array for the
     vector<Normal<typename BaseVecT::CoordType>> tmp(
         numPoints,
@@ -332,38 +361,55 @@ void AdaptiveKSearchSurface<BaseVecT>::interpolateSurfaceNormals()
     string comment = timestamp.getElapsedTime() + "Interpolating normals ";
     lvr2::ProgressBar progress(numPoints, comment);
 
-    // Interpolate normals
-    #pragma omp parallel for schedule(static)
-    for( int i = 0; i < (int)numPoints; i++)
-    {
-        vector<size_t> id;
-        vector<float> di;
+    // Interpolate normals, the neighborhoods are searched in blocks
+    // of points through the batch interface of the search tree
+    const size_t blockSize = 1024;
+    const size_t numBlocks = (numPoints + blockSize - 1) / blockSize;
 
-        this->m_searchTree->kSearch(pts[i], this->m_ki, id, di);
+    #pragma omp parallel for schedule(dynamic)
+    for(size_t block = 0; block < numBlocks; block++)
+    {
+        size_t first = block * blockSize;
+        size_t last  = std::min(numPoints, first + blockSize);
 
-        BaseVecT mean = normals[i];
-        for(int j = 0; j < this->m_ki; j++)
+        vector<BaseVecT> queries(last - first);
+        for(size_t i = first; i < last; i++)
         {
-            mean += normals[id[j]];
+            queries[i - first] = pts[i];
         }
-        auto mean_normal = mean.normalized();
-        tmp[i] = mean_normal;
 
-        ///todo Try to remove this code. Should improve the results at all.
-        for(int j = 0; j < this->m_ki; j++)
+        vector<size_t> ids(queries.size() * ki);
+        vector<typename BaseVecT::CoordType> dists(queries.size() * ki);
+        this->m_searchTree->kSearchMany(queries.data(), queries.size(), ki, ids.data(), dists.data());
+
+        for(size_t i = first; i < last; i++)
         {
-            Normal<typename BaseVecT::CoordType> n = normals[id[j]];
+            const size_t* id = ids.data() + (i - first) * ki;
+
+            BaseVecT mean = normals[i];
+            for(size_t j = 0; j < ki; j++)
+            {
+                mean += normals[id[j]];
+            }
+            auto mean_normal = mean.normalized();
+            tmp[i] = mean_normal;
 
-            // Only override existing normals if the interpolated
-            // normals is significantly different from the initial
-            // estimation. This helps to avoid a too smooth normal
-            // field
-            if(fabs(n.dot(mean_normal)) > 0.2 )
+            ///todo Try to remove this code. Should improve the results at all.
+            for(size_t j = 0; j < ki; j++)
             {
-                normals[id[j]] = mean_normal;
+                Normal<typename BaseVecT::CoordType> n = normals[id[j]];
+
+                // Only override existing normals if the interpolated
+                // normals is significantly different from the initial
+                // estimation. This helps to avoid a too smooth normal
+                // field
+                if(fabs(n.dot(mean_normal)) > 0.2 )
+                {
+                    normals[id[j]] = mean_normal;
+                }
             }
+            ++progress;
         }
-        ++progress;
     }
     cout << endl;
     cout << timestamp.getElapsedTime() << "Copying normals..." << endl;
@@ -497,6 +543,151 @@ pair<typename BaseVecT::CoordType, typename BaseVecT::CoordType>
     // return make_pair(euklideanDistance, projectedDistance);
 }
 
+template<typename BaseVecT>
+void AdaptiveKSearchSurface<BaseVecT>::distances(
+    const BaseVecT* queries,
+    size_t n,
+    typename BaseVecT::CoordType* projected,
+    typename BaseVecT::CoordType* euklidean
+) const
+{
+    using CoordT = typename BaseVecT::CoordType;
+
+    if(n == 0)
+    {
+        return;
+    }
+
+    const CoordT* pts     = this->m_pointBuffer->getFloatChannel("points")->dataPtr().get();
+    const CoordT* normals = this->m_pointBuffer->getFloatChannel("normals")->dataPtr().get();
+    size_t numPoints      = this->m_pointBuffer->numPoints();
+    size_t k              = std::min<size_t>(this->m_kd, numPoints);
+
+    // Candidate neighborhood around the centroid of the block
+    BaseVecT center;
+    for(size_t i = 0; i < n; i++)
+    {
+        center += queries[i];
+    }
+    center /= n;
+
+    size_t numCandidates = std::min(numPoints, std::max<size_t>(8 * k, 64));
+
+    vector<size_t> id;
+    vector<CoordT> di;
+    this->m_searchTree->kSearch(center, numCandidates, id, di);
+
+    // Copy the candidates into a structure of arrays layout to get
+    // vectorizable distance computations
+    vector<CoordT> cx(numCandidates), cy(numCandidates), cz(numCandidates);
+    CoordT radius = 0;
+    for(size_t j = 0; j < numCandidates; j++)
+    {
+        cx[j] = pts[3 * id[j]];
+        cy[j] = pts[3 * id[j] + 1];
+        cz[j] = pts[3 * id[j] + 2];
+        radius = std::max(radius, (BaseVecT(cx[j], cy[j], cz[j]) - center).length());
+    }
+
+    // The candidates contain the whole point set, all searches are exact
+    if(numCandidates == numPoints)
+    {
+        radius = numeric_limits<CoordT>::max();
+    }
+
+    // Neighbors of all queries. Queries whose neighbors are not guaranteed
+    // to be among the candidates are searched in the tree afterwards in a
+    // single batch
+    vector<size_t> neighborIds(n * k);
+    vector<size_t> fallback;
+
+    vector<CoordT> sqrDist(numCandidates);
+    vector<size_t> order(numCandidates);
+    for(size_t i = 0; i < n; i++)
+    {
+        const BaseVecT& q = queries[i];
+
+        bool exact = false;
+        if(k <= numCandidates)
+        {
+            for(size_t j = 0; j < numCandidates; j++)
+            {
+                CoordT dx = cx[j] - q.x;
+                CoordT dy = cy[j] - q.y;
+                CoordT dz = cz[j] - q.z;
+                sqrDist[j] = dx * dx + dy * dy + dz * dz;
+            }
+
+            for(size_t j = 0; j < numCandidates; j++)
+            {
+                order[j] = j;
+            }
+            std::nth_element(order.begin(), order.begin() + (k - 1), order.end(),
+                [&](size_t a, size_t b) { return sqrDist[a] < sqrDist[b]; });
+
+            // Every point outside of the candidate ball is at least
+            // radius - |q - center| away from q
+            CoordT kthDistance = std::sqrt(sqrDist[order[k - 1]]);
+            exact = kthDistance + (q - center).length() <= radius;
+
+            for(size_t j = 0; exact && j < k; j++)
+            {
+                neighborIds[i * k + j] = id[order[j]];
+            }
+        }
+
+        if(!exact)
+        {
+            fallback.push_back(i);
+        }
+    }
+
+    if(!fallback.empty())
+    {
+        vector<BaseVecT> fallbackQueries(fallback.size());
+        for(size_t i = 0; i < fallback.size(); i++)
+        {
+            fallbackQueries[i] = queries[fallback[i]];
+        }
+
+        vector<size_t> fallbackIds(fallback.size() * k);
+        vector<CoordT> fallbackDists(fallback.size() * k);
+        this->m_searchTree->kSearchMany(
+            fallbackQueries.data(), fallback.size(), k, fallbackIds.data(), fallbackDists.data());
+
+        for(size_t i = 0; i < fallback.size(); i++)
+        {
+            std::copy(fallbackIds.begin() + i * k, fallbackIds.begin() + (i + 1) * k,
+                      neighborIds.begin() + fallback[i] * k);
+        }
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        const BaseVecT& q = queries[i];
+        const size_t* neighbors = neighborIds.data() + i * k;
+
+        CoordT nx = 0, ny = 0, nz = 0;
+        CoordT px = 0, py = 0, pz = 0;
+        for(size_t j = 0; j < k; j++)
+        {
+            size_t idx = 3 * neighbors[j];
+            px += pts[idx];
+            py += pts[idx + 1];
+            pz += pts[idx + 2];
+            nx += normals[idx];
+            ny += normals[idx + 1];
+            nz += normals[idx + 2];
+        }
+
+        BaseVecT nearest(px / k, py / k, pz / k);
+        auto normal = BaseVecT(nx / k, ny / k, nz / k).normalized();
+
+        projected[i] = (q - nearest).dot(normal);
+        euklidean[i] = (q - nearest).length();
+    }
+}
+
 // template<typename BaseVecT>
 // VertexT AdaptiveKSearchSurface<BaseVecT>::fromID(int i){
 //     return VertexT(
@@ -37,6 +37,7 @@
 
 #include "lvr2/geometry/BoundingBox.hpp"
 #include "lvr2/io/DataStruct.hpp"
+#include "lvr2/types/MatrixTypes.hpp"
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
@@ -45,6 +46,7 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace lvr2
 {
@@ -53,7 +55,7 @@ using Vec = BaseVector<float>;
 
 struct CellInfo
 {
-    CellInfo() : size(0), offset(0), inserted(0), dist_offset(0) {}
+    CellInfo() : size(0), offset(0), inserted(0), dist_offset(0), ix(0), iy(0), iz(0) {}
     size_t size;
     size_t offset;
     size_t inserted;
@@ -83,6 +85,19 @@ class BigGrid
 
     BigGrid(std::string path);
 
+    /**
+     * @brief A read only view on the points of one or more grid cells that
+     *        are stored consecutively in the memory mapped point store.
+     *        normals and colors are nullptr if the grid has none.
+     */
+    struct CellView
+    {
+        const float* points;
+        const float* normals;
+        const unsigned char* colors;
+        size_t size;
+    };
+
     /**
      * @return Number of voxels
      */
@@ -124,13 +139,16 @@ class BigGrid
      * @return lvr2::floatArr, containing points
      */
     lvr2::floatArr points(
-        float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints);
+        float minx, float miny, float minz, float maxx, float maxy, float maxz,
+        size_t& numPoints) const;
 
     lvr2::floatArr normals(
-        float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints);
+        float minx, float miny, float minz, float maxx, float maxy, float maxz,
+        size_t& numPoints) const;
 
     lvr2::ucharArr colors(
-        float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints);
+        float minx, float miny, float minz, float maxx, float maxy, float maxz,
+        size_t& numPoints) const;
     /**
      * return numbers of points in a specific area (defined by the params) of the grid
      * @param minx
@@ -141,17 +159,44 @@ class BigGrid
      * @param maxz
      * @return number of points in area
      */
-    size_t getSizeofBox(float minx, float miny, float minz, float maxx, float maxy, float maxz);
+    size_t getSizeofBox(
+        float minx, float miny, float minz, float maxx, float maxy, float maxz) const;
+
+    /**
+     * @brief Returns zero-copy views on all points within the given box. The
+     *        views point into the memory mapped point store and stay valid
+     *        as long as the grid exists. This method does not modify the
+     *        grid and is safe to call from several threads concurrently.
+     */
+    std::vector<CellView> cellViews(
+        float minx, float miny, float minz, float maxx, float maxy, float maxz) const;
 
+    /**
+     * @brief Writes the cell index to the given file. The index can be
+     *        reopened with BigGrid(std::string path) as long as the point
+     *        store (points.mmf, normals.mmf and colors.mmf) is located
+     *        next to the index file or in the current working directory.
+     */
     void serialize(std::string path = "serinfo.ls");
 
     lvr2::floatArr getPointCloud(size_t& numPoints);
 
     BoundingBox<BaseVecT>& getBB() { return m_bb; }
 
+    float getVoxelsize() const { return m_voxelSize; }
+
+    /**
+     * @brief Checks whether the grid was built from the given input files
+     *        with the given voxel size and scale, and whether none of the
+     *        files changed since, judged by their size and modification
+     *        time. Grids reopened from an index of an older version do not
+     *        know their input and never match.
+     */
+    bool matchesInput(const std::vector<std::string>& cloudPath, float voxelsize, float scale) const;
+
     virtual ~BigGrid();
 
-    inline size_t hashValue(size_t i, size_t j, size_t k)
+    inline size_t hashValue(size_t i, size_t j, size_t k) const
     {
         return i * m_maxIndexSquare + j * m_maxIndex + k;
     }
@@ -175,7 +220,35 @@ class BigGrid
     inline bool hasNormals() { return m_has_normal; }
 
   private:
-    inline int calcIndex(float f) { return f < 0 ? f - .5 : f + .5; }
+    /// Header of the cell index written by serialize()
+    static constexpr char INDEX_MAGIC[8] = {'L', 'V', 'R', 'B', 'G', 'R', 'I', 'D'};
+    static constexpr uint32_t INDEX_VERSION = 3;
+
+    /// An input file of the grid and its state when the grid was built
+    struct InputFile
+    {
+        std::string path;
+        uint64_t size;
+        int64_t modified;
+    };
+
+    /// Reads the state of an input file. Missing files have size and time 0
+    static InputFile inputFile(const std::string& path);
+
+    inline int calcIndex(float f) const { return f < 0 ? f - .5 : f + .5; }
+
+    /// Assigns the point store offsets of all cells in hash order
+    void assignCellOffsets();
+
+    /// Maps the point store read only for the box queries
+    void openData();
+
+    /// Path of a point store file
+    std::string dataPath(const std::string& name) const;
+
+    /// Non-empty cells within the given box, sorted by their offset
+    std::vector<const CellInfo*> cellsInBox(
+        float minx, float miny, float minz, float maxx, float maxy, float maxz) const;
 
     bool exists(int i, int j, int k);
     void insert(float x, float y, float z);
@@ -191,7 +264,6 @@ class BigGrid
 
     float m_voxelSize;
     bool m_extrude;
-    omp_lock_t m_lock;
 
     bool m_has_normal;
     bool m_has_color;
@@ -199,9 +271,20 @@ class BigGrid
     boost::iostreams::mapped_file m_PointFile;
     boost::iostreams::mapped_file m_NomralFile;
     boost::iostreams::mapped_file m_ColorFile;
+
+    // Read only mappings of the point store, shared by all readers
+    boost::iostreams::mapped_file_source m_pointData;
+    boost::iostreams::mapped_file_source m_normalData;
+    boost::iostreams::mapped_file_source m_colorData;
+
+    // Directory of the point store, empty for the working directory
+    std::string m_directory;
     BoundingBox<BaseVecT> m_bb;
     std::unordered_map<size_t, CellInfo> m_gridNumPoints;
     float m_scale;
+
+    // The files the grid was built from, empty if unknown
+    std::vector<InputFile> m_inputFiles;
 };
 
 } // namespace lvr2
@@ -32,15 +32,19 @@
  *      Author: Isaak Mitschke
  */
 
+#include "lvr2/config/lvropenmp.hpp"
 #include "lvr2/io/LineReader.hpp"
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/optional/optional_io.hpp>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <lvr2/io/GHDF5IO.hpp>
 #include <lvr2/io/hdf5/ArrayIO.hpp>
 #include <lvr2/io/hdf5/ChannelIO.hpp>
@@ -67,9 +71,13 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
     boost::filesystem::path selectedFile(cloudPath[0]);
     string extension = selectedFile.extension().string();
 
-    omp_init_lock(&m_lock);
     m_voxelSize = voxelsize;
 
+    for (auto& path : cloudPath)
+    {
+        m_inputFiles.push_back(inputFile(path));
+    }
+
     if (extension == ".h5") //################################ HDF5 Version
                             //############################################
     {
@@ -216,14 +224,7 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
             progress += 3;
         }
 
-        size_t num_cells = 0;
-        size_t offset = 0;
-        for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
-        {
-            it->second.offset = offset;
-            offset += it->second.size;
-            it->second.dist_offset = num_cells++;
-        }
+        assignCellOffsets();
 
         boost::iostreams::mapped_file_params mmfparam;
 
@@ -291,93 +292,52 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
 
     else
     {
+        // The files are decoded in parallel. Bounding box and cell sizes do
+        // not depend on the order of the points, so they are accumulated per
+        // thread. The points are stored in input order.
+        LineReader lineReader(cloudPath);
+        int threads = lvr2::OpenMPConfig::getNumThreads();
+
+        m_has_normal = true;
+        m_has_color = true;
+        for (size_t i = 0; i < cloudPath.size(); i++)
+        {
+            fileType type = lineReader.getFileType(i);
+            m_has_normal &= type == XYZN || type == XYZNRGB;
+            m_has_color &= type == XYZRGB || type == XYZNRGB;
+        }
 
         // First, parse whole file to get BoundingBox and amount of points
-        float ix, iy, iz;
         std::cout << lvr2::timestamp << "Computing Bounding Box..." << std::endl;
-        m_numPoints = 0;
-        size_t rsize = 0;
-        LineReader lineReader(cloudPath);
-        size_t lasti = 0;
-        while (lineReader.ok())
-        {
-            if (lineReader.getFileType() == XYZNRGB)
-            {
-                boost::shared_ptr<xyznc> a = boost::static_pointer_cast<xyznc>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                }
-            }
-            else if (lineReader.getFileType() == XYZN)
-            {
-                boost::shared_ptr<xyzn> a = boost::static_pointer_cast<xyzn>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                }
-            }
-            else if (lineReader.getFileType() == XYZ)
-            {
-                boost::shared_ptr<xyz> a = boost::static_pointer_cast<xyz>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (size_t i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                    lasti = i;
-                }
-            }
-            else if (lineReader.getFileType() == XYZRGB)
-            {
-                boost::shared_ptr<xyzc> a = boost::static_pointer_cast<xyzc>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
+        std::vector<BoundingBox<BaseVecT>> threadBB(threads);
+        std::vector<size_t> threadNumPoints(threads, 0);
+        lineReader.readBatches(
+            [&](const PointBatch& batch, int thread) {
+                const float* p = batch.points.data();
+                for (size_t i = 0; i < batch.size(); i++)
                 {
-                    break;
+                    threadBB[thread].expand(
+                        BaseVecT(p[3 * i] * m_scale, p[3 * i + 1] * m_scale, p[3 * i + 2] * m_scale));
                 }
-                for (size_t i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                    lasti = i;
-                }
-            }
-            else
+                threadNumPoints[thread] += batch.size();
+            },
+            false,
+            threads);
+
+        m_numPoints = 0;
+        for (int i = 0; i < threads; i++)
+        {
+            if (threadNumPoints[i] > 0)
             {
-                exit(-1);
+                m_bb.expand(threadBB[i]);
             }
+            m_numPoints += threadNumPoints[i];
         }
 
         // Make box side lenghts be divisible by voxel size
         float longestSide = m_bb.getLongestSide();
 
         BaseVecT center = m_bb.getCentroid();
-        size_t xsize2 = calcIndex(m_bb.getXSize() / m_voxelSize);
         float xsize = ceil(m_bb.getXSize() / voxelsize) * voxelsize;
         float ysize = ceil(m_bb.getYSize() / voxelsize) * voxelsize;
         float zsize = ceil(m_bb.getZSize() / voxelsize) * voxelsize;
@@ -402,181 +362,43 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
         string comment = lvr2::timestamp.getElapsedTime() + "Building grid... ";
         lvr2::ProgressBar progress(this->m_numPoints, comment);
 
-        lineReader.rewind();
-
-        size_t idx, idy, idz;
-        while (lineReader.ok())
-        {
-            if (lineReader.getFileType() == XYZNRGB)
-            {
-                boost::shared_ptr<xyznc> a = boost::static_pointer_cast<xyznc>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (lineReader.getFileType() == XYZN)
-            {
-                boost::shared_ptr<xyzn> a = boost::static_pointer_cast<xyzn>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (lineReader.getFileType() == XYZ)
-            {
-                boost::shared_ptr<xyz> a = boost::static_pointer_cast<xyz>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (lineReader.getFileType() == XYZRGB)
-            {
-                boost::shared_ptr<xyzc> a = boost::static_pointer_cast<xyzc>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
+        // Count the points per cell, the extruded neighbor cells are created
+        // without points
+        std::vector<std::unordered_map<size_t, size_t>> threadCells(threads);
+        lineReader.readBatches(
+            [&](const PointBatch& batch, int thread) {
+                std::unordered_map<size_t, size_t>& cells = threadCells[thread];
+                const float* p = batch.points.data();
+                int e = this->m_extrude ? 8 : 1;
+                for (size_t i = 0; i < batch.size(); i++)
+                {
+                    size_t idx = calcIndex((p[3 * i] * m_scale - m_bb.getMin()[0]) / voxelsize);
+                    size_t idy = calcIndex((p[3 * i + 1] * m_scale - m_bb.getMin()[1]) / voxelsize);
+                    size_t idz = calcIndex((p[3 * i + 2] * m_scale - m_bb.getMin()[2]) / voxelsize);
+                    cells[hashValue(idx, idy, idz)]++;
+                    for (int j = 1; j < e; j++)
                     {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
+                        cells.emplace(hashValue(idx + HGCreateTable[j][0],
+                                                idy + HGCreateTable[j][1],
+                                                idz + HGCreateTable[j][2]),
+                                      0);
                     }
                 }
-            }
-            else
-            {
-                exit(-1);
-            }
-            progress += rsize;
-        }
+                progress += batch.size();
+            },
+            false,
+            threads);
 
-        size_t num_cells = 0;
-        size_t offset = 0;
-        for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
+        for (auto& cells : threadCells)
         {
-            it->second.offset = offset;
-            offset += it->second.size;
-            it->second.dist_offset = num_cells++;
+            for (auto it = cells.begin(); it != cells.end(); ++it)
+            {
+                m_gridNumPoints[it->first].size += it->second;
+            }
+            cells = std::unordered_map<size_t, size_t>();
         }
 
-        lineReader.rewind();
+        assignCellOffsets();
 
         boost::iostreams::mapped_file_params mmfparam;
         mmfparam.path = "points.mmf";
@@ -594,155 +416,54 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
         mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
 
         m_PointFile.open(mmfparam);
-        float* mmfdata_normal;
-        unsigned char* mmfdata_color;
-        if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZN)
+        float* mmfdata = (float*)m_PointFile.data();
+        float* mmfdata_normal = nullptr;
+        unsigned char* mmfdata_color = nullptr;
+        if (m_has_normal)
         {
             m_NomralFile.open(mmfparam_normal);
             mmfdata_normal = (float*)m_NomralFile.data();
-            m_has_normal = true;
         }
-        if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZRGB)
+        if (m_has_color)
         {
             m_ColorFile.open(mmfparam_color);
             mmfdata_color = (unsigned char*)m_ColorFile.data();
-            m_has_color = true;
         }
-        float* mmfdata = (float*)m_PointFile.data();
-
-        while (lineReader.ok())
-        {
-            if (lineReader.getFileType() == XYZNRGB)
-            {
-                boost::shared_ptr<xyznc> a = boost::static_pointer_cast<xyznc>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                    mmfdata_normal[index * 3] = a.get()[i].normal.x;
-                    mmfdata_normal[index * 3 + 1] = a.get()[i].normal.y;
-                    mmfdata_normal[index * 3 + 2] = a.get()[i].normal.z;
 
-                    mmfdata_color[index * 3] = a.get()[i].color.r;
-                    mmfdata_color[index * 3 + 1] = a.get()[i].color.g;
-                    mmfdata_color[index * 3 + 2] = a.get()[i].color.b;
-                }
-            }
-            else if (lineReader.getFileType() == XYZN)
-            {
-                boost::shared_ptr<xyzn> a = boost::static_pointer_cast<xyzn>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                    mmfdata_normal[index * 3] = a.get()[i].normal.x;
-                    mmfdata_normal[index * 3 + 1] = a.get()[i].normal.y;
-                    mmfdata_normal[index * 3 + 2] = a.get()[i].normal.z;
-                }
-            }
-            else if (lineReader.getFileType() == XYZ)
-            {
-                boost::shared_ptr<xyz> a = boost::static_pointer_cast<xyz>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                }
-            }
-            else if (lineReader.getFileType() == XYZRGB)
-            {
-                boost::shared_ptr<xyzc> a = boost::static_pointer_cast<xyzc>(
-                    lineReader.getNextPoints(rsize, m_pointBufferSize));
-                if (rsize <= 0 && !lineReader.ok())
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
+        // Batches arrive in input order, so the order of the points within
+        // a cell does not depend on the number of threads
+        lineReader.readBatches(
+            [&](const PointBatch& batch, int) {
+                const float* p = batch.points.data();
+                for (size_t i = 0; i < batch.size(); i++)
                 {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
+                    float ix = p[3 * i] * m_scale;
+                    float iy = p[3 * i + 1] * m_scale;
+                    float iz = p[3 * i + 2] * m_scale;
                     size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
                     size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
                     size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
+                    CellInfo& cell = m_gridNumPoints[hashValue(idx, idy, idz)];
+                    cell.ix = idx;
+                    cell.iy = idy;
+                    cell.iz = idz;
+                    size_t index = cell.offset + cell.inserted++;
                     mmfdata[index * 3] = ix;
                     mmfdata[index * 3 + 1] = iy;
                     mmfdata[index * 3 + 2] = iz;
-                    mmfdata_color[index * 3] = a.get()[i].color.r;
-                    mmfdata_color[index * 3 + 1] = a.get()[i].color.g;
-                    mmfdata_color[index * 3 + 2] = a.get()[i].color.b;
+                    if (mmfdata_normal)
+                    {
+                        memcpy(mmfdata_normal + index * 3, &batch.normals[i * 3], 3 * sizeof(float));
+                    }
+                    if (mmfdata_color)
+                    {
+                        memcpy(mmfdata_color + index * 3, &batch.colors[i * 3], 3);
+                    }
                 }
-            }
-        }
+            },
+            true,
+            threads);
 
-        //    for(auto it = m_gridNumPoints.begin(); it!= m_gridNumPoints.end() ; it++)
-        //    {
-        //        std::cout << "h : " << it->first << std::endl;
-        //    }
         m_PointFile.close();
         m_NomralFile.close();
         mmfparam.path = "distances.mmf";
@@ -751,730 +472,129 @@ BigGrid<BaseVecT>::BigGrid(std::vector<std::string> cloudPath,
         m_PointFile.open(mmfparam);
         m_PointFile.close();
     }
+    m_ColorFile.close();
+
+    openData();
 }
 
 template <typename BaseVecT>
 BigGrid<BaseVecT>::BigGrid(std::string cloudPath, float voxelsize, float scale)
-    : m_maxIndex(0), m_maxIndexSquare(0), m_maxIndexX(0), m_maxIndexY(0), m_maxIndexZ(0),
-      m_numPoints(0), m_extrude(true), m_scale(scale), m_has_normal(false), m_has_color(false)
+    : BigGrid(std::vector<std::string>{cloudPath}, voxelsize, scale)
 {
-    boost::filesystem::path selectedFile(cloudPath);
-    string extension = selectedFile.extension().string();
-
-    omp_init_lock(&m_lock);
-    m_voxelSize = voxelsize;
+}
 
-    // First, parse whole file to get BoundingBox and amount of points
+template <typename BaseVecT>
+BigGrid<BaseVecT>::~BigGrid()
+{
+}
 
-    if (extension == ".h5")
+template <typename BaseVecT>
+typename BigGrid<BaseVecT>::InputFile BigGrid<BaseVecT>::inputFile(const std::string& path)
+{
+    boost::system::error_code ec;
+    InputFile file;
+    file.path = boost::filesystem::absolute(path).string();
+    file.size = boost::filesystem::file_size(path, ec);
+    if (ec)
     {
+        file.size = 0;
+    }
+    file.modified = boost::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        file.modified = 0;
+    }
+    return file;
+}
 
-        float ix, iy, iz;
-        using HDF5PCIO = lvr2::Hdf5IO<lvr2::hdf5features::ArrayIO,
-                                      lvr2::hdf5features::ChannelIO,
-                                      lvr2::hdf5features::VariantChannelIO,
-                                      lvr2::hdf5features::PointCloudIO,
-                                      lvr2::hdf5features::MatrixIO>;
-
-        std::shared_ptr<HDF5PCIO> h5_ptr(new HDF5PCIO());
-        h5_ptr->open(cloudPath);
-
-        HighFive::Group hfscans = hdf5util::getGroup(h5_ptr->m_hdf5_file, "raw/scans");
-
-        vector<string> scans = hfscans.listObjectNames();
-
-        // TODO: this is an alternative to calc the Bounding Box, remove one variation later
-        /*BoundingBox<BaseVecT> temp(BaseVecT(0,0,0),
-                                      BaseVecT(0,0,0));
-
-        for(int i = 0; i < scans.size(); i++)
+template <typename BaseVecT>
+bool BigGrid<BaseVecT>::matchesInput(const std::vector<std::string>& cloudPath,
+                                     float voxelsize,
+                                     float scale) const
+{
+    if (m_voxelSize != voxelsize || m_scale != scale || m_inputFiles.size() != cloudPath.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < cloudPath.size(); i++)
+    {
+        InputFile file = inputFile(cloudPath[i]);
+        if (file.path != m_inputFiles[i].path || file.size != m_inputFiles[i].size
+            || file.modified != m_inputFiles[i].modified)
         {
-            Transformd finalPose_n = h5_ptr->loadMatrix<Transformd>("raw/scans/" + scans[i],
-        "finalPose").get(); Transformd finalPose = finalPose_n.transpose(); size_t six;
-            boost::shared_array<double> bb_array = h5_ptr->loadArray<double>("raw/scans/" +
-        scans[i],"boundingBox", six);
-
-            Eigen::Vector4d bb_min(bb_array[0], bb_array[1],
-                                   bb_array[2] , 1.0);
-
-            Eigen::Vector4d bb_max(bb_array[3], bb_array[4],
-                                   bb_array[5] , 1.0);
-
-            Eigen::Vector4d bb_tmin = finalPose * bb_min;
-            Eigen::Vector4d bb_tmax = finalPose * bb_max;
-
-            BoundingBox<BaseVecT> scan_bb(BaseVecT(bb_tmin[0], bb_tmin[1], bb_tmin[2]),
-                                          BaseVecT(bb_tmax[0], bb_tmax[1], bb_tmax[2]));
-            temp.expand(scan_bb);
+            return false;
         }
-        */
-        // std::cout << temp << std::endl;
-        int b = 0;
+    }
+    return true;
+}
 
-        // calculate global Bounding Box of all scans
-        for (int i = 0; i < scans.size(); i++)
-        {
-            size_t numPoints;
-            boost::shared_array<float> points =
-                h5_ptr->loadArray<float>("raw/scans/" + scans[i], "points", numPoints);
-            // m_numPoints += numPoints / 3;
-            Transformd finalPose_n =
-                h5_ptr->loadMatrix<Transformd>("raw/scans/" + scans[i], "finalPose").get();
+template <typename BaseVecT>
+BigGrid<BaseVecT>::BigGrid(std::string path)
+{
+    ifstream ifs(path, ios::binary);
+    if (!ifs.good())
+    {
+        throw std::runtime_error("[BigGrid]: Cannot open grid index " + path);
+    }
 
-            Transformd finalPose = finalPose_n.transpose();
+    // Indices without a header were written by older versions (version 1)
+    char magic[sizeof(INDEX_MAGIC)];
+    uint32_t version = 1;
+    ifs.read(magic, sizeof(magic));
+    if (ifs.good() && memcmp(magic, INDEX_MAGIC, sizeof(magic)) == 0)
+    {
+        ifs.read((char*)&version, sizeof(version));
+    }
+    else
+    {
+        ifs.clear();
+        ifs.seekg(0);
+    }
 
-            std::cout << finalPose << std::endl;
-            for (int k = 0; k < numPoints / 3; k++)
-            {
-                Eigen::Vector4d point(
-                    points.get()[k * 3], points.get()[k * 3 + 1], points.get()[k * 3 + 2], 1);
-                Eigen::Vector4d transPoint = finalPose * point;
+    ifs.read((char*)&m_maxIndexSquare, sizeof(m_maxIndexSquare));
+    ifs.read((char*)&m_maxIndex, sizeof(m_maxIndex));
+    ifs.read((char*)&m_maxIndexX, sizeof(m_maxIndexX));
+    ifs.read((char*)&m_maxIndexY, sizeof(m_maxIndexY));
+    ifs.read((char*)&m_maxIndexZ, sizeof(m_maxIndexZ));
+    ifs.read((char*)&m_numPoints, sizeof(m_numPoints));
+    ifs.read((char*)&m_pointBufferSize, sizeof(m_pointBufferSize));
+    ifs.read((char*)&m_voxelSize, sizeof(m_voxelSize));
+    ifs.read((char*)&m_extrude, sizeof(m_extrude));
+    ifs.read((char*)&m_has_normal, sizeof(m_has_normal));
+    ifs.read((char*)&m_has_color, sizeof(m_has_color));
+    ifs.read((char*)&m_scale, sizeof(m_scale));
+    float mx, my, mz, n1, n2, n3;
+    ifs.read((char*)&mx, sizeof(float));
+    ifs.read((char*)&my, sizeof(float));
+    ifs.read((char*)&mz, sizeof(float));
+    ifs.read((char*)&n1, sizeof(float));
+    ifs.read((char*)&n2, sizeof(float));
+    ifs.read((char*)&n3, sizeof(float));
+    m_bb.expand(BaseVecT(mx, my, mz));
+    m_bb.expand(BaseVecT(n1, n2, n3));
 
-                BaseVecT temp(transPoint[0], transPoint[1], transPoint[2]);
-                m_bb.expand(temp);
-            }
+    if (version >= 3)
+    {
+        uint64_t numFiles = 0;
+        ifs.read((char*)&numFiles, sizeof(numFiles));
+        for (uint64_t i = 0; i < numFiles && ifs.good(); i++)
+        {
+            InputFile file;
+            uint64_t length = 0;
+            ifs.read((char*)&length, sizeof(length));
+            file.path.resize(length);
+            ifs.read(&file.path[0], length);
+            ifs.read((char*)&file.size, sizeof(file.size));
+            ifs.read((char*)&file.modified, sizeof(file.modified));
+            m_inputFiles.push_back(file);
         }
-        std::cout << "Global BB: " << std::endl << m_bb << std::endl;
+    }
 
-        // Make box side lenghts divisible by voxel size
-        float longestSide = m_bb.getLongestSide();
-
-        BaseVecT center = m_bb.getCentroid();
-        size_t xsize2 = calcIndex(m_bb.getXSize() / m_voxelSize);
-        float xsize = ceil(m_bb.getXSize() / voxelsize) * voxelsize;
-        float ysize = ceil(m_bb.getYSize() / voxelsize) * voxelsize;
-        float zsize = ceil(m_bb.getZSize() / voxelsize) * voxelsize;
-        m_bb.expand(BaseVecT(center.x + xsize / 2, center.y + ysize / 2, center.z + zsize / 2));
-        m_bb.expand(BaseVecT(center.x - xsize / 2, center.y - ysize / 2, center.z - zsize / 2));
-        longestSide = ceil(longestSide / voxelsize) * voxelsize;
-
-        // calculate max indices
-
-        // m_maxIndex = (size_t)(longestSide/voxelsize);
-        m_maxIndexX = (size_t)(xsize / voxelsize);
-        m_maxIndexY = (size_t)(ysize / voxelsize);
-        m_maxIndexZ = (size_t)(zsize / voxelsize);
-        m_maxIndex = std::max(m_maxIndexX, std::max(m_maxIndexY, m_maxIndexZ)) + 5 * voxelsize;
-        m_maxIndexX += 1;
-        m_maxIndexY += 2;
-        m_maxIndexZ += 3;
-        m_maxIndexSquare = m_maxIndex * m_maxIndex;
-        std::cout << "BG: " << m_maxIndexSquare << "|" << m_maxIndexX << "|" << m_maxIndexY << "|"
-                  << m_maxIndexZ << std::endl;
-
-        string comment = lvr2::timestamp.getElapsedTime() + "Building grid... ";
-        lvr2::ProgressBar progress(this->m_numPoints, comment);
-
-        size_t idx, idy, idz;
-        for (int i = 0; i < scans.size(); i++)
-        {
-            size_t numPoints;
-            boost::shared_array<float> points =
-                h5_ptr->loadArray<float>("raw/scans/" + scans[i], "points", numPoints);
-            m_numPoints += numPoints / 3;
-            Transformd finalPose_n =
-                h5_ptr->loadMatrix<Transformd>("raw/scans/" + scans[i], "finalPose").get();
-            Transformd finalPose = finalPose_n.transpose();
-            int dx, dy, dz;
-            for (int k = 0; k < numPoints / 3; k++)
-            {
-                Eigen::Vector4d point(
-                    points.get()[k * 3], points.get()[k * 3 + 1], points.get()[k * 3 + 2], 1);
-                Eigen::Vector4d transPoint = finalPose * point;
-                BaseVecT temp(transPoint[0], transPoint[1], transPoint[2]);
-                // m_bb.expand(temp);
-                ix = transPoint[0] * m_scale;
-                iy = transPoint[1] * m_scale;
-                iz = transPoint[2] * m_scale;
-                idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                int e;
-                this->m_extrude ? e = 8 : e = 1;
-                for (int j = 0; j < e; j++)
-                {
-                    dx = HGCreateTable[j][0];
-                    dy = HGCreateTable[j][1];
-                    dz = HGCreateTable[j][2];
-                    size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                    if (j == 0)
-                        m_gridNumPoints[h].size++;
-                    else
-                    {
-                        auto it = m_gridNumPoints.find(h);
-                        if (it == m_gridNumPoints.end())
-                        {
-                            m_gridNumPoints[h].size = 0;
-                        }
-                    }
-                }
-            }
-            progress += 3;
-        }
-
-        size_t num_cells = 0;
-        size_t offset = 0;
-        for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
-        {
-            it->second.offset = offset;
-            offset += it->second.size;
-            it->second.dist_offset = num_cells++;
-        }
-
-        boost::iostreams::mapped_file_params mmfparam;
-
-        mmfparam.path = "points.mmf";
-        mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-        mmfparam.new_file_size = sizeof(float) * m_numPoints * 3;
-
-        boost::iostreams::mapped_file_params mmfparam_normal;
-        mmfparam_normal.path = "normals.mmf";
-        mmfparam_normal.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-        mmfparam_normal.new_file_size = sizeof(float) * m_numPoints * 3;
-
-        boost::iostreams::mapped_file_params mmfparam_color;
-        mmfparam_color.path = "colors.mmf";
-        mmfparam_color.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-        mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
-
-        m_PointFile.open(mmfparam);
-
-        float* mmfdata = (float*)m_PointFile.data();
-
-        for (int i = 0; i < scans.size(); i++)
-        {
-            size_t numPoints;
-            boost::shared_array<float> points =
-                h5_ptr->loadArray<float>("raw/scans/" + scans[i], "points", numPoints);
-            Transformd finalPose_n =
-                h5_ptr->loadMatrix<Transformd>("raw/scans/" + scans[i], "finalPose").get();
-            Transformd finalPose = finalPose_n.transpose();
-            for (int k = 0; k < numPoints / 3; k++)
-            {
-                Eigen::Vector4d point(
-                    points.get()[k * 3], points.get()[k * 3 + 1], points.get()[k * 3 + 2], 1);
-                Eigen::Vector4d transPoint = finalPose * point;
-
-                ix = transPoint[0] * m_scale;
-                iy = transPoint[1] * m_scale;
-                iz = transPoint[2] * m_scale;
-                size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                size_t h = hashValue(idx, idy, idz);
-                size_t ins = (m_gridNumPoints[h].inserted);
-                m_gridNumPoints[h].ix = idx;
-                m_gridNumPoints[h].iy = idy;
-                m_gridNumPoints[h].iz = idz;
-                m_gridNumPoints[h].inserted++;
-                size_t index = m_gridNumPoints[h].offset + ins;
-                mmfdata[index * 3] = ix;
-                mmfdata[index * 3 + 1] = iy;
-                mmfdata[index * 3 + 2] = iz;
-            }
-        }
-
-        m_PointFile.close();
-        m_NomralFile.close();
-        mmfparam.path = "distances.mmf";
-        mmfparam.new_file_size = sizeof(float) * size() * 8;
-
-        m_PointFile.open(mmfparam);
-        m_PointFile.close();
-
-    } // ############################ End of HDF5 version #################################
-    else
-    {
-        std::cout << "opening: " << cloudPath << endl;
-        float ix, iy, iz;
-        std::cout << lvr2::timestamp << " Starting BB" << std::endl;
-        m_numPoints = 0;
-        size_t rsize = 0;
-        LineReader lineReader(cloudPath);
-        size_t lasti = 0;
-        while (true)
-        {
-            if (lineReader.getFileType() == XYZNRGB)
-            {
-                boost::shared_ptr<xyznc> a =
-                    boost::static_pointer_cast<xyznc>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                }
-            }
-            else if (lineReader.getFileType() == XYZN)
-            {
-                boost::shared_ptr<xyzn> a =
-                    boost::static_pointer_cast<xyzn>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                }
-            }
-            else if (lineReader.getFileType() == XYZ)
-            {
-                boost::shared_ptr<xyz> a =
-                    boost::static_pointer_cast<xyz>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (size_t i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                    lasti = i;
-                }
-            }
-            else if (lineReader.getFileType() == XYZRGB)
-            {
-                boost::shared_ptr<xyzc> a =
-                    boost::static_pointer_cast<xyzc>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (size_t i = 0; i < rsize; i++)
-                {
-                    m_bb.expand(BaseVecT(a.get()[i].point.x * m_scale,
-                                         a.get()[i].point.y * m_scale,
-                                         a.get()[i].point.z * m_scale));
-                    m_numPoints++;
-                    lasti = i;
-                }
-            }
-            else
-            {
-                exit(-1);
-            }
-        }
-
-        // Make box side lenghts be divisible by voxel size
-        float longestSide = m_bb.getLongestSide();
-
-        BaseVecT center = m_bb.getCentroid();
-        float xsize = ceil(m_bb.getXSize() / voxelsize) * voxelsize;
-        float ysize = ceil(m_bb.getYSize() / voxelsize) * voxelsize;
-        float zsize = ceil(m_bb.getZSize() / voxelsize) * voxelsize;
-        m_bb.expand(BaseVecT(center.x + xsize / 2, center.y + ysize / 2, center.z + zsize / 2));
-        m_bb.expand(BaseVecT(center.x - xsize / 2, center.y - ysize / 2, center.z - zsize / 2));
-        longestSide = ceil(longestSide / voxelsize) * voxelsize;
-
-        // calc max indices
-
-        // m_maxIndex = (size_t)(longestSide/voxelsize);
-        m_maxIndexX = (size_t)(xsize / voxelsize);
-        m_maxIndexY = (size_t)(ysize / voxelsize);
-        m_maxIndexZ = (size_t)(zsize / voxelsize);
-        m_maxIndex = std::max(m_maxIndexX, std::max(m_maxIndexY, m_maxIndexZ)) + 5 * voxelsize;
-        m_maxIndexX += 1;
-        m_maxIndexY += 2;
-        m_maxIndexZ += 3;
-        m_maxIndexSquare = m_maxIndex * m_maxIndex;
-        std::cout << "BG: " << m_maxIndexSquare << "|" << m_maxIndexX << "|" << m_maxIndexY << "|"
-                  << m_maxIndexZ << std::endl;
-
-        //
-        lineReader.rewind();
-
-        size_t idx, idy, idz;
-        while (true)
-        {
-            if (lineReader.getFileType() == XYZNRGB)
-            {
-                boost::shared_ptr<xyznc> a =
-                    boost::static_pointer_cast<xyznc>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (lineReader.getFileType() == XYZN)
-            {
-                boost::shared_ptr<xyzn> a =
-                    boost::static_pointer_cast<xyzn>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (lineReader.getFileType() == XYZ)
-            {
-                boost::shared_ptr<xyz> a =
-                    boost::static_pointer_cast<xyz>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else if (lineReader.getFileType() == XYZRGB)
-            {
-                boost::shared_ptr<xyzc> a =
-                    boost::static_pointer_cast<xyzc>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                int dx, dy, dz;
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    int e;
-                    this->m_extrude ? e = 8 : e = 1;
-                    for (int j = 0; j < e; j++)
-                    {
-                        dx = HGCreateTable[j][0];
-                        dy = HGCreateTable[j][1];
-                        dz = HGCreateTable[j][2];
-                        size_t h = hashValue(idx + dx, idy + dy, idz + dz);
-                        if (j == 0)
-                            m_gridNumPoints[h].size++;
-                        else
-                        {
-                            auto it = m_gridNumPoints.find(h);
-                            if (it == m_gridNumPoints.end())
-                            {
-                                m_gridNumPoints[h].size = 0;
-                            }
-                        }
-                    }
-                }
-            }
-            else
-            {
-                exit(-1);
-            }
-        }
-
-        size_t num_cells = 0;
-        size_t offset = 0;
-        for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
-        {
-            it->second.offset = offset;
-            offset += it->second.size;
-            it->second.dist_offset = num_cells++;
-        }
-
-        lineReader.rewind();
-
-        boost::iostreams::mapped_file_params mmfparam;
-        mmfparam.path = "points.mmf";
-        mmfparam.mode = std::ios_base::in | std::ios_base::out;
-        mmfparam.new_file_size = sizeof(float) * m_numPoints * 3;
-
-        boost::iostreams::mapped_file_params mmfparam_normal;
-        mmfparam_normal.path = "normals.mmf";
-        mmfparam_normal.mode = std::ios_base::in | std::ios_base::out;
-        mmfparam_normal.new_file_size = sizeof(float) * m_numPoints * 3;
-
-        boost::iostreams::mapped_file_params mmfparam_color;
-        mmfparam_color.path = "colors.mmf";
-        mmfparam_color.mode = std::ios_base::in | std::ios_base::out;
-        mmfparam_color.new_file_size = sizeof(unsigned char) * m_numPoints * 3;
-
-        m_PointFile.open(mmfparam);
-        float* mmfdata_normal;
-        unsigned char* mmfdata_color;
-        if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZN)
-        {
-            m_NomralFile.open(mmfparam_normal);
-            mmfdata_normal = (float*)m_NomralFile.data();
-            m_has_normal = true;
-        }
-        if (lineReader.getFileType() == XYZNRGB || lineReader.getFileType() == XYZRGB)
-        {
-            m_ColorFile.open(mmfparam_color);
-            mmfdata_color = (unsigned char*)m_ColorFile.data();
-            m_has_color = true;
-        }
-        float* mmfdata = (float*)m_PointFile.data();
-
-        while (true)
-        {
-            if (lineReader.getFileType() == XYZNRGB)
-            {
-                boost::shared_ptr<xyznc> a =
-                    boost::static_pointer_cast<xyznc>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                    mmfdata_normal[index * 3] = a.get()[i].normal.x;
-                    mmfdata_normal[index * 3 + 1] = a.get()[i].normal.y;
-                    mmfdata_normal[index * 3 + 2] = a.get()[i].normal.z;
-
-                    mmfdata_color[index * 3] = a.get()[i].color.r;
-                    mmfdata_color[index * 3 + 1] = a.get()[i].color.g;
-                    mmfdata_color[index * 3 + 2] = a.get()[i].color.b;
-                }
-            }
-            else if (lineReader.getFileType() == XYZN)
-            {
-                boost::shared_ptr<xyzn> a =
-                    boost::static_pointer_cast<xyzn>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                    mmfdata_normal[index * 3] = a.get()[i].normal.x;
-                    mmfdata_normal[index * 3 + 1] = a.get()[i].normal.y;
-                    mmfdata_normal[index * 3 + 2] = a.get()[i].normal.z;
-                }
-            }
-            else if (lineReader.getFileType() == XYZ)
-            {
-                boost::shared_ptr<xyz> a =
-                    boost::static_pointer_cast<xyz>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                }
-            }
-            else if (lineReader.getFileType() == XYZRGB)
-            {
-                boost::shared_ptr<xyzc> a =
-                    boost::static_pointer_cast<xyzc>(lineReader.getNextPoints(rsize, 1024));
-                if (rsize <= 0)
-                {
-                    break;
-                }
-                for (int i = 0; i < rsize; i++)
-                {
-                    ix = a.get()[i].point.x * m_scale;
-                    iy = a.get()[i].point.y * m_scale;
-                    iz = a.get()[i].point.z * m_scale;
-                    size_t idx = calcIndex((ix - m_bb.getMin()[0]) / voxelsize);
-                    size_t idy = calcIndex((iy - m_bb.getMin()[1]) / voxelsize);
-                    size_t idz = calcIndex((iz - m_bb.getMin()[2]) / voxelsize);
-                    size_t h = hashValue(idx, idy, idz);
-                    size_t ins = (m_gridNumPoints[h].inserted);
-                    m_gridNumPoints[h].ix = idx;
-                    m_gridNumPoints[h].iy = idy;
-                    m_gridNumPoints[h].iz = idz;
-                    m_gridNumPoints[h].inserted++;
-                    size_t index = m_gridNumPoints[h].offset + ins;
-                    mmfdata[index * 3] = ix;
-                    mmfdata[index * 3 + 1] = iy;
-                    mmfdata[index * 3 + 2] = iz;
-                    mmfdata_color[index * 3] = a.get()[i].color.r;
-                    mmfdata_color[index * 3 + 1] = a.get()[i].color.g;
-                    mmfdata_color[index * 3 + 2] = a.get()[i].color.b;
-                }
-            }
-        }
-
-        m_PointFile.close();
-        m_NomralFile.close();
-        mmfparam.path = "distances.mmf";
-        mmfparam.new_file_size = sizeof(float) * size() * 8;
-
-        m_PointFile.open(mmfparam);
-        m_PointFile.close();
-    }
-}
-
-template <typename BaseVecT>
-BigGrid<BaseVecT>::~BigGrid()
-{
-    omp_destroy_lock(&m_lock);
-}
-
-template <typename BaseVecT>
-BigGrid<BaseVecT>::BigGrid(std::string path)
-{
-    ifstream ifs(path, ios::binary);
-
-    ifs.read((char*)&m_maxIndexSquare, sizeof(m_maxIndexSquare));
-    ifs.read((char*)&m_maxIndex, sizeof(m_maxIndex));
-    ifs.read((char*)&m_maxIndexX, sizeof(m_maxIndexX));
-    ifs.read((char*)&m_maxIndexY, sizeof(m_maxIndexY));
-    ifs.read((char*)&m_maxIndexZ, sizeof(m_maxIndexZ));
-    ifs.read((char*)&m_numPoints, sizeof(m_numPoints));
-    ifs.read((char*)&m_pointBufferSize, sizeof(m_pointBufferSize));
-    ifs.read((char*)&m_voxelSize, sizeof(m_voxelSize));
-    ifs.read((char*)&m_extrude, sizeof(m_extrude));
-    ifs.read((char*)&m_has_normal, sizeof(m_has_normal));
-    ifs.read((char*)&m_has_color, sizeof(m_has_color));
-    ifs.read((char*)&m_scale, sizeof(m_scale));
-    float mx, my, mz, n1, n2, n3;
-    ifs.read((char*)&mx, sizeof(float));
-    ifs.read((char*)&my, sizeof(float));
-    ifs.read((char*)&mz, sizeof(float));
-    ifs.read((char*)&n1, sizeof(float));
-    ifs.read((char*)&n2, sizeof(float));
-    ifs.read((char*)&n3, sizeof(float));
-    m_bb.expand(BaseVecT(mx, my, mz));
-    m_bb.expand(BaseVecT(n1, n2, n3));
-
-    size_t gridSize;
-    ifs.read((char*)&gridSize, sizeof(gridSize));
+    size_t gridSize;
+    ifs.read((char*)&gridSize, sizeof(gridSize));
 
     std::cout << "LOADING OLD GRID: " << std::endl;
+    std::cout << "version: \t\t\t" << version << std::endl;
     std::cout << "m_maxIndexSquare: \t\t\t" << m_maxIndexSquare << std::endl;
     std::cout << "m_maxIndex: \t\t\t" << m_maxIndex << std::endl;
     std::cout << "m_maxIndexX: \t\t\t" << m_maxIndexX << std::endl;
@@ -1489,6 +609,7 @@ BigGrid<BaseVecT>::BigGrid(std::string path)
     std::cout << "m_bb: \t\t\t" << m_bb << std::endl;
     std::cout << "gridSize: \t\t\t" << gridSize << std::endl;
 
+    m_gridNumPoints.reserve(gridSize);
     for (size_t i = 0; i < gridSize; i++)
     {
         CellInfo c;
@@ -1503,19 +624,29 @@ BigGrid<BaseVecT>::BigGrid(std::string path)
         ifs.read((char*)&c.iz, sizeof(size_t));
         m_gridNumPoints[hash] = c;
     }
+    if (!ifs.good())
+    {
+        throw std::runtime_error("[BigGrid]: Grid index " + path + " is truncated");
+    }
+
+    // The point store is expected next to the index. Older indices were
+    // always used from within the directory of the point store.
+    boost::filesystem::path directory = boost::filesystem::path(path).parent_path();
+    if (!directory.empty() && boost::filesystem::exists(directory / "points.mmf"))
+    {
+        m_directory = directory.string();
+    }
+    openData();
 }
 
 template <typename BaseVecT>
 void BigGrid<BaseVecT>::serialize(std::string path)
 {
     ofstream ofs(path, ios::binary);
-    //    size_t data_size =      sizeof(m_maxIndexSquare) + sizeof(m_maxIndex) +
-    //    sizeof(m_maxIndexX) + sizeof(m_maxIndexY) +
-    //                            sizeof(m_maxIndexZ) + sizeof(m_numPoints) +
-    //                            sizeof(m_pointBufferSize) + sizeof(m_voxelSize) +
-    //                            sizeof(m_extrude) + sizeof(m_has_normal) + sizeof(m_has_color) +
-    //                            sizeof(m_scale) + (m_gridNumPoints.size() * (sizeof(size_t)*7)) +
-    //                            (m_gridNumPoints.size() *(sizeof(size_t)));
+
+    uint32_t version = INDEX_VERSION;
+    ofs.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    ofs.write((char*)&version, sizeof(version));
 
     ofs.write((char*)&m_maxIndexSquare, sizeof(m_maxIndexSquare));
     ofs.write((char*)&m_maxIndex, sizeof(m_maxIndex));
@@ -1530,12 +661,22 @@ void BigGrid<BaseVecT>::serialize(std::string path)
     ofs.write((char*)&m_has_color, sizeof(m_has_color));
     ofs.write((char*)&m_scale, sizeof(m_scale));
 
-    ofs.write((char*)&m_bb.getMin()[0], sizeof(float));
-    ofs.write((char*)&m_bb.getMin()[1], sizeof(float));
-    ofs.write((char*)&m_bb.getMin()[2], sizeof(float));
-    ofs.write((char*)&m_bb.getMax()[0], sizeof(float));
-    ofs.write((char*)&m_bb.getMax()[1], sizeof(float));
-    ofs.write((char*)&m_bb.getMax()[2], sizeof(float));
+    float bbMin[3] = {m_bb.getMin()[0], m_bb.getMin()[1], m_bb.getMin()[2]};
+    float bbMax[3] = {m_bb.getMax()[0], m_bb.getMax()[1], m_bb.getMax()[2]};
+    ofs.write((char*)bbMin, sizeof(bbMin));
+    ofs.write((char*)bbMax, sizeof(bbMax));
+
+    uint64_t numFiles = m_inputFiles.size();
+    ofs.write((char*)&numFiles, sizeof(numFiles));
+    for (auto& file : m_inputFiles)
+    {
+        uint64_t length = file.path.size();
+        ofs.write((char*)&length, sizeof(length));
+        ofs.write(file.path.data(), length);
+        ofs.write((char*)&file.size, sizeof(file.size));
+        ofs.write((char*)&file.modified, sizeof(file.modified));
+    }
+
     size_t gridSize = m_gridNumPoints.size();
     ofs.write((char*)&gridSize, sizeof(gridSize));
     for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
@@ -1552,6 +693,157 @@ void BigGrid<BaseVecT>::serialize(std::string path)
     ofs.close();
 }
 
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::assignCellOffsets()
+{
+    // Store the cells sorted by their hash, i.e. by x, y and z index. Cells
+    // that are neighbors along z are adjacent in the point store, so box
+    // queries read long consecutive runs instead of scattered cells.
+    std::vector<size_t> hashes;
+    hashes.reserve(m_gridNumPoints.size());
+    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); ++it)
+    {
+        hashes.push_back(it->first);
+    }
+    std::sort(hashes.begin(), hashes.end());
+
+    size_t num_cells = 0;
+    size_t offset = 0;
+    for (size_t h : hashes)
+    {
+        CellInfo& cell = m_gridNumPoints[h];
+        cell.offset = offset;
+        offset += cell.size;
+        cell.dist_offset = num_cells++;
+    }
+}
+
+template <typename BaseVecT>
+std::string BigGrid<BaseVecT>::dataPath(const std::string& name) const
+{
+    return (boost::filesystem::path(m_directory) / name).string();
+}
+
+template <typename BaseVecT>
+void BigGrid<BaseVecT>::openData()
+{
+    if (m_numPoints == 0)
+    {
+        return;
+    }
+
+    m_pointData.open(dataPath("points.mmf"));
+    if (m_pointData.size() < sizeof(float) * 3 * m_numPoints)
+    {
+        throw std::runtime_error("[BigGrid]: " + dataPath("points.mmf") +
+                                 " does not match the grid index");
+    }
+    if (m_has_normal)
+    {
+        m_normalData.open(dataPath("normals.mmf"));
+    }
+    if (m_has_color)
+    {
+        m_colorData.open(dataPath("colors.mmf"));
+    }
+}
+
+template <typename BaseVecT>
+std::vector<const CellInfo*> BigGrid<BaseVecT>::cellsInBox(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz) const
+{
+    std::vector<const CellInfo*> cells;
+
+    minx = std::max(minx, m_bb.getMin()[0]);
+    miny = std::max(miny, m_bb.getMin()[1]);
+    minz = std::max(minz, m_bb.getMin()[2]);
+    maxx = std::min(maxx, m_bb.getMax()[0]);
+    maxy = std::min(maxy, m_bb.getMax()[1]);
+    maxz = std::min(maxz, m_bb.getMax()[2]);
+    if (minx > maxx || miny > maxy || minz > maxz)
+    {
+        return cells;
+    }
+
+    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
+    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
+    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
+    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
+    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
+    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
+
+    size_t boxCells = (idxmax - idxmin + 1) * (idymax - idymin + 1) * (idzmax - idzmin + 1);
+    if (boxCells <= m_gridNumPoints.size())
+    {
+        // Small boxes: look up the cells of the box directly
+        for (size_t i = idxmin; i <= idxmax; i++)
+        {
+            for (size_t j = idymin; j <= idymax; j++)
+            {
+                for (size_t k = idzmin; k <= idzmax; k++)
+                {
+                    auto it = m_gridNumPoints.find(hashValue(i, j, k));
+                    if (it != m_gridNumPoints.end() && it->second.size > 0 &&
+                        it->second.ix == i && it->second.iy == j && it->second.iz == k)
+                    {
+                        cells.push_back(&it->second);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        // Large boxes: scanning the index is cheaper than probing empty cells
+        for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+        {
+            if (it->second.size > 0 && it->second.ix >= idxmin && it->second.iy >= idymin &&
+                it->second.iz >= idzmin && it->second.ix <= idxmax && it->second.iy <= idymax &&
+                it->second.iz <= idzmax)
+            {
+                cells.push_back(&it->second);
+            }
+        }
+    }
+
+    std::sort(cells.begin(), cells.end(), [](const CellInfo* a, const CellInfo* b) {
+        return a->offset < b->offset;
+    });
+    return cells;
+}
+
+template <typename BaseVecT>
+std::vector<typename BigGrid<BaseVecT>::CellView> BigGrid<BaseVecT>::cellViews(
+    float minx, float miny, float minz, float maxx, float maxy, float maxz) const
+{
+    std::vector<CellView> views;
+
+    const float* points = (const float*)m_pointData.data();
+    const float* normals = m_has_normal ? (const float*)m_normalData.data() : nullptr;
+    const unsigned char* colors =
+        m_has_color ? (const unsigned char*)m_colorData.data() : nullptr;
+
+    size_t end = 0;
+    for (const CellInfo* cell : cellsInBox(minx, miny, minz, maxx, maxy, maxz))
+    {
+        if (!views.empty() && cell->offset == end)
+        {
+            // Continues the previous run in the point store
+            views.back().size += cell->size;
+        }
+        else
+        {
+            size_t index = cell->offset * 3;
+            views.push_back({points + index,
+                             normals ? normals + index : nullptr,
+                             colors ? colors + index : nullptr,
+                             cell->size});
+        }
+        end = cell->offset + cell->size;
+    }
+    return views;
+}
+
 template <typename BaseVecT>
 size_t BigGrid<BaseVecT>::size()
 {
@@ -1583,180 +875,100 @@ template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::points(int i, int j, int k, size_t& numPoints)
 {
     lvr2::floatArr points;
-    size_t h = hashValue(i, j, k);
-    auto it = m_gridNumPoints.find(h);
-    if (it != m_gridNumPoints.end())
+    numPoints = 0;
+    auto it = m_gridNumPoints.find(hashValue(i, j, k));
+    if (it != m_gridNumPoints.end() && it->second.size > 0)
     {
-        size_t cellSize = m_gridNumPoints[h].size;
-
-        points = lvr2::floatArr(new float[3 * cellSize]);
-        boost::iostreams::mapped_file_params mmfparam;
-        mmfparam.path = "points.mmf";
-        mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-
-        m_PointFile.open(mmfparam);
-        float* mmfdata = (float*)m_PointFile.data();
+        numPoints = it->second.size;
+        points = lvr2::floatArr(new float[3 * numPoints]);
 
-        memcpy(points.get(), mmfdata, 3 * pointSize() * sizeof(float));
-
-        numPoints = pointSize();
+        const float* mmfdata = (const float*)m_pointData.data();
+        memcpy(points.get(), mmfdata + 3 * it->second.offset, 3 * numPoints * sizeof(float));
     }
     return points;
 }
 
 template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::points(
-    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+    float minx, float miny, float minz, float maxx, float maxy, float maxz,
+    size_t& numPoints) const
 {
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
-
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
+    std::vector<CellView> views = cellViews(minx, miny, minz, maxx, maxy, maxz);
 
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
-
-    std::cout << "Current BB: " << m_bb << std::endl;
-
-    std::cout << "Number of Points: " << numPoints << std::endl;
-    std::cout << "min[" << minx << ", " << miny << ", " << minz << "]" << std::endl;
-    std::cout << "max[" << maxx << ", " << maxy << ", " << maxz << "]" << std::endl;
+    numPoints = 0;
+    for (const CellView& view : views)
+    {
+        numPoints += view.size;
+    }
 
     lvr2::floatArr points(new float[numPoints * 3]);
-    size_t p_index = 0;
-
-    boost::iostreams::mapped_file_source mmfs("points.mmf");
-    float* mmfdata = (float*)mmfs.data();
-
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    float* dst = points.get();
+    for (const CellView& view : views)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
-        }
+        memcpy(dst, view.points, 3 * view.size * sizeof(float));
+        dst += 3 * view.size;
     }
-    std::cout << "Here we are!" << std::endl;
     return points;
 }
 
 template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::normals(
-    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+    float minx, float miny, float minz, float maxx, float maxy, float maxz,
+    size_t& numPoints) const
 {
-    std::ifstream ifs("normals.mmf");
-    if (!ifs.good())
+    if (!m_has_normal)
     {
         numPoints = 0;
         lvr2::floatArr arr;
         return arr;
     }
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
-
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
-
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
-
-    lvr2::floatArr points(new float[numPoints * 3]);
-    size_t p_index = 0;
 
-    boost::iostreams::mapped_file_source mmfs("normals.mmf");
-    float* mmfdata = (float*)mmfs.data();
+    std::vector<CellView> views = cellViews(minx, miny, minz, maxx, maxy, maxz);
 
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    numPoints = 0;
+    for (const CellView& view : views)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
-        }
+        numPoints += view.size;
     }
 
-    return points;
+    lvr2::floatArr normals(new float[numPoints * 3]);
+    float* dst = normals.get();
+    for (const CellView& view : views)
+    {
+        memcpy(dst, view.normals, 3 * view.size * sizeof(float));
+        dst += 3 * view.size;
+    }
+    return normals;
 }
 
 template <typename BaseVecT>
 lvr2::ucharArr BigGrid<BaseVecT>::colors(
-    float minx, float miny, float minz, float maxx, float maxy, float maxz, size_t& numPoints)
+    float minx, float miny, float minz, float maxx, float maxy, float maxz,
+    size_t& numPoints) const
 {
-    std::ifstream ifs("colors.mmf");
-    if (!ifs.good())
+    if (!m_has_color)
     {
         numPoints = 0;
         lvr2::ucharArr arr;
         return arr;
     }
-    minx = (minx > m_bb.getMin()[0]) ? minx : m_bb.getMin()[0];
-    miny = (miny > m_bb.getMin()[1]) ? miny : m_bb.getMin()[1];
-    minz = (minz > m_bb.getMin()[2]) ? minz : m_bb.getMin()[2];
-    maxx = (maxx < m_bb.getMax()[0]) ? maxx : m_bb.getMax()[0];
-    maxy = (maxy < m_bb.getMax()[1]) ? maxy : m_bb.getMax()[1];
-    maxz = (maxz < m_bb.getMax()[2]) ? maxz : m_bb.getMax()[2];
-
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
 
-    numPoints = getSizeofBox(minx, miny, minz, maxx, maxy, maxz);
+    std::vector<CellView> views = cellViews(minx, miny, minz, maxx, maxy, maxz);
 
-    lvr2::ucharArr points(new unsigned char[numPoints * 3]);
-    size_t p_index = 0;
-
-    boost::iostreams::mapped_file_source mmfs("colors.mmf");
-    unsigned char* mmfdata = (unsigned char*)mmfs.data();
-
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    numPoints = 0;
+    for (const CellView& view : views)
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            size_t cSize = it->second.size;
-            for (size_t x = 0; x < cSize; x++)
-            {
-                points.get()[p_index] = mmfdata[(it->second.offset + x) * 3];
-                points.get()[p_index + 1] = mmfdata[(it->second.offset + x) * 3 + 1];
-                points.get()[p_index + 2] = mmfdata[(it->second.offset + x) * 3 + 2];
-                p_index += 3;
-            }
-        }
+        numPoints += view.size;
     }
 
-    return points;
+    lvr2::ucharArr colors(new unsigned char[numPoints * 3]);
+    unsigned char* dst = colors.get();
+    for (const CellView& view : views)
+    {
+        memcpy(dst, view.colors, 3 * view.size);
+        dst += 3 * view.size;
+    }
+    return colors;
 }
 
 template <typename BaseVecT>
@@ -1775,62 +987,24 @@ void BigGrid<BaseVecT>::insert(float x, float y, float z)
 template <typename BaseVecT>
 lvr2::floatArr BigGrid<BaseVecT>::getPointCloud(size_t& numPoints)
 {
-    lvr2::floatArr points(new float[3 * pointSize()]);
-    boost::iostreams::mapped_file_params mmfparam;
-    mmfparam.path = "points.mmf";
-    mmfparam.mode = std::ios_base::in | std::ios_base::out | std::ios_base::trunc;
-
-    m_PointFile.open(mmfparam);
-    float* mmfdata = (float*)m_PointFile.data();
-    memcpy(points.get(), mmfdata, 3 * pointSize() * sizeof(float));
-
     numPoints = pointSize();
+    lvr2::floatArr points(new float[3 * numPoints]);
+    if (numPoints > 0)
+    {
+        memcpy(points.get(), m_pointData.data(), 3 * numPoints * sizeof(float));
+    }
     return points;
 }
 
 template <typename BaseVecT>
 size_t BigGrid<BaseVecT>::getSizeofBox(
-    float minx, float miny, float minz, float maxx, float maxy, float maxz)
+    float minx, float miny, float minz, float maxx, float maxy, float maxz) const
 {
-    size_t idxmin = calcIndex((minx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymin = calcIndex((miny - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmin = calcIndex((minz - m_bb.getMin()[2]) / m_voxelSize);
-    size_t idxmax = calcIndex((maxx - m_bb.getMin()[0]) / m_voxelSize);
-    size_t idymax = calcIndex((maxy - m_bb.getMin()[1]) / m_voxelSize);
-    size_t idzmax = calcIndex((maxz - m_bb.getMin()[2]) / m_voxelSize);
-
     size_t numPoints = 0;
-
-    // Overhead of saving indices needed to speedup size lookup
-    for (auto it = m_gridNumPoints.begin(); it != m_gridNumPoints.end(); it++)
+    for (const CellInfo* cell : cellsInBox(minx, miny, minz, maxx, maxy, maxz))
     {
-        if (it->second.ix >= idxmin && it->second.iy >= idymin && it->second.iz >= idzmin &&
-            it->second.ix <= idxmax && it->second.iy <= idymax && it->second.iz <= idzmax)
-        {
-            numPoints += it->second.size;
-        }
+        numPoints += cell->size;
     }
-
-    //    #pragma omp parallel for schedule(dynamic,1) collapse(3)
-    //    for(size_t i = idxmin ; i<=idxmax ; i++)
-    //    {
-    //        for(size_t j = idymin ; j<=idymax ; j++)
-    //        {
-    //            for(size_t k = idzmin ; k<=idzmax ; k++)
-    //            {
-    //
-    //                size_t h = hashValue(i,j,k);
-    //                auto it = m_gridNumPoints.find(h);
-    //                if(it != m_gridNumPoints.end())
-    //                {
-    //                    omp_set_lock(&m_lock);
-    //                    numPoints+=it->second.size;
-    //                    omp_unset_lock(&m_lock);
-    //                }
-    //
-    //            }
-    //        }
-    //    }
     return numPoints;
 }
 
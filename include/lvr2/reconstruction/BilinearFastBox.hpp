@@ -75,6 +75,12 @@ public:
 
     void optimizePlanarFaces(BaseMesh<BaseVecT>& mesh, size_t kc);
 
+    /**
+     * @brief Registers a face that was created for this box outside of
+     *        getSurface(), e.g. during parallel mesh extraction.
+     */
+    void addFace(FaceHandle f) { m_faces.push_back(f); }
+
     // the point set surface
     static PointsetSurfacePtr<BaseVecT> m_surface;
 
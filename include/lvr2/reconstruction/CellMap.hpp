@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CellMap.hpp
+ */
+
+#ifndef _LVR2_RECONSTRUCTION_CELLMAP_H_
+#define _LVR2_RECONSTRUCTION_CELLMAP_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+namespace lvr2
+{
+
+/**
+ * @brief   A compact map from linear grid cell indices to cell values.
+ *
+ *          All entries are stored contiguously in insertion order, lookups
+ *          go through an open addressing table with linear probing that
+ *          only stores 32 bit entry positions. Compared to an unordered_map
+ *          this avoids one heap node per cell and keeps iteration over all
+ *          cells a linear scan. The interface mimics the subset of
+ *          std::unordered_map that is used by the reconstruction grids,
+ *          so iterators dereference to (key, value) pairs. Entries can not
+ *          be erased individually.
+ */
+template<typename ValueT>
+class CellMap
+{
+public:
+
+    typedef std::pair<size_t, ValueT>                       value_type;
+    typedef typename vector<value_type>::iterator           iterator;
+    typedef typename vector<value_type>::const_iterator     const_iterator;
+
+    CellMap();
+
+    iterator        begin()         { return m_entries.begin(); }
+    iterator        end()           { return m_entries.end(); }
+    const_iterator  begin() const   { return m_entries.begin(); }
+    const_iterator  end() const     { return m_entries.end(); }
+
+    size_t  size() const    { return m_entries.size(); }
+    bool    empty() const   { return m_entries.empty(); }
+
+    /**
+     * @brief   Returns an iterator to the entry with the given key or end()
+     *          if there is no such entry.
+     */
+    iterator find(size_t key);
+
+    /**
+     * @brief   Returns the value associated with the given key. A default
+     *          constructed value is inserted if the key is not present.
+     */
+    ValueT& operator[](size_t key);
+
+    /**
+     * @brief   Allocates space for at least \ref n entries.
+     */
+    void reserve(size_t n);
+
+    /**
+     * @brief   Removes all entries.
+     */
+    void clear();
+
+    /**
+     * @brief   Reorders the entries according to the given key function
+     *          (e.g. a space filling curve). Keys are computed once per
+     *          entry, the lookup table is rebuilt afterwards.
+     */
+    template<typename KeyFunc>
+    void sortBy(KeyFunc keyFunc);
+
+    /**
+     * @brief   Returns the number of bytes allocated by the map
+     */
+    size_t memoryUsage() const;
+
+private:
+
+    static constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+    /// Returns the first probing position for the given key
+    inline size_t slot(size_t key) const
+    {
+        // Fibonacci hashing, spreads consecutive cell indices evenly
+        return (key * 0x9E3779B97F4A7C15ull) >> m_shift;
+    }
+
+    /// Rebuilds the lookup table with the given number of slots
+    void rehash(size_t numSlots);
+
+    /// The (key, value) pairs in insertion order
+    vector<value_type>  m_entries;
+
+    /// Open addressing table holding positions in m_entries
+    vector<uint32_t>    m_slots;
+
+    /// Shift to map a hashed key into the table
+    unsigned int        m_shift;
+};
+
+/**
+ * @brief   Allocates grid cells in large blocks instead of one heap
+ *          allocation per cell. All cells are destroyed together with
+ *          the arena.
+ */
+template<typename BoxT>
+class BoxArena
+{
+public:
+
+    /**
+     * @param blockSize     Number of boxes per allocated block
+     */
+    BoxArena(size_t blockSize = 4096) : m_blockSize(blockSize), m_used(blockSize) {}
+
+    BoxArena(const BoxArena&) = delete;
+    BoxArena& operator=(const BoxArena&) = delete;
+
+    ~BoxArena() { clear(); }
+
+    /**
+     * @brief   Constructs a new box from the given arguments.
+     */
+    template<typename... Args>
+    BoxT* create(Args&&... args);
+
+    /**
+     * @brief   Destroys all boxes and releases the memory.
+     */
+    void clear();
+
+    /**
+     * @brief   Returns the number of bytes allocated by the arena
+     */
+    size_t memoryUsage() const { return m_blocks.size() * m_blockSize * sizeof(BoxT); }
+
+private:
+
+    struct Storage
+    {
+        alignas(BoxT) unsigned char data[sizeof(BoxT)];
+    };
+
+    /// The allocated blocks
+    vector<std::unique_ptr<Storage[]>> m_blocks;
+
+    /// Number of boxes per block
+    size_t  m_blockSize;
+
+    /// Number of used boxes in the last block
+    size_t  m_used;
+};
+
+} // namespace lvr2
+
+#include "lvr2/reconstruction/CellMap.tcc"
+
+#endif /* _LVR2_RECONSTRUCTION_CELLMAP_H_ */
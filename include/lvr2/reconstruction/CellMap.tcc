@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CellMap.tcc
+ */
+
+#include <algorithm>
+#include <numeric>
+
+namespace lvr2
+{
+
+template<typename ValueT>
+CellMap<ValueT>::CellMap()
+{
+    rehash(16);
+}
+
+template<typename ValueT>
+typename CellMap<ValueT>::iterator CellMap<ValueT>::find(size_t key)
+{
+    size_t mask = m_slots.size() - 1;
+    for(size_t s = slot(key); ; s = (s + 1) & mask)
+    {
+        uint32_t pos = m_slots[s];
+        if(pos == EMPTY_SLOT)
+        {
+            return m_entries.end();
+        }
+        if(m_entries[pos].first == key)
+        {
+            return m_entries.begin() + pos;
+        }
+    }
+}
+
+template<typename ValueT>
+ValueT& CellMap<ValueT>::operator[](size_t key)
+{
+    // Keep the load factor below 0.5 to get short probing sequences
+    if(2 * (m_entries.size() + 1) > m_slots.size())
+    {
+        rehash(2 * m_slots.size());
+    }
+
+    size_t mask = m_slots.size() - 1;
+    size_t s = slot(key);
+    for(; m_slots[s] != EMPTY_SLOT; s = (s + 1) & mask)
+    {
+        if(m_entries[m_slots[s]].first == key)
+        {
+            return m_entries[m_slots[s]].second;
+        }
+    }
+
+    m_slots[s] = static_cast<uint32_t>(m_entries.size());
+    m_entries.emplace_back(key, ValueT());
+    return m_entries.back().second;
+}
+
+template<typename ValueT>
+void CellMap<ValueT>::reserve(size_t n)
+{
+    m_entries.reserve(n);
+    size_t numSlots = m_slots.size();
+    while(numSlots < 2 * n)
+    {
+        numSlots *= 2;
+    }
+    if(numSlots != m_slots.size())
+    {
+        rehash(numSlots);
+    }
+}
+
+template<typename ValueT>
+void CellMap<ValueT>::clear()
+{
+    vector<value_type>().swap(m_entries);
+    rehash(16);
+}
+
+template<typename ValueT>
+template<typename KeyFunc>
+void CellMap<ValueT>::sortBy(KeyFunc keyFunc)
+{
+    vector<std::pair<uint64_t, uint32_t>> order(m_entries.size());
+    for(size_t i = 0; i < m_entries.size(); i++)
+    {
+        order[i] = std::make_pair(static_cast<uint64_t>(keyFunc(m_entries[i])), static_cast<uint32_t>(i));
+    }
+    std::sort(order.begin(), order.end());
+
+    vector<value_type> sorted;
+    sorted.reserve(m_entries.size());
+    for(auto& o : order)
+    {
+        sorted.push_back(m_entries[o.second]);
+    }
+    m_entries.swap(sorted);
+
+    rehash(m_slots.size());
+}
+
+template<typename ValueT>
+size_t CellMap<ValueT>::memoryUsage() const
+{
+    return m_entries.capacity() * sizeof(value_type) + m_slots.capacity() * sizeof(uint32_t);
+}
+
+template<typename ValueT>
+void CellMap<ValueT>::rehash(size_t numSlots)
+{
+    unsigned int bits = 0;
+    while((size_t(1) << bits) < numSlots)
+    {
+        bits++;
+    }
+
+    m_shift = 64 - bits;
+    m_slots.assign(size_t(1) << bits, EMPTY_SLOT);
+
+    size_t mask = m_slots.size() - 1;
+    for(size_t i = 0; i < m_entries.size(); i++)
+    {
+        size_t s = slot(m_entries[i].first);
+        while(m_slots[s] != EMPTY_SLOT)
+        {
+            s = (s + 1) & mask;
+        }
+        m_slots[s] = static_cast<uint32_t>(i);
+    }
+}
+
+template<typename BoxT>
+template<typename... Args>
+BoxT* BoxArena<BoxT>::create(Args&&... args)
+{
+    if(m_used == m_blockSize)
+    {
+        m_blocks.emplace_back(new Storage[m_blockSize]);
+        m_used = 0;
+    }
+    void* mem = m_blocks.back()[m_used].data;
+    BoxT* box = new (mem) BoxT(std::forward<Args>(args)...);
+    m_used++;
+    return box;
+}
+
+template<typename BoxT>
+void BoxArena<BoxT>::clear()
+{
+    for(size_t b = 0; b < m_blocks.size(); b++)
+    {
+        size_t n = (b + 1 == m_blocks.size()) ? m_used : m_blockSize;
+        for(size_t i = 0; i < n; i++)
+        {
+            reinterpret_cast<BoxT*>(m_blocks[b][i].data)->~BoxT();
+        }
+    }
+    m_blocks.clear();
+    m_used = m_blockSize;
+}
+
+} // namespace lvr2
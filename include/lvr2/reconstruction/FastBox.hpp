@@ -137,6 +137,23 @@ public:
         float comparePrecision
     );
 
+    /**
+     * @brief Calculates the Marching Cubes configuration of this box and
+     *        the interpolated edge intersections without modifying a mesh
+     *        or any neighbor cell. This is safe to call concurrently for
+     *        different boxes of the same grid.
+     *
+     * @param query_points  A vector containing the query points of the
+     *                      reconstruction grid
+     * @param positions     The twelve interpolated edge intersections
+     * @return              The MC table index of the box or -1 if the box
+     *                      does not contribute any triangles
+     */
+    int getLocalSurface(
+        vector<QueryPoint<BaseVecT>>& query_points,
+        BaseVecT positions[12]
+    );
+
     /// The voxelsize of the reconstruction grid
     static float             m_voxelsize;
 
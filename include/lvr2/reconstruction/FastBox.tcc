@@ -360,6 +360,42 @@ void FastBox<BaseVecT>::getSurface(
     }
 }
 
+template<typename BaseVecT>
+int FastBox<BaseVecT>::getLocalSurface(
+    vector<QueryPoint<BaseVecT>>& qp,
+    BaseVecT positions[12]
+)
+{
+    if (this->m_extruded)
+    {
+        return -1;
+    }
+
+    // Do not create triangles for invalid boxes
+    for (int i = 0; i < 8; i++)
+    {
+        if (qp[m_vertices[i]].m_invalid)
+        {
+            return -1;
+        }
+    }
+
+    int index = getIndex(qp);
+    if(MCTable[index][0] == -1)
+    {
+        return -1;
+    }
+
+    BaseVecT corners[8];
+    float distances[8];
+
+    getCorners(corners, qp);
+    getDistances(distances, qp);
+    getIntersections(corners, distances, positions);
+
+    return index;
+}
+
 template<typename BaseVecT>
 float FastBox<BaseVecT>::distanceToBB(const BaseVecT& v, const BoundingBox<BaseVecT>& bb) const
 {
@@ -113,9 +113,46 @@ public:
         float comparePrecision
     );
 
+    /**
+     * @brief   Enables parallel mesh extraction. The grid cells are split
+     *          into slabs along the x axis that are triangulated concurrently
+     *          into thread local buffers. The buffers are merged into the
+     *          mesh afterwards, vertices on slab borders are deduplicated
+     *          deterministically. Only supported for FastBox and
+     *          BilinearFastBox, all other box types are processed serially.
+     */
+    void setParallelExtraction(bool parallel) { m_parallelExtraction = parallel; }
+
 private:
 
+    /// Triangles of a single slab of grid cells
+    struct SlabBuffer
+    {
+        /// Interpolated vertex positions
+        vector<BaseVecT>        positions;
+
+        /// Grid edge of each vertex, encoded by its two query point indices
+        vector<uint64_t>        edgeKeys;
+
+        /// True if the vertex lies on the border to a neighboring slab
+        vector<char>            border;
+
+        /// Three slab local vertex indices per triangle
+        vector<uint32_t>        triangles;
+
+        /// Box edge (0 to 11) of each triangle vertex
+        vector<char>            edges;
+
+        /// The box that created each triangle
+        vector<BoxT*>           boxes;
+    };
+
+    /// Parallel version of getMesh(mesh), see setParallelExtraction()
+    void getMeshParallel(BaseMesh<BaseVecT>& mesh);
+
     shared_ptr<HashGrid<BaseVecT, BoxT>> m_grid;
+
+    bool m_parallelExtraction = false;
 };
 
 
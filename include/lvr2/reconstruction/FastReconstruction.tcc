@@ -34,6 +34,12 @@
 #include "lvr2/geometry/BaseMesh.hpp"
 #include "lvr2/reconstruction/FastReconstructionTables.hpp"
 #include "lvr2/io/Progress.hpp"
+#include "lvr2/config/lvropenmp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 namespace lvr2
 {
@@ -47,26 +53,44 @@ FastReconstruction<BaseVecT, BoxT>::FastReconstruction(shared_ptr<HashGrid<BaseV
 template<typename BaseVecT, typename BoxT>
 void FastReconstruction<BaseVecT, BoxT>::getMesh(BaseMesh<BaseVecT> &mesh)
 {
-    // Status message for mesh generation
-    string comment = timestamp.getElapsedTime() + "Creating mesh ";
-    ProgressBar progress(m_grid->getNumberOfCells(), comment);
+    typename HashGrid<BaseVecT, BoxT>::box_map_it it;
 
-    // Some pointers
-    BoxT* b;
-    unsigned int global_index = mesh.numVertices();
+    // Only boxes that use the plain marching cubes table can be
+    // triangulated independently of their neighbors
+    constexpr bool parallelCapable =
+        std::is_same<BoxT, FastBox<BaseVecT>>::value ||
+        std::is_same<BoxT, BilinearFastBox<BaseVecT>>::value;
 
-    // Iterate through cells and calculate local approximations
-    typename HashGrid<BaseVecT, BoxT>::box_map_it it;
-    for(it = m_grid->firstCell(); it != m_grid->lastCell(); it++)
+    if constexpr (parallelCapable)
     {
-        b = it->second;
-        b->getSurface(mesh, m_grid->getQueryPoints(), global_index);
-        if(!timestamp.isQuiet())
-            ++progress;
+        if(m_parallelExtraction)
+        {
+            getMeshParallel(mesh);
+        }
     }
 
-    if(!timestamp.isQuiet())
-        cout << endl;
+    if(!parallelCapable || !m_parallelExtraction)
+    {
+        // Status message for mesh generation
+        string comment = timestamp.getElapsedTime() + "Creating mesh ";
+        ProgressBar progress(m_grid->getNumberOfCells(), comment);
+
+        // Some pointers
+        BoxT* b;
+        unsigned int global_index = mesh.numVertices();
+
+        // Iterate through cells and calculate local approximations
+        for(it = m_grid->firstCell(); it != m_grid->lastCell(); it++)
+        {
+            b = it->second;
+            b->getSurface(mesh, m_grid->getQueryPoints(), global_index);
+            if(!timestamp.isQuiet())
+                ++progress;
+        }
+
+        if(!timestamp.isQuiet())
+            cout << endl;
+    }
 
     BoxTraits<BoxT> traits;
 
@@ -177,6 +201,199 @@ void FastReconstruction<BaseVecT, BoxT>::getMesh(BaseMesh<BaseVecT> &mesh)
 
 }
 
+template<typename BaseVecT, typename BoxT>
+void FastReconstruction<BaseVecT, BoxT>::getMeshParallel(BaseMesh<BaseVecT> &mesh)
+{
+    string comment = timestamp.getElapsedTime() + "Creating mesh (parallel) ";
+    ProgressBar progress(m_grid->getNumberOfCells(), comment);
+
+    vector<QueryPoint<BaseVecT>>& qp = m_grid->getQueryPoints();
+    const float voxelsize = BoxT::m_voxelsize;
+    const float minX = m_grid->getBoundingBox().getMin().x;
+
+    // Sort the cells into x layers with a counting sort. This keeps
+    // the order within a layer stable and the result reproducible.
+    vector<BoxT*> cells;
+    vector<int> layers;
+    cells.reserve(m_grid->getNumberOfCells());
+    layers.reserve(m_grid->getNumberOfCells());
+
+    int minLayer = std::numeric_limits<int>::max();
+    int maxLayer = std::numeric_limits<int>::min();
+    typename HashGrid<BaseVecT, BoxT>::box_map_it it;
+    for(it = m_grid->firstCell(); it != m_grid->lastCell(); it++)
+    {
+        int layer = static_cast<int>(std::floor((it->second->getCenter().x - minX) / voxelsize + 0.5f));
+        minLayer = std::min(minLayer, layer);
+        maxLayer = std::max(maxLayer, layer);
+        cells.push_back(it->second);
+        layers.push_back(layer);
+    }
+
+    if(cells.empty())
+    {
+        return;
+    }
+
+    size_t numLayers = maxLayer - minLayer + 1;
+    vector<size_t> layerStart(numLayers + 1, 0);
+    for(int layer : layers)
+    {
+        layerStart[layer - minLayer + 1]++;
+    }
+    for(size_t i = 1; i <= numLayers; i++)
+    {
+        layerStart[i] += layerStart[i - 1];
+    }
+
+    vector<BoxT*> sorted(cells.size());
+    {
+        vector<size_t> pos(layerStart.begin(), layerStart.end() - 1);
+        for(size_t i = 0; i < cells.size(); i++)
+        {
+            sorted[pos[layers[i] - minLayer]++] = cells[i];
+        }
+    }
+    cells.clear();
+    cells.shrink_to_fit();
+    layers.clear();
+    layers.shrink_to_fit();
+
+    // Group whole layers into slabs of roughly equal cell count. A few
+    // more slabs than threads give a better load balance.
+    size_t numSlabs = std::min(numLayers, static_cast<size_t>(4 * OpenMPConfig::getNumThreads()));
+    vector<size_t> slabLayer;
+    slabLayer.push_back(0);
+    for(size_t l = 1; l < numLayers; l++)
+    {
+        size_t target = sorted.size() * slabLayer.size() / numSlabs;
+        if(layerStart[l] >= target && layerStart[l] > layerStart[slabLayer.back()])
+        {
+            slabLayer.push_back(l);
+        }
+    }
+    slabLayer.push_back(numLayers);
+    numSlabs = slabLayer.size() - 1;
+
+    vector<SlabBuffer> buffers(numSlabs);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(size_t s = 0; s < numSlabs; s++)
+    {
+        SlabBuffer& buffer = buffers[s];
+        std::unordered_map<uint64_t, uint32_t> localIndices;
+
+        size_t first = layerStart[slabLayer[s]];
+        size_t last = layerStart[slabLayer[s + 1]];
+
+        // Cell faces on the slab borders
+        float lower = sorted[first]->getCenter().x - 0.5f * voxelsize;
+        float upper = sorted[last - 1]->getCenter().x + 0.5f * voxelsize;
+        float eps = 0.25f * voxelsize;
+
+        BaseVecT positions[12];
+        for(size_t c = first; c < last; c++)
+        {
+            BoxT* box = sorted[c];
+            int index = box->getLocalSurface(qp, positions);
+            if(index < 0)
+            {
+                continue;
+            }
+
+            for(int a = 0; MCTable[index][a] != -1; a++)
+            {
+                int edge = MCTable[index][a];
+                uint64_t v1 = box->getVertex(vertex_edge_table[edge][0]);
+                uint64_t v2 = box->getVertex(vertex_edge_table[edge][1]);
+                uint64_t key = std::min(v1, v2) << 32 | std::max(v1, v2);
+
+                auto inserted = localIndices.emplace(key, buffer.positions.size());
+                if(inserted.second)
+                {
+                    float x1 = qp[v1].m_position.x;
+                    float x2 = qp[v2].m_position.x;
+                    bool onBorder =
+                        (fabs(x1 - lower) < eps && fabs(x2 - lower) < eps) ||
+                        (fabs(x1 - upper) < eps && fabs(x2 - upper) < eps);
+
+                    buffer.positions.push_back(positions[edge]);
+                    buffer.edgeKeys.push_back(key);
+                    buffer.border.push_back(onBorder);
+                }
+                buffer.triangles.push_back(inserted.first->second);
+                buffer.edges.push_back(edge);
+                if(a % 3 == 0)
+                {
+                    buffer.boxes.push_back(box);
+                }
+            }
+        }
+
+        if(!timestamp.isQuiet())
+        {
+            progress += last - first;
+        }
+    }
+
+    if(!timestamp.isQuiet())
+        cout << endl;
+
+    // Merge the slabs in a fixed order. Only vertices on slab borders
+    // can be shared between slabs and need a global lookup.
+    std::unordered_map<uint64_t, VertexHandle> borderVertices;
+    vector<VertexHandle> handles;
+    for(size_t s = 0; s < numSlabs; s++)
+    {
+        SlabBuffer& buffer = buffers[s];
+
+        handles.clear();
+        handles.reserve(buffer.positions.size());
+        for(size_t i = 0; i < buffer.positions.size(); i++)
+        {
+            if(buffer.border[i])
+            {
+                auto found = borderVertices.find(buffer.edgeKeys[i]);
+                if(found != borderVertices.end())
+                {
+                    handles.push_back(found->second);
+                    continue;
+                }
+                VertexHandle vh = mesh.addVertex(buffer.positions[i]);
+                borderVertices.emplace(buffer.edgeKeys[i], vh);
+                handles.push_back(vh);
+            }
+            else
+            {
+                handles.push_back(mesh.addVertex(buffer.positions[i]));
+            }
+        }
+
+        for(size_t t = 0; t < buffer.boxes.size(); t++)
+        {
+            BoxT* box = buffer.boxes[t];
+            for(int b = 0; b < 3; b++)
+            {
+                box->m_intersections[buffer.edges[3 * t + b]] = handles[buffer.triangles[3 * t + b]];
+            }
+
+            FaceHandle f = mesh.addFace(
+                handles[buffer.triangles[3 * t]],
+                handles[buffer.triangles[3 * t + 1]],
+                handles[buffer.triangles[3 * t + 2]]
+            );
+
+            if constexpr (std::is_same<BoxT, BilinearFastBox<BaseVecT>>::value)
+            {
+                box->addFace(f);
+            }
+        }
+
+        // Release the slab memory as early as possible
+        buffers[s] = SlabBuffer();
+    }
+}
+
 template<typename BaseVecT, typename BoxT>
 void FastReconstruction<BaseVecT, BoxT>::getMesh(
     BaseMesh<BaseVecT>& mesh,
@@ -40,6 +40,7 @@
 #include <string>
 
 #include "QueryPoint.hpp"
+#include "CellMap.hpp"
 
 #include "lvr2/geometry/BoundingBox.hpp"
 #include "lvr2/reconstruction/QueryPoint.hpp"
@@ -98,12 +99,12 @@ public:
     BoundingBox<BaseVecT> qp_bb;
 
     /// Typedef to alias box map
-    typedef unordered_map<size_t, BoxT*> box_map;
+    typedef CellMap<BoxT*> box_map;
 
     typedef unordered_map<size_t, size_t> qp_map;
 
     /// Typedef to alias iterators for box maps
-    typedef typename unordered_map<size_t, BoxT*>::iterator  box_map_it;
+    typedef typename box_map::iterator  box_map_it;
 
     /// Typedef to alias iterators to query points
     typedef typename vector<QueryPoint<BaseVecT>>::iterator query_point_it;
@@ -141,6 +142,26 @@ public:
      */
     HashGrid(std::vector<string>& files, BoundingBox<BaseVecT>& boundingBox, float voxelsize);
 
+    /***
+     * @brief Construct a new Hash Grid object from the cells in the given
+     *        files whose centers lie within \ref region. Regions are half
+     *        open, i.e. a cell on the max border is not loaded. Grids that
+     *        are created with the same bounding box and voxelsize use the
+     *        same cell hashes, so they can be used to process a large grid
+     *        piece by piece.
+     *
+     * @param files
+     * @param boundingBox
+     * @param voxelsize
+     * @param region        Only cells within this region are loaded
+     */
+    HashGrid(
+        std::vector<string>& files,
+        BoundingBox<BaseVecT>& boundingBox,
+        float voxelsize,
+        const BoundingBox<BaseVecT>& region
+    );
+
     /**
      *
      * @param i         Discrete x position within the grid.
@@ -172,6 +193,11 @@ public:
      */
     size_t getNumberOfCells() { return m_cells.size(); }
 
+    /***
+     * @brief   Returns the voxel size of the grid cells.
+     */
+    float getVoxelsize() const { return m_voxelsize; }
+
     /**
      * @return  Returns an iterator to the first box in the cell map.
      */
@@ -248,6 +274,13 @@ public:
      */
     void calcIndices();
 
+    /**
+     * @brief   Reorders the cells along a Morton (Z-order) curve, so that
+     *          iterating over the cells visits spatial neighbors in
+     *          succession. Iterators to cells are invalidated.
+     */
+    void sortCells();
+
 protected:
 
     inline int calcIndex(float f)
@@ -255,11 +288,12 @@ protected:
         return f < 0 ? f - .5 : f + .5;
     }
 
+    /// Memory for all boxes of the grid
+    BoxArena<BoxT>  m_boxArena;
+
     /// Map to handle the boxes in the grid
     box_map         m_cells;
 
-    qp_map          m_qpIndices;
-
     /// The voxelsize used for reconstruction
     float                       m_voxelsize;
 
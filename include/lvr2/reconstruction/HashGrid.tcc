@@ -37,7 +37,9 @@
 #include "lvr2/reconstruction/FastReconstructionTables.hpp"
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
+#include "lvr2/util/Util.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -148,7 +150,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(string file)
         //cout << "i: " << k << endl;
         ifs >> h >> cell[0] >> cell[1] >> cell[2] >> cell[3] >> cell[4] >> cell[5] >> cell[6] >> cell[7]
                  >> cell_center.x >> cell_center.y >> cell_center.z >> fusion;
-        BoxT* box = new BoxT(cell_center);
+        BoxT* box = m_boxArena.create(cell_center);
         box->m_extruded = fusion;
         for(int j=0 ; j<8 ; j++)
         {
@@ -209,6 +211,16 @@ template<typename BaseVecT, typename BoxT>
 HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
                                    BoundingBox<BaseVecT>& boundingBox,
                                    float voxelsize)
+    : HashGrid(files, boundingBox, voxelsize, BoundingBox<BaseVecT>())
+{
+
+}
+
+template<typename BaseVecT, typename BoxT>
+HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
+                                   BoundingBox<BaseVecT>& boundingBox,
+                                   float voxelsize,
+                                   const BoundingBox<BaseVecT>& region)
     : m_boundingBox(boundingBox), m_voxelsize(voxelsize), m_globalIndex(0)
 {
     unsigned int INVALID = BoxT::INVALID_INDEX;
@@ -236,6 +248,14 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
 
             r = fread(&(distances[0]), sizeof(float), 8, pFile);
 
+            if (region.isValid() &&
+                (box_center[0] <  region.getMin()[0] || box_center[0] >= region.getMax()[0] ||
+                 box_center[1] <  region.getMin()[1] || box_center[1] >= region.getMax()[1] ||
+                 box_center[2] <  region.getMin()[2] || box_center[2] >= region.getMax()[2]))
+            {
+                continue;
+            }
+
             size_t idx = calcIndex((box_center[0] - m_boundingBox.getMin()[0]) / m_voxelsize);
             size_t idy = calcIndex((box_center[1] - m_boundingBox.getMin()[1]) / m_voxelsize);
             size_t idz = calcIndex((box_center[2] - m_boundingBox.getMin()[2]) / m_voxelsize);
@@ -243,7 +263,7 @@ HashGrid<BaseVecT, BoxT>::HashGrid(std::vector<string>& files,
             auto cell_it = this->m_cells.find(hash);
             if (cell_it == this->m_cells.end() && !extruded)
             {
-                BoxT* box = new BoxT(box_center);
+                BoxT* box = m_boxArena.create(box_center);
                 for (int i = 0; i < 8; i++)
                 {
                     current_index = this->findQueryPoint(i, idx, idy, idz);
@@ -349,7 +369,7 @@ void HashGrid<BaseVecT, BoxT>::addLatticePoint(int index_x, int index_y, int ind
                     // }
 
                     //Create new box
-                    BoxT* box = new BoxT(box_center);
+                    BoxT* box = m_boxArena.create(box_center);
 
                     if(
                         box_center[0] <= m_boundingBox.getMin().x + m_voxelsize*5  ||
@@ -438,17 +458,25 @@ void HashGrid<BaseVecT, BoxT>::setCoordinateScaling(float x, float y, float z)
 template<typename BaseVecT, typename BoxT>
 HashGrid<BaseVecT, BoxT>::~HashGrid()
 {
-    box_map_it iter;
-    for(iter = m_cells.begin(); iter != m_cells.end(); iter++)
-    {
-        if(iter->second != NULL)
-        {
-            delete (iter->second);
-            iter->second = NULL;
-        }
-    }
-
     m_cells.clear();
+    m_boxArena.clear();
+}
+
+template<typename BaseVecT, typename BoxT>
+void HashGrid<BaseVecT, BoxT>::sortCells()
+{
+    auto v_min = m_boundingBox.getMin();
+
+    m_cells.sortBy([&](const typename box_map::value_type& cell)
+    {
+        // Shift by one to account for extruded cells in front of the
+        // bounding box
+        BaseVecT center = cell.second->getCenter();
+        int i = std::max(0, calcIndex((center.x - v_min.x) / m_voxelsize) + 1);
+        int j = std::max(0, calcIndex((center.y - v_min.y) / m_voxelsize) + 1);
+        int k = std::max(0, calcIndex((center.z - v_min.z) / m_voxelsize) + 1);
+        return Util::mortonCode(i, j, k);
+    });
 }
 
 
@@ -535,7 +563,7 @@ void HashGrid<BaseVecT, BoxT>::saveGrid(string filename)
         }
 
         // Write box definitions
-        typename unordered_map<size_t, BoxT* >::iterator it;
+        box_map_it it;
         BoxT* box;
         for(it = m_cells.begin(); it != m_cells.end(); it++)
         {
@@ -612,7 +640,7 @@ void HashGrid<BaseVecT, BoxT>::serialize(string file)
         }
 
         // Write box definitions
-        typename unordered_map<size_t, BoxT* >::iterator it;
+        box_map_it it;
         BoxT* box;
         for(it = m_cells.begin(); it != m_cells.end(); it++)
         {
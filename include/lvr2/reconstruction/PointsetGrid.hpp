@@ -39,6 +39,7 @@
 
 #include "PointsetSurface.hpp"
 #include "lvr2/geometry/BoundingBox.hpp"
+#include "lvr2/util/Util.hpp"
 
 namespace lvr2
 {
@@ -61,6 +62,11 @@ public:
 
 private:
 
+    /**
+     * @brief Returns the query point indices sorted along a Morton curve
+     */
+    vector<size_t> mortonOrder();
+
     /**
      * @brief Rounds the given value to the neares integer value
      */
@@ -63,37 +63,93 @@ PointsetGrid<BaseVecT, BoxT>::PointsetGrid(
         auto index = (pt - v_min) / this->m_voxelsize;
         this->addLatticePoint(calcIndex(index.x), calcIndex(index.y), calcIndex(index.z));
     }
+
+    // Store spatially close cells close to each other in memory
+    this->sortCells();
 }
 
 
 template<typename BaseVecT, typename BoxT>
 void PointsetGrid<BaseVecT, BoxT>::calcDistanceValues()
 {
+    using CoordT = typename BaseVecT::CoordType;
+
     // Status message output
     string comment = timestamp.getElapsedTime() + "Calculating distance values ";
     ProgressBar progress(this->m_queryPoints.size(), comment);
 
     Timestamp ts;
 
-    // Calculate a distance value for each query point
-    #pragma omp parallel for
-    for( int i = 0; i < (int)this->m_queryPoints.size(); i++){
-        float projectedDistance;
-        float euklideanDistance;
+    // Sort the query points along a Morton curve and evaluate them in
+    // blocks of spatially close points. The surface can share neighbor
+    // searches within a block.
+    vector<size_t> order = mortonOrder();
 
-        //cout << euklideanDistance << " " << projectedDistance << endl;
+    const size_t blockSize = 64;
+    const size_t numBlocks = (order.size() + blockSize - 1) / blockSize;
 
-        std::tie(projectedDistance, euklideanDistance) =
-            this->m_surface->distance(this->m_queryPoints[i].m_position);
-        if (euklideanDistance > 1.7320 * this->m_voxelsize)
+    #pragma omp parallel
+    {
+        vector<BaseVecT> positions(blockSize);
+        vector<CoordT> projected(blockSize);
+        vector<CoordT> euklidean(blockSize);
+
+        #pragma omp for schedule(dynamic, 16)
+        for(size_t b = 0; b < numBlocks; b++)
         {
-            this->m_queryPoints[i].m_invalid = true;
+            size_t first = b * blockSize;
+            size_t n = std::min(blockSize, order.size() - first);
+
+            for(size_t i = 0; i < n; i++)
+            {
+                positions[i] = this->m_queryPoints[order[first + i]].m_position;
+            }
+
+            m_surface->distances(positions.data(), n, projected.data(), euklidean.data());
+
+            for(size_t i = 0; i < n; i++)
+            {
+                QueryPoint<BaseVecT>& qp = this->m_queryPoints[order[first + i]];
+                if (euklidean[i] > 1.7320 * this->m_voxelsize)
+                {
+                    qp.m_invalid = true;
+                }
+                qp.m_distance = projected[i];
+            }
+            progress += n;
         }
-        this->m_queryPoints[i].m_distance = projectedDistance;
-        ++progress;
     }
     cout << endl;
     cout << timestamp << "Elapsed time: " << ts.getElapsedTimeInS() << endl;
 }
 
+template<typename BaseVecT, typename BoxT>
+vector<size_t> PointsetGrid<BaseVecT, BoxT>::mortonOrder()
+{
+    auto v_min = this->m_queryPoints.empty() ? BaseVecT() : this->m_queryPoints[0].m_position;
+    for(auto& qp : this->m_queryPoints)
+    {
+        v_min.x = std::min(v_min.x, qp.m_position.x);
+        v_min.y = std::min(v_min.y, qp.m_position.y);
+        v_min.z = std::min(v_min.z, qp.m_position.z);
+    }
+
+    vector<std::pair<uint64_t, size_t>> codes(this->m_queryPoints.size());
+    #pragma omp parallel for
+    for(size_t i = 0; i < codes.size(); i++)
+    {
+        auto index = (this->m_queryPoints[i].m_position - v_min) / this->m_voxelsize;
+        codes[i].first = Util::mortonCode(calcIndex(index.x), calcIndex(index.y), calcIndex(index.z));
+        codes[i].second = i;
+    }
+    std::sort(codes.begin(), codes.end());
+
+    vector<size_t> order(codes.size());
+    for(size_t i = 0; i < codes.size(); i++)
+    {
+        order[i] = codes[i].second;
+    }
+    return order;
+}
+
 } // namespace lvr2
@@ -73,6 +73,26 @@ public:
      */
     virtual pair<typename BaseVecT::CoordType, typename BaseVecT::CoordType>
         distance(BaseVecT v) const = 0;
+
+    /**
+     * @brief Calculates the distances for a block of query points. The
+     *        results are the same as calling @ref distance for each point,
+     *        but implementations may share neighbor searches and scratch
+     *        memory between the points of a block. Blocks of spatially
+     *        close points give the best performance.
+     *
+     * @param queries       The query points
+     * @param n             The number of query points
+     * @param projected     Output array for the projected distances
+     * @param euklidean     Output array for the euclidian distances
+     */
+    virtual void distances(
+        const BaseVecT* queries,
+        size_t n,
+        typename BaseVecT::CoordType* projected,
+        typename BaseVecT::CoordType* euklidean
+    ) const;
+
     /**
      * @brief   Calculates surface normals for each data point in the given
      *          PointBuffeer. If the buffer alreay contains normal information
@@ -50,6 +50,20 @@ PointsetSurface<BaseVecT>::PointsetSurface(PointBufferPtr pointBuffer)
     }
 }
 
+template<typename BaseVecT>
+void PointsetSurface<BaseVecT>::distances(
+    const BaseVecT* queries,
+    size_t n,
+    typename BaseVecT::CoordType* projected,
+    typename BaseVecT::CoordType* euklidean
+) const
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        std::tie(projected[i], euklidean[i]) = distance(queries[i]);
+    }
+}
+
 template<typename BaseVecT>
 Normal<float> PointsetSurface<BaseVecT>::getInterpolatedNormal(const BaseVecT& position) const
 {
@@ -36,6 +36,7 @@
 #define LVR2_RECONSTRUCTION_SEARCHTREE_H_
 
 #include <vector>
+#include <memory>
 
 namespace lvr2
 {
@@ -96,6 +97,30 @@ public:
         std::vector<size_t>& indices
     ) const;
 
+    /**
+     * @brief Performs a k-next-neighbor search for a batch of query points.
+     *        The default implementation calls kSearch() for each query in
+     *        an OpenMP parallel loop, backends may override it with a
+     *        native batch search.
+
+     * @param query       Array of n query points.
+     * @param n           The number of query points.
+     * @param k           The number of neighbours that should be searched.
+     * @param indices     Preallocated array of n * k entries. Row i holds
+     *                    the neighbours of query[i] sorted by distance.
+     * @param distances   Preallocated array of n * k entries that receives
+     *                    the squared distances of the neighbours. Entries
+     *                    for which no neighbour was found are set to the
+     *                    maximum index and distance value.
+     */
+    virtual void kSearchMany(
+        const BaseVecT* query,
+        size_t n,
+        int k,
+        size_t* indices,
+        CoordT* distances
+    ) const;
+
     // /**
     //  * @brief Set the number of neighbours used to estimate and interpolate normals.
     //  */
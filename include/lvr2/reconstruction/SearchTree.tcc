@@ -35,7 +35,9 @@
 
 #include "lvr2/io/Timestamp.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 using std::cout;
 using std::endl;
 
@@ -53,6 +55,36 @@ int SearchTree<BaseVecT>::kSearch(
     return this->kSearch(qp, neighbours, indices, distances);
 }
 
+template<typename BaseVecT>
+void SearchTree<BaseVecT>::kSearchMany(
+    const BaseVecT* query,
+    size_t n,
+    int k,
+    size_t* indices,
+    CoordT* distances
+) const
+{
+    #pragma omp parallel
+    {
+        std::vector<size_t> id;
+        std::vector<CoordT> di;
+
+        #pragma omp for schedule(dynamic, 64)
+        for(size_t i = 0; i < n; i++)
+        {
+            id.clear();
+            di.clear();
+            this->kSearch(query[i], k, id, di);
+
+            size_t found = std::min<size_t>(k, std::min(id.size(), di.size()));
+            std::copy(id.begin(), id.begin() + found, indices + i * k);
+            std::copy(di.begin(), di.begin() + found, distances + i * k);
+            std::fill(indices + i * k + found, indices + (i + 1) * k, std::numeric_limits<size_t>::max());
+            std::fill(distances + i * k + found, distances + (i + 1) * k, std::numeric_limits<CoordT>::max());
+        }
+    }
+}
+
 // template<typename BaseVecT>
 // void SearchTree<BaseVecT>::setKi(int ki)
 // {
@@ -103,16 +103,21 @@ void SearchTreeFlann<BaseVecT>::radiusSearch(
 template<typename BaseVecT>
 void SearchTreeFlann<BaseVecT>::kSearchMany(
     const BaseVecT* query,
-    int n,
+    size_t n,
     int k,
     size_t* indices,
     CoordT* distances
 ) const
 {
-    CoordT* queries = new CoordT[n * 3];
-    flann::Matrix<CoordT> queries_mat(queries, n, 3);
-    flann::Matrix<size_t> indices_mat(indices, n, 1);
-    flann::Matrix<CoordT> distances_mat(distances, n, 1);
+    if(n == 0)
+    {
+        return;
+    }
+
+    vector<CoordT> queries(n * 3);
+    flann::Matrix<CoordT> queries_mat(queries.data(), n, 3);
+    flann::Matrix<size_t> indices_mat(indices, n, k);
+    flann::Matrix<CoordT> distances_mat(distances, n, k);
 
     #pragma omp parallel for
     for (size_t i = 0; i < n; i++)
@@ -123,10 +128,8 @@ void SearchTreeFlann<BaseVecT>::kSearchMany(
     }
 
     flann::SearchParams params;
-    params.cores = omp_get_max_threads();
-    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, 1, params);
-
-    delete[] queries;
+    params.cores = omp_in_parallel() ? 1 : omp_get_max_threads();
+    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, k, params);
 }
 
 
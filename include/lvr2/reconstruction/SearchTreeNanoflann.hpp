@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * SearchTreeNanoflann.hpp
+ */
+
+#ifndef LVR2_RECONSTRUCTION_SEARCHTREENANOFLANN_HPP_
+#define LVR2_RECONSTRUCTION_SEARCHTREENANOFLANN_HPP_
+
+#include <vector>
+#include <memory>
+
+#include <nanoflann.hpp>
+
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/reconstruction/SearchTree.hpp"
+
+using std::vector;
+using std::unique_ptr;
+
+namespace lvr2
+{
+
+/**
+ * @brief SearchClass for point data.
+ *
+ *      This class uses the header only nanoflann library
+ *      ( https://github.com/jlblancoc/nanoflann ) to implement a nearest
+ *      neighbour search for point data. In contrast to SearchTreeFlann the
+ *      tree is built directly on the "points" channel of the given point
+ *      buffer, the coordinates are not copied.
+ */
+template<typename BaseVecT>
+class SearchTreeNanoflann : public SearchTree<BaseVecT>
+{
+private:
+    using CoordT = typename BaseVecT::CoordType;
+
+public:
+
+    /**
+     *  @brief Takes the point-data and initializes the underlying searchtree.
+     *         The tree keeps a reference to the point channel of the buffer,
+     *         the points must not be modified while the tree is in use.
+     *
+     *  @param buffer  A PointBuffer point that holds the data.
+     */
+    SearchTreeNanoflann(PointBufferPtr buffer);
+
+    /// See interface documentation.
+    virtual int kSearch(
+        const BaseVecT& qp,
+        int k,
+        vector<size_t>& indices,
+        vector<CoordT>& distances
+    ) const override;
+
+    /// See interface documentation.
+    virtual void radiusSearch(
+        const BaseVecT& qp,
+        CoordT r,
+        vector<size_t>& indices
+    ) const override;
+
+    /// See interface documentation.
+    virtual void kSearchMany(
+        const BaseVecT* query,
+        size_t n,
+        int k,
+        size_t* indices,
+        CoordT* distances
+    ) const override;
+
+private:
+
+    /// Dataset adaptor that exposes an interleaved xyz float array to nanoflann
+    struct PointArrayAdaptor
+    {
+        const float*    m_points;
+        size_t          m_numPoints;
+
+        inline size_t kdtree_get_point_count() const
+        {
+            return m_numPoints;
+        }
+
+        inline CoordT kdtree_distance(const float* p, const size_t idx, size_t) const
+        {
+            const float* q = m_points + 3 * idx;
+            CoordT dx = p[0] - q[0];
+            CoordT dy = p[1] - q[1];
+            CoordT dz = p[2] - q[2];
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        inline float kdtree_get_pt(const size_t idx, int dim) const
+        {
+            return m_points[3 * idx + dim];
+        }
+
+        /// Let nanoflann compute the bounding box itself
+        template<class BBOX>
+        bool kdtree_get_bbox(BBOX&) const
+        {
+            return false;
+        }
+    };
+
+    /// Collects all points within a squared radius. Replaces the radius
+    /// result set of the bundled nanoflann version, which does not compile
+    /// with C++11 and later.
+    struct RadiusResultSet
+    {
+        CoordT              m_radius;
+        vector<size_t>&     m_indices;
+
+        inline size_t size() const
+        {
+            return m_indices.size();
+        }
+
+        inline bool full() const
+        {
+            return true;
+        }
+
+        inline void addPoint(CoordT dist, size_t index)
+        {
+            if(dist < m_radius)
+            {
+                m_indices.push_back(index);
+            }
+        }
+
+        inline CoordT worstDist() const
+        {
+            return m_radius;
+        }
+    };
+
+    using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
+        nanoflann::L2_Simple_Adaptor<float, PointArrayAdaptor, CoordT>,
+        PointArrayAdaptor,
+        3
+    >;
+
+    /// Keeps the point channel alive as long as the tree exists
+    floatArr                m_points;
+
+    /// The adaptor the tree is built on
+    PointArrayAdaptor       m_adaptor;
+
+    /// The nanoflann search tree structure
+    unique_ptr<KDTree>      m_tree;
+};
+
+} // namespace lvr2
+
+#include "lvr2/reconstruction/SearchTreeNanoflann.tcc"
+
+#endif /* LVR2_RECONSTRUCTION_SEARCHTREENANOFLANN_HPP_ */
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * SearchTreeNanoflann.tcc
+ */
+
+#include "lvr2/reconstruction/SearchTreeNanoflann.hpp"
+
+#include "lvr2/util/Panic.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using std::make_unique;
+
+namespace lvr2
+{
+
+template<typename BaseVecT>
+SearchTreeNanoflann<BaseVecT>::SearchTreeNanoflann(PointBufferPtr buffer)
+{
+    FloatChannelOptional pts_optional = buffer->getFloatChannel("points");
+    if(!pts_optional || pts_optional->width() != 3)
+    {
+        panic("SearchTreeNanoflann: point buffer has no valid points channel");
+    }
+
+    m_points = pts_optional->dataPtr();
+    m_adaptor.m_points = m_points.get();
+    m_adaptor.m_numPoints = pts_optional->numElements();
+
+    m_tree = make_unique<KDTree>(
+                 3,
+                 m_adaptor,
+                 nanoflann::KDTreeSingleIndexAdaptorParams(10)
+             );
+    m_tree->buildIndex();
+}
+
+template<typename BaseVecT>
+int SearchTreeNanoflann<BaseVecT>::kSearch(
+    const BaseVecT& qp,
+    int k,
+    vector<size_t>& indices,
+    vector<CoordT>& distances
+) const
+{
+    float point[3] = { (float)qp.x, (float)qp.y, (float)qp.z };
+
+    indices.resize(k);
+    distances.resize(k);
+
+    nanoflann::KNNResultSet<CoordT, size_t> resultSet(k);
+    resultSet.init(indices.data(), distances.data());
+    m_tree->findNeighbors(resultSet, point, nanoflann::SearchParams());
+
+    indices.resize(resultSet.size());
+    distances.resize(resultSet.size());
+    return resultSet.size();
+}
+
+template<typename BaseVecT>
+void SearchTreeNanoflann<BaseVecT>::radiusSearch(
+    const BaseVecT& qp,
+    CoordT r,
+    vector<size_t>& indices
+) const
+{
+    float point[3] = { (float)qp.x, (float)qp.y, (float)qp.z };
+
+    // The L2 metric of nanoflann works on squared distances
+    indices.clear();
+    RadiusResultSet resultSet{r * r, indices};
+    m_tree->findNeighbors(resultSet, point, nanoflann::SearchParams());
+}
+
+template<typename BaseVecT>
+void SearchTreeNanoflann<BaseVecT>::kSearchMany(
+    const BaseVecT* query,
+    size_t n,
+    int k,
+    size_t* indices,
+    CoordT* distances
+) const
+{
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(size_t i = 0; i < n; i++)
+    {
+        float point[3] = { (float)query[i].x, (float)query[i].y, (float)query[i].z };
+        size_t* id = indices + i * k;
+        CoordT* di = distances + i * k;
+
+        nanoflann::KNNResultSet<CoordT, size_t> resultSet(k);
+        resultSet.init(id, di);
+        m_tree->findNeighbors(resultSet, point, nanoflann::SearchParams());
+
+        std::fill(id + resultSet.size(), id + k, std::numeric_limits<size_t>::max());
+        std::fill(di + resultSet.size(), di + k, std::numeric_limits<CoordT>::max());
+    }
+}
+
+} // namespace lvr2
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * TSDFGrid.hpp
+ */
+
+#ifndef _LVR2_RECONSTRUCTION_TSDFGRID_H_
+#define _LVR2_RECONSTRUCTION_TSDFGRID_H_
+
+#include "HashGrid.hpp"
+#include "PointsetSurface.hpp"
+#include "lvr2/geometry/BoundingBox.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief   A HashGrid that accumulates the signed distances of several
+ *          scans. Each query point stores a weighted running average of
+ *          all observed distances, so new scans can be fused into a
+ *          persisted grid without recomputing the distances of the
+ *          unaffected cells. The weights are saved in a sidecar file
+ *          next to the serialized grid (see serialize()).
+ */
+template<typename BaseVecT, typename BoxT>
+class TSDFGrid : public HashGrid<BaseVecT, BoxT>
+{
+public:
+
+    /**
+     * @brief   Creates an empty grid
+     *
+     * @param voxelsize     Voxel size of the grid cells
+     * @param bb            Initial bounding box of the grid. The grid is
+     *                      extended if a fused scan does not fit into it.
+     * @param extrude       If set to true, the 26 neighbors of each occupied
+     *                      cell are created, too.
+     */
+    TSDFGrid(float voxelsize, BoundingBox<BaseVecT> bb, bool extrude = true);
+
+    /**
+     * @brief   Loads a grid that was saved with serialize(). If the weight
+     *          file is missing, all present distances get the weight 1.
+     *
+     * @param file          Grid file (see HashGrid::serialize(string file))
+     * @param extrude       See above
+     */
+    TSDFGrid(string file, bool extrude = true);
+
+    virtual ~TSDFGrid() {}
+
+    /**
+     * @brief   Fuses the distances of the given surface into the grid.
+     *          Cells around the surface's points are created if necessary,
+     *          only the query points of these cells are evaluated. A
+     *          distance is discarded if the closest surface point is
+     *          farther away than the cell diagonal.
+     *
+     * @param surface       Surface of the new scan. Normals have to be
+     *                      present.
+     * @return              The number of updated query points
+     */
+    size_t fuse(PointsetSurfacePtr<BaseVecT> surface);
+
+    /**
+     * @brief   Saves the grid to the given file and the fusion weights to
+     *          file + ".tsdf".
+     */
+    virtual void serialize(string file);
+
+    /**
+     * @brief   Returns a new grid that contains copies of all cells whose
+     *          centers lie within the given region, including their
+     *          distances. Extract a mesh from it with FastReconstruction
+     *          to update a part of the surface only.
+     */
+    std::shared_ptr<TSDFGrid<BaseVecT, BoxT>> extractRegion(const BoundingBox<BaseVecT>& region);
+
+    /**
+     * @brief   Returns the bounding box of all cells that were changed by
+     *          fuse() since the last call of clearDirtyRegion().
+     */
+    const BoundingBox<BaseVecT>& getDirtyRegion() const { return m_dirtyRegion; }
+
+    /**
+     * @brief   Resets the dirty region.
+     */
+    void clearDirtyRegion() { m_dirtyRegion = BoundingBox<BaseVecT>(); }
+
+    /**
+     * @brief   Limits the accumulated weight of a query point. A lower limit
+     *          lets the grid adapt faster to changes in the scene. Zero
+     *          disables the limit (default).
+     */
+    void setMaxWeight(float maxWeight) { m_maxWeight = maxWeight; }
+
+    /**
+     * @brief   Returns the fusion weight of each query point
+     */
+    const vector<float>& getWeights() const { return m_weights; }
+
+private:
+
+    /**
+     * @brief   Extends the bounding box by whole voxels so that it contains
+     *          the given box and rehashes all cells. Cell centers and query
+     *          points are not moved.
+     */
+    void extendBoundingBox(const BoundingBox<BaseVecT>& bb);
+
+    /**
+     * @brief   Loads the weights from the sidecar file of the given grid
+     *          file. Returns false if the file is missing or does not
+     *          match the grid.
+     */
+    bool loadWeights(const string& file);
+
+    /**
+     * @brief Rounds the given value to the neares integer value
+     */
+    inline int calcIndex(float f)
+    {
+        return f < 0 ? f - .5 : f + .5;
+    }
+
+    /// Accumulated weight of each query point, zero for unobserved points
+    vector<float>               m_weights;
+
+    /// Upper limit for the weights, zero for no limit
+    float                       m_maxWeight;
+
+    /// Bounding box of the cells changed since the last clearDirtyRegion()
+    BoundingBox<BaseVecT>       m_dirtyRegion;
+};
+
+} // namespace lvr2
+
+#include "lvr2/reconstruction/TSDFGrid.tcc"
+
+#endif // _LVR2_RECONSTRUCTION_TSDFGRID_H_
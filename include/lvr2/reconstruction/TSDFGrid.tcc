@@ -0,0 +1,343 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * TSDFGrid.tcc
+ */
+
+#include "lvr2/io/Progress.hpp"
+#include "lvr2/io/Timestamp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace lvr2
+{
+
+/// Magic number at the beginning of a weight file
+static const char TSDF_WEIGHTS_MAGIC[8] = {'L', 'V', 'R', 'T', 'S', 'D', 'F', '1'};
+
+template<typename BaseVecT, typename BoxT>
+TSDFGrid<BaseVecT, BoxT>::TSDFGrid(float voxelsize, BoundingBox<BaseVecT> bb, bool extrude)
+    : HashGrid<BaseVecT, BoxT>(voxelsize, bb, true, extrude), m_maxWeight(0)
+{
+
+}
+
+template<typename BaseVecT, typename BoxT>
+TSDFGrid<BaseVecT, BoxT>::TSDFGrid(string file, bool extrude)
+    : HashGrid<BaseVecT, BoxT>(file), m_maxWeight(0)
+{
+    // The file constructor does not restore these values
+    this->m_extrude = extrude;
+    this->m_globalIndex = this->m_queryPoints.size();
+
+    if(!loadWeights(file))
+    {
+        cout << timestamp << "No fusion weights found for " << file
+             << ", using weight 1 for all query points." << endl;
+        m_weights.assign(this->m_queryPoints.size(), 1.0f);
+    }
+}
+
+template<typename BaseVecT, typename BoxT>
+bool TSDFGrid<BaseVecT, BoxT>::loadWeights(const string& file)
+{
+    std::ifstream in(file + ".tsdf", std::ios::binary);
+    if(!in.good())
+    {
+        return false;
+    }
+
+    char magic[8];
+    uint64_t n = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    if(!in.good() || memcmp(magic, TSDF_WEIGHTS_MAGIC, sizeof(magic)) != 0 || n != this->m_queryPoints.size())
+    {
+        return false;
+    }
+
+    vector<float> weights(n);
+    vector<unsigned char> invalid(n);
+    in.read(reinterpret_cast<char*>(weights.data()), n * sizeof(float));
+    in.read(reinterpret_cast<char*>(invalid.data()), n);
+    if(!in.good())
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        this->m_queryPoints[i].m_invalid = invalid[i];
+    }
+    m_weights.swap(weights);
+    return true;
+}
+
+template<typename BaseVecT, typename BoxT>
+void TSDFGrid<BaseVecT, BoxT>::serialize(string file)
+{
+    HashGrid<BaseVecT, BoxT>::serialize(file);
+
+    std::ofstream out(file + ".tsdf", std::ios::binary);
+    uint64_t n = this->m_queryPoints.size();
+    vector<unsigned char> invalid(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        invalid[i] = this->m_queryPoints[i].m_invalid;
+    }
+    out.write(TSDF_WEIGHTS_MAGIC, sizeof(TSDF_WEIGHTS_MAGIC));
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    out.write(reinterpret_cast<const char*>(m_weights.data()), n * sizeof(float));
+    out.write(reinterpret_cast<const char*>(invalid.data()), n);
+
+    if(!out.good())
+    {
+        cout << timestamp << "Warning: Unable to write fusion weights to " << file << ".tsdf" << endl;
+    }
+}
+
+template<typename BaseVecT, typename BoxT>
+void TSDFGrid<BaseVecT, BoxT>::extendBoundingBox(const BoundingBox<BaseVecT>& bb)
+{
+    BaseVecT oldMin = this->m_boundingBox.getMin();
+    BaseVecT oldMax = this->m_boundingBox.getMax();
+    BaseVecT newMin = oldMin;
+    BaseVecT newMax = oldMax;
+
+    // The lower corner is moved by whole voxels to keep all
+    // cell centers on the lattice
+    for(int c = 0; c < 3; c++)
+    {
+        if(bb.getMin()[c] < oldMin[c])
+        {
+            newMin[c] = oldMin[c] - ceil((oldMin[c] - bb.getMin()[c]) / this->m_voxelsize) * this->m_voxelsize;
+        }
+        newMax[c] = std::max(newMax[c], bb.getMax()[c]);
+    }
+
+    if(newMin == oldMin && newMax == oldMax)
+    {
+        return;
+    }
+
+    cout << timestamp << "Extending grid bounding box" << endl;
+    this->m_boundingBox = BoundingBox<BaseVecT>(newMin, newMax);
+    this->calcIndices();
+
+    // The cell hashes depend on the bounding box
+    typename HashGrid<BaseVecT, BoxT>::box_map cells;
+    cells.reserve(this->m_cells.size());
+    for(auto it = this->m_cells.begin(); it != this->m_cells.end(); it++)
+    {
+        auto index = (it->second->getCenter() - newMin) / this->m_voxelsize;
+        cells[this->hashValue(calcIndex(index.x), calcIndex(index.y), calcIndex(index.z))] = it->second;
+    }
+    this->m_cells = std::move(cells);
+}
+
+template<typename BaseVecT, typename BoxT>
+size_t TSDFGrid<BaseVecT, BoxT>::fuse(PointsetSurfacePtr<BaseVecT> surface)
+{
+    using CoordT = typename BaseVecT::CoordType;
+
+    float voxelsize = this->m_voxelsize;
+    float vsh = 0.5 * voxelsize;
+    int limit = this->m_extrude ? 1 : 0;
+
+    // Cells and their corners must have non negative indices below the
+    // maximum index, otherwise the cell hashes are not unique
+    BoundingBox<BaseVecT> scanBB = surface->getBoundingBox();
+    BaseVecT margin(2 * voxelsize, 2 * voxelsize, 2 * voxelsize);
+    BoundingBox<BaseVecT> required(scanBB.getMin() - margin, scanBB.getMax() + margin);
+    extendBoundingBox(required);
+
+    auto v_min = this->m_boundingBox.getMin();
+    size_t numPoints = surface->pointBuffer()->numPoints();
+    FloatChannel pts = *(surface->pointBuffer()->getFloatChannel("points"));
+
+    cout << timestamp << "Adding cells for " << numPoints << " points" << endl;
+
+    // Create missing cells and collect all cells that are
+    // touched by the new points
+    vector<size_t> touched;
+    touched.reserve(numPoints * (limit ? 27 : 1));
+    for(size_t i = 0; i < numPoints; i++)
+    {
+        BaseVecT pt = pts[i];
+        auto index = (pt - v_min) / voxelsize;
+        int ix = calcIndex(index.x);
+        int iy = calcIndex(index.y);
+        int iz = calcIndex(index.z);
+        this->addLatticePoint(ix, iy, iz);
+
+        for(int dx = -limit; dx <= limit; dx++)
+        {
+            for(int dy = -limit; dy <= limit; dy++)
+            {
+                for(int dz = -limit; dz <= limit; dz++)
+                {
+                    touched.push_back(this->hashValue(ix + dx, iy + dy, iz + dz));
+                }
+            }
+        }
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+    // New query points have not been observed yet
+    m_weights.resize(this->m_queryPoints.size(), 0.0f);
+
+    // Only the corners of the touched cells are evaluated. Cells that
+    // share a corner with them may change their surface, too.
+    vector<unsigned int> affected;
+    affected.reserve(touched.size() * 8);
+    for(size_t h : touched)
+    {
+        auto it = this->m_cells.find(h);
+        if(it == this->m_cells.end())
+        {
+            continue;
+        }
+        BoxT* box = it->second;
+        for(int k = 0; k < 8; k++)
+        {
+            affected.push_back(box->getVertex(k));
+        }
+        BaseVecT center = box->getCenter();
+        BaseVecT ring(3 * vsh, 3 * vsh, 3 * vsh);
+        m_dirtyRegion.expand(center - ring);
+        m_dirtyRegion.expand(center + ring);
+    }
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    string comment = timestamp.getElapsedTime() + "Fusing distance values ";
+    ProgressBar progress(affected.size(), comment);
+
+    const size_t blockSize = 64;
+    const size_t numBlocks = (affected.size() + blockSize - 1) / blockSize;
+    size_t updated = 0;
+
+    #pragma omp parallel reduction(+:updated)
+    {
+        vector<BaseVecT> positions(blockSize);
+        vector<CoordT> projected(blockSize);
+        vector<CoordT> euklidean(blockSize);
+
+        #pragma omp for schedule(dynamic, 16)
+        for(size_t b = 0; b < numBlocks; b++)
+        {
+            size_t first = b * blockSize;
+            size_t n = std::min(blockSize, affected.size() - first);
+
+            for(size_t i = 0; i < n; i++)
+            {
+                positions[i] = this->m_queryPoints[affected[first + i]].m_position;
+            }
+
+            surface->distances(positions.data(), n, projected.data(), euklidean.data());
+
+            for(size_t i = 0; i < n; i++)
+            {
+                QueryPoint<BaseVecT>& qp = this->m_queryPoints[affected[first + i]];
+                float& weight = m_weights[affected[first + i]];
+
+                // Keep previous observations if the new scan does not
+                // see this query point
+                if(euklidean[i] > 1.7320 * voxelsize)
+                {
+                    if(weight == 0)
+                    {
+                        qp.m_invalid = true;
+                    }
+                    continue;
+                }
+
+                qp.m_distance = (weight * qp.m_distance + projected[i]) / (weight + 1);
+                qp.m_invalid = false;
+                weight += 1;
+                if(m_maxWeight > 0 && weight > m_maxWeight)
+                {
+                    weight = m_maxWeight;
+                }
+                updated++;
+            }
+            progress += n;
+        }
+    }
+    cout << endl;
+    cout << timestamp << "Updated " << updated << " of " << affected.size() << " query points" << endl;
+
+    return updated;
+}
+
+template<typename BaseVecT, typename BoxT>
+std::shared_ptr<TSDFGrid<BaseVecT, BoxT>> TSDFGrid<BaseVecT, BoxT>::extractRegion(const BoundingBox<BaseVecT>& region)
+{
+    // Same bounding box and voxelsize, i.e. the same cell hashes
+    auto grid = std::make_shared<TSDFGrid<BaseVecT, BoxT>>(this->m_voxelsize, this->m_boundingBox, false);
+    auto v_min = this->m_boundingBox.getMin();
+
+    for(auto it = this->m_cells.begin(); it != this->m_cells.end(); it++)
+    {
+        BoxT* box = it->second;
+        BaseVecT center = box->getCenter();
+        if(center.x < region.getMin().x || center.x > region.getMax().x ||
+           center.y < region.getMin().y || center.y > region.getMax().y ||
+           center.z < region.getMin().z || center.z > region.getMax().z)
+        {
+            continue;
+        }
+
+        auto index = (center - v_min) / this->m_voxelsize;
+        int ix = calcIndex(index.x);
+        int iy = calcIndex(index.y);
+        int iz = calcIndex(index.z);
+        grid->addLatticePoint(ix, iy, iz);
+
+        BoxT* copy = grid->m_cells.find(grid->hashValue(ix, iy, iz))->second;
+        copy->m_extruded = box->m_extruded;
+        grid->m_weights.resize(grid->m_queryPoints.size(), 0.0f);
+        for(int k = 0; k < 8; k++)
+        {
+            unsigned int src = box->getVertex(k);
+            unsigned int dst = copy->getVertex(k);
+            grid->m_queryPoints[dst].m_distance = this->m_queryPoints[src].m_distance;
+            grid->m_queryPoints[dst].m_invalid = this->m_queryPoints[src].m_invalid;
+            grid->m_weights[dst] = m_weights[src];
+        }
+    }
+
+    return grid;
+}
+
+} // namespace lvr2
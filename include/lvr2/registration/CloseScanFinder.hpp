@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * CloseScanFinder.hpp
+ */
+#ifndef CLOSESCANFINDER_HPP_
+#define CLOSESCANFINDER_HPP_
+
+#include "SLAMScanWrapper.hpp"
+#include "SLAMOptions.hpp"
+#include "KDTree.hpp"
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Finds the loop closing candidates of Scans, like findCloseScans, while keeping
+ *        information about the Scans between the calls.
+ *
+ * With closeLoopDistance, the positions of the Scans are kept in a hash grid, so only the
+ * Scans in the neighboring cells are compared.
+ *
+ * With closeLoopPairs, every Scan has a bounding box and an occupancy signature: the number
+ * of Points in every voxel of size slamMaxDistance. Two Points can only be closer than
+ * slamMaxDistance if their voxels are adjacent, so the signatures give an upper bound for the
+ * number of Point pairs. The exact pairs are only counted for the Scans on the resulting short
+ * list, in parallel and with the local KDTree of the Scan from the given TreeSource, so the
+ * KDTrees are shared with GraphSLAM instead of being built again.
+ *
+ * The information of a Scan is recalculated when its Pose changes, so the results are the same
+ * as those of findCloseScans.
+ */
+class CloseScanFinder
+{
+public:
+    /// Returns the KDTree of scans[index] in the local coordinate system of that Scan
+    using TreeSource = std::function<KDTreePtr(const std::vector<SLAMScanPtr>& scans, size_t index)>;
+
+    /**
+     * @brief Creates a new CloseScanFinder
+     *
+     * @param options The options on how to search. Changes are applied on the next call
+     * @param trees   The source of the local KDTrees. If empty, a KDTree is built for every
+     *                call that needs one and is not kept
+     */
+    CloseScanFinder(const SLAMOptions* options, TreeSource trees = TreeSource());
+
+    virtual ~CloseScanFinder() = default;
+
+    /**
+     * @brief finds Scans that are "close" to a Scan as determined by a Loopclosing strategy
+     *
+     * @param scans   A vector with all Scans
+     * @param scan    The index of the scan
+     * @param output  Will be filled with the indices of all close Scans, in ascending order
+     *
+     * @return true if any Scans were found, false otherwise
+     */
+    bool findCloseScans(const std::vector<SLAMScanPtr>& scans, size_t scan, std::vector<size_t>& output);
+
+    /**
+     * @brief Updates the information about the first 'count' Scans. Is called by findCloseScans
+     *        for the required Scans.
+     *
+     * @param scans The Scans
+     * @param count The number of Scans to update
+     */
+    void update(const std::vector<SLAMScanPtr>& scans, size_t count);
+
+protected:
+    /// The information about one Scan
+    struct Entry
+    {
+        SLAMScanPtr scan;
+
+        /// The Pose the information was calculated with
+        Transformd pose;
+
+        /// The voxel size of 'voxels', or 0 if they were not calculated
+        double voxelSize = 0;
+
+        /// The bounding box of the Scan in global coordinates
+        Vector3d min = Vector3d::Zero();
+        Vector3d max = Vector3d::Zero();
+
+        /// The occupied voxels in global coordinates with their number of Points, sorted by voxel
+        std::vector<std::pair<size_t, size_t>> voxels;
+    };
+
+    /// Counts the Points of 'other' that have a neighbor in 'tree', the local KDTree of 'cur', stopping at 'required'
+    size_t countPairs(const KDTree& tree, const Entry& cur, const Entry& other, size_t required) const;
+
+    const SLAMOptions*  m_options;
+
+    TreeSource          m_trees;
+
+    std::vector<Entry>  m_entries;
+
+    /// The indices of the Scans by the cell of their position
+    std::unordered_map<size_t, std::vector<size_t>> m_grid;
+
+    /// The cell size of 'm_grid'
+    double              m_cellSize;
+
+    /// The number of Scans in 'm_grid'
+    size_t              m_gridSize;
+};
+
+} /* namespace lvr2 */
+
+#endif /* CLOSESCANFINDER_HPP_ */
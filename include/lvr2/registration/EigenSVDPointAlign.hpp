@@ -94,6 +94,22 @@ public:
         const Vec3& centroid_m,
         const Vec3& centroid_d,
         Mat4& align) const;
+
+    /**
+     * @brief Calculates the estimated Transformation to match a Data Pointcloud to a Model
+     *        Pointcloud from the accumulated cross-covariance of the Point pairs
+     *
+     * @param H          The sum of d * m^T over all pairs, with the Data Point d and the Model
+     *                   Point m relative to their centroids
+     * @param centroid_m The center of the Model Pointcloud
+     * @param centroid_d The center of the Data Pointcloud
+     * @param align      Will be set to the Transformation
+     */
+    void alignPoints(
+        const Mat3& H,
+        const Vec3& centroid_m,
+        const Vec3& centroid_d,
+        Mat4& align) const;
 };
 
 } /* namespace lvr2 */
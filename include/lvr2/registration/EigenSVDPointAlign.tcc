@@ -78,19 +78,7 @@ T EigenSVDPointAlign<T, PointT>::alignPoints(
 
     error = sqrt(error / (T)pairs);
 
-    JacobiSVD<Mat3> svd(H, ComputeFullU | ComputeFullV);
-
-    Mat3 U = svd.matrixU();
-    Mat3 V = svd.matrixV();
-
-    Mat3 R = V * U.transpose();
-
-    align = Mat4::Identity();
-    align.template block<3, 3>(0, 0) = R;
-
-    // Calculate translation
-    Vec3 translation = centroid_m - R * centroid_d;
-    align.template block<3, 1>(0, 3) = translation;
+    alignPoints(H, centroid_m, centroid_d, align);
 
     return error;
 }
@@ -127,6 +115,18 @@ T EigenSVDPointAlign<T, PointT>::alignPoints(
 
     error = sqrt(error / (T)n);
 
+    alignPoints(H, centroid_m, centroid_d, align);
+
+    return error;
+}
+
+template<typename T, typename PointT>
+void EigenSVDPointAlign<T, PointT>::alignPoints(
+    const Mat3& H,
+    const Vec3& centroid_m,
+    const Vec3& centroid_d,
+    Mat4& align) const
+{
     JacobiSVD<Mat3> svd(H, ComputeFullU | ComputeFullV);
 
     Mat3 U = svd.matrixU();
@@ -140,8 +140,6 @@ T EigenSVDPointAlign<T, PointT>::alignPoints(
     // Calculate translation
     Vec3 translation = centroid_m - R * centroid_d;
     align.template block<3, 1>(0, 3) = translation;
-
-    return error;
 }
 
 } // namespace lvr2
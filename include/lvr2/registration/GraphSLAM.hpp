@@ -37,8 +37,10 @@
 #include "SLAMScanWrapper.hpp"
 #include "SLAMOptions.hpp"
 #include "KDTree.hpp"
+#include "CloseScanFinder.hpp"
 
 #include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
 
 namespace lvr2
 {
@@ -52,11 +54,18 @@ namespace lvr2
  * @param output  Will be filled with the indices of all close Scans
  *
  * @return true if any Scans were found, false otherwise
+ *
+ * Use a CloseScanFinder to keep the information about the Scans between calls.
  */
 bool findCloseScans(const std::vector<SLAMScanPtr>& scans, size_t scan, const SLAMOptions& options, std::vector<size_t>& output);
 
 /**
  * @brief Wrapper class for running GraphSLAM on Scans
+ *
+ * The KDTrees of the Scans are built in the local coordinate system of each Scan, so they
+ * stay valid when the Poses change and are kept for all following iterations and calls.
+ * The symbolic factorization of the equation system is reused as long as the Graph does
+ * not change.
  */
 class GraphSLAM
 {
@@ -68,6 +77,9 @@ public:
 
     GraphSLAM(const SLAMOptions* options);
 
+    /// m_closeScans refers to this instance
+    GraphSLAM(const GraphSLAM&) = delete;
+
     virtual ~GraphSLAM() = default;
 
     /**
@@ -77,15 +89,46 @@ public:
      * @param last  The index of the last Scan to consider. `scans` may be longer, but anything
      *              after `last` will be ignored
      */
-    void doGraphSLAM(const std::vector<SLAMScanPtr>& scans, size_t last) const;
+    void doGraphSLAM(const std::vector<SLAMScanPtr>& scans, size_t last);
+
+    /**
+     * @brief finds Scans that are "close" to a Scan, like the function findCloseScans, but
+     *        with the information about the Scans and their KDTrees kept by this GraphSLAM
+     *
+     * @param scans   A vector with all Scans
+     * @param scan    The index of the scan
+     * @param output  Will be filled with the indices of all close Scans, in ascending order
+     *
+     * @return true if any Scans were found, false otherwise
+     */
+    bool findCloseScans(const std::vector<SLAMScanPtr>& scans, size_t scan, std::vector<size_t>& output);
+
+    /**
+     * @brief Returns the KDTree of scans[index] in its local coordinate system, building it
+     *        if the Scan has none yet
+     */
+    KDTreePtr localTree(const std::vector<SLAMScanPtr>& scans, size_t index);
 
 protected:
 
-    void createGraph(const std::vector<SLAMScanPtr>& scans, size_t last, Graph& graph) const;
+    void createGraph(const std::vector<SLAMScanPtr>& scans, size_t last, Graph& graph);
+    void updateTrees(const std::vector<SLAMScanPtr>& scans, const Graph& graph);
     void fillEquation(const std::vector<SLAMScanPtr>& scans, const Graph& graph, GraphMatrix& mat, GraphVector& vec) const;
-    void eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outMat, Vector6d& outVec) const;
+    void eulerCovariance(const KDTreePtr& tree, const SLAMScanPtr& treeScan, const SLAMScanPtr& scan, Matrix6d& outMat, Vector6d& outVec) const;
 
     const SLAMOptions*     m_options;
+
+    /// The local KDTrees of the Scans with the same index, together with the Scan they were built from
+    std::vector<std::pair<SLAMScanPtr, KDTreePtr>> m_trees;
+
+    /// Finds the loop closing edges of the Graph, with the KDTrees from 'm_trees'
+    CloseScanFinder        m_closeScans;
+
+    /// The solver with the symbolic factorization of the last equation system
+    Eigen::SimplicialCholesky<GraphMatrix> m_solver;
+
+    /// The Graph of the last equation system
+    Graph                  m_solverGraph;
 };
 
 } /* namespace lvr2 */
@@ -34,17 +34,23 @@
 #ifndef ICPPOINTALIGN_HPP_
 #define ICPPOINTALIGN_HPP_
 
+#include "ICPPyramid.hpp"
 #include "KDTree.hpp"
 #include "SLAMScanWrapper.hpp"
 
 #include "lvr2/types/MatrixTypes.hpp"
 
+#include <vector>
+
 namespace lvr2
 {
 
 /**
  * @brief A class to align two Scans with ICP
- * 
+ *
+ * With more than one level, ICP first runs on coarse versions of both Scans, which are reduced
+ * with an Octree, and refines the result on the finer levels. On coarse levels, the maximum match
+ * distance is raised to twice the voxel size if it is smaller than that.
  */
 class ICPPointAlign
 {
@@ -72,11 +78,39 @@ public:
     void    setEpsilon(double epsilon);
     void    setVerbose(bool verbose);
 
+    /**
+     * @brief Sets the number of resolution levels. Level 0 uses all Points, level 1 is reduced to
+     *        the given voxel size and each further level doubles the voxel size.
+     */
+    void    setLevels(int levels, double voxelSize);
+
+    /**
+     * @brief Minimize the distance of data Points to the tangent planes of their model neighbors
+     *        instead of the Point-to-Point distance. The normals are calculated once per level.
+     */
+    void    setPointToPlane(bool pointToPlane);
+
+    /**
+     * @brief Uses a prebuilt pyramid of the model Scan instead of building one in match().
+     *        It is ignored if it was built with other parameters than this instance.
+     */
+    void    setModelPyramid(ICPPyramidPtr pyramid);
+
+    /**
+     * @brief Uses the coarse levels of a prebuilt pyramid of the data Scan instead of
+     *        reducing the data Scan in match().
+     *        It is ignored if it was built with other parameters than this instance.
+     */
+    void    setDataPyramid(ICPPyramidPtr pyramid);
+
     double  getMaxMatchDistance() const;
     int     getMaxIterations() const;
     int     getMaxLeafSize() const;
     double  getEpsilon() const;
     bool    getVerbose() const;
+    int     getLevels() const;
+    double  getLevelVoxelSize() const;
+    bool    getPointToPlane() const;
 
 protected:
 
@@ -87,10 +121,40 @@ protected:
 
     bool        m_verbose;
 
+    int         m_levels;
+    double      m_levelVoxelSize;
+    bool        m_pointToPlane;
+
     SLAMScanPtr m_modelCloud;
     SLAMScanPtr m_dataCloud;
 
-    KDTreePtr   m_searchTree;
+    ICPPyramidPtr m_modelPyramid;
+    ICPPyramidPtr m_dataPyramid;
+
+private:
+    /**
+     * @brief Runs ICP on one level
+     *
+     * @param model       The model level
+     * @param modelPose   The Transformation of the model level into global coordinates
+     * @param data        The data Points, or nullptr to use the data Scan itself
+     * @param numData     The number of data Points
+     * @param dataPose    The Transformation of the data Points into global coordinates at the
+     *                    start of match()
+     * @param delta       The transformation applied to the data Scan so far. Is updated
+     * @param iterations  Will be set to the number of iterations
+     *
+     * @return double the last error
+     */
+    double matchLevel(
+        const ICPPyramid::Level& model,
+        const Transformd& modelPose,
+        const KDTree::Point* data,
+        size_t numData,
+        const Transformd& dataPose,
+        Transformd& delta,
+        int& iterations
+    );
 };
 
 } /* namespace lvr2 */
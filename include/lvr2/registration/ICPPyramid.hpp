@@ -0,0 +1,310 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * ICPPyramid.hpp
+ */
+#ifndef ICPPYRAMID_HPP_
+#define ICPPYRAMID_HPP_
+
+#include "KDTree.hpp"
+#include "SLAMScanWrapper.hpp"
+
+#include "lvr2/types/MatrixTypes.hpp"
+
+#include <boost/shared_array.hpp>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief The resolution pyramid of a Scan for ICPPointAlign, with KDTrees and, for
+ *        Point-to-Plane ICP, normals on every level.
+ *
+ * Level 0 contains all Points, level 1 is reduced with an Octree to the given voxel size and
+ * every further level doubles the voxel size of the previous one.
+ *
+ * The Points of a Scan are stored in its local coordinate system. The pyramid stays valid
+ * when the Scan is transformed and only reads the untransformed Points, so it can be built
+ * on another thread while the Scan itself is being registered.
+ *
+ * A Metascan has no local coordinate system, so its Points are stored in global coordinates
+ * and split into cubic tiles that each have their own KDTree. When Scans are added to the
+ * Metascan, update() only rebuilds the tiles that they overlap, instead of the whole Metascan,
+ * and a nearest neighbor search only visits the tiles within the search radius.
+ */
+class ICPPyramid
+{
+public:
+    /// A set of Points with its KDTree
+    struct Block
+    {
+        /// The Points in the coordinate system of the pyramid, in the order of the KDTree
+        boost::shared_array<KDTree::Point> points;
+        size_t numPoints = 0;
+
+        /// The KDTree of 'points'
+        KDTreePtr tree;
+
+        /// The normal of every Point, or zero if it has too few neighbors. Empty without Point-to-Plane
+        std::vector<Vector3f> normals;
+    };
+
+    /// One level of the pyramid
+    struct Level
+    {
+        /// The tiles of the level by tileIndex(). A single tile at the coordinates 0 if tileSize is 0
+        std::unordered_map<size_t, Block> tiles;
+
+        /// The edge length of a tile. At least 'maxDistance', or 0 for a single tile
+        double tileSize = 0;
+
+        /// The total number of Points in 'tiles'
+        size_t numPoints = 0;
+
+        /// The maximum distance between two Points on this level
+        double maxDistance = 0;
+
+        /// The integer coordinates of the tile containing 'point'
+        Vector3<int> tileCoordinates(const KDTree::Point& point) const
+        {
+            if (tileSize == 0)
+            {
+                return Vector3<int>::Zero();
+            }
+            return (point.cast<double>() / tileSize).array().floor().cast<int>().matrix();
+        }
+
+        /// The index of the tile with the given coordinates in 'tiles'
+        static size_t tileIndex(const Vector3<int>& tile)
+        {
+            // 21 bits per axis, which is far more than the extent of any Scan
+            const size_t offset = 1 << 20;
+            return ((tile.x() + offset) << 42) | ((tile.y() + offset) << 21) | (tile.z() + offset);
+        }
+
+        /**
+         * @brief Finds the nearest neighbor of 'point' that is within 'maxDistance'
+         *
+         * @param point     The Point in the coordinate system of the pyramid
+         * @param neighbor  The neighbor of a previous search as the starting candidate or nullptr.
+         *                  Is set to the neighbor or nullptr if none is found
+         * @param distance  The final distance between point and neighbor
+         * @return bool true if a neighbor was found, false otherwise
+         */
+        template<typename T>
+        bool nearestNeighbor(const Vector3<T>& point, KDTree::Neighbor& neighbor, double& distance) const
+        {
+            KDTree::Point p = point.template cast<KDTree::PointT>();
+            Vector3<int> center = tileCoordinates(p);
+
+            // The search in the tile of the point starts from the previous neighbor
+            auto it = tiles.find(tileIndex(center));
+            if (it != tiles.end())
+            {
+                it->second.tree->updateNearestNeighbor(p, neighbor, distance, maxDistance);
+            }
+            else
+            {
+                neighbor = nullptr;
+                distance = maxDistance;
+            }
+
+            forNeighborTiles(center, p, distance, [&](const Vector3<int>& tile)
+            {
+                searchTile(tile, p, neighbor, distance);
+            });
+
+            return neighbor != nullptr;
+        }
+
+        /**
+         * @brief Finds the k nearest neighbors of 'point' that are within 'maxDistance' in all tiles
+         *
+         * @param point     The Point in the coordinate system of the pyramid
+         * @param k         The maximum number of neighbors
+         * @param neighbors An array with space for k neighbors, starting with the closest one
+         * @return size_t the number of neighbors that were found
+         */
+        size_t kNearestNeighbors(const KDTree::Point& point, size_t k, KDTree::Neighbor* neighbors) const;
+
+        /// The normal of a neighbor returned by nearestNeighbor
+        const Vector3f& normal(KDTree::Neighbor neighbor) const;
+
+        /**
+         * @brief Calls 'visit' with the coordinates of every tile around 'center' that is closer to
+         *        'point' than 'distance'. 'distance' may shrink during the visits
+         */
+        template<typename F>
+        void forNeighborTiles(const Vector3<int>& center, const KDTree::Point& point, const double& distance, F visit) const
+        {
+            if (tileSize == 0)
+            {
+                return;
+            }
+
+            // the neighboring tiles only need to be visited if they are closer than 'distance'
+            Vector3f min = (center.cast<double>() * tileSize).cast<float>();
+            Vector3f lower = point - min;
+            Vector3f upper = Vector3f::Constant(tileSize) - lower;
+            Vector3<int> first, last;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                first[axis] = lower[axis] < distance ? -1 : 0;
+                last[axis] = upper[axis] < distance ? 1 : 0;
+            }
+
+            for (int dx = first.x(); dx <= last.x(); dx++)
+            {
+                for (int dy = first.y(); dy <= last.y(); dy++)
+                {
+                    for (int dz = first.z(); dz <= last.z(); dz++)
+                    {
+                        Vector3<int> offset(dx, dy, dz);
+                        if (offset == Vector3<int>::Zero())
+                        {
+                            continue;
+                        }
+
+                        double gap = 0;
+                        for (int axis = 0; axis < 3; axis++)
+                        {
+                            double d = offset[axis] < 0 ? lower[axis] : (offset[axis] > 0 ? upper[axis] : 0.0);
+                            gap += d * d;
+                        }
+                        if (gap < distance * distance)
+                        {
+                            visit(center + offset);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        /// Improves 'neighbor' with the Points of one tile
+        void searchTile(const Vector3<int>& tile, const KDTree::Point& point, KDTree::Neighbor& neighbor, double& distance) const
+        {
+            auto it = tiles.find(tileIndex(tile));
+            if (it == tiles.end())
+            {
+                return;
+            }
+
+            KDTree::Neighbor candidate;
+            double candidateDistance;
+            if (it->second.tree->nearestNeighbor(point, candidate, candidateDistance, distance))
+            {
+                neighbor = candidate;
+                distance = candidateDistance;
+            }
+        }
+    };
+
+    /**
+     * @brief Builds the pyramid of a Scan
+     *
+     * @param scan          The Scan
+     * @param levels        The number of levels
+     * @param voxelSize     The voxel size of level 1
+     * @param maxDistance   The maximum distance between two Points on level 0. Coarse levels
+     *                      use at least twice their voxel size
+     * @param pointToPlane  Whether to calculate normals
+     * @param maxLeafSize   The maximum number of points in a Leaf of the KDTrees
+     */
+    ICPPyramid(SLAMScanPtr scan, int levels, double voxelSize, double maxDistance, bool pointToPlane, int maxLeafSize);
+
+    /**
+     * @brief Brings the pyramid of a Metascan up to date. Scans that were added to the Metascan
+     *        are inserted into the tiles they overlap, while a transformation of any Scan that is
+     *        already part of the pyramid requires rebuilding it. Does nothing for other Scans.
+     */
+    void update();
+
+    /**
+     * @brief Returns the current Transformation from the coordinate system of the pyramid
+     *        into global coordinates
+     */
+    Transformd pose() const;
+
+    /// The Scan of the pyramid
+    SLAMScanPtr scan() const;
+
+    /// The number of levels
+    int levels() const;
+
+    /// Access to a level
+    const Level& level(int index) const;
+
+    /// Whether the pyramid was built with the given parameters
+    bool matches(int levels, double voxelSize, double maxDistance, bool pointToPlane, int maxLeafSize) const;
+
+private:
+    /// Removes all Points and inserts the whole Scan
+    void build();
+
+    /// Inserts the Points into the tiles of every level and rebuilds the affected tiles
+    void addPoints(std::vector<Vector3f>& points);
+
+    /// Appends the global Points of the Scans of a Metascan, starting with 'first', to 'points'
+    void addGlobalPoints(size_t first, std::vector<Vector3f>& points);
+
+    /**
+     * @brief Calculates the normals of a tile from the neighbors in all tiles of the level
+     *
+     * @param level     The level of the tile
+     * @param block     The tile, whose KDTree is already built
+     * @param changed   nullptr to calculate all normals, or the indices of the changed tiles to
+     *                  only recalculate the normals of Points within 'maxDistance' of them
+     */
+    void calculateNormals(const Level& level, Block& block, const std::unordered_set<size_t>* changed) const;
+
+    SLAMScanPtr        m_scan;
+
+    /// true if the Points are in the local coordinate system of the Scan
+    bool               m_local;
+
+    /// for a Metascan: the Poses of its Scans when they were inserted
+    std::vector<Transformd> m_poses;
+
+    std::vector<Level> m_levels;
+
+    double             m_voxelSize;
+    double             m_maxDistance;
+    bool               m_pointToPlane;
+    int                m_maxLeafSize;
+};
+
+using ICPPyramidPtr = std::shared_ptr<ICPPyramid>;
+
+} /* namespace lvr2 */
+
+#endif /* ICPPYRAMID_HPP_ */
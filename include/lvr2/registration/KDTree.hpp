@@ -38,8 +38,10 @@
 #include "TreeUtils.hpp"
 #include "SLAMScanWrapper.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <limits>
+#include <vector>
 #include <boost/shared_array.hpp>
 
 namespace lvr2
@@ -65,6 +67,27 @@ public:
      */
     static std::shared_ptr<KDTree> create(SLAMScanPtr scan, int maxLeafSize = 20);
 
+    /**
+     * @brief Creates a new KDTree from the untransformed Points of the given Scan.
+     *
+     * The Tree stays valid when the Pose of the Scan changes, but queries have to be
+     * transformed into the local coordinate system of the Scan first.
+     *
+     * @param scan          The Scan
+     * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
+     */
+    static std::shared_ptr<KDTree> createLocal(SLAMScanPtr scan, int maxLeafSize = 20);
+
+    /**
+     * @brief Creates a new KDTree from the given Points. The order of the Points is changed
+     *        and the Tree keeps a reference to the array.
+     *
+     * @param points        The Points
+     * @param n             The number of points in 'points'
+     * @param maxLeafSize   The maximum number of points to use for a Leaf in the Tree
+     */
+    static std::shared_ptr<KDTree> create(boost::shared_array<Point> points, size_t n, int maxLeafSize = 20);
+
     /**
      * @brief Finds the nearest neighbor of 'point' that is within 'maxDistance' (defaults to infinity).
      *        The resulting neighbor is written into 'neighbor' (or nullptr if none is found).
@@ -91,6 +114,76 @@ public:
         return neighbor != nullptr;
     }
 
+    /**
+     * @brief Same as nearestNeighbor, but starts the search with the given 'neighbor' as the
+     *        best candidate. If that neighbor is close to the result, which is the case for
+     *        the neighbor of the previous ICP iteration, most of the Tree can be skipped.
+     *
+     * @param point         The Point whose neighbor is searched
+     * @param neighbor      The candidate or nullptr, which may be a Point of another KDTree.
+     *                      Is set to the neighbor or nullptr if none is found
+     * @param distance      The final distance between point and neighbor
+     * @param maxDistance   The maximum distance allowed between neighbors
+     * @return bool true if a neighbors was found, false otherwise
+     */
+    template<typename T>
+    bool updateNearestNeighbor(
+        const Vector3<T>& point,
+        Neighbor& neighbor,
+        double& distance,
+        double maxDistance = std::numeric_limits<double>::infinity()
+    ) const
+    {
+        Point p = point.template cast<PointT>();
+        distance = maxDistance;
+        if (neighbor != nullptr)
+        {
+            double candidate = (p - *neighbor).norm();
+            if (candidate < maxDistance)
+            {
+                distance = candidate;
+            }
+            else
+            {
+                neighbor = nullptr;
+            }
+        }
+        nnInternal(p, neighbor, distance);
+
+        return neighbor != nullptr;
+    }
+
+    /**
+     * @brief Finds the k nearest neighbors of 'point' that are within 'maxDistance'.
+     *
+     * @param point         The Point whose neighbors are searched
+     * @param k             The maximum number of neighbors
+     * @param neighbors     An array with space for k neighbors. The neighbors are written into it,
+     *                      starting with the closest one
+     * @param maxDistance   The maximum distance allowed between neighbors
+     * @return size_t the number of neighbors that were found
+     */
+    template<typename T>
+    size_t kNearestNeighbors(
+        const Vector3<T>& point,
+        size_t k,
+        Neighbor* neighbors,
+        double maxDistance = std::numeric_limits<double>::infinity()
+    ) const
+    {
+        NeighborHeap heap;
+        heap.reserve(k + 1);
+        double distance = maxDistance;
+        knnInternal(point.template cast<PointT>(), k, heap, distance);
+
+        std::sort_heap(heap.begin(), heap.end());
+        for (size_t i = 0; i < heap.size(); i++)
+        {
+            neighbors[i] = heap[i].second;
+        }
+        return heap.size();
+    }
+
     virtual ~KDTree() = default;
 
     /**
@@ -125,8 +218,13 @@ protected:
     KDTree() = default;
     KDTree(const KDTree&&) = delete;
 
+    /// A max-heap of (squared distance, neighbor)
+    using NeighborHeap = std::vector<std::pair<double, Neighbor>>;
+
     virtual void nnInternal(const Point& point, Neighbor& neighbor, double& maxDist) const = 0;
 
+    virtual void knnInternal(const Point& point, size_t k, NeighborHeap& heap, double& maxDist) const = 0;
+
     friend class KDNode;
 
     boost::shared_array<Point> points;
@@ -56,6 +56,9 @@ public:
 
     void addScan(SLAMScanPtr scan);
 
+    /// The Scans of the Metascan in the order they were added
+    const std::vector<SLAMScanPtr>& scans() const;
+
 protected:
     std::vector<SLAMScanPtr> m_scans;
 };
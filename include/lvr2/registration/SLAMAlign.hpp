@@ -37,6 +37,7 @@
 #include "SLAMScanWrapper.hpp"
 #include "SLAMOptions.hpp"
 #include "GraphSLAM.hpp"
+#include "ICPPyramid.hpp"
 
 namespace lvr2
 {
@@ -162,6 +163,9 @@ protected:
 
     SLAMScanPtr              m_metascan;
 
+    /// The ICPPyramid of the next model: the last matched Scan or the Metascan
+    ICPPyramidPtr            m_lastPyramid;
+
     GraphSLAM                m_graph;
     bool                     m_foundLoop;
     int                      m_loopIndexCount;
@@ -85,6 +85,16 @@ struct SLAMOptions
     /// The epsilon difference between ICP-errors for the stop criterion of ICP
     double  epsilon = 0.00001;
 
+    /// Number of resolution levels for ICP. Level 0 uses all Points, every further level is reduced with
+    /// twice the voxel size of the previous one, starting at icpVoxelSize. 1 disables the coarse levels
+    int     icpLevels = 1;
+
+    /// The voxel size of ICP level 1
+    double  icpVoxelSize = 10;
+
+    /// Minimize the Point-to-Plane error instead of the Point-to-Point error in ICP
+    bool    icpPointToPlane = false;
+
     // ==================== SLAM Options =========================================================
 
     /// Use simple Loopclosing
@@ -38,11 +38,13 @@
 
 #include "lvr2/geometry/Handles.hpp"
 
+#include <array>
 #include <vector>
 #include <utility>
 
 using std::vector;
 using std::pair;
+using std::array;
 
 namespace lvr2
 {
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * DenseMeap.hpp
+ */
+
+#ifndef LVR2_UTIL_DENSEMEAP_H_
+#define LVR2_UTIL_DENSEMEAP_H_
+
+#include <limits>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "lvr2/util/Meap.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief A meap for handle keys, which stores the heap position of each key
+ *        in a flat array.
+ *
+ * This has the same interface as `Meap`, but the keys have to be handles.
+ * Since handles are dense indices, the position of a key is simply looked up
+ * with its index, instead of in a hash map. The index array grows with the
+ * largest key inserted, so the meap should be created with the capacity
+ * `mesh.nextXIndex()` to avoid reallocations.
+ *
+ * The heap is a d-ary heap: each node has `Arity` children, which are stored
+ * next to each other. This halves the height of the heap for `Arity = 4`
+ * and the children of a node mostly share a cache line, which makes
+ * `popMin()` faster than with a binary heap. `lvr2_meap_benchmark` compares
+ * the different layouts.
+ */
+template<typename HandleT, typename ValueT, size_t Arity = 4>
+class DenseMeap
+{
+public:
+    /**
+     * @brief Initializes an empty meap.
+     */
+    DenseMeap() {}
+
+    /**
+     * @brief Initializes an empty meap for handles with an index smaller
+     *        than `capacity`.
+     */
+    DenseMeap(size_t capacity);
+
+
+    // =======================================================================
+    // These methode work exactly like the ones from `Meap`
+    // =======================================================================
+    bool containsKey(HandleT key) const;
+    boost::optional<ValueT> insert(HandleT key, const ValueT& value);
+    boost::optional<ValueT> erase(HandleT key);
+    void clear();
+    boost::optional<const ValueT&> get(HandleT key) const;
+    size_t numValues() const;
+    const MeapPair<HandleT, ValueT>& peekMin() const;
+    MeapPair<HandleT, ValueT> popMin();
+    void updateValue(const HandleT& key, const ValueT& newValue);
+    bool isEmpty() const;
+
+private:
+    /// Position of handles which are not in the heap
+    static constexpr size_t NOT_IN_HEAP = std::numeric_limits<size_t>::max();
+
+    static_assert(Arity >= 2, "a heap node needs at least two children");
+
+    // The heap which stores the costs as well as all keys.
+    std::vector<MeapPair<HandleT, ValueT>> m_heap;
+
+    // The index within `m_heap` of each handle or NOT_IN_HEAP
+    std::vector<size_t> m_indices;
+
+    /**
+     * @brief Puts `elem` into the heap slot `to` and updates its index.
+     */
+    void place(size_t to, MeapPair<HandleT, ValueT>&& elem);
+
+    /**
+     * @brief Moves the element at `idx` up until its father is not greater.
+     */
+    void bubbleUp(size_t idx);
+
+    /**
+     * @brief Moves the element at `idx` down until no child is smaller.
+     */
+    void bubbleDown(size_t idx);
+};
+
+} // namespace lvr2
+
+#include "lvr2/util/DenseMeap.tcc"
+
+#endif /* LVR2_UTIL_DENSEMEAP_H_ */
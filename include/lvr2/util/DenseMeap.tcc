@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * DenseMeap.tcc
+ */
+
+#include <algorithm>
+
+#include "lvr2/util/Panic.hpp"
+
+namespace lvr2
+{
+
+template<typename HandleT, typename ValueT, size_t Arity>
+DenseMeap<HandleT, ValueT, Arity>::DenseMeap(size_t capacity)
+    : m_indices(capacity, NOT_IN_HEAP)
+{
+    m_heap.reserve(capacity);
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+bool DenseMeap<HandleT, ValueT, Arity>::containsKey(HandleT key) const
+{
+    return key.idx() < m_indices.size() && m_indices[key.idx()] != NOT_IN_HEAP;
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+boost::optional<ValueT> DenseMeap<HandleT, ValueT, Arity>::insert(HandleT key, const ValueT& value)
+{
+    if (containsKey(key))
+    {
+        auto prevValue = m_heap[m_indices[key.idx()]].value();
+        updateValue(key, value);
+        return prevValue;
+    }
+
+    if (key.idx() >= m_indices.size())
+    {
+        m_indices.resize(key.idx() + 1, NOT_IN_HEAP);
+    }
+
+    m_heap.emplace_back(key, value);
+    m_indices[key.idx()] = m_heap.size() - 1;
+    bubbleUp(m_heap.size() - 1);
+    return boost::none;
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+boost::optional<ValueT> DenseMeap<HandleT, ValueT, Arity>::erase(HandleT key)
+{
+    if (!containsKey(key))
+    {
+        return boost::none;
+    }
+
+    auto idx = m_indices[key.idx()];
+    auto out = m_heap[idx].value();
+    m_indices[key.idx()] = NOT_IN_HEAP;
+
+    // Fill the gap with the last element and repair the heap in whichever
+    // direction is needed.
+    auto last = std::move(m_heap.back());
+    m_heap.pop_back();
+    if (idx < m_heap.size())
+    {
+        place(idx, std::move(last));
+        if (idx != 0 && m_heap[idx].value() < m_heap[(idx - 1) / Arity].value())
+        {
+            bubbleUp(idx);
+        }
+        else
+        {
+            bubbleDown(idx);
+        }
+    }
+
+    return out;
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+void DenseMeap<HandleT, ValueT, Arity>::clear()
+{
+    for (auto& elem: m_heap)
+    {
+        m_indices[elem.key().idx()] = NOT_IN_HEAP;
+    }
+    m_heap.clear();
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+boost::optional<const ValueT&> DenseMeap<HandleT, ValueT, Arity>::get(HandleT key) const
+{
+    if (!containsKey(key))
+    {
+        return boost::none;
+    }
+    return m_heap[m_indices[key.idx()]].value();
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+size_t DenseMeap<HandleT, ValueT, Arity>::numValues() const
+{
+    return m_heap.size();
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+const MeapPair<HandleT, ValueT>& DenseMeap<HandleT, ValueT, Arity>::peekMin() const
+{
+    if (m_heap.empty())
+    {
+        panic("attempt to peek at min in an empty heap");
+    }
+
+    return m_heap[0];
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+MeapPair<HandleT, ValueT> DenseMeap<HandleT, ValueT, Arity>::popMin()
+{
+    if (m_heap.empty())
+    {
+        panic("attempt to pop min from an empty heap");
+    }
+
+    auto out = std::move(m_heap[0]);
+    m_indices[out.key().idx()] = NOT_IN_HEAP;
+
+    auto last = std::move(m_heap.back());
+    m_heap.pop_back();
+    if (!m_heap.empty())
+    {
+        place(0, std::move(last));
+        bubbleDown(0);
+    }
+
+    return out;
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+void DenseMeap<HandleT, ValueT, Arity>::updateValue(const HandleT& key, const ValueT& newValue)
+{
+    auto idx = m_indices[key.idx()];
+    if (newValue > m_heap[idx].value())
+    {
+        m_heap[idx].value() = newValue;
+        bubbleDown(idx);
+    }
+    else if (newValue < m_heap[idx].value())
+    {
+        m_heap[idx].value() = newValue;
+        bubbleUp(idx);
+    }
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+bool DenseMeap<HandleT, ValueT, Arity>::isEmpty() const
+{
+    return m_heap.empty();
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+void DenseMeap<HandleT, ValueT, Arity>::place(size_t to, MeapPair<HandleT, ValueT>&& elem)
+{
+    m_indices[elem.key().idx()] = to;
+    m_heap[to] = std::move(elem);
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+void DenseMeap<HandleT, ValueT, Arity>::bubbleUp(size_t idx)
+{
+    // Instead of swapping, the element is moved into the final slot once and
+    // all fathers on the way are moved down by one level.
+    auto elem = std::move(m_heap[idx]);
+    while (idx != 0)
+    {
+        auto father = (idx - 1) / Arity;
+        if (!(elem.value() < m_heap[father].value()))
+        {
+            break;
+        }
+        place(idx, std::move(m_heap[father]));
+        idx = father;
+    }
+    place(idx, std::move(elem));
+}
+
+template<typename HandleT, typename ValueT, size_t Arity>
+void DenseMeap<HandleT, ValueT, Arity>::bubbleDown(size_t idx)
+{
+    const auto len = m_heap.size();
+    auto elem = std::move(m_heap[idx]);
+    while (true)
+    {
+        // Find the smallest child
+        auto first = Arity * idx + 1;
+        if (first >= len)
+        {
+            break;
+        }
+        auto last = std::min(first + Arity, len);
+        auto child = first;
+        for (auto i = first + 1; i < last; i++)
+        {
+            if (m_heap[i].value() < m_heap[child].value())
+            {
+                child = i;
+            }
+        }
+
+        if (!(m_heap[child].value() < elem.value()))
+        {
+            break;
+        }
+        place(idx, std::move(m_heap[child]));
+        idx = child;
+    }
+    place(idx, std::move(elem));
+}
+
+} // namespace lvr2
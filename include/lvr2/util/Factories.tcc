@@ -32,6 +32,8 @@
 #include <algorithm>
 
 #include "lvr2/reconstruction/SearchTree.hpp"
+#include "lvr2/reconstruction/SearchTreeFlann.hpp"
+#include "lvr2/reconstruction/SearchTreeNanoflann.hpp"
 #include "lvr2/io/PointBuffer.hpp"
 #include "lvr2/util/Panic.hpp"
 
@@ -72,8 +74,7 @@ SearchTreePtr<BaseVecT> getSearchTree(string name, PointBufferPtr buffer)
 
     if(name == "nanoflann")
     {
-        // TODO2
-        // this->m_searchTree = std::make_shared<SearchTreeNanoflann<BaseVecT>>(buffer, this->m_numPoints, kn, ki, kd);
+        return std::make_shared<SearchTreeNanoflann<BaseVecT>>(buffer);
     }
 
     if(name == "flann")
@@ -29,10 +29,16 @@
  * Meap.tcc
  */
 
+#include <iostream>
+#include <unordered_set>
+
 #include "lvr2/util/Panic.hpp"
 
+using std::cout;
+using std::endl;
 using std::move;
 using std::swap;
+using std::unordered_set;
 
 namespace lvr2
 {
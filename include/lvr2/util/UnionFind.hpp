@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * UnionFind.hpp
+ */
+
+#ifndef LVR2_UTIL_UNIONFIND_H_
+#define LVR2_UTIL_UNIONFIND_H_
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "lvr2/geometry/Handles.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Disjoint sets of the indices `0, ..., size - 1`, which can be
+ *        merged by several threads at the same time without locks.
+ *
+ * A set is always linked below the set with the smaller root, so the root of
+ * each set is its smallest index. Thus the result does not depend on the
+ * order in which the sets were merged.
+ */
+class ConcurrentUnionFind
+{
+public:
+    /**
+     * @brief Creates `size` sets, each containing one index.
+     */
+    explicit ConcurrentUnionFind(size_t size) : m_parents(size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            m_parents[i].store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Returns the smallest index of the set containing `idx`.
+     */
+    Index find(Index idx)
+    {
+        while (true)
+        {
+            Index parent = m_parents[idx].load();
+            if (parent == idx)
+            {
+                return idx;
+            }
+
+            // Path halving: let `idx` skip its parent. Losing this race to
+            // another thread is harmless.
+            Index grandParent = m_parents[parent].load();
+            if (grandParent != parent)
+            {
+                m_parents[idx].compare_exchange_weak(parent, grandParent);
+            }
+            idx = grandParent;
+        }
+    }
+
+    /**
+     * @brief Merges the sets containing `a` and `b`.
+     */
+    void unite(Index a, Index b)
+    {
+        while (true)
+        {
+            a = find(a);
+            b = find(b);
+            if (a == b)
+            {
+                return;
+            }
+            if (a < b)
+            {
+                std::swap(a, b);
+            }
+
+            // Link the larger root below the smaller one. If the larger one
+            // is not a root anymore, another thread was faster: try again.
+            Index expected = a;
+            if (m_parents[a].compare_exchange_strong(expected, b))
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector<std::atomic<Index>> m_parents;
+};
+
+} // namespace lvr2
+
+#endif /* LVR2_UTIL_UNIONFIND_H_ */
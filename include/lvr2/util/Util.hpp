@@ -155,10 +155,10 @@ public:
      * @return The transformation matrix in riegl coordinate system
      */
     template <typename T>
-    Transform<T> slam6d_to_riegl_transform(const Transform<T> &mat)
+    static Transform<T> slam6d_to_riegl_transform(const Transform<T> &mat)
     {
-        T* in = mat.data();
-        T* ret[16];
+        const T* in = mat.data();
+        T ret[16];
         ret[0] = in[10];
         ret[1] = -in[2];
         ret[2] = in[6];
@@ -217,6 +217,35 @@ public:
         return rad * 180 / M_PI;
     }
 
+    /**
+     * @brief Calculates the Morton code (z-order) of a grid index by interleaving the
+     *        lower 21 bits of its coordinates.
+     *
+     * @param    x    The x index
+     * @param    y    The y index
+     * @param    z    The z index
+     *
+     * @return The Morton code, with the bits of x at the lowest positions
+     */
+    static uint64_t mortonCode(uint64_t x, uint64_t y, uint64_t z)
+    {
+        return spreadBits(x) | spreadBits(y) << 1 | spreadBits(z) << 2;
+    }
+
+    /**
+     * @brief Spreads the lower 21 bits of v so that there are two zero bits between each of them.
+     */
+    static uint64_t spreadBits(uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffffull;
+        v = (v | v << 16) & 0x1f0000ff0000ffull;
+        v = (v | v << 8)  & 0x100f00f00f00f00full;
+        v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+        v = (v | v << 2)  & 0x1249249249249249ull;
+        return v;
+    }
+
     /**
      * @brief A comparison object for Vector<VecUChar>
      */
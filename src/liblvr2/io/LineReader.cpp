@@ -32,15 +32,26 @@
  *      Author: Isaak Mitschke
  */
 
+#include <algorithm>
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdio.h>
+#include <thread>
 
+#include "lvr2/config/lvropenmp.hpp"
 #include "lvr2/io/LineReader.hpp"
 
 namespace lvr2
@@ -76,6 +87,7 @@ void LineReader::open(std::vector<std::string> filePaths)
     for (size_t currentFile = 0; currentFile < filePaths.size(); currentFile++)
     {
         fileAttribut currentAttr;
+        currentAttr.m_binary = false;
         std::string filePath = filePaths[currentFile];
         currentAttr.m_filePath = filePath;
         bool gotxyz = false;
@@ -97,10 +109,47 @@ void LineReader::open(std::vector<std::string> filePaths)
 
         if (currentAttr.m_ply)
         {
+            // Layout of the vertex properties for readBatches()
+            bool inVertexElement = false;
+            size_t recordSize = 0;
+            size_t column = 0;
+            size_t pointByte = 0, normalByte = 0, colorByte = 0;
+            size_t pointColumn = 0, normalColumn = 0, colorColumn = 0;
+
             std::string line;
             while (!readHeader)
             {
                 std::getline(ifs, line);
+                if (boost::algorithm::starts_with(line, "element"))
+                {
+                    inVertexElement = boost::algorithm::contains(line, "element vertex") ||
+                                      boost::algorithm::contains(line, "element point");
+                }
+                else if (inVertexElement && boost::algorithm::starts_with(line, "property") &&
+                         !boost::algorithm::contains(line, "property list"))
+                {
+                    std::stringstream ss(line);
+                    string keyword, type, name;
+                    ss >> keyword >> type >> name;
+                    if (name == "x")
+                    {
+                        pointByte = recordSize;
+                        pointColumn = column;
+                    }
+                    else if (name == "nx")
+                    {
+                        normalByte = recordSize;
+                        normalColumn = column;
+                    }
+                    else if (name == "red")
+                    {
+                        colorByte = recordSize;
+                        colorColumn = column;
+                    }
+                    recordSize += (type == "uchar" || type == "uint8") ? 1 : sizeof(float);
+                    column++;
+                }
+
                 if (boost::algorithm::contains(line, "element vertex") ||
                     boost::algorithm::contains(line, "element point"))
                 {
@@ -154,6 +203,11 @@ void LineReader::open(std::vector<std::string> filePaths)
                                             .c_str());
                 }
             }
+            currentAttr.m_pointOffset = currentAttr.m_binary ? pointByte : pointColumn;
+            currentAttr.m_normalOffset = currentAttr.m_binary ? normalByte : normalColumn;
+            currentAttr.m_colorOffset = currentAttr.m_binary ? colorByte : colorColumn;
+            currentAttr.m_line_element_amount = column;
+
             std::cout << "FINISHED READING HEADER" << std::endl;
             std::cout << "XYT:    " << gotxyz << std::endl;
             std::cout << "COLOR:  " << gotcolor << std::endl;
@@ -227,6 +281,13 @@ void LineReader::open(std::vector<std::string> filePaths)
         {
             throw std::range_error("Did not find any points in data");
         }
+        if (!currentAttr.m_ply)
+        {
+            // Column order of getNextPoints(): x y z [r g b] [nx ny nz]
+            currentAttr.m_pointOffset = 0;
+            currentAttr.m_colorOffset = 3;
+            currentAttr.m_normalOffset = gotcolor ? 6 : 3;
+        }
         ifs.close();
         m_fileAttributes.push_back(currentAttr);
     }
@@ -251,7 +312,7 @@ fileType LineReader::getFileType(size_t i)
                             "LineReader when reading file again?)");
     }
 }
-fileType LineReader::getFileType() { getFileType(m_currentReadFile); }
+fileType LineReader::getFileType() { return getFileType(m_currentReadFile); }
 
 bool LineReader::ok() { return m_currentReadFile < m_fileAttributes.size(); }
 
@@ -478,6 +539,463 @@ boost::shared_ptr<void> LineReader::getNextPoints(size_t& return_amount, size_t
     }
 }
 
+namespace
+{
+
+/// A part of an input file that is decoded into one PointBatch
+struct Chunk
+{
+    size_t file;
+
+    /// Byte range of the chunk. ASCII chunks contain all lines that start
+    /// within the range.
+    size_t begin;
+    size_t end;
+
+    /// Maximum number of points in the chunk
+    size_t maxPoints;
+};
+
+/// Powers of ten that are exactly representable as double
+const double exactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline void skipBlanks(const char*& p, const char* end)
+{
+    while (p < end && isBlank(*p))
+    {
+        p++;
+    }
+}
+
+inline bool skipToken(const char*& p, const char* end)
+{
+    const char* start = p;
+    while (p < end && !isBlank(*p))
+    {
+        p++;
+    }
+    return p != start;
+}
+
+/// Converts the token at p with strtof, used for all numbers the fast path
+/// of parseFloat() does not handle
+bool parseFloatFallback(const char*& p, const char* end, float& value)
+{
+    const char* tokenEnd = p;
+    skipToken(tokenEnd, end);
+    std::string token(p, tokenEnd);
+    char* parsed;
+    value = strtof(token.c_str(), &parsed);
+    if (token.empty() || *parsed != '\0')
+    {
+        return false;
+    }
+    p = tokenEnd;
+    return true;
+}
+
+/**
+ * Parses the decimal number at p and advances p behind it. Numbers with up
+ * to 19 significant digits and a small decimal exponent are converted with
+ * a single rounding step, so the result is the same as from strtof.
+ */
+bool parseFloat(const char*& p, const char* end, float& value)
+{
+    const char* q = p;
+    bool negative = false;
+    if (q < end && (*q == '-' || *q == '+'))
+    {
+        negative = *q == '-';
+        q++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    while (q < end && isDigit(*q))
+    {
+        mantissa = mantissa * 10 + (*q - '0');
+        digits += mantissa != 0;
+        anyDigit = true;
+        q++;
+    }
+    if (q < end && *q == '.')
+    {
+        q++;
+        while (q < end && isDigit(*q))
+        {
+            mantissa = mantissa * 10 + (*q - '0');
+            digits += mantissa != 0;
+            exponent--;
+            anyDigit = true;
+            q++;
+        }
+    }
+    if (anyDigit && q < end && (*q == 'e' || *q == 'E'))
+    {
+        const char* e = q + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+'))
+        {
+            negativeExponent = *e == '-';
+            e++;
+        }
+        int decimalExponent = 0;
+        if (e < end && isDigit(*e))
+        {
+            while (e < end && isDigit(*e))
+            {
+                decimalExponent = std::min(decimalExponent * 10 + (*e - '0'), 100000);
+                e++;
+            }
+            exponent += negativeExponent ? -decimalExponent : decimalExponent;
+            q = e;
+        }
+    }
+
+    if (!anyDigit || digits > 19 || (q < end && !isBlank(*q)) ||
+        mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+    {
+        return parseFloatFallback(p, end, value);
+    }
+
+    double exact = (double)mantissa;
+    exact = exponent < 0 ? exact / exactPowersOfTen[-exponent]
+                         : exact * exactPowersOfTen[exponent];
+    float rounded = (float)exact;
+    if ((double)rounded != exact)
+    {
+        // Rounding to double first may have moved the value onto the
+        // midpoint between two floats, leave those to strtof
+        float direction = exact > rounded ? std::numeric_limits<float>::infinity()
+                                          : -std::numeric_limits<float>::infinity();
+        float other = std::nextafter(rounded, direction);
+        if (((double)rounded + (double)other) / 2 == exact)
+        {
+            return parseFloatFallback(p, end, value);
+        }
+    }
+    value = negative ? -rounded : rounded;
+    p = q;
+    return true;
+}
+
+/// Parses an unsigned integer modulo 256, like scanf's %hhu
+bool parseUChar(const char*& p, const char* end, unsigned char& value)
+{
+    const char* q = p;
+    if (q < end && *q == '+')
+    {
+        q++;
+    }
+    if (q == end || !isDigit(*q))
+    {
+        return false;
+    }
+    unsigned int number = 0;
+    while (q < end && isDigit(*q))
+    {
+        number = number * 10 + (*q - '0');
+        q++;
+    }
+    if (q < end && !isBlank(*q))
+    {
+        return false;
+    }
+    value = (unsigned char)number;
+    p = q;
+    return true;
+}
+
+void decodeAscii(const fileAttribut& attr, const Chunk& chunk, PointBatch& batch)
+{
+    // Start one byte early to find out whether the first line starts
+    // within the chunk or belongs to the previous one
+    size_t start = chunk.begin > attr.m_filePos ? chunk.begin - 1 : chunk.begin;
+    std::ifstream ifs(attr.m_filePath, std::ios::binary);
+    ifs.seekg(start);
+    std::string buffer(chunk.end - start, '\0');
+    ifs.read(&buffer[0], buffer.size());
+    buffer.resize(ifs.gcount());
+    if (ifs.good() && !buffer.empty() && buffer.back() != '\n')
+    {
+        // The last line starts within the chunk, read it completely
+        std::string rest;
+        std::getline(ifs, rest);
+        buffer += rest;
+    }
+
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
+    if (start != chunk.begin)
+    {
+        const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+
+    bool hasNormals = attr.m_fileType == XYZN || attr.m_fileType == XYZNRGB;
+    bool hasColors = attr.m_fileType == XYZRGB || attr.m_fileType == XYZNRGB;
+    size_t columns = attr.m_pointOffset + 3;
+    if (hasNormals)
+    {
+        columns = std::max(columns, attr.m_normalOffset + 3);
+    }
+    if (hasColors)
+    {
+        columns = std::max(columns, attr.m_colorOffset + 3);
+    }
+
+    while (p < end && batch.size() < chunk.maxPoints)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+        {
+            lineEnd = end;
+        }
+
+        float point[3], normal[3];
+        unsigned char color[3];
+        bool valid = true;
+        for (size_t column = 0; column < columns && valid; column++)
+        {
+            skipBlanks(p, lineEnd);
+            if (column - attr.m_pointOffset < 3)
+            {
+                valid = parseFloat(p, lineEnd, point[column - attr.m_pointOffset]);
+            }
+            else if (hasNormals && column - attr.m_normalOffset < 3)
+            {
+                valid = parseFloat(p, lineEnd, normal[column - attr.m_normalOffset]);
+            }
+            else if (hasColors && column - attr.m_colorOffset < 3)
+            {
+                valid = parseUChar(p, lineEnd, color[column - attr.m_colorOffset]);
+            }
+            else
+            {
+                valid = skipToken(p, lineEnd);
+            }
+        }
+
+        // Lines that do not contain a complete point are skipped
+        if (valid)
+        {
+            batch.points.insert(batch.points.end(), point, point + 3);
+            if (hasNormals)
+            {
+                batch.normals.insert(batch.normals.end(), normal, normal + 3);
+            }
+            if (hasColors)
+            {
+                batch.colors.insert(batch.colors.end(), color, color + 3);
+            }
+        }
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+}
+
+void decodeBinary(const fileAttribut& attr, const Chunk& chunk, PointBatch& batch)
+{
+    std::ifstream ifs(attr.m_filePath, std::ios::binary);
+    ifs.seekg(chunk.begin);
+    std::vector<char> buffer(chunk.end - chunk.begin);
+    ifs.read(buffer.data(), buffer.size());
+
+    size_t n = ifs.gcount() / attr.m_PointBlockSize;
+    bool hasNormals = attr.m_fileType == XYZN || attr.m_fileType == XYZNRGB;
+    bool hasColors = attr.m_fileType == XYZRGB || attr.m_fileType == XYZNRGB;
+    batch.points.resize(3 * n);
+    batch.normals.resize(hasNormals ? 3 * n : 0);
+    batch.colors.resize(hasColors ? 3 * n : 0);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const char* record = buffer.data() + i * attr.m_PointBlockSize;
+        memcpy(&batch.points[3 * i], record + attr.m_pointOffset, 3 * sizeof(float));
+        if (hasNormals)
+        {
+            memcpy(&batch.normals[3 * i], record + attr.m_normalOffset, 3 * sizeof(float));
+        }
+        if (hasColors)
+        {
+            memcpy(&batch.colors[3 * i], record + attr.m_colorOffset, 3);
+        }
+    }
+}
+
+} // namespace
+
+void LineReader::readBatches(const BatchConsumer& consumer,
+                             bool ordered,
+                             int threads,
+                             size_t chunkSize)
+{
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < m_fileAttributes.size(); i++)
+    {
+        const fileAttribut& attr = m_fileAttributes[i];
+        std::ifstream ifs(attr.m_filePath, std::ios::binary | std::ios::ate);
+        size_t fileSize = ifs.tellg();
+        if (!ifs.good() || fileSize < attr.m_filePos)
+        {
+            throw readException("Could not read " + attr.m_filePath);
+        }
+
+        if (attr.m_ply && attr.m_binary)
+        {
+            size_t points = std::min(attr.m_elementAmount,
+                                     (fileSize - attr.m_filePos) / attr.m_PointBlockSize);
+            size_t pointsPerChunk = std::max<size_t>(1, chunkSize / attr.m_PointBlockSize);
+            for (size_t first = 0; first < points; first += pointsPerChunk)
+            {
+                size_t count = std::min(pointsPerChunk, points - first);
+                size_t begin = attr.m_filePos + first * attr.m_PointBlockSize;
+                chunks.push_back({i, begin, begin + count * attr.m_PointBlockSize, count});
+            }
+        }
+        else if (attr.m_ply)
+        {
+            // The vertex lines can only be told apart from the following
+            // elements by counting, so ASCII PLY files are a single chunk
+            chunks.push_back({i, attr.m_filePos, fileSize, attr.m_elementAmount});
+        }
+        else
+        {
+            for (size_t begin = attr.m_filePos; begin < fileSize; begin += chunkSize)
+            {
+                chunks.push_back({i,
+                                  begin,
+                                  std::min(begin + chunkSize, fileSize),
+                                  std::numeric_limits<size_t>::max()});
+            }
+        }
+    }
+
+    if (threads <= 0)
+    {
+        threads = OpenMPConfig::getNumThreads();
+    }
+    threads = std::max(1, std::min<int>(threads, chunks.size()));
+
+    // In ordered mode decoded batches wait in done until the consumer takes
+    // them. The parsers stay at most window chunks ahead of the consumer.
+    const size_t window = 2 * threads;
+    std::vector<std::unique_ptr<PointBatch>> done(chunks.size());
+    size_t delivered = 0;
+    std::atomic<size_t> nextChunk(0);
+    std::atomic<bool> abort(false);
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+        {
+            error = e;
+        }
+        abort = true;
+        cv.notify_all();
+    };
+
+    auto parse = [&](int id) {
+        try
+        {
+            while (!abort)
+            {
+                size_t c = nextChunk++;
+                if (c >= chunks.size())
+                {
+                    break;
+                }
+                if (ordered)
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return c < delivered + window || abort; });
+                }
+
+                const fileAttribut& attr = m_fileAttributes[chunks[c].file];
+                std::unique_ptr<PointBatch> batch(new PointBatch);
+                batch->file = chunks[c].file;
+                if (attr.m_ply && attr.m_binary)
+                {
+                    decodeBinary(attr, chunks[c], *batch);
+                }
+                else
+                {
+                    decodeAscii(attr, chunks[c], *batch);
+                }
+
+                if (ordered)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done[c] = std::move(batch);
+                    cv.notify_all();
+                }
+                else
+                {
+                    consumer(*batch, id);
+                }
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+    };
+
+    std::vector<std::thread> parsers;
+    for (int i = 0; i < threads; i++)
+    {
+        parsers.emplace_back(parse, i);
+    }
+
+    if (ordered)
+    {
+        for (size_t c = 0; c < chunks.size() && !abort; c++)
+        {
+            std::unique_ptr<PointBatch> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return done[c] || abort; });
+                batch = std::move(done[c]);
+            }
+            if (!batch)
+            {
+                break;
+            }
+            try
+            {
+                consumer(*batch, 0);
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+                break;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            delivered = c + 1;
+            cv.notify_all();
+        }
+    }
+
+    for (auto& parser : parsers)
+    {
+        parser.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
 void LineReader::rewind()
 {
     std::vector<std::string> tmp;
@@ -34,7 +34,9 @@
 
 
 #include "lvr2/io/Progress.hpp"
+#include "lvr2/config/lvropenmp.hpp"
 
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 
@@ -48,13 +50,52 @@ namespace lvr2
 
 ProgressCallbackPtr ProgressBar::m_progressCallback = 0;
 ProgressTitleCallbackPtr ProgressBar::m_titleCallback = 0;
+ProgressTimingCallbackPtr ProgressBar::m_timingCallback = 0;
+
+namespace
+{
+
+/// Assigns the progress bar counters to threads in a round robin fashion
+std::atomic<size_t> nextCounter(0);
+
+inline size_t counterIndex()
+{
+    thread_local size_t index = ProgressBar::NUM_COUNTERS;
+    if(index == ProgressBar::NUM_COUNTERS)
+    {
+        index = nextCounter++ % ProgressBar::NUM_COUNTERS;
+    }
+    return index;
+}
+
+} // namespace
 
 ProgressBar::ProgressBar(size_t max_val, string prefix)
 {
 	m_prefix = prefix;
 	m_maxVal = max_val;
-    m_currentVal = 0;
 	m_percent = 0;
+	m_timingReported = false;
+	m_start = std::chrono::steady_clock::now();
+
+	for(Counter& counter : m_counters)
+	{
+		counter.value.store(0, std::memory_order_relaxed);
+	}
+
+	// Update the progress about 400 times per thread, which keeps the
+	// output accurate to one percent. The interval is a power of two of
+	// at most 1024 iterations. Every counter performs less than one
+	// interval after its last update, so the final phase starts before
+	// the last iteration in any case.
+	size_t threads = std::max(OpenMPConfig::getNumThreads(), 1);
+	m_updateShift = 0;
+	while(m_updateShift < 10 && (size_t(2) << m_updateShift) * 400 * threads <= max_val)
+	{
+		m_updateShift++;
+	}
+	m_finalIterations = (2 * NUM_COUNTERS + 1) << m_updateShift;
+	m_final = max_val <= m_finalIterations;
 
 	if(m_titleCallback)
 	{
@@ -67,7 +108,17 @@ ProgressBar::ProgressBar(size_t max_val, string prefix)
 
 ProgressBar::~ProgressBar()
 {
+	if(m_timingCallback)
+	{
+		size_t current = 0;
+		for(Counter& counter : m_counters)
+		{
+			current += counter.value.load();
+		}
 
+		std::lock_guard<std::mutex> lock(m_mutex);
+		report_timing(current);
+	}
 }
 
 void ProgressBar::setProgressCallback(ProgressCallbackPtr ptr)
@@ -80,46 +131,60 @@ void ProgressBar::setProgressTitleCallback(ProgressTitleCallbackPtr ptr)
 	m_titleCallback = ptr;
 }
 
+void ProgressBar::setTimingCallback(ProgressTimingCallbackPtr ptr)
+{
+	m_timingCallback = ptr;
+}
+
 void ProgressBar::operator++()
 {
-    boost::mutex::scoped_lock lock(m_mutex);
+    add(1);
+}
 
-    m_currentVal++;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
-    if (difference < 1)
+void ProgressBar::operator+=(size_t n)
+{
+    add(n);
+}
+
+void ProgressBar::add(size_t n)
+{
+    size_t value = m_counters[counterIndex()].value.fetch_add(n) + n;
+
+    if(m_final.load(std::memory_order_relaxed)
+       || (value - n) >> m_updateShift != value >> m_updateShift)
     {
-        return;
+        update();
     }
+}
 
-    while (difference >= 1)
+void ProgressBar::update()
+{
+    size_t current = 0;
+    for(Counter& counter : m_counters)
     {
-        m_percent++;
-        difference--;
-        print_bar();
-
-        if(m_progressCallback)
-        {
-        	m_progressCallback(m_percent);
-        }
+        current += counter.value.load();
     }
 
-}
+    if(m_maxVal == 0)
+    {
+        return;
+    }
 
-void ProgressBar::operator+=(size_t n)
-{
-    boost::mutex::scoped_lock lock(m_mutex);
+    if(!m_final.load(std::memory_order_relaxed) && current + m_finalIterations >= m_maxVal)
+    {
+        m_final = true;
+    }
 
-    m_currentVal+= n;
-    short difference = (short)((float)m_currentVal/m_maxVal * 100 - m_percent);
-    if (difference < 1)
+    int percent = (int)(std::min(current, m_maxVal) * 100 / m_maxVal);
+    if(percent <= m_percent.load(std::memory_order_relaxed))
     {
         return;
     }
 
-    while (difference >= 1)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (m_percent < percent)
     {
         m_percent++;
-        difference--;
         print_bar();
 
         if(m_progressCallback)
@@ -128,6 +193,31 @@ void ProgressBar::operator+=(size_t n)
         }
     }
 
+    if(current >= m_maxVal)
+    {
+        report_timing(current);
+    }
+}
+
+void ProgressBar::report_timing(size_t iterations)
+{
+	if(!m_timingCallback || m_timingReported)
+	{
+		return;
+	}
+	m_timingReported = true;
+
+	ProgressTiming timing;
+
+	// Remove time brackets and surrounding blanks
+	timing.phase = m_prefix.substr(m_prefix.find_last_of("]") + 1);
+	size_t first = timing.phase.find_first_not_of(" \t");
+	size_t last = timing.phase.find_last_not_of(" \t");
+	timing.phase = first == string::npos ? "" : timing.phase.substr(first, last - first + 1);
+
+	timing.iterations = iterations;
+	timing.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	m_timingCallback(timing);
 }
 
 void ProgressBar::print_bar()
@@ -144,17 +234,17 @@ ProgressCounter::ProgressCounter(int stepVal, string prefix)
 
 void ProgressCounter::operator++()
 {
-	boost::mutex::scoped_lock lock(m_mutex);
-	m_currentVal++;
-	if(m_currentVal % m_stepVal == 0)
+	size_t value = ++m_currentVal;
+	if(value % m_stepVal == 0)
 	{
-		print_progress();
+		print_progress(value);
 	}
 }
 
-void ProgressCounter::print_progress()
+void ProgressCounter::print_progress(size_t value)
 {
-	cout << "\r" << m_prefix << " " << m_currentVal << flush;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	cout << "\r" << m_prefix << " " << value << flush;
 }
 
 PacmanProgressCallbackPtr PacmanProgressBar::m_progressCallback = 0;
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * TimingReport.cpp
+ */
+
+#include "lvr2/io/TimingReport.hpp"
+
+#include <fstream>
+#include <mutex>
+
+namespace lvr2
+{
+
+namespace
+{
+
+std::mutex reportMutex;
+std::vector<ProgressTiming> reportEntries;
+
+} // namespace
+
+void TimingReport::enable()
+{
+    ProgressBar::setTimingCallback(&TimingReport::add);
+}
+
+void TimingReport::disable()
+{
+    ProgressBar::setTimingCallback(0);
+}
+
+void TimingReport::add(const ProgressTiming& timing)
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    reportEntries.push_back(timing);
+}
+
+std::vector<ProgressTiming> TimingReport::entries()
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    return reportEntries;
+}
+
+void TimingReport::clear()
+{
+    std::lock_guard<std::mutex> lock(reportMutex);
+    reportEntries.clear();
+}
+
+void TimingReport::write(std::ostream& os)
+{
+    os << "phase,iterations,seconds,iterations_per_second" << std::endl;
+    for(const ProgressTiming& timing : entries())
+    {
+        // Quote the phase name, quotes inside are doubled
+        std::string phase;
+        for(char c : timing.phase)
+        {
+            phase += c;
+            if(c == '"')
+            {
+                phase += c;
+            }
+        }
+
+        os << "\"" << phase << "\"," << timing.iterations << ","
+           << timing.seconds << "," << timing.throughput() << std::endl;
+    }
+}
+
+bool TimingReport::write(const std::string& filename)
+{
+    std::ofstream out(filename);
+    if(!out.good())
+    {
+        return false;
+    }
+    write(out);
+    return out.good();
+}
+
+} // namespace lvr2
@@ -0,0 +1,329 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * CloseScanFinder.cpp
+ */
+#include "lvr2/registration/CloseScanFinder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using namespace std;
+using namespace Eigen;
+
+namespace lvr2
+{
+
+namespace
+{
+
+// 21 bits per axis, which is far more than the extent of any Scan
+const long VOXEL_OFFSET = 1 << 20;
+const size_t VOXEL_MASK = (1 << 21) - 1;
+
+size_t voxelIndex(const Vector3<long>& voxel)
+{
+    return ((size_t)(voxel.x() + VOXEL_OFFSET) << 42)
+           | ((size_t)(voxel.y() + VOXEL_OFFSET) << 21)
+           | (size_t)(voxel.z() + VOXEL_OFFSET);
+}
+
+Vector3<long> voxelCoordinates(size_t index)
+{
+    return Vector3<long>(
+        (long)((index >> 42) & VOXEL_MASK) - VOXEL_OFFSET,
+        (long)((index >> 21) & VOXEL_MASK) - VOXEL_OFFSET,
+        (long)(index & VOXEL_MASK) - VOXEL_OFFSET
+    );
+}
+
+Vector3<long> voxelOf(const Vector3d& point, double voxelSize)
+{
+    return (point / voxelSize).array().floor().cast<long>().matrix();
+}
+
+} // namespace
+
+CloseScanFinder::CloseScanFinder(const SLAMOptions* options, TreeSource trees)
+    : m_options(options), m_trees(trees), m_cellSize(0), m_gridSize(0)
+{
+}
+
+void CloseScanFinder::update(const vector<SLAMScanPtr>& scans, size_t count)
+{
+    // slightly larger than slamMaxDistance, so that rounding can't put a pair two voxels apart
+    double voxelSize = 0;
+    if (m_options->closeLoopPairs >= 0 && m_options->slamMaxDistance > 0)
+    {
+        voxelSize = m_options->slamMaxDistance * 1.001;
+    }
+
+    if (m_entries.size() < count)
+    {
+        m_entries.resize(count);
+    }
+
+    vector<size_t> changed;
+    for (size_t i = 0; i < count; i++)
+    {
+        Entry& entry = m_entries[i];
+        if (entry.scan != scans[i])
+        {
+            entry = Entry();
+            entry.scan = scans[i];
+            changed.push_back(i);
+        }
+        else if (entry.pose != scans[i]->pose() || entry.voxelSize != voxelSize)
+        {
+            changed.push_back(i);
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < changed.size(); k++)
+    {
+        Entry& entry = m_entries[changed[k]];
+        entry.pose = entry.scan->pose();
+        entry.voxelSize = voxelSize;
+        entry.voxels.clear();
+
+        if (voxelSize == 0)
+        {
+            continue;
+        }
+
+        Matrix3d rotation = entry.pose.block<3, 3>(0, 0);
+        Vector3d translation = entry.pose.block<3, 1>(0, 3);
+
+        entry.min = Vector3d::Constant(numeric_limits<double>::infinity());
+        entry.max = -entry.min;
+
+        unordered_map<size_t, size_t> counts;
+        for (size_t i = 0; i < entry.scan->numPoints(); i++)
+        {
+            Vector3d point = rotation * entry.scan->rawPoint(i).cast<double>() + translation;
+            entry.min = entry.min.cwiseMin(point);
+            entry.max = entry.max.cwiseMax(point);
+            counts[voxelIndex(voxelOf(point, voxelSize))]++;
+        }
+
+        entry.voxels.assign(counts.begin(), counts.end());
+        sort(entry.voxels.begin(), entry.voxels.end());
+    }
+
+    // the grid only has to be rebuilt if a position changed
+    double cellSize = fabs(m_options->closeLoopDistance);
+    if (!changed.empty() || cellSize != m_cellSize)
+    {
+        m_grid.clear();
+        m_gridSize = 0;
+        m_cellSize = cellSize;
+    }
+    if (m_cellSize > 0)
+    {
+        for (; m_gridSize < count; m_gridSize++)
+        {
+            Vector3d position = m_entries[m_gridSize].pose.block<3, 1>(0, 3);
+            m_grid[voxelIndex(voxelOf(position, m_cellSize))].push_back(m_gridSize);
+        }
+    }
+}
+
+bool CloseScanFinder::findCloseScans(const vector<SLAMScanPtr>& scans, size_t scan, vector<size_t>& output)
+{
+    if (scan < m_options->loopSize)
+    {
+        return false;
+    }
+
+    update(scans, scan + 1);
+
+    // only Scans before 'end' are considered
+    size_t end = scan - m_options->loopSize;
+    size_t first = output.size();
+
+    const Entry& cur = m_entries[scan];
+
+    // closeLoopPairs not specified => use closeLoopDistance
+    if (m_options->closeLoopPairs < 0)
+    {
+        if (m_cellSize == 0)
+        {
+            return false;
+        }
+
+        double maxDist = std::pow(m_options->closeLoopDistance, 2);
+        Vector3d pos = cur.pose.block<3, 1>(0, 3);
+        Vector3<long> cell = voxelOf(pos, m_cellSize);
+
+        // every Scan within closeLoopDistance is in one of the neighboring cells
+        for (long dx = -1; dx <= 1; dx++)
+        {
+            for (long dy = -1; dy <= 1; dy++)
+            {
+                for (long dz = -1; dz <= 1; dz++)
+                {
+                    auto it = m_grid.find(voxelIndex(cell + Vector3<long>(dx, dy, dz)));
+                    if (it == m_grid.end())
+                    {
+                        continue;
+                    }
+                    for (size_t other : it->second)
+                    {
+                        if (other < end && (m_entries[other].pose.block<3, 1>(0, 3) - pos).squaredNorm() < maxDist)
+                        {
+                            output.push_back(other);
+                        }
+                    }
+                }
+            }
+        }
+
+        sort(output.begin() + first, output.end());
+        return output.size() > first;
+    }
+
+    size_t required = m_options->closeLoopPairs;
+    if (required == 0)
+    {
+        for (size_t other = 0; other < end; other++)
+        {
+            output.push_back(other);
+        }
+        return end > 0;
+    }
+
+    // no Point has a neighbor within a distance of 0
+    if (cur.voxelSize == 0)
+    {
+        return false;
+    }
+
+    // a Point of another Scan can only have a neighbor in 'cur' if its voxel is next to one of 'cur'
+    unordered_set<size_t> near;
+    near.reserve(cur.voxels.size() * 27);
+    for (const auto& voxel : cur.voxels)
+    {
+        Vector3<long> center = voxelCoordinates(voxel.first);
+        for (long dx = -1; dx <= 1; dx++)
+        {
+            for (long dy = -1; dy <= 1; dy++)
+            {
+                for (long dz = -1; dz <= 1; dz++)
+                {
+                    near.insert(voxelIndex(center + Vector3<long>(dx, dy, dz)));
+                }
+            }
+        }
+    }
+
+    double maxDistance = m_options->slamMaxDistance;
+    vector<char> possible(end, 0);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t other = 0; other < end; other++)
+    {
+        const Entry& entry = m_entries[other];
+        if ((entry.min.array() > cur.max.array() + maxDistance).any()
+            || (entry.max.array() < cur.min.array() - maxDistance).any())
+        {
+            continue;
+        }
+
+        // upper bound for the number of pairs
+        size_t bound = 0;
+        for (size_t i = 0; i < entry.voxels.size() && bound < required; i++)
+        {
+            if (near.count(entry.voxels[i].first))
+            {
+                bound += entry.voxels[i].second;
+            }
+        }
+        possible[other] = bound >= required;
+    }
+
+    vector<size_t> candidates;
+    for (size_t other = 0; other < end; other++)
+    {
+        if (possible[other])
+        {
+            candidates.push_back(other);
+        }
+    }
+
+    if (candidates.empty())
+    {
+        return false;
+    }
+
+    const Entry& query = m_entries[scan];
+    KDTreePtr tree = m_trees ? m_trees(scans, scan) : KDTree::createLocal(query.scan, m_options->maxLeafSize);
+
+    vector<char> close(candidates.size(), 0);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+        close[k] = countPairs(*tree, query, m_entries[candidates[k]], required) >= required;
+    }
+
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+        if (close[k])
+        {
+            output.push_back(candidates[k]);
+        }
+    }
+
+    return output.size() > first;
+}
+
+size_t CloseScanFinder::countPairs(const KDTree& tree, const Entry& cur, const Entry& other, size_t required) const
+{
+    // the Tree is in the local coordinate system of 'cur'
+    Transformd toCur = cur.pose.inverse() * other.pose;
+    Matrix3d rotation = toCur.block<3, 3>(0, 0);
+    Vector3d translation = toCur.block<3, 1>(0, 3);
+
+    size_t count = 0;
+    for (size_t i = 0; i < other.scan->numPoints() && count < required; i++)
+    {
+        Vector3d point = rotation * other.scan->rawPoint(i).cast<double>() + translation;
+
+        KDTree::Neighbor neighbor;
+        double distance;
+        if (tree.nearestNeighbor(point, neighbor, distance, m_options->slamMaxDistance))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+} /* namespace lvr2 */
@@ -33,8 +33,6 @@
  */
 #include "lvr2/registration/GraphSLAM.hpp"
 
-#include <Eigen/SparseCholesky>
-
 using namespace std;
 using namespace Eigen;
 
@@ -43,51 +41,8 @@ namespace lvr2
 
 bool findCloseScans(const vector<SLAMScanPtr>& scans, size_t scan, const SLAMOptions& options, vector<size_t>& output)
 {
-    if (scan < options.loopSize)
-    {
-        return false;
-    }
-
-    const SLAMScanPtr& cur = scans[scan];
-
-    // closeLoopPairs not specified => use closeLoopDistance
-    if (options.closeLoopPairs < 0)
-    {
-        double maxDist = std::pow(options.closeLoopDistance, 2);
-        Vector3d pos = cur->getPosition();
-        for (size_t other = 0; other < scan - options.loopSize; other++)
-        {
-            if ((scans[other]->getPosition() - pos).squaredNorm() < maxDist)
-            {
-                output.push_back(other);
-            }
-        }
-    }
-    else
-    {
-        // convert current Scan to KDTree for Pair search
-        auto tree = KDTree::create(cur, options.maxLeafSize);
-
-        size_t maxLen = 0;
-        for (size_t other = 0; other < scan - options.loopSize; other++)
-        {
-            maxLen = max(maxLen, scans[other]->numPoints());
-        }
-        KDTree::Neighbor* neighbors = new KDTree::Neighbor[maxLen];
-
-        for (size_t other = 0; other < scan - options.loopSize; other++)
-        {
-            size_t count = KDTree::nearestNeighbors(tree, scans[other], neighbors, options.slamMaxDistance);
-            if (count >= options.closeLoopPairs)
-            {
-                output.push_back(other);
-            }
-        }
-
-        delete[] neighbors;
-    }
-
-    return !output.empty();
+    CloseScanFinder finder(&options);
+    return finder.findCloseScans(scans, scan, output);
 }
 
 // Conversions between Pose and Matrix representations in GraphSLAMs internally consistent Coordinate System
@@ -95,11 +50,12 @@ void EulerToMatrix4(const Vector3d& pos, const Vector3d& theta, Matrix4d& mat);
 void Matrix4ToEuler(const Matrix4d mat, Vector3d& rPosTheta, Vector3d& rPos);
 
 GraphSLAM::GraphSLAM(const SLAMOptions* options)
-    : m_options(options)
+    : m_options(options),
+      m_closeScans(options, [this](const vector<SLAMScanPtr>& scans, size_t index) { return localTree(scans, index); })
 {
 }
 
-void GraphSLAM::doGraphSLAM(const vector<SLAMScanPtr>& scans, size_t last) const
+void GraphSLAM::doGraphSLAM(const vector<SLAMScanPtr>& scans, size_t last)
 {
     // ignore first scan, keep last scan => n = last - 1 + 1
     size_t n = last;
@@ -118,13 +74,21 @@ void GraphSLAM::doGraphSLAM(const vector<SLAMScanPtr>& scans, size_t last) const
         cout << "GraphSLAM Iteration " << iteration << " of " << m_options->slamIterations << endl;
 
         createGraph(scans, last, graph);
+        updateTrees(scans, graph);
 
         // Construct the linear equation system A * X = B..
         fillEquation(scans, graph, A, B);
 
-        graph.clear();
+        // the structure of A only depends on the Graph, so the symbolic factorization
+        // can be kept as long as the Graph stays the same
+        if (graph != m_solverGraph)
+        {
+            m_solver.analyzePattern(A);
+            m_solverGraph = graph;
+        }
+        m_solver.factorize(A);
 
-        X = SimplicialCholesky<GraphMatrix>().compute(A).solve(B);
+        X = m_solver.solve(B);
 
         double sum_position_diff = 0.0;
 
@@ -211,7 +175,7 @@ void GraphSLAM::doGraphSLAM(const vector<SLAMScanPtr>& scans, size_t last) const
     }
 }
 
-void GraphSLAM::createGraph(const vector<SLAMScanPtr>& scans, size_t last, Graph& graph) const
+void GraphSLAM::createGraph(const vector<SLAMScanPtr>& scans, size_t last, Graph& graph)
 {
     graph.clear();
 
@@ -223,7 +187,7 @@ void GraphSLAM::createGraph(const vector<SLAMScanPtr>& scans, size_t last, Graph
     vector<size_t> others;
     for (size_t i = m_options->loopSize; i <= last; i++)
     {
-        findCloseScans(scans, i, *m_options, others);
+        findCloseScans(scans, i, others);
 
         for (size_t other : others)
         {
@@ -234,23 +198,39 @@ void GraphSLAM::createGraph(const vector<SLAMScanPtr>& scans, size_t last, Graph
     }
 }
 
+bool GraphSLAM::findCloseScans(const vector<SLAMScanPtr>& scans, size_t scan, vector<size_t>& output)
+{
+    return m_closeScans.findCloseScans(scans, scan, output);
+}
+
+KDTreePtr GraphSLAM::localTree(const vector<SLAMScanPtr>& scans, size_t index)
+{
+    if (m_trees.size() < scans.size())
+    {
+        m_trees.resize(scans.size());
+    }
+
+    // the Trees don't depend on the Poses, so they only need to be built for new Scans
+    if (m_trees[index].first != scans[index])
+    {
+        m_trees[index] = make_pair(scans[index], KDTree::createLocal(scans[index], m_options->maxLeafSize));
+    }
+    return m_trees[index].second;
+}
+
+void GraphSLAM::updateTrees(const vector<SLAMScanPtr>& scans, const Graph& graph)
+{
+    for (const auto& edge : graph)
+    {
+        localTree(scans, edge.first);
+    }
+}
+
 /**
  * A function to fill the linear system mat * x = vec.
  */
 void GraphSLAM::fillEquation(const vector<SLAMScanPtr>& scans, const Graph& graph, GraphMatrix& mat, GraphVector& vec) const
 {
-    // Cache all KDTrees
-    map<size_t, KDTreePtr> trees;
-    for (size_t i = 0; i < graph.size(); i++)
-    {
-        size_t a = graph[i].first;
-        if (trees.find(a) == trees.end())
-        {
-            auto tree = KDTree::create(scans[a], m_options->maxLeafSize);
-            trees.insert(make_pair(a, tree));
-        }
-    }
-
     vector<pair<Matrix6d, Vector6d>> coeff(graph.size());
 
     #pragma omp parallel for schedule(dynamic)
@@ -259,135 +239,130 @@ void GraphSLAM::fillEquation(const vector<SLAMScanPtr>& scans, const Graph& grap
         int a, b;
         std::tie(a, b) = graph[i];
 
-        KDTreePtr tree  = trees[a];
-        SLAMScanPtr scan = scans[b];
-
         Matrix6d coeffMat;
         Vector6d coeffVec;
-        eulerCovariance(tree, scan, coeffMat, coeffVec);
+        eulerCovariance(m_trees[a].second, scans[a], scans[b], coeffMat, coeffVec);
 
         coeff[i] = make_pair(coeffMat, coeffVec);
     }
 
-    trees.clear();
+    // first scan is not part of Matrix => ignore any a or b of 0
+    // every Edge adds up to four 6x6 blocks, so each Edge gets its own range of triplets
+    vector<size_t> tripletOffsets(graph.size() + 1, 0);
+    for (size_t i = 0; i < graph.size(); i++)
+    {
+        int a, b;
+        std::tie(a, b) = graph[i];
 
-    map<pair<int, int>, Matrix6d> result;
+        size_t blocks = (a > 0 ? 1 : 0) + (b > 0 ? 1 : 0) + (a > 0 && b > 0 ? 2 : 0);
+        tripletOffsets[i + 1] = tripletOffsets[i] + blocks * 6 * 6;
+    }
 
-    mat.setZero();
-    vec.setZero();
+    vector<Triplet<double>> triplets(tripletOffsets.back());
 
+    #pragma omp parallel for schedule(static)
     for (size_t i = 0; i < graph.size(); i++)
     {
         int a, b;
         std::tie(a, b) = graph[i];
 
-        Matrix6d coeffMat;
-        Vector6d coeffVec;
-        std::tie(coeffMat, coeffVec) = coeff[i];
-
-        // first scan is not part of Matrix => ignore any a or b of 0
-
         int offsetA = (a - 1) * 6;
         int offsetB = (b - 1) * 6;
 
-        if (offsetA >= 0)
+        const Matrix6d& coeffMat = coeff[i].first;
+
+        auto out = triplets.begin() + tripletOffsets[i];
+        auto addBlock = [&out](int x, int y, const Matrix6d& m)
         {
-            vec.block<6, 1>(offsetA, 0) += coeffVec;
-            auto key = make_pair(offsetA, offsetA);
-            auto found = result.find(key);
-            if (found == result.end())
+            for (int dx = 0; dx < 6; dx++)
             {
-                result.insert(make_pair(key, coeffMat));
-            }
-            else
-            {
-                found->second += coeffMat;
+                for (int dy = 0; dy < 6; dy++)
+                {
+                    *out++ = Triplet<double>(x + dx, y + dy, m(dx, dy));
+                }
             }
+        };
+
+        if (offsetA >= 0)
+        {
+            addBlock(offsetA, offsetA, coeffMat);
         }
         if (offsetB >= 0)
         {
-            vec.block<6, 1>(offsetB, 0) -= coeffVec;
-            auto key = make_pair(offsetB, offsetB);
-            auto found = result.find(key);
-            if (found == result.end())
-            {
-                result.insert(make_pair(key, coeffMat));
-            }
-            else
-            {
-                found->second += coeffMat;
-            }
+            addBlock(offsetB, offsetB, coeffMat);
         }
         if (offsetA >= 0 && offsetB >= 0)
         {
-            auto key = make_pair(offsetA, offsetB);
-            auto found = result.find(key);
-            if (found == result.end())
-            {
-                result.insert(make_pair(key, -coeffMat));
-            }
-            else
-            {
-                found->second -= coeffMat;
-            }
-
-            key = make_pair(offsetB, offsetA);
-            found = result.find(key);
-            if (found == result.end())
-            {
-                result.insert(make_pair(key, -coeffMat));
-            }
-            else
-            {
-                found->second -= coeffMat;
-            }
+            addBlock(offsetA, offsetB, -coeffMat);
+            addBlock(offsetB, offsetA, -coeffMat);
         }
     }
 
-    vector<Triplet<double>> triplets;
-    triplets.reserve(result.size() * 6 * 6);
-
-    int x, y;
-    for (auto& e : result)
+    vec.setZero();
+    for (size_t i = 0; i < graph.size(); i++)
     {
-        tie(x, y) = e.first;
-        Matrix6d& m = e.second;
-        for (int dx = 0; dx < 6; dx++)
+        int a, b;
+        std::tie(a, b) = graph[i];
+
+        int offsetA = (a - 1) * 6;
+        int offsetB = (b - 1) * 6;
+
+        if (offsetA >= 0)
         {
-            for (int dy = 0; dy < 6; dy++)
-            {
-                triplets.push_back(Triplet<double>(x + dx, y + dy, m(dx, dy)));
-            }
+            vec.block<6, 1>(offsetA, 0) += coeff[i].second;
+        }
+        if (offsetB >= 0)
+        {
+            vec.block<6, 1>(offsetB, 0) -= coeff[i].second;
         }
     }
+
+    // duplicate entries are summed up
     mat.setFromTriplets(triplets.begin(), triplets.end());
 }
 
-void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outMat, Vector6d& outVec) const
+void GraphSLAM::eulerCovariance(const KDTreePtr& tree, const SLAMScanPtr& treeScan, const SLAMScanPtr& scan, Matrix6d& outMat, Vector6d& outVec) const
 {
     size_t n = scan->numPoints();
 
-    KDTree::Neighbor* results = new KDTree::Neighbor[n];
+    // the Tree contains the Points of treeScan in its local coordinate system
+    const Transformd& treePose = treeScan->pose();
+    Transformd toTree = treePose.inverse() * scan->pose();
 
-    size_t pairs = KDTree::nearestNeighbors(tree, scan, results, m_options->slamMaxDistance);
+    Matrix3d toTreeRotation = toTree.block<3, 3>(0, 0);
+    Vector3d toTreeTranslation = toTree.block<3, 1>(0, 3);
+    Matrix3d treeRotation = treePose.block<3, 3>(0, 0);
+    Vector3d treeTranslation = treePose.block<3, 1>(0, 3);
 
-    Vector6d mz = Vector6d::Zero();
-    Vector3d sum = Vector3d::Zero();
-    double xy, yz, xz, ypz, xpz, xpy;
-    xy = yz = xz = ypz = xpz = xpy = 0.0;
+    // the midpoint and the difference of every pair of Points in global coordinates
+    vector<pair<Vector3d, Vector3d>> pairs;
+    pairs.reserve(n);
 
+    KDTree::Neighbor neighbor;
+    double distance;
     for (size_t i = 0; i < n; i++)
     {
-        if (results[i] == nullptr)
+        Vector3d query = toTreeRotation * scan->rawPoint(i).cast<double>() + toTreeTranslation;
+        if (!tree->nearestNeighbor(query, neighbor, distance, m_options->slamMaxDistance))
         {
             continue;
         }
 
-        Vector3d p = scan->point(i).cast<double>();
-        Vector3d r = results[i]->cast<double>();
+        Vector3d p = scan->point(i);
+        Vector3d r = treeRotation * neighbor->cast<double>() + treeTranslation;
+
+        pairs.emplace_back((p + r) / 2.0, r - p);
+    }
 
-        Vector3d mid = (p + r) / 2.0;
-        Vector3d d = r - p;
+    Vector6d mz = Vector6d::Zero();
+    Vector3d sum = Vector3d::Zero();
+    double xy, yz, xz, ypz, xpz, xpy;
+    xy = yz = xz = ypz = xpz = xpy = 0.0;
+
+    for (const auto& pair : pairs)
+    {
+        const Vector3d& mid = pair.first;
+        const Vector3d& d = pair.second;
 
         double x = mid.x(), y = mid.y(), z = mid.z();
 
@@ -409,7 +384,7 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
     }
 
     Matrix6d mm = Matrix6d::Zero();
-    mm(0, 0) = mm(1, 1) = mm(2, 2) = pairs;
+    mm(0, 0) = mm(1, 1) = mm(2, 2) = pairs.size();
     mm(3, 3) = ypz;
     mm(4, 4) = xpy;
     mm(5, 5) = xpz;
@@ -429,27 +404,17 @@ void GraphSLAM::eulerCovariance(KDTreePtr tree, SLAMScanPtr scan, Matrix6d& outM
 
     double ss = 0.0;
 
-    for (size_t i = 0; i < n; i++)
+    for (const auto& pair : pairs)
     {
-        if (results[i] == nullptr)
-        {
-            continue;
-        }
-
-        Vector3d p = scan->point(i).cast<double>();
-        Vector3d r = results[i]->cast<double>();
-
-        Vector3d mid = (p + r) / 2.0;
-        Vector3d delta = r - p;
+        const Vector3d& mid = pair.first;
+        const Vector3d& delta = pair.second;
 
         ss += pow(delta.x() + (d(0) - mid.y() * d(4) + mid.z() * d(5)), 2.0)
               + pow(delta.y() + (d(1) - mid.z() * d(3) + mid.x() * d(4)), 2.0)
               + pow(delta.z() + (d(2) + mid.y() * d(3) - mid.x() * d(5)), 2.0);
     }
 
-    delete[] results;
-
-    ss = ss / (2.0 * pairs - 3.0);
+    ss = ss / (2.0 * pairs.size() - 3.0);
 
     ss = 1.0 / ss;
 
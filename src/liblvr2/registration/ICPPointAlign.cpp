@@ -33,6 +33,7 @@
  */
 #include "lvr2/registration/ICPPointAlign.hpp"
 #include "lvr2/registration/EigenSVDPointAlign.hpp"
+#include "lvr2/registration/TreeUtils.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
 #include <iomanip>
@@ -49,10 +50,12 @@ ICPPointAlign::ICPPointAlign(SLAMScanPtr model, SLAMScanPtr data) :
     // Init default values
     m_maxDistanceMatch  = 25;
     m_maxIterations     = 50;
+    m_maxLeafSize       = 20;
     m_epsilon           = 0.00001;
     m_verbose           = false;
-
-    m_searchTree = KDTree::create(model, m_maxLeafSize);
+    m_levels            = 1;
+    m_levelVoxelSize    = 10;
+    m_pointToPlane      = false;
 }
 
 Transformd ICPPointAlign::match()
@@ -64,18 +67,140 @@ Transformd ICPPointAlign::match()
 
     auto start_time = chrono::steady_clock::now();
 
+    int levels = max(m_levels, 1);
+
+    if (!m_modelPyramid || m_modelPyramid->scan() != m_modelCloud
+        || !m_modelPyramid->matches(levels, m_levelVoxelSize, m_maxDistanceMatch, m_pointToPlane, m_maxLeafSize))
+    {
+        m_modelPyramid = make_shared<ICPPyramid>(m_modelCloud, levels, m_levelVoxelSize, m_maxDistanceMatch, m_pointToPlane, m_maxLeafSize);
+    }
+    else
+    {
+        m_modelPyramid->update();
+    }
+
+    // The data Points of the coarse levels. Level 0 uses the data Scan itself
+    vector<const KDTree::Point*> dataPoints(levels, nullptr);
+    vector<size_t> dataSizes(levels, 0);
+    Transformd dataPose = Matrix4d::Identity();
+
+    vector<vector<Vector3f>> dataLevels(levels);
+    if (levels > 1)
+    {
+        if (m_dataPyramid && m_dataPyramid->scan() == m_dataCloud
+            && m_dataPyramid->matches(levels, m_levelVoxelSize, m_maxDistanceMatch, m_pointToPlane, m_maxLeafSize))
+        {
+            m_dataPyramid->update();
+            dataPose = m_dataPyramid->pose();
+            for (int level = 1; level < levels; level++)
+            {
+                const ICPPyramid::Level& dataLevel = m_dataPyramid->level(level);
+                if (dataLevel.tiles.size() == 1)
+                {
+                    dataPoints[level] = dataLevel.tiles.begin()->second.points.get();
+                }
+                else
+                {
+                    for (const auto& tile : dataLevel.tiles)
+                    {
+                        const ICPPyramid::Block& block = tile.second;
+                        dataLevels[level].insert(dataLevels[level].end(), block.points.get(), block.points.get() + block.numPoints);
+                    }
+                    dataPoints[level] = dataLevels[level].data();
+                }
+                dataSizes[level] = dataLevel.numPoints;
+            }
+        }
+        else
+        {
+            // only the reduced Points are needed, in global coordinates
+            vector<Vector3f> points(m_dataCloud->numPoints());
+
+            #pragma omp parallel for schedule(static)
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                points[i] = m_dataCloud->point(i).cast<float>();
+            }
+
+            double voxelSize = m_levelVoxelSize;
+            for (int level = 1; level < levels; level++)
+            {
+                // a leaf size of 1 keeps at most one Point per voxel
+                points.resize(octreeReduce(points.data(), points.size(), voxelSize, 1));
+                voxelSize *= 2;
+
+                dataLevels[level] = points;
+                dataPoints[level] = dataLevels[level].data();
+                dataSizes[level] = dataLevels[level].size();
+            }
+        }
+    }
+
+    double ret = 0.0;
+    int iteration = 0;
+    Transformd delta = Matrix4d::Identity();
+    Transformd modelPose = m_modelPyramid->pose();
+
+    for (int level = levels - 1; level >= 0; level--)
+    {
+        if (m_verbose && levels > 1)
+        {
+            cout << timestamp << "ICP level " << level << " with " << (level == 0 ? m_dataCloud->numPoints() : dataSizes[level]) << " points." << endl;
+        }
+
+        ret = matchLevel(m_modelPyramid->level(level), modelPose, dataPoints[level], dataSizes[level], dataPose, delta, iteration);
+    }
+
+    auto duration = chrono::steady_clock::now() - start_time;
+    cout << setw(6) << (int)(duration.count() / 1e6) << " ms, ";
+    cout << "Error: " << fixed << setprecision(3) << setw(7) << ret;
+    if (iteration < m_maxIterations)
+    {
+        cout << " after " << iteration << " Iterations";
+    }
+    cout << endl;
+    if (m_verbose)
+    {
+        cout << "Result: " << endl << m_dataCloud->deltaPose() << endl;
+    }
+
+    return delta;
+}
+
+double ICPPointAlign::matchLevel(
+    const ICPPyramid::Level& model,
+    const Transformd& modelPose,
+    const KDTree::Point* data,
+    size_t numData,
+    const Transformd& dataPose,
+    Transformd& delta,
+    int& iteration)
+{
     double ret = 0.0, prev_ret = 0.0, prev_prev_ret = 0.0;
     EigenSVDPointAlign<double> align;
-    int iteration = 0;
 
-    Vector3d centroid_m = Vector3d::Zero();
-    Vector3d centroid_d = Vector3d::Zero();
-    Transformd transform = Matrix4d::Identity();
-    Transformd delta = Matrix4d::Identity();
+    size_t numPoints = data ? numData : m_dataCloud->numPoints();
 
-    size_t numPoints = m_dataCloud->numPoints();
+    // the model Points and normals are in the coordinate system of the pyramid
+    Transformd toModel = modelPose.inverse();
+    Matrix3d toModelRotation = toModel.block<3, 3>(0, 0);
+    Vector3d toModelTranslation = toModel.block<3, 1>(0, 3);
+    Matrix3d modelRotation = modelPose.block<3, 3>(0, 0);
+    Vector3d modelTranslation = modelPose.block<3, 1>(0, 3);
 
-    KDTree::Neighbor* neighbors = new KDTree::Neighbor[numPoints];
+    // the neighbors of the last iteration are the starting points of the next search
+    vector<KDTree::Neighbor> neighbors(numPoints, nullptr);
+
+    Matrix3d dataRotation;
+    Vector3d dataTranslation;
+    auto dataPoint = [&](size_t i) -> Vector3d
+    {
+        return data ? Vector3d(dataRotation * data[i].cast<double>() + dataTranslation) : m_dataCloud->point(i);
+    };
+    auto hasNormal = [&](KDTree::Neighbor neighbor)
+    {
+        return !m_pointToPlane || model.normal(neighbor).squaredNorm() > 0;
+    };
 
     for (iteration = 0; iteration < m_maxIterations; iteration++)
     {
@@ -83,16 +208,131 @@ Transformd ICPPointAlign::match()
         prev_prev_ret = prev_ret;
         prev_ret = ret;
 
+        Transformd current = delta * dataPose;
+        dataRotation = current.block<3, 3>(0, 0);
+        dataTranslation = current.block<3, 1>(0, 3);
+
         // Get point pairs
-        size_t pairs = KDTree::nearestNeighbors(m_searchTree, m_dataCloud, neighbors, m_maxDistanceMatch, centroid_m, centroid_d);
+        size_t pairs = 0;
+        double mx = 0.0, my = 0.0, mz = 0.0, dx = 0.0, dy = 0.0, dz = 0.0;
+
+        #pragma omp parallel for reduction(+:pairs,mx,my,mz,dx,dy,dz) schedule(dynamic,8)
+        for (size_t i = 0; i < numPoints; i++)
+        {
+            Vector3d point = dataPoint(i);
+            Vector3d query = toModelRotation * point + toModelTranslation;
+            double distance;
+            if (model.nearestNeighbor(query, neighbors[i], distance) && hasNormal(neighbors[i]))
+            {
+                Vector3d m = modelRotation * neighbors[i]->cast<double>() + modelTranslation;
+                mx += m.x();
+                my += m.y();
+                mz += m.z();
+                dx += point.x();
+                dy += point.y();
+                dz += point.z();
+                pairs++;
+            }
+        }
+
+        // not enough pairs to determine a transformation
+        if (pairs < (m_pointToPlane ? 6 : 3))
+        {
+            break;
+        }
+
+        Vector3d centroid_m = Vector3d(mx, my, mz) / pairs;
+        Vector3d centroid_d = Vector3d(dx, dy, dz) / pairs;
+
+        // Sum up the pairs in fixed blocks, so the result doesn't depend on the number of threads.
+        // Point-to-Point: H = sum of d * m^T relative to the centroids.
+        // Point-to-Plane: linearized error with x = (rotation angles, translation), centered
+        // at the data centroid
+        const size_t blockSize = 1 << 14;
+        size_t blocks = (numPoints + blockSize - 1) / blockSize;
+        vector<Matrix3d> blockH(blocks, Matrix3d::Zero());
+        vector<Matrix6d> blockATA(blocks, Matrix6d::Zero());
+        vector<Vector6d> blockATb(blocks, Vector6d::Zero());
+        vector<double> blockError(blocks, 0.0);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t b = 0; b < blocks; b++)
+        {
+            size_t end = min(numPoints, (b + 1) * blockSize);
+            for (size_t i = b * blockSize; i < end; i++)
+            {
+                if (neighbors[i] == nullptr || !hasNormal(neighbors[i]))
+                {
+                    continue;
+                }
+
+                Vector3d d = dataPoint(i);
+                Vector3d m = modelRotation * neighbors[i]->cast<double>() + modelTranslation;
+
+                if (m_pointToPlane)
+                {
+                    Vector3d n = modelRotation * model.normal(neighbors[i]).cast<double>();
+                    Vector3d p = d - centroid_d;
+
+                    double distance = (d - m).dot(n);
+
+                    Vector6d a;
+                    a << p.cross(n), n;
+
+                    blockATA[b] += a * a.transpose();
+                    blockATb[b] -= a * distance;
+                    blockError[b] += distance * distance;
+                }
+                else
+                {
+                    m -= centroid_m;
+                    d -= centroid_d;
+
+                    blockH[b] += d * m.transpose();
+                    blockError[b] += (m - d).squaredNorm();
+                }
+            }
+        }
+
+        Matrix3d H = Matrix3d::Zero();
+        Matrix6d ATA = Matrix6d::Zero();
+        Vector6d ATb = Vector6d::Zero();
+        double error = 0.0;
+        for (size_t b = 0; b < blocks; b++)
+        {
+            H += blockH[b];
+            ATA += blockATA[b];
+            ATb += blockATb[b];
+            error += blockError[b];
+        }
+
+        ret = sqrt(error / pairs);
 
         // Get transformation
-        transform = Transformd::Identity();
-        ret = align.alignPoints(m_dataCloud, neighbors, centroid_m, centroid_d, transform);
+        Transformd transform = Transformd::Identity();
+        if (m_pointToPlane)
+        {
+            Vector6d x = ATA.ldlt().solve(ATb);
+
+            Vector3d omega = x.block<3, 1>(0, 0);
+            double angle = omega.norm();
+            Matrix3d R = Matrix3d::Identity();
+            if (angle > 0.0)
+            {
+                R = Eigen::AngleAxisd(angle, omega / angle).toRotationMatrix();
+            }
+
+            transform.block<3, 3>(0, 0) = R;
+            transform.block<3, 1>(0, 3) = centroid_d + x.block<3, 1>(3, 0) - R * centroid_d;
+        }
+        else
+        {
+            align.alignPoints(H, centroid_m, centroid_d, transform);
+        }
 
         // Apply transformation
         m_dataCloud->transform(transform, false);
-        delta = delta * transform;
+        delta = transform * delta;
 
         if (m_verbose)
         {
@@ -106,22 +346,7 @@ Transformd ICPPointAlign::match()
         }
     }
 
-    delete[] neighbors;
-
-    auto duration = chrono::steady_clock::now() - start_time;
-    cout << setw(6) << (int)(duration.count() / 1e6) << " ms, ";
-    cout << "Error: " << fixed << setprecision(3) << setw(7) << ret;
-    if (iteration < m_maxIterations)
-    {
-        cout << " after " << iteration << " Iterations";
-    }
-    cout << endl;
-    if (m_verbose)
-    {
-        cout << "Result: " << endl << m_dataCloud->deltaPose() << endl;
-    }
-
-    return delta;
+    return ret;
 }
 
 void ICPPointAlign::setMaxMatchDistance(double d)
@@ -148,6 +373,27 @@ void ICPPointAlign::setVerbose(bool verbose)
     m_verbose = verbose;
 }
 
+void ICPPointAlign::setLevels(int levels, double voxelSize)
+{
+    m_levels = levels;
+    m_levelVoxelSize = voxelSize;
+}
+
+void ICPPointAlign::setPointToPlane(bool pointToPlane)
+{
+    m_pointToPlane = pointToPlane;
+}
+
+void ICPPointAlign::setModelPyramid(ICPPyramidPtr pyramid)
+{
+    m_modelPyramid = pyramid;
+}
+
+void ICPPointAlign::setDataPyramid(ICPPyramidPtr pyramid)
+{
+    m_dataPyramid = pyramid;
+}
+
 double ICPPointAlign::getMaxMatchDistance() const
 {
     return m_maxDistanceMatch;
@@ -173,4 +419,19 @@ bool ICPPointAlign::getVerbose() const
     return m_verbose;
 }
 
+int ICPPointAlign::getLevels() const
+{
+    return m_levels;
+}
+
+double ICPPointAlign::getLevelVoxelSize() const
+{
+    return m_levelVoxelSize;
+}
+
+bool ICPPointAlign::getPointToPlane() const
+{
+    return m_pointToPlane;
+}
+
 } /* namespace lvr2 */
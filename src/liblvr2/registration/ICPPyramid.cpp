@@ -0,0 +1,403 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/**
+ * ICPPyramid.cpp
+ */
+#include "lvr2/registration/ICPPyramid.hpp"
+#include "lvr2/registration/Metascan.hpp"
+#include "lvr2/registration/TreeUtils.hpp"
+
+#include <Eigen/Eigenvalues>
+#include <map>
+#include <unordered_set>
+
+using namespace std;
+using namespace Eigen;
+
+namespace lvr2
+{
+
+/// The edge length of the tiles of a Metascan in multiples of the maximum distance of a level
+constexpr double TILE_SCALE = 32.0;
+
+ICPPyramid::ICPPyramid(SLAMScanPtr scan, int levels, double voxelSize, double maxDistance, bool pointToPlane, int maxLeafSize)
+    : m_scan(scan), m_levels(max(levels, 1)),
+      m_voxelSize(voxelSize), m_maxDistance(maxDistance), m_pointToPlane(pointToPlane), m_maxLeafSize(maxLeafSize)
+{
+    m_local = dynamic_cast<Metascan*>(scan.get()) == nullptr;
+
+    for (size_t index = 0; index < m_levels.size(); index++)
+    {
+        Level& level = m_levels[index];
+        level.maxDistance = maxDistance;
+        if (index > 0)
+        {
+            // the Points of coarse levels are up to a voxel apart
+            level.maxDistance = max(maxDistance, 2 * voxelSize);
+            voxelSize *= 2;
+        }
+        if (!m_local)
+        {
+            level.tileSize = TILE_SCALE * level.maxDistance;
+        }
+    }
+
+    build();
+}
+
+void ICPPyramid::build()
+{
+    for (Level& level : m_levels)
+    {
+        level.tiles.clear();
+        level.numPoints = 0;
+    }
+    m_poses.clear();
+
+    vector<Vector3f> points;
+    if (m_local)
+    {
+        points.resize(m_scan->numPoints());
+
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            points[i] = m_scan->rawPoint(i);
+        }
+    }
+    else
+    {
+        addGlobalPoints(0, points);
+    }
+
+    addPoints(points);
+}
+
+void ICPPyramid::update()
+{
+    if (m_local)
+    {
+        return;
+    }
+
+    const vector<SLAMScanPtr>& scans = static_cast<Metascan*>(m_scan.get())->scans();
+
+    bool moved = scans.size() < m_poses.size();
+    for (size_t i = 0; i < m_poses.size() && !moved; i++)
+    {
+        moved = scans[i]->pose() != m_poses[i];
+    }
+
+    if (moved)
+    {
+        build();
+    }
+    else if (scans.size() > m_poses.size())
+    {
+        vector<Vector3f> points;
+        addGlobalPoints(m_poses.size(), points);
+        addPoints(points);
+    }
+}
+
+void ICPPyramid::addGlobalPoints(size_t first, vector<Vector3f>& points)
+{
+    const vector<SLAMScanPtr>& scans = static_cast<Metascan*>(m_scan.get())->scans();
+
+    for (size_t s = first; s < scans.size(); s++)
+    {
+        const SLAMScanPtr& scan = scans[s];
+        Transformd pose = scan->pose();
+        m_poses.push_back(pose);
+
+        size_t offset = points.size();
+        points.resize(offset + scan->numPoints());
+
+        Matrix3f rotation = pose.block<3, 3>(0, 0).cast<float>();
+        Vector3f translation = pose.block<3, 1>(0, 3).cast<float>();
+
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < scan->numPoints(); i++)
+        {
+            points[offset + i] = rotation * scan->rawPoint(i) + translation;
+        }
+    }
+}
+
+void ICPPyramid::addPoints(vector<Vector3f>& points)
+{
+    double voxelSize = m_voxelSize;
+
+    for (size_t index = 0; index < m_levels.size() && !points.empty(); index++)
+    {
+        Level& level = m_levels[index];
+
+        if (index > 0)
+        {
+            // a leaf size of 1 keeps at most one Point per voxel
+            points.resize(octreeReduce(points.data(), points.size(), voxelSize, 1));
+        }
+
+        // the new Points of every affected tile
+        map<size_t, vector<Vector3f>> added;
+        for (const Vector3f& point : points)
+        {
+            added[Level::tileIndex(level.tileCoordinates(point))].push_back(point);
+        }
+
+        vector<pair<Block*, vector<Vector3f>*>> affected;
+        unordered_set<size_t> changed;
+        for (auto& entry : added)
+        {
+            affected.emplace_back(&level.tiles[entry.first], &entry.second);
+            changed.insert(entry.first);
+        }
+
+        // the unchanged tiles next to a changed one, whose Points may have new neighbors
+        unordered_set<size_t> adjacent;
+        if (m_pointToPlane && level.tileSize > 0)
+        {
+            for (auto& entry : added)
+            {
+                Vector3<int> tile = level.tileCoordinates(entry.second.front());
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        for (int dz = -1; dz <= 1; dz++)
+                        {
+                            size_t neighbor = Level::tileIndex(tile + Vector3<int>(dx, dy, dz));
+                            if (changed.count(neighbor) == 0 && level.tiles.count(neighbor) > 0)
+                            {
+                                adjacent.insert(neighbor);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // a single tile uses the threads within KDTree::create instead
+        #pragma omp parallel for schedule(dynamic) if(affected.size() > 1)
+        for (size_t i = 0; i < affected.size(); i++)
+        {
+            Block& block = *affected[i].first;
+            vector<Vector3f>& tilePoints = *affected[i].second;
+
+            tilePoints.insert(tilePoints.end(), block.points.get(), block.points.get() + block.numPoints);
+            if (index > 0 && block.numPoints > 0)
+            {
+                // keep one Point per voxel where Scans overlap
+                tilePoints.resize(octreeReduce(tilePoints.data(), tilePoints.size(), voxelSize, 1));
+            }
+
+            block.numPoints = tilePoints.size();
+            block.points = boost::shared_array<KDTree::Point>(new KDTree::Point[block.numPoints]);
+            copy(tilePoints.begin(), tilePoints.end(), block.points.get());
+
+            block.tree = KDTree::create(block.points, block.numPoints, m_maxLeafSize);
+            block.normals.clear();
+        }
+
+        if (m_pointToPlane)
+        {
+            // neighborhoods reach across tile borders, so the normals are calculated once
+            // the trees of all changed tiles are built
+            for (auto& entry : affected)
+            {
+                calculateNormals(level, *entry.first, nullptr);
+            }
+            for (size_t tile : adjacent)
+            {
+                calculateNormals(level, level.tiles[tile], &changed);
+            }
+        }
+
+        level.numPoints = 0;
+        for (auto& tile : level.tiles)
+        {
+            level.numPoints += tile.second.numPoints;
+        }
+
+        if (index > 0)
+        {
+            voxelSize *= 2;
+        }
+    }
+}
+
+void ICPPyramid::calculateNormals(const Level& level, Block& block, const unordered_set<size_t>* changed) const
+{
+    // The normal of a Point is the direction in which its neighbors vary the least
+    const size_t k = 10;
+    block.normals.resize(block.numPoints, Vector3f::Zero());
+
+    #pragma omp parallel for schedule(dynamic,64)
+    for (size_t i = 0; i < block.numPoints; i++)
+    {
+        const KDTree::Point& point = block.points[i];
+        if (changed != nullptr)
+        {
+            bool near = false;
+            level.forNeighborTiles(level.tileCoordinates(point), point, level.maxDistance, [&](const Vector3<int>& tile)
+            {
+                near = near || changed->count(Level::tileIndex(tile)) > 0;
+            });
+            if (!near)
+            {
+                continue;
+            }
+        }
+
+        KDTree::Neighbor neighbors[k];
+        size_t found = level.kNearestNeighbors(point, k, neighbors);
+        if (found < 3)
+        {
+            block.normals[i] = Vector3f::Zero();
+            continue;
+        }
+
+        Vector3d mean = Vector3d::Zero();
+        for (size_t j = 0; j < found; j++)
+        {
+            mean += neighbors[j]->cast<double>();
+        }
+        mean /= found;
+
+        Matrix3d covariance = Matrix3d::Zero();
+        for (size_t j = 0; j < found; j++)
+        {
+            Vector3d d = neighbors[j]->cast<double>() - mean;
+            covariance += d * d.transpose();
+        }
+
+        // eigenvalues are sorted in increasing order
+        SelfAdjointEigenSolver<Matrix3d> solver(covariance);
+        block.normals[i] = solver.eigenvectors().col(0).cast<float>();
+    }
+}
+
+size_t ICPPyramid::Level::kNearestNeighbors(const KDTree::Point& point, size_t k, KDTree::Neighbor* neighbors) const
+{
+    if (tileSize == 0)
+    {
+        auto it = tiles.find(tileIndex(Vector3<int>::Zero()));
+        return it == tiles.end() ? 0 : it->second.tree->kNearestNeighbors(point, k, neighbors, maxDistance);
+    }
+
+    // the candidates of all tiles by distance. Once there are k, only closer tiles are searched
+    vector<pair<double, KDTree::Neighbor>> candidates;
+    candidates.reserve(2 * k);
+    double distance = maxDistance;
+
+    auto visitTile = [&](const Vector3<int>& tile)
+    {
+        auto it = tiles.find(tileIndex(tile));
+        if (it == tiles.end())
+        {
+            return;
+        }
+
+        size_t found = it->second.tree->kNearestNeighbors(point, k, neighbors, distance);
+        for (size_t i = 0; i < found; i++)
+        {
+            candidates.emplace_back((point - *neighbors[i]).norm(), neighbors[i]);
+        }
+
+        sort(candidates.begin(), candidates.end());
+        if (candidates.size() >= k)
+        {
+            candidates.resize(k);
+            distance = candidates.back().first;
+        }
+    };
+
+    Vector3<int> center = tileCoordinates(point);
+    visitTile(center);
+    forNeighborTiles(center, point, distance, visitTile);
+
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        neighbors[i] = candidates[i].second;
+    }
+    return candidates.size();
+}
+
+const Vector3f& ICPPyramid::Level::normal(KDTree::Neighbor neighbor) const
+{
+    auto it = tiles.find(tileIndex(tileCoordinates(*neighbor)));
+    if (it != tiles.end())
+    {
+        const Block& block = it->second;
+        if (neighbor >= block.points.get() && neighbor < block.points.get() + block.numPoints)
+        {
+            return block.normals[neighbor - block.points.get()];
+        }
+    }
+
+    // same as a Point without enough neighbors
+    static const Vector3f none = Vector3f::Zero();
+    return none;
+}
+
+Transformd ICPPyramid::pose() const
+{
+    if (m_local)
+    {
+        return m_scan->pose();
+    }
+    return Transformd::Identity();
+}
+
+SLAMScanPtr ICPPyramid::scan() const
+{
+    return m_scan;
+}
+
+int ICPPyramid::levels() const
+{
+    return m_levels.size();
+}
+
+const ICPPyramid::Level& ICPPyramid::level(int index) const
+{
+    return m_levels[index];
+}
+
+bool ICPPyramid::matches(int levels, double voxelSize, double maxDistance, bool pointToPlane, int maxLeafSize) const
+{
+    return (int)m_levels.size() == max(levels, 1)
+           && m_voxelSize == voxelSize
+           && m_maxDistance == maxDistance
+           && m_pointToPlane == pointToPlane
+           && m_maxLeafSize == maxLeafSize;
+}
+
+} /* namespace lvr2 */
@@ -66,6 +66,27 @@ protected:
         }
     }
 
+    virtual void knnInternal(const Point& point, size_t k, NeighborHeap& heap, double& maxDist) const override
+    {
+        double val = point(this->axis);
+        if (val < this->split)
+        {
+            this->lesser->knnInternal(point, k, heap, maxDist);
+            if (val + maxDist >= this->split)
+            {
+                this->greater->knnInternal(point, k, heap, maxDist);
+            }
+        }
+        else
+        {
+            this->greater->knnInternal(point, k, heap, maxDist);
+            if (val - maxDist <= this->split)
+            {
+                this->lesser->knnInternal(point, k, heap, maxDist);
+            }
+        }
+    }
+
 private:
     int axis;
     double split;
@@ -101,6 +122,36 @@ protected:
         }
     }
 
+    virtual void knnInternal(const Point& point, size_t k, NeighborHeap& heap, double& maxDist) const override
+    {
+        // maxDist is the search radius until k neighbors are found, the distance of the k-th neighbor afterwards
+        double maxDistSq = maxDist * maxDist;
+        bool changed = false;
+        for (int i = 0; i < this->count; i++)
+        {
+            double dist = (point - this->points[i]).squaredNorm();
+            if (dist < maxDistSq)
+            {
+                heap.emplace_back(dist, &this->points[i]);
+                std::push_heap(heap.begin(), heap.end());
+                if (heap.size() > k)
+                {
+                    std::pop_heap(heap.begin(), heap.end());
+                    heap.pop_back();
+                }
+                if (heap.size() == k)
+                {
+                    maxDistSq = heap.front().first;
+                    changed = true;
+                }
+            }
+        }
+        if (changed)
+        {
+            maxDist = sqrt(maxDistSq);
+        }
+    }
+
 private:
     Point* points;
     int count;
@@ -152,8 +203,6 @@ KDTreePtr create_recursive(KDTree::Point* points, int n, int maxLeafSize)
 
 KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
 {
-    KDTreePtr ret;
-
     size_t n = scan->numPoints();
     auto points = boost::shared_array<Point>(new Point[n]);
 
@@ -163,6 +212,27 @@ KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
         points[i] = scan->point(i).cast<PointT>();
     }
 
+    return create(points, n, maxLeafSize);
+}
+
+KDTreePtr KDTree::createLocal(SLAMScanPtr scan, int maxLeafSize)
+{
+    size_t n = scan->numPoints();
+    auto points = boost::shared_array<Point>(new Point[n]);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
+    {
+        points[i] = scan->rawPoint(i).cast<PointT>();
+    }
+
+    return create(points, n, maxLeafSize);
+}
+
+KDTreePtr KDTree::create(boost::shared_array<Point> points, size_t n, int maxLeafSize)
+{
+    KDTreePtr ret;
+
     #pragma omp parallel // allows "pragma omp task"
     #pragma omp single // only execute every task once
     ret = create_recursive(points.get(), n, maxLeafSize);
@@ -172,7 +242,6 @@ KDTreePtr KDTree::create(SLAMScanPtr scan, int maxLeafSize)
     return ret;
 }
 
-
 size_t KDTree::nearestNeighbors(KDTreePtr tree, SLAMScanPtr scan, KDTree::Neighbor* neighbors, double maxDistance, Vector3d& centroid_m, Vector3d& centroid_d)
 {
     size_t found = KDTree::nearestNeighbors(tree, scan, neighbors, maxDistance);
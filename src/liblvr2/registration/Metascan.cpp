@@ -75,4 +75,9 @@ void Metascan::addScan(SLAMScanPtr scan)
     m_deltaPose = scan->deltaPose();
 }
 
+const std::vector<SLAMScanPtr>& Metascan::scans() const
+{
+    return m_scans;
+}
+
 } /* namespace lvr2 */
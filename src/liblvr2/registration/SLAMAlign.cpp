@@ -34,9 +34,12 @@
 
 #include "lvr2/registration/SLAMAlign.hpp"
 #include "lvr2/registration/ICPPointAlign.hpp"
+#include "lvr2/registration/ICPPyramid.hpp"
 #include "lvr2/registration/Metascan.hpp"
 
+#include <future>
 #include <iomanip>
+#include <map>
 
 using namespace std;
 
@@ -49,9 +52,11 @@ SLAMAlign::SLAMAlign(const SLAMOptions& options, const vector<SLAMScanPtr>& scan
     // The first Scan is never changed
     m_alreadyMatched = 1;
 
-    for (auto& scan : m_scans)
+    // The Scans are independent, and the serial parts of octreeReduce would leave most threads idle
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < m_scans.size(); i++)
     {
-        reduceScan(scan);
+        reduceScan(m_scans[i]);
     }
 }
 
@@ -120,6 +125,7 @@ void SLAMAlign::reduceScan(const SLAMScanPtr& scan)
 
         if (m_options.verbose)
         {
+            #pragma omp critical
             cout << "Removed " << (prev - scan->numPoints()) << " / " << prev << " Points -> " << scan->numPoints() << " left" << endl;
         }
     }
@@ -146,6 +152,59 @@ void SLAMAlign::match()
 
     string scan_number_string = to_string(m_scans.size() - 1);
 
+    // Without a Metascan, every Scan is the data of one ICP and the model of the next one. The
+    // ICPs themselves depend on each other's results, but the ICPPyramid of a Scan only depends
+    // on its untransformed Points, so the pyramids of the next Scans are built on worker threads
+    // while the current Scan is matched.
+    const size_t lookahead = 2;
+    map<size_t, future<ICPPyramidPtr>> pending;
+    auto requestPyramid = [&](size_t index)
+    {
+        if (m_options.metascan || index >= m_scans.size() || pending.count(index))
+        {
+            return;
+        }
+        SLAMScanPtr scan = m_scans[index];
+        SLAMOptions options = m_options;
+        pending[index] = async(launch::async, [scan, options]()
+        {
+            return make_shared<ICPPyramid>(scan, options.icpLevels, options.icpVoxelSize, options.icpMaxDistance,
+                                           options.icpPointToPlane, options.maxLeafSize);
+        });
+    };
+    auto takePyramid = [&](size_t index) -> ICPPyramidPtr
+    {
+        requestPyramid(index);
+        auto it = pending.find(index);
+        if (it == pending.end())
+        {
+            return nullptr;
+        }
+        ICPPyramidPtr pyramid = it->second.get();
+        pending.erase(it);
+        return pyramid;
+    };
+
+    for (size_t next = m_alreadyMatched; next <= m_alreadyMatched + lookahead; next++)
+    {
+        requestPyramid(next);
+    }
+
+    // The model pyramid is kept between calls to match(). With a Metascan, it is a single
+    // pyramid that inserts every newly matched Scan incrementally (see ICPPyramid::update)
+    if (m_alreadyMatched < m_scans.size() && !m_lastPyramid)
+    {
+        if (m_options.metascan)
+        {
+            m_lastPyramid = make_shared<ICPPyramid>(m_metascan, m_options.icpLevels, m_options.icpVoxelSize, m_options.icpMaxDistance,
+                                                    m_options.icpPointToPlane, m_options.maxLeafSize);
+        }
+        else
+        {
+            m_lastPyramid = takePyramid(m_alreadyMatched - 1);
+        }
+    }
+
     // only match everything after m_alreadyMatched
     for (; m_alreadyMatched < m_scans.size(); m_alreadyMatched++)
     {
@@ -161,6 +220,12 @@ void SLAMAlign::match()
             cout << setw(scan_number_string.length()) << i << "/" << scan_number_string << ": " << flush;
         }
 
+        for (size_t next = i; next <= i + lookahead; next++)
+        {
+            requestPyramid(next);
+        }
+        ICPPyramidPtr dataPyramid = takePyramid(i);
+
         SLAMScanPtr prev = m_options.metascan ? m_metascan : m_scans[i - 1];
         const SLAMScanPtr& cur = m_scans[i];
 
@@ -182,9 +247,18 @@ void SLAMAlign::match()
         icp.setMaxLeafSize(m_options.maxLeafSize);
         icp.setEpsilon(m_options.epsilon);
         icp.setVerbose(m_options.verbose);
+        icp.setLevels(m_options.icpLevels, m_options.icpVoxelSize);
+        icp.setPointToPlane(m_options.icpPointToPlane);
+        icp.setModelPyramid(m_lastPyramid);
+        icp.setDataPyramid(dataPyramid);
 
         icp.match();
 
+        if (!m_options.metascan)
+        {
+            m_lastPyramid = dataPyramid;
+        }
+
         if (m_options.createFrames)
         {
             applyTransform(cur, Matrix4d::Identity());
@@ -231,7 +305,7 @@ void SLAMAlign::checkLoopClose(size_t last)
     size_t first = 0;
 
     vector<size_t> others;
-    if (findCloseScans(m_scans, last, m_options, others))
+    if (m_graph.findCloseScans(m_scans, last, others))
     {
         hasLoop = true;
         first = others[0];
@@ -284,6 +358,8 @@ void SLAMAlign::loopClose(size_t first, size_t last)
     icp.setMaxLeafSize(m_options.maxLeafSize);
     icp.setEpsilon(m_options.slamEpsilon);
     icp.setVerbose(m_options.verbose);
+    icp.setLevels(m_options.icpLevels, m_options.icpVoxelSize);
+    icp.setPointToPlane(m_options.icpPointToPlane);
 
     Matrix4d transform = icp.match();
 
@@ -0,0 +1,218 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Main.cpp
+ *
+ * Compares build time and memory consumption of the flat cell storage
+ * used by HashGrid (CellMap + BoxArena) against an unordered_map with
+ * one heap allocated box per cell. Both variants replay the lookup
+ * pattern of HashGrid::addLatticePoint on a synthetic point cloud. Each
+ * variant runs in its own process to get an unbiased peak memory value.
+ *
+ * Usage: lvr2_grid_benchmark [numPoints] [voxelsize]
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/HalfEdgeMesh.hpp"
+#include "lvr2/reconstruction/FastReconstruction.hpp"
+#include "lvr2/reconstruction/FastReconstructionTables.hpp"
+#include "lvr2/io/Timestamp.hpp"
+
+using namespace lvr2;
+
+using Vec = BaseVector<float>;
+using Box = FastBox<Vec>;
+
+/**
+ * @brief Creates points on a noisy sphere with radius 1
+ */
+std::vector<Vec> createPoints(size_t n)
+{
+    std::mt19937 gen(42);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<Vec> points(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        Vec p(normal(gen), normal(gen), normal(gen));
+        points[i] = p / p.length() * (1.0f + 0.005f * normal(gen));
+    }
+    return points;
+}
+
+/**
+ * @brief Replays the map accesses of HashGrid::addLatticePoint
+ */
+template<typename MapT, typename CreateFunc>
+size_t buildCells(const std::vector<Vec>& points, float voxelsize, MapT& cells, CreateFunc create)
+{
+    const int maxIndex = static_cast<int>(std::ceil((2.0f + 5 * voxelsize) / voxelsize));
+    auto hash = [&](int i, int j, int k)
+    {
+        return size_t(i) * maxIndex * maxIndex + size_t(j) * maxIndex + k;
+    };
+
+    uint qpIndex = 0;
+    for(auto& p : points)
+    {
+        int x = static_cast<int>((p.x + 1.0f) / voxelsize + 0.5f) + 2;
+        int y = static_cast<int>((p.y + 1.0f) / voxelsize + 0.5f) + 2;
+        int z = static_cast<int>((p.z + 1.0f) / voxelsize + 0.5f) + 2;
+
+        for(int dx = -1; dx <= 1; dx++)
+        for(int dy = -1; dy <= 1; dy++)
+        for(int dz = -1; dz <= 1; dz++)
+        {
+            size_t h = hash(x + dx, y + dy, z + dz);
+            if(cells.find(h) != cells.end())
+            {
+                continue;
+            }
+
+            Box* box = create(Vec((x + dx) * voxelsize, (y + dy) * voxelsize, (z + dz) * voxelsize));
+
+            // Shared query point lookup
+            for(int corner = 0; corner < 8; corner++)
+            {
+                uint index = Box::INVALID_INDEX;
+                for(int n = 0; n < 7 && index == Box::INVALID_INDEX; n++)
+                {
+                    const int* entry = &shared_vertex_table[corner][n * 4];
+                    auto it = cells.find(hash(x + dx + entry[0], y + dy + entry[1], z + dz + entry[2]));
+                    if(it != cells.end())
+                    {
+                        index = it->second->getVertex(entry[3]);
+                    }
+                }
+                box->setVertex(corner, index != Box::INVALID_INDEX ? index : qpIndex++);
+            }
+
+            // Neighbor linking
+            int neighbor = 0;
+            for(int a = -1; a <= 1; a++)
+            for(int b = -1; b <= 1; b++)
+            for(int c = -1; c <= 1; c++)
+            {
+                auto it = cells.find(hash(x + dx + a, y + dy + b, z + dz + c));
+                if(it != cells.end())
+                {
+                    box->setNeighbor(neighbor, it->second);
+                    it->second->setNeighbor(26 - neighbor, box);
+                }
+                neighbor++;
+            }
+
+            cells[h] = box;
+        }
+    }
+    return cells.size();
+}
+
+size_t runUnorderedMap(const std::vector<Vec>& points, float voxelsize)
+{
+    std::unordered_map<size_t, Box*> cells;
+    size_t n = buildCells(points, voxelsize, cells, [](const Vec& c) { return new Box(c); });
+    for(auto& cell : cells)
+    {
+        delete cell.second;
+    }
+    return n;
+}
+
+size_t runCellMap(const std::vector<Vec>& points, float voxelsize)
+{
+    CellMap<Box*> cells;
+    BoxArena<Box> arena;
+    return buildCells(points, voxelsize, cells, [&](const Vec& c) { return arena.create(c); });
+}
+
+size_t runHashGrid(const std::vector<Vec>& points, float voxelsize)
+{
+    BoundingBox<Vec> bb(Vec(-1, -1, -1), Vec(1, 1, 1));
+    HashGrid<Vec, Box> grid(voxelsize, bb);
+    for(auto& p : points)
+    {
+        auto index = (p - bb.getMin()) / voxelsize;
+        grid.addLatticePoint(
+            static_cast<int>(index.x + 0.5f),
+            static_cast<int>(index.y + 0.5f),
+            static_cast<int>(index.z + 0.5f));
+    }
+    grid.sortCells();
+    return grid.getNumberOfCells();
+}
+
+/**
+ * @brief Runs the given benchmark in a child process and prints the
+ *        elapsed time and the peak resident memory of the child.
+ */
+template<typename Func>
+void runIsolated(const std::string& name, Func func)
+{
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        Timestamp ts;
+        size_t numCells = func();
+        std::cout << name << ": " << numCells << " cells in "
+                  << ts.getElapsedTimeInMs() << " ms" << std::endl;
+        _exit(0);
+    }
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    std::cout << name << ": peak memory " << usage.ru_maxrss / 1024 << " MB" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    float voxelsize = argc > 2 ? std::stof(argv[2]) : 0.005f;
+
+    timestamp.setQuiet(true);
+
+    std::cout << "Creating " << numPoints << " points, voxelsize " << voxelsize << std::endl;
+    std::vector<Vec> points = createPoints(numPoints);
+
+    runIsolated("unordered_map + new", [&]() { return runUnorderedMap(points, voxelsize); });
+    runIsolated("CellMap + BoxArena ", [&]() { return runCellMap(points, voxelsize); });
+    runIsolated("HashGrid           ", [&]() { return runHashGrid(points, voxelsize); });
+
+    return 0;
+}
@@ -237,6 +237,19 @@ int main( int argc, char ** argv )
       std::cout << timestamp << "Vertex average angles already included." << std::endl;
     }
 
+    // The local neighborhoods are only calculated once for the roughness and
+    // the height differences
+    boost::optional<LocalVertexNeighborhoods> neighborhoods;
+    auto getNeighborhoods = [&]() -> const LocalVertexNeighborhoods&
+    {
+      if (!neighborhoods)
+      {
+        std::cout << timestamp << "Computing local neighborhoods..." << std::endl;
+        neighborhoods.emplace(hem, 0.3);
+      }
+      return *neighborhoods;
+    };
+
     // roughness
     DenseVertexMap<float> roughness;
     boost::optional<DenseVertexMap<float>> roughnessOpt;
@@ -252,7 +265,7 @@ int main( int argc, char ** argv )
     else
     {
       std::cout << timestamp << "Computing roughness..." << std::endl;
-      roughness = calcVertexRoughness(hem, 0.3, vertexNormals);
+      roughness = calcVertexRoughness(hem, getNeighborhoods(), averageAngles);
     }
     if (!roughnessOpt || !writeToHdf5Input)
     {
@@ -288,7 +301,8 @@ int main( int argc, char ** argv )
     else
     {
       std::cout << timestamp << "Computing height differences..." << std::endl;
-      heightDifferences = calcVertexHeightDifferences(hem, 0.3);
+      heightDifferences = calcVertexHeightDifferences(hem, getNeighborhoods());
+      neighborhoods = boost::none;
     }
     if (!heightDifferencesOpt || !writeToHdf5Input)
     {
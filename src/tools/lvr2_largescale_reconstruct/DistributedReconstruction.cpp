@@ -0,0 +1,389 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * DistributedReconstruction.cpp
+ */
+
+#include "DistributedReconstruction.hpp"
+
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/reconstruction/BigGrid.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+
+using Vec = lvr2::BaseVector<float>;
+
+std::string encodeJob(size_t id, const PartitionJob& job)
+{
+    std::stringstream ss;
+    ss << std::setprecision(std::numeric_limits<float>::max_digits10);
+    ss << "JOB " << id << " " << job.name << " "
+       << job.bb.getMin().x << " " << job.bb.getMin().y << " " << job.bb.getMin().z << " "
+       << job.bb.getMax().x << " " << job.bb.getMax().y << " " << job.bb.getMax().z;
+    return ss.str();
+}
+
+PartitionJob decodeJob(std::stringstream& ss)
+{
+    PartitionJob job;
+    float minx, miny, minz, maxx, maxy, maxz;
+    ss >> job.name >> minx >> miny >> minz >> maxx >> maxy >> maxz;
+    job.bb = lvr2::BoundingBox<Vec>(Vec(minx, miny, minz), Vec(maxx, maxy, maxz));
+    return job;
+}
+
+} // namespace
+
+PartitionCoordinator::PartitionCoordinator(const LargeScaleOptions::Options& options, char** argv)
+    : m_options(options), m_argv(argv), m_skipped(0)
+{
+}
+
+pid_t PartitionCoordinator::spawn(const std::string& socket)
+{
+    std::vector<char*> args;
+    for (char** arg = m_argv; *arg; arg++)
+    {
+        args.push_back(*arg);
+    }
+    std::string option = "--worker";
+    args.push_back(&option[0]);
+    std::string path = socket;
+    args.push_back(&path[0]);
+    args.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execv("/proc/self/exe", args.data());
+        _exit(127);
+    }
+    if (pid < 0)
+    {
+        throw std::runtime_error("Unable to start worker process");
+    }
+    return pid;
+}
+
+std::vector<std::string> PartitionCoordinator::run(const std::vector<PartitionJob>& jobs,
+                                                   const std::string& gridFile)
+{
+    m_skipped = 0;
+
+    size_t numProcesses = m_options.getProcesses();
+    SocketServer server("lvr2_ls_" + std::to_string(getpid()) + ".sock");
+
+    std::vector<pid_t> pids;
+    std::vector<Worker> workers;
+    try
+    {
+        for (size_t i = 0; i < numProcesses; i++)
+        {
+            pids.push_back(spawn(server.path()));
+        }
+
+        std::vector<std::string> files = distribute(server, jobs, gridFile, workers);
+        shutdown(workers, pids);
+
+        std::vector<std::string> written;
+        for (auto& file : files)
+        {
+            if (!file.empty())
+            {
+                written.push_back(file);
+            }
+        }
+        return written;
+    }
+    catch (...)
+    {
+        shutdown(workers, pids);
+        throw;
+    }
+}
+
+std::vector<std::string> PartitionCoordinator::distribute(SocketServer& server,
+                                                          const std::vector<PartitionJob>& jobs,
+                                                          const std::string& gridFile,
+                                                          std::vector<Worker>& workers)
+{
+    size_t numProcesses = m_options.getProcesses();
+
+    // Wait until every worker either connected or terminated
+    size_t terminated = 0;
+    while (workers.size() + terminated < numProcesses)
+    {
+        auto channel = server.accept(1000);
+        if (channel)
+        {
+            workers.push_back({std::move(channel), {}});
+            continue;
+        }
+        int status;
+        while (waitpid(-1, &status, WNOHANG) > 0)
+        {
+            terminated++;
+        }
+    }
+
+    if (workers.empty())
+    {
+        throw std::runtime_error("No worker process could be started");
+    }
+    cout << lvr2::timestamp << workers.size() << " worker processes connected" << endl;
+
+    for (auto& worker : workers)
+    {
+        worker.channel->send("GRID " + gridFile);
+    }
+
+    std::deque<size_t> pending;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        pending.push_back(i);
+    }
+
+    // Every worker reconstructs up to partitionJobs partitions concurrently
+    size_t batchSize = std::max(1, m_options.getPartitionJobs());
+
+    std::vector<std::string> files(jobs.size());
+    size_t finished = 0;
+    size_t alive = workers.size();
+
+    while (finished < jobs.size())
+    {
+        // Hand out batches of jobs to idle workers, splitting the
+        // remaining jobs evenly if there are fewer than batches
+        size_t idle = 0;
+        for (auto& worker : workers)
+        {
+            idle += worker.channel && worker.jobs.empty();
+        }
+        for (auto& worker : workers)
+        {
+            if (!worker.channel || !worker.jobs.empty() || pending.empty())
+            {
+                continue;
+            }
+
+            size_t count = std::min(batchSize, (pending.size() + idle - 1) / idle);
+            idle--;
+
+            bool sent = true;
+            for (size_t i = 0; i < count; i++)
+            {
+                worker.jobs.push_back(pending.front());
+                pending.pop_front();
+                sent = sent && worker.channel->send(encodeJob(worker.jobs.back(), jobs[worker.jobs.back()]));
+            }
+            if (!sent || !worker.channel->send("RUN"))
+            {
+                pending.insert(pending.begin(), worker.jobs.begin(), worker.jobs.end());
+                worker.jobs.clear();
+                worker.channel.reset();
+                alive--;
+            }
+        }
+
+        if (alive == 0)
+        {
+            throw std::runtime_error("All worker processes terminated");
+        }
+
+        // Wait for results of busy workers
+        std::vector<pollfd> fds;
+        std::vector<size_t> index;
+        bool buffered = false;
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            if (workers[i].channel && !workers[i].jobs.empty())
+            {
+                fds.push_back({workers[i].channel->descriptor(), POLLIN, 0});
+                index.push_back(i);
+                buffered |= workers[i].channel->hasBufferedMessage();
+            }
+        }
+        if (!buffered && poll(fds.data(), fds.size(), -1) < 0)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < fds.size(); i++)
+        {
+            Worker& worker = workers[index[i]];
+            if (!fds[i].revents && !worker.channel->hasBufferedMessage())
+            {
+                continue;
+            }
+
+            std::string message;
+            if (!worker.channel->receive(message))
+            {
+                cout << lvr2::timestamp << "Worker process lost, rescheduling "
+                     << worker.jobs.size() << " jobs" << endl;
+                pending.insert(pending.begin(), worker.jobs.begin(), worker.jobs.end());
+                worker.jobs.clear();
+                worker.channel.reset();
+                alive--;
+                continue;
+            }
+
+            std::stringstream ss(message);
+            std::string type;
+            size_t id;
+            ss >> type >> id;
+            auto job = std::find(worker.jobs.begin(), worker.jobs.end(), id);
+            if (!ss || job == worker.jobs.end())
+            {
+                throw std::runtime_error("Unexpected message from worker: " + message);
+            }
+
+            if (type == "DONE")
+            {
+                ss >> files[id];
+            }
+            else if (type == "SKIP")
+            {
+                m_skipped++;
+            }
+            else
+            {
+                throw std::runtime_error("Partition " + jobs[id].name + " failed: " + message);
+            }
+
+            cout << lvr2::timestamp << "Finished partition " << ++finished << "/"
+                 << jobs.size() << endl;
+            worker.jobs.erase(job);
+        }
+    }
+
+    return files;
+}
+
+void PartitionCoordinator::shutdown(std::vector<Worker>& workers, const std::vector<pid_t>& pids)
+{
+    for (auto& worker : workers)
+    {
+        if (worker.channel)
+        {
+            worker.channel->send("QUIT");
+        }
+    }
+    workers.clear();
+
+    // Workers that are still busy exit once they find the channel closed
+    for (pid_t pid : pids)
+    {
+        int status;
+        waitpid(pid, &status, 0);
+    }
+}
+
+int runPartitionWorker(const LargeScaleOptions::Options& options)
+{
+    auto channel = SocketChannel::connect(options.getWorkerSocket());
+
+    std::unique_ptr<lvr2::BigGrid<Vec>> grid;
+    std::unique_ptr<PartitionScheduler> scheduler;
+
+    // The jobs received since the last RUN and their ids
+    std::vector<PartitionJob> batch;
+    std::vector<size_t> ids;
+
+    std::string message;
+    while (channel->receive(message))
+    {
+        std::stringstream ss(message);
+        std::string type;
+        ss >> type;
+
+        if (type == "GRID")
+        {
+            std::string gridFile;
+            ss >> gridFile;
+            grid = std::make_unique<lvr2::BigGrid<Vec>>(gridFile);
+            scheduler = std::make_unique<PartitionScheduler>(*grid, options);
+        }
+        else if (type == "JOB" && scheduler)
+        {
+            size_t id;
+            ss >> id;
+            ids.push_back(id);
+            batch.push_back(decodeJob(ss));
+        }
+        else if (type == "RUN" && scheduler)
+        {
+            std::vector<std::string> replies;
+            try
+            {
+                std::vector<std::string> files = scheduler->runJobs(batch);
+                for (size_t i = 0; i < ids.size(); i++)
+                {
+                    replies.push_back(files[i].empty() ? "SKIP " + std::to_string(ids[i])
+                                                       : "DONE " + std::to_string(ids[i]) + " " + files[i]);
+                }
+            }
+            catch (std::exception& e)
+            {
+                std::string reason = e.what();
+                std::replace(reason.begin(), reason.end(), '\n', ' ');
+                for (size_t id : ids)
+                {
+                    replies.push_back("FAIL " + std::to_string(id) + " " + reason);
+                }
+            }
+
+            for (auto& reply : replies)
+            {
+                channel->send(reply);
+            }
+            ids.clear();
+            batch.clear();
+        }
+        else
+        {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * DistributedReconstruction.hpp
+ */
+
+#ifndef DISTRIBUTEDRECONSTRUCTION_H_
+#define DISTRIBUTEDRECONSTRUCTION_H_
+
+#include "LargeScaleOptions.hpp"
+#include "MessageChannel.hpp"
+#include "PartitionScheduler.hpp"
+
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * @brief Distributes partition jobs to worker processes.
+ *
+ * The coordinator starts the given number of worker processes, i.e.
+ * instances of this executable with the additional --worker option.
+ * Each worker opens the serialized BigGrid and reconstructs batches of
+ * up to partitionJobs partitions concurrently with a PartitionScheduler.
+ * Batches are handed out on demand, so fast workers get more jobs. Jobs
+ * of workers that die are handed to the remaining ones.
+ *
+ * Protocol (one message per line):
+ *   coordinator -> worker: GRID <file>, JOB <id> <name> <bounding box>, RUN, QUIT
+ *   worker -> coordinator: DONE <id> <cell file>, SKIP <id>, FAIL <id> <reason>
+ *
+ * RUN starts the jobs received since the last RUN. The worker answers
+ * each of them once the batch is done.
+ */
+class PartitionCoordinator
+{
+public:
+    /**
+     * @param options   Reconstruction parameters. The number of worker
+     *                  processes is taken from the processes option.
+     * @param argv      The command line of this process, used to start
+     *                  the workers with the same parameters
+     */
+    PartitionCoordinator(const LargeScaleOptions::Options& options, char** argv);
+
+    /**
+     * @brief Reconstructs the given partitions in the worker processes.
+     *
+     * @param jobs      The partitions to reconstruct
+     * @param gridFile  The BigGrid serialized with BigGrid::serialize()
+     * @return The names of all written cell files in the order of the jobs
+     */
+    std::vector<std::string> run(const std::vector<PartitionJob>& jobs, const std::string& gridFile);
+
+    /// Number of partitions skipped in the last run
+    size_t skipped() const { return m_skipped; }
+
+private:
+
+    struct Worker
+    {
+        std::unique_ptr<MessageChannel> channel;
+
+        /// The jobs the worker is processing, empty if idle
+        std::vector<size_t> jobs;
+    };
+
+    /// Starts a worker process that connects to the given socket
+    pid_t spawn(const std::string& socket);
+
+    /// Connects the workers and hands out the jobs until all are done.
+    /// Returns the cell file of every job, empty if it was skipped
+    std::vector<std::string> distribute(SocketServer& server,
+                                        const std::vector<PartitionJob>& jobs,
+                                        const std::string& gridFile,
+                                        std::vector<Worker>& workers);
+
+    /// Tells the connected workers to quit and waits for all processes
+    void shutdown(std::vector<Worker>& workers, const std::vector<pid_t>& pids);
+
+    const LargeScaleOptions::Options&   m_options;
+    char**                              m_argv;
+    size_t                              m_skipped;
+};
+
+/**
+ * @brief Main loop of a worker process. Connects to the coordinator at
+ *        the socket given by the worker option and processes jobs until
+ *        it is told to quit.
+ */
+int runPartitionWorker(const LargeScaleOptions::Options& options);
+
+#endif /* DISTRIBUTEDRECONSTRUCTION_H_ */
@@ -77,7 +77,7 @@ Options::Options(int argc, char** argv) : BaseOption(argc, argv)
         "calculated automatically.")("pcm,p",
                                      value<string>(&m_pcm)->default_value("FLANN"),
                                      "Point cloud manager used for point handling and normal "
-                                     "estimation. Choose from {STANN, PCL, NABO}.")(
+                                     "estimation. Choose from {FLANN, NANOFLANN, STANN, PCL, NABO}.")(
         "ransac", "Set this flag for RANSAC based normal estimation.")(
         "decomposition,d",
         value<string>(&m_pcm)->default_value("PMC"),
@@ -205,7 +205,29 @@ Options::Options(int argc, char** argv) : BaseOption(argc, argv)
         "volumenSize",
         value<size_t>(&m_volumenSize)->default_value(0),
         "The volumen of the partitions. Volume = (voxelsize*volumenSize)^3 if not set kd-tree will "
-        "be used")("onlyNormals", "If true, only normals will be generated");
+        "be used")("onlyNormals", "If true, only normals will be generated")(
+        "partitionJobs",
+        value<int>(&m_partitionJobs)->default_value(1),
+        "Number of partitions that are reconstructed concurrently. The available threads are "
+        "split evenly between them. With --processes, this applies to every worker process.")(
+        "memoryBudget",
+        value<size_t>(&m_memoryBudget)->default_value(0),
+        "Approximate memory budget in MB for partition reconstruction and the final mesh "
+        "extraction. 0 means no limit.")(
+        "processes",
+        value<int>(&m_processes)->default_value(0),
+        "Number of worker processes the partitions are distributed to. 0 reconstructs all "
+        "partitions in this process.")(
+        "gridIndex",
+        value<string>(&m_gridIndex)->default_value(""),
+        "Index file of the grid. If it exists, the grid and its point store are reopened instead "
+        "of reading the input again. Otherwise the index is written after building the grid.")(
+        "timingReport",
+        value<string>(&m_timingReport)->default_value(""),
+        "Write the elapsed time and throughput of all processing stages to the given CSV file.")(
+        "worker",
+        value<string>(&m_workerSocket)->default_value(""),
+        "Internal: run as worker process of the coordinator listening on the given socket");
 
     setup();
 }
@@ -263,6 +285,18 @@ int Options::getVGrid() const { return (m_variables["useVGrid"].as<int>()); }
 
 int Options::getGridSize() const { return (m_variables["gridSize"].as<int>()); }
 
+int Options::getPartitionJobs() const { return (m_variables["partitionJobs"].as<int>()); }
+
+size_t Options::getMemoryBudget() const { return (m_variables["memoryBudget"].as<size_t>()); }
+
+int Options::getProcesses() const { return (m_variables["processes"].as<int>()); }
+
+string Options::getWorkerSocket() const { return (m_variables["worker"].as<string>()); }
+
+string Options::getGridIndex() const { return (m_variables["gridIndex"].as<string>()); }
+
+string Options::getTimingReport() const { return (m_variables["timingReport"].as<string>()); }
+
 string Options::getPartialReconstruct() const
 {
     return (m_variables["partialReconstruct"].as<string>());
@@ -341,6 +341,18 @@ class Options : public lvr2::BaseOption
 
     string getPartialReconstruct() const;
 
+    int getPartitionJobs() const;
+
+    size_t getMemoryBudget() const;
+
+    int getProcesses() const;
+
+    string getWorkerSocket() const;
+
+    string getGridIndex() const;
+
+    string getTimingReport() const;
+
   private:
     /// The set voxelsize
     float m_voxelsizeBG;
@@ -485,6 +497,24 @@ class Options : public lvr2::BaseOption
 
     //gridsize for virtual grid
     int m_gridsize;
+
+    //number of concurrently reconstructed partitions
+    int m_partitionJobs;
+
+    //memory budget in MB
+    size_t m_memoryBudget;
+
+    //number of worker processes
+    int m_processes;
+
+    //socket of the coordinator in worker mode
+    string m_workerSocket;
+
+    //index file of the grid
+    string m_gridIndex;
+
+    //csv file the stage timings are written to
+    string m_timingReport;
 };
 
 /// Overlaoeded outpur operator
@@ -616,6 +646,23 @@ inline ostream& operator<<(ostream& os, const Options& o)
         cout << "##### Buffer Size: \t\t: " << o.getBufferSize() << endl;
     }
     cout << "##### Volumen Size: \t\t: " << o.getVolumenSize() << endl;
+    cout << "##### Partition jobs: \t\t: " << o.getPartitionJobs() << endl;
+    if (o.getProcesses())
+    {
+        cout << "##### Worker processes: \t: " << o.getProcesses() << endl;
+    }
+    if (o.getGridIndex() != "")
+    {
+        cout << "##### Grid index: \t\t: " << o.getGridIndex() << endl;
+    }
+    if (o.getTimingReport() != "")
+    {
+        cout << "##### Timing report: \t\t: " << o.getTimingReport() << endl;
+    }
+    if (o.getMemoryBudget())
+    {
+        cout << "##### Memory budget (MB): \t: " << o.getMemoryBudget() << endl;
+    }
     return os;
 }
 
@@ -25,7 +25,10 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "DistributedReconstruction.hpp"
 #include "LargeScaleOptions.hpp"
+#include "PartitionScheduler.hpp"
+#include "SlabExtraction.hpp"
 #include "lvr2/algorithm/CleanupAlgorithms.hpp"
 #include "lvr2/algorithm/FinalizeAlgorithms.hpp"
 #include "lvr2/algorithm/GeometryAlgorithms.hpp"
@@ -37,6 +40,7 @@
 #include "lvr2/io/Model.hpp"
 #include "lvr2/io/PLYIO.hpp"
 #include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/io/TimingReport.hpp"
 #include "lvr2/reconstruction/BigGrid.hpp"
 #include "lvr2/reconstruction/BigGridKdTree.hpp"
 #include "lvr2/reconstruction/BigVolumen.hpp"
@@ -47,6 +51,7 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/serialization/vector.hpp>
 #include <flann/flann.hpp>
 #include <fstream>
@@ -70,6 +75,7 @@
 #include <lvr2/reconstruction/PointsetGrid.hpp>
 #include <lvr2/reconstruction/PointsetSurface.hpp>
 #include <lvr2/reconstruction/SearchTreeFlann.hpp>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <string>
@@ -111,14 +117,35 @@ typedef lvr2::PointsetSurface<lvr2::ColorVertex<float, unsigned char>> psSurface
 typedef lvr2::AdaptiveKSearchSurface<Vec> akSurface;
 
 template <typename BaseVecT>
-int mpiReconstruct(const LargeScaleOptions::Options& options)
+int mpiReconstruct(const LargeScaleOptions::Options& options, char** argv)
 {
     string filePath = options.getInputFileName()[0];
     float voxelsize = options.getVoxelsize();
     float bgVoxelsize = options.getBGVoxelsize();
     float scale = options.getScaling();
-    cout << lvr2::timestamp << "Starting grid" << endl;
-    BigGrid<BaseVecT> bg(filePath, bgVoxelsize, scale);
+    string gridIndex = options.getGridIndex();
+    std::unique_ptr<BigGrid<BaseVecT>> grid;
+    if (gridIndex != "" && boost::filesystem::exists(gridIndex))
+    {
+        cout << lvr2::timestamp << "Opening grid " << gridIndex << endl;
+        grid = std::make_unique<BigGrid<BaseVecT>>(gridIndex);
+        if (!grid->matchesInput({filePath}, bgVoxelsize, scale))
+        {
+            cout << lvr2::timestamp << "Input file, voxel size or scale of " << gridIndex
+                 << " does not match, rebuilding grid" << endl;
+            grid.reset();
+        }
+    }
+    if (!grid)
+    {
+        cout << lvr2::timestamp << "Starting grid" << endl;
+        grid = std::make_unique<BigGrid<BaseVecT>>(filePath, bgVoxelsize, scale);
+        if (gridIndex != "")
+        {
+            grid->serialize(gridIndex);
+        }
+    }
+    BigGrid<BaseVecT>& bg = *grid;
     cout << lvr2::timestamp << "grid finished " << endl;
     BoundingBox<BaseVecT> bb = bg.getBB();
     shared_ptr<BoundingBox<BaseVecT>> part_bb; // Bounding Box for partial reconstruction
@@ -180,8 +207,7 @@ int mpiReconstruct(const LargeScaleOptions::Options& options)
     vector<string> grid_files;
     unordered_set<string> meshes;
 
-    uint partitionBoxesSkipped = 0;
-
+    vector<PartitionJob> jobs;
     for (int i = 0; i < partitionBoxes.size(); i++)
     {
         string name_id;
@@ -200,82 +226,37 @@ int mpiReconstruct(const LargeScaleOptions::Options& options)
         {
             name_id = std::to_string(i);
         }
+        jobs.push_back({partitionBoxes[i], name_id});
+    }
 
-        size_t numPoints;
-
-        // todo: okay?
-        floatArr points = bg.points(partitionBoxes[i].getMin().x,
-                                    partitionBoxes[i].getMin().y,
-                                    partitionBoxes[i].getMin().z,
-                                    partitionBoxes[i].getMax().x,
-                                    partitionBoxes[i].getMax().y,
-                                    partitionBoxes[i].getMax().z,
-                                    numPoints);
+    cout << "kn=" << options.getKn() << endl;
+    cout << "ki=" << options.getKi() << endl;
+    cout << "kd=" << options.getKd() << endl;
 
-        if (numPoints <= 50)
+    uint partitionBoxesSkipped;
+    if (options.getProcesses() > 0)
+    {
+        // Workers open the grid from its serialized index
+        if (gridIndex == "")
         {
-            partitionBoxesSkipped++;
-            continue;
+            gridIndex = "serinfo.ls";
+            bg.serialize(gridIndex);
         }
-
-        BaseVecT gridbb_min(partitionBoxes[i].getMin().x,
-                            partitionBoxes[i].getMin().y,
-                            partitionBoxes[i].getMin().z);
-        BaseVecT gridbb_max(partitionBoxes[i].getMax().x,
-                            partitionBoxes[i].getMax().y,
-                            partitionBoxes[i].getMax().z);
-        BoundingBox<BaseVecT> gridbb(gridbb_min, gridbb_max);
-
-        cout << "grid: " << i << "/" << partitionBoxes.size() - 1 << endl;
-        cout << "grid has " << numPoints << " points" << endl;
-        cout << "kn=" << options.getKn() << endl;
-        cout << "ki=" << options.getKi() << endl;
-        cout << "kd=" << options.getKd() << endl;
-        cout << gridbb << endl;
-
-        lvr2::PointBufferPtr p_loader(new lvr2::PointBuffer);
-        p_loader->setPointArray(points, numPoints);
-
-        if (bg.hasNormals())
+        PartitionCoordinator coordinator(options, argv);
+        for (auto& file : coordinator.run(jobs, gridIndex))
         {
-            size_t numNormals;
-            lvr2::floatArr normals = bg.normals(partitionBoxes[i].getMin().x,
-                                                partitionBoxes[i].getMin().y,
-                                                partitionBoxes[i].getMin().z,
-                                                partitionBoxes[i].getMax().x,
-                                                partitionBoxes[i].getMax().y,
-                                                partitionBoxes[i].getMax().z,
-                                                numNormals);
-
-            p_loader->setNormalArray(normals, numNormals);
-            cout << "got " << numNormals << " normals" << endl;
+            meshes.insert(file);
         }
-
-        lvr2::PointsetSurfacePtr<Vec> surface;
-        surface = make_shared<lvr2::AdaptiveKSearchSurface<Vec>>(p_loader,
-                                                                 "FLANN",
-                                                                 options.getKn(),
-                                                                 options.getKi(),
-                                                                 options.getKd(),
-                                                                 options.useRansac());
-
-        if (!bg.hasNormals())
-            surface->calculateSurfaceNormals();
-
-        auto ps_grid = std::make_shared<lvr2::PointsetGrid<Vec, lvr2::FastBox<Vec>>>(
-            voxelsize, surface, gridbb, true, options.extrude());
-
-        ps_grid->setBB(gridbb);
-        ps_grid->calcIndices();
-        ps_grid->calcDistanceValues();
-
-        auto reconstruction =
-            make_unique<lvr2::FastReconstruction<Vec, lvr2::FastBox<Vec>>>(ps_grid);
-
-        std::stringstream ss2;
-        ss2 << name_id << ".ser";
-        ps_grid->saveCells(ss2.str());
-        meshes.insert(ss2.str());
+        partitionBoxesSkipped = coordinator.skipped();
+    }
+    else
+    {
+        PartitionScheduler scheduler(bg, options);
+        for (auto& file : scheduler.run(jobs))
+        {
+            meshes.insert(file);
+        }
+        partitionBoxesSkipped = scheduler.skipped();
     }
 
     ifstream old_mesh("VGrid.ser");
@@ -318,13 +299,9 @@ int mpiReconstruct(const LargeScaleOptions::Options& options)
     cbb.expand(vmin);
     cbb.expand(vmax);
 
-    auto hg = std::make_shared<HashGrid<BaseVecT, lvr2::FastBox<Vec>>>(grid_files, cbb, voxelsize);
-
-    auto reconstruction = make_unique<lvr2::FastReconstruction<Vec, lvr2::FastBox<Vec>>>(hg);
-
     lvr2::HalfEdgeMesh<Vec> mesh;
 
-    reconstruction->getMesh(mesh);
+    extractMeshInSlabs(grid_files, cbb, voxelsize, options.getMemoryBudget() * 1024 * 1024, mesh);
 
     if (options.getDanglingArtifacts())
     {
@@ -405,6 +382,11 @@ int main(int argc, char** argv)
     // Parse command line arguments
     LargeScaleOptions::Options options(argc, argv);
 
+    if (!options.getWorkerSocket().empty())
+    {
+        return runPartitionWorker(options);
+    }
+
     options.printLogo();
 
     // Exit if options had to generate a usage message
@@ -416,7 +398,17 @@ int main(int argc, char** argv)
 
     std::cout << options << std::endl;
 
-    int i = mpiReconstruct<Vec>(options);
+    if (options.getTimingReport() != "")
+    {
+        TimingReport::enable();
+    }
+
+    int i = mpiReconstruct<Vec>(options, argv);
+
+    if (options.getTimingReport() != "" && !TimingReport::write(options.getTimingReport()))
+    {
+        cout << "Unable to write timing report " << options.getTimingReport() << endl;
+    }
 
     cout << "Program end." << endl;
 
@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * MessageChannel.cpp
+ */
+
+#include "MessageChannel.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+sockaddr_un socketAddress(const std::string& path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+} // namespace
+
+SocketChannel::SocketChannel(int fd) : m_fd(fd) {}
+
+SocketChannel::~SocketChannel()
+{
+    close(m_fd);
+}
+
+std::unique_ptr<SocketChannel> SocketChannel::connect(const std::string& path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::string("Unable to create socket: ") + strerror(errno));
+    }
+
+    sockaddr_un address = socketAddress(path);
+    if (::connect(fd, (sockaddr*)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        throw std::runtime_error("Unable to connect to " + path + ": " + strerror(errno));
+    }
+    return std::unique_ptr<SocketChannel>(new SocketChannel(fd));
+}
+
+bool SocketChannel::send(const std::string& message)
+{
+    std::string line = message + "\n";
+    size_t written = 0;
+    while (written < line.size())
+    {
+        ssize_t n = ::send(m_fd, line.data() + written, line.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+bool SocketChannel::receive(std::string& message)
+{
+    size_t end;
+    while ((end = m_buffer.find('\n')) == std::string::npos)
+    {
+        char chunk[4096];
+        ssize_t n = ::recv(m_fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        m_buffer.append(chunk, n);
+    }
+    message = m_buffer.substr(0, end);
+    m_buffer.erase(0, end + 1);
+    return true;
+}
+
+bool SocketChannel::hasBufferedMessage() const
+{
+    return m_buffer.find('\n') != std::string::npos;
+}
+
+SocketServer::SocketServer(const std::string& path) : m_path(path)
+{
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(std::string("Unable to create socket: ") + strerror(errno));
+    }
+
+    unlink(path.c_str());
+    sockaddr_un address = socketAddress(path);
+    if (bind(m_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(m_fd, 64) < 0)
+    {
+        close(m_fd);
+        throw std::runtime_error("Unable to listen on " + path + ": " + strerror(errno));
+    }
+}
+
+SocketServer::~SocketServer()
+{
+    close(m_fd);
+    unlink(m_path.c_str());
+}
+
+std::unique_ptr<SocketChannel> SocketServer::accept(int timeoutMs)
+{
+    pollfd pfd = {m_fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeoutMs) <= 0)
+    {
+        return nullptr;
+    }
+
+    int fd = ::accept(m_fd, nullptr, nullptr);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<SocketChannel>(new SocketChannel(fd));
+}
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * MessageChannel.hpp
+ */
+
+#ifndef MESSAGECHANNEL_H_
+#define MESSAGECHANNEL_H_
+
+#include <memory>
+#include <string>
+
+/**
+ * @brief A bidirectional, line based message connection between the
+ *        coordinator and a worker process. Messages must not contain
+ *        newlines.
+ */
+class MessageChannel
+{
+public:
+    virtual ~MessageChannel() = default;
+
+    /// Sends a message. Returns false if the connection is broken.
+    virtual bool send(const std::string& message) = 0;
+
+    /// Blocks until a message is available. Returns false if the
+    /// connection was closed.
+    virtual bool receive(std::string& message) = 0;
+
+    /// A file descriptor that becomes readable when a message arrives,
+    /// used by the coordinator to wait for several workers at once
+    virtual int descriptor() const = 0;
+
+    /// True if a complete message was already read from the descriptor
+    virtual bool hasBufferedMessage() const = 0;
+};
+
+/**
+ * @brief MessageChannel over a connected Unix domain socket
+ */
+class SocketChannel : public MessageChannel
+{
+public:
+    /// Takes ownership of the connected socket
+    explicit SocketChannel(int fd);
+
+    ~SocketChannel() override;
+
+    /// Connects to the SocketServer listening at the given path
+    static std::unique_ptr<SocketChannel> connect(const std::string& path);
+
+    bool send(const std::string& message) override;
+
+    bool receive(std::string& message) override;
+
+    int descriptor() const override { return m_fd; }
+
+    bool hasBufferedMessage() const override;
+
+private:
+    int         m_fd;
+    std::string m_buffer;
+};
+
+/**
+ * @brief Listening Unix domain socket. The socket file is removed on
+ *        destruction.
+ */
+class SocketServer
+{
+public:
+    explicit SocketServer(const std::string& path);
+
+    ~SocketServer();
+
+    /// Waits at most timeoutMs milliseconds for a new connection.
+    /// Returns nullptr on timeout.
+    std::unique_ptr<SocketChannel> accept(int timeoutMs);
+
+    const std::string& path() const { return m_path; }
+
+private:
+    int         m_fd;
+    std::string m_path;
+};
+
+#endif /* MESSAGECHANNEL_H_ */
@@ -0,0 +1,263 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PartitionScheduler.cpp
+ */
+
+#include "PartitionScheduler.hpp"
+
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/reconstruction/AdaptiveKSearchSurface.hpp"
+#include "lvr2/reconstruction/FastReconstruction.hpp"
+#include "lvr2/reconstruction/PointsetGrid.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+#include <thread>
+
+using std::cout;
+using std::endl;
+
+PartitionScheduler::PartitionScheduler(lvr2::BigGrid<Vec>& grid,
+                                       const LargeScaleOptions::Options& options)
+    : m_grid(grid),
+      m_options(options),
+      m_numWorkers(std::max(1, options.getPartitionJobs())),
+      m_budget(options.getMemoryBudget() * 1024 * 1024),
+      m_used(0),
+      m_skipped(0),
+      m_loadingDone(false),
+      m_failed(false)
+{
+}
+
+std::vector<std::string> PartitionScheduler::run(const std::vector<PartitionJob>& jobs)
+{
+    std::vector<std::string> written;
+    for (auto& file : runJobs(jobs))
+    {
+        if (!file.empty())
+        {
+            written.push_back(file);
+        }
+    }
+    return written;
+}
+
+std::vector<std::string> PartitionScheduler::runJobs(const std::vector<PartitionJob>& jobs)
+{
+    m_used = 0;
+    m_skipped = 0;
+    m_queue.clear();
+    m_loadingDone = false;
+    m_failed = false;
+    m_error = nullptr;
+
+    std::vector<std::string> files(jobs.size());
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_numWorkers; i++)
+    {
+        workers.emplace_back(&PartitionScheduler::work, this, std::cref(jobs), std::ref(files));
+    }
+
+    load(jobs);
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (m_error)
+    {
+        std::rethrow_exception(m_error);
+    }
+
+    return files;
+}
+
+void PartitionScheduler::load(const std::vector<PartitionJob>& jobs)
+{
+    try
+    {
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            const auto& bb = jobs[i].bb;
+            size_t numPoints = m_grid.getSizeofBox(bb.getMin().x, bb.getMin().y, bb.getMin().z,
+                                                   bb.getMax().x, bb.getMax().y, bb.getMax().z);
+            if (numPoints <= 50)
+            {
+                m_skipped++;
+                continue;
+            }
+
+            size_t bytes = numPoints * BYTES_PER_POINT;
+            if (!acquire(bytes))
+            {
+                return;
+            }
+
+            lvr2::floatArr points = m_grid.points(bb.getMin().x, bb.getMin().y, bb.getMin().z,
+                                                  bb.getMax().x, bb.getMax().y, bb.getMax().z,
+                                                  numPoints);
+
+            lvr2::PointBufferPtr buffer(new lvr2::PointBuffer);
+            buffer->setPointArray(points, numPoints);
+
+            if (m_grid.hasNormals())
+            {
+                size_t numNormals;
+                lvr2::floatArr normals = m_grid.normals(bb.getMin().x, bb.getMin().y, bb.getMin().z,
+                                                        bb.getMax().x, bb.getMax().y, bb.getMax().z,
+                                                        numNormals);
+                buffer->setNormalArray(normals, numNormals);
+            }
+
+            // Prefetch at most one partition per worker
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueChanged.wait(lock, [&] { return m_failed || m_queue.size() < m_numWorkers; });
+            if (m_failed)
+            {
+                return;
+            }
+            m_queue.push_back({i, buffer, bytes});
+            m_queueChanged.notify_all();
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_loadingDone = true;
+    m_queueChanged.notify_all();
+}
+
+void PartitionScheduler::work(const std::vector<PartitionJob>& jobs, std::vector<std::string>& files)
+{
+    // Share the available threads between the concurrent partitions
+    omp_set_num_threads(std::max<int>(1, m_options.getNumThreads() / m_numWorkers));
+
+    while (true)
+    {
+        LoadedPartition partition;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueChanged.wait(lock, [&] { return m_failed || m_loadingDone || !m_queue.empty(); });
+            if (m_failed || m_queue.empty())
+            {
+                return;
+            }
+            partition = m_queue.front();
+            m_queue.pop_front();
+            m_queueChanged.notify_all();
+        }
+
+        try
+        {
+            cout << lvr2::timestamp << "grid: " << partition.job << "/" << jobs.size() - 1 << endl;
+            files[partition.job] = reconstruct(jobs[partition.job], partition.buffer);
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+            return;
+        }
+
+        partition.buffer.reset();
+        release(partition.bytes);
+    }
+}
+
+std::string PartitionScheduler::reconstruct(const PartitionJob& job, lvr2::PointBufferPtr buffer)
+{
+    cout << "grid has " << buffer->numPoints() << " points" << endl;
+    cout << job.bb << endl;
+
+    lvr2::PointsetSurfacePtr<Vec> surface;
+    surface = std::make_shared<lvr2::AdaptiveKSearchSurface<Vec>>(buffer,
+                                                                 "FLANN",
+                                                                 m_options.getKn(),
+                                                                 m_options.getKi(),
+                                                                 m_options.getKd(),
+                                                                 m_options.useRansac());
+
+    if (!m_grid.hasNormals())
+    {
+        surface->calculateSurfaceNormals();
+    }
+
+    lvr2::BoundingBox<Vec> gridbb = job.bb;
+    auto ps_grid = std::make_shared<lvr2::PointsetGrid<Vec, lvr2::FastBox<Vec>>>(
+        m_options.getVoxelsize(), surface, gridbb, true, m_options.extrude());
+
+    ps_grid->setBB(gridbb);
+    ps_grid->calcIndices();
+    ps_grid->calcDistanceValues();
+
+    std::string file = job.name + ".ser";
+    ps_grid->saveCells(file);
+    return file;
+}
+
+bool PartitionScheduler::acquire(size_t bytes)
+{
+    // A partition that exceeds the budget on its own is processed
+    // when nothing else is in memory
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_budgetChanged.wait(lock, [&] {
+        return m_failed || m_budget == 0 || m_used == 0 || m_used + bytes <= m_budget;
+    });
+    if (m_failed)
+    {
+        return false;
+    }
+    m_used += bytes;
+    return true;
+}
+
+void PartitionScheduler::release(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_used -= bytes;
+    m_budgetChanged.notify_all();
+}
+
+void PartitionScheduler::fail(std::exception_ptr e)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_failed)
+    {
+        m_failed = true;
+        m_error = e;
+    }
+    m_queueChanged.notify_all();
+    m_budgetChanged.notify_all();
+}
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PartitionScheduler.hpp
+ */
+
+#ifndef PARTITIONSCHEDULER_H_
+#define PARTITIONSCHEDULER_H_
+
+#include "LargeScaleOptions.hpp"
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/BoundingBox.hpp"
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/reconstruction/BigGrid.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A partition of the input cloud that is reconstructed into a
+ *        cell file called <name>.ser
+ */
+struct PartitionJob
+{
+    lvr2::BoundingBox<lvr2::BaseVector<float>> bb;
+    std::string name;
+};
+
+/**
+ * @brief Reconstructs the cell files of several partitions concurrently.
+ *
+ * A loader thread reads the points of the upcoming partitions from the
+ * BigGrid while the workers compute normals and distance values of the
+ * already loaded ones. Every partition reserves an estimate of its memory
+ * footprint from the budget before its points are loaded and returns it
+ * after its cells are written, so the number of partitions in memory is
+ * limited by the budget and not by the number of workers alone.
+ */
+class PartitionScheduler
+{
+public:
+    using Vec = lvr2::BaseVector<float>;
+
+    /**
+     * @param grid          The BigGrid that holds the input points
+     * @param options       Reconstruction parameters. The number of
+     *                      workers and the memory budget are taken from
+     *                      the partitionJobs and memoryBudget options.
+     */
+    PartitionScheduler(lvr2::BigGrid<Vec>& grid, const LargeScaleOptions::Options& options);
+
+    /**
+     * @brief Reconstructs the given partitions.
+     *
+     * @return The names of all written cell files in the order of the jobs.
+     *         Partitions with too few points are skipped.
+     */
+    std::vector<std::string> run(const std::vector<PartitionJob>& jobs);
+
+    /**
+     * @brief Reconstructs the given partitions like run().
+     *
+     * @return The cell file of every job, or an empty string if the
+     *         partition was skipped
+     */
+    std::vector<std::string> runJobs(const std::vector<PartitionJob>& jobs);
+
+    /// Number of partitions skipped in the last run
+    size_t skipped() const { return m_skipped; }
+
+    /// Rough estimate of the memory needed per point of a partition, i.e.
+    /// points, normals, search tree and the reconstruction grid.
+    static constexpr size_t BYTES_PER_POINT = 256;
+
+private:
+
+    /// A partition whose points are loaded and that waits for a worker
+    struct LoadedPartition
+    {
+        size_t              job;
+        lvr2::PointBufferPtr buffer;
+        size_t              bytes;
+    };
+
+    /// Loads the points of all jobs and feeds them to the workers
+    void load(const std::vector<PartitionJob>& jobs);
+
+    /// Reconstructs loaded partitions until all jobs are done
+    void work(const std::vector<PartitionJob>& jobs, std::vector<std::string>& files);
+
+    /// Computes the distance values of a single partition and writes its cells
+    std::string reconstruct(const PartitionJob& job, lvr2::PointBufferPtr buffer);
+
+    /// Blocks until the given amount of memory is available. Returns
+    /// false if the reconstruction was aborted in the meantime.
+    bool acquire(size_t bytes);
+
+    /// Returns memory to the budget
+    void release(size_t bytes);
+
+    /// Stores the first exception thrown by any thread and stops all work
+    void fail(std::exception_ptr e);
+
+    lvr2::BigGrid<Vec>&                 m_grid;
+    const LargeScaleOptions::Options&   m_options;
+
+    size_t                              m_numWorkers;
+    size_t                              m_budget;
+    size_t                              m_used;
+    size_t                              m_skipped;
+
+    std::deque<LoadedPartition>         m_queue;
+    bool                                m_loadingDone;
+    bool                                m_failed;
+    std::exception_ptr                  m_error;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_queueChanged;
+    std::condition_variable             m_budgetChanged;
+};
+
+#endif /* PARTITIONSCHEDULER_H_ */
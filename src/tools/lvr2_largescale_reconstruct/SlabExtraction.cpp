@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * SlabExtraction.cpp
+ */
+
+#include "SlabExtraction.hpp"
+
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/reconstruction/FastBox.hpp"
+#include "lvr2/reconstruction/FastBoxTables.hpp"
+#include "lvr2/reconstruction/FastReconstruction.hpp"
+#include "lvr2/reconstruction/HashGrid.hpp"
+
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+using std::cout;
+using std::endl;
+
+using Vec = lvr2::BaseVector<float>;
+using Box = lvr2::FastBox<Vec>;
+using Grid = lvr2::HashGrid<Vec, Box>;
+
+namespace
+{
+
+/// Same rounding as HashGrid::calcIndex()
+inline int layerIndex(float x, const lvr2::BoundingBox<Vec>& bb, float voxelsize)
+{
+    float f = (x - bb.getMin().x) / voxelsize;
+    return f < 0 ? f - .5 : f + .5;
+}
+
+/// Counts the non extruded cells per grid layer along the x axis
+std::vector<size_t> countLayerCells(
+    std::vector<std::string>& files,
+    const lvr2::BoundingBox<Vec>& bb,
+    float voxelsize)
+{
+    std::vector<size_t> counts(layerIndex(bb.getMax().x, bb, voxelsize) + 2, 0);
+
+    for (auto& file : files)
+    {
+        FILE* pFile = fopen(file.c_str(), "rb");
+        if (!pFile)
+        {
+            continue;
+        }
+
+        size_t numCells = 0;
+        size_t r = fread(&numCells, sizeof(size_t), 1, pFile);
+        for (size_t i = 0; r && i < numCells; i++)
+        {
+            float center[3];
+            bool extruded;
+            float distances[8];
+            r = fread(center, sizeof(float), 3, pFile);
+            r = fread(&extruded, sizeof(bool), 1, pFile);
+            r = fread(distances, sizeof(float), 8, pFile);
+
+            int layer = layerIndex(center[0], bb, voxelsize);
+            if (!extruded && layer >= 0 && layer < (int)counts.size())
+            {
+                counts[layer]++;
+            }
+        }
+        fclose(pFile);
+    }
+    return counts;
+}
+
+} // namespace
+
+void extractMeshInSlabs(
+    std::vector<std::string>& files,
+    lvr2::BoundingBox<Vec>& bb,
+    float voxelsize,
+    size_t memoryBudget,
+    lvr2::HalfEdgeMesh<Vec>& mesh)
+{
+    // A single grid is the same as the regular merge
+    if (memoryBudget == 0)
+    {
+        auto grid = std::make_shared<Grid>(files, bb, voxelsize);
+        lvr2::FastReconstruction<Vec, Box> reconstruction(grid);
+        reconstruction.getMesh(mesh);
+        return;
+    }
+
+    std::vector<size_t> counts = countLayerCells(files, bb, voxelsize);
+
+    // Box, query point and hash map entry of a cell
+    size_t bytesPerCell = sizeof(Box) + sizeof(lvr2::QueryPoint<Vec>) + 2 * sizeof(size_t);
+    size_t maxCells = std::max<size_t>(1, memoryBudget / bytesPerCell);
+
+    // Group the layers into slabs, a slab contains at least one layer
+    std::vector<int> slabBegin;
+    size_t cells = 0;
+    for (size_t layer = 0; layer < counts.size(); layer++)
+    {
+        if (slabBegin.empty() || (cells > 0 && cells + counts[layer] > maxCells))
+        {
+            slabBegin.push_back(layer);
+            cells = 0;
+        }
+        cells += counts[layer];
+    }
+    slabBegin.push_back(counts.size());
+
+    size_t numSlabs = slabBegin.size() - 1;
+    cout << lvr2::timestamp << "Extracting mesh in " << numSlabs << " slabs" << endl;
+
+    // Vertex handles of the cells in the last layer of the previous slab
+    std::unordered_map<size_t, std::array<lvr2::OptionalVertexHandle, 12>> border;
+
+    for (size_t s = 0; s < numSlabs; s++)
+    {
+        int first = slabBegin[s];
+        int last = slabBegin[s + 1];
+
+        cout << lvr2::timestamp << "Slab " << s + 1 << "/" << numSlabs << ": layers "
+             << first << " to " << last - 1 << endl;
+
+        // Load one additional layer on each side
+        Vec regionMin(bb.getMin().x + (first - 1.5) * voxelsize,
+                      bb.getMin().y - voxelsize,
+                      bb.getMin().z - voxelsize);
+        Vec regionMax(bb.getMin().x + (last + 0.5) * voxelsize,
+                      bb.getMax().y + voxelsize,
+                      bb.getMax().z + voxelsize);
+        lvr2::BoundingBox<Vec> region(regionMin, regionMax);
+
+        auto grid = std::make_shared<Grid>(files, bb, voxelsize, region);
+
+        // Neighbor layers are only used for their distance values. The
+        // cells of the previous slab pass their border vertices on to the
+        // cells of this slab.
+        for (auto it = grid->firstCell(); it != grid->lastCell(); it++)
+        {
+            Box* box = it->second;
+            int layer = layerIndex(box->getCenter().x, bb, voxelsize);
+            if (layer >= first && layer < last)
+            {
+                continue;
+            }
+
+            box->m_extruded = true;
+
+            auto handles = border.find(it->first);
+            if (handles == border.end())
+            {
+                continue;
+            }
+
+            for (int e = 0; e < 12; e++)
+            {
+                if (!handles->second[e])
+                {
+                    continue;
+                }
+
+                box->m_intersections[e] = handles->second[e];
+                for (int i = 0; i < 3; i++)
+                {
+                    auto neighbor = box->m_neighbors[lvr2::neighbor_table[e][i]];
+                    if (neighbor)
+                    {
+                        neighbor->m_intersections[lvr2::neighbor_vertex_table[e][i]] =
+                            handles->second[e];
+                    }
+                }
+            }
+        }
+
+        lvr2::FastReconstruction<Vec, Box> reconstruction(grid);
+        reconstruction.getMesh(mesh);
+
+        border.clear();
+        for (auto it = grid->firstCell(); it != grid->lastCell(); it++)
+        {
+            Box* box = it->second;
+            if (layerIndex(box->getCenter().x, bb, voxelsize) == last - 1)
+            {
+                auto& handles = border[it->first];
+                std::copy(box->m_intersections, box->m_intersections + 12, handles.begin());
+            }
+        }
+    }
+}
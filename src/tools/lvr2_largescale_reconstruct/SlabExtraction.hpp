@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * SlabExtraction.hpp
+ */
+
+#ifndef SLABEXTRACTION_H_
+#define SLABEXTRACTION_H_
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/BoundingBox.hpp"
+#include "lvr2/geometry/HalfEdgeMesh.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Extracts the mesh of the cells in the given cell files without
+ *        loading all of them at once.
+ *
+ * The cells are processed in slabs of grid layers along the x axis. Every
+ * slab grid additionally loads one layer of neighbor cells on each side,
+ * so the distance values on the slab borders are the same as in a single
+ * grid. Vertices on the border to the previous slab are handed over to
+ * the next slab, so the result is a connected mesh without duplicate
+ * vertices.
+ *
+ * @param files         The cell files written by HashGrid::saveCells()
+ * @param bb            Bounding box of the whole grid
+ * @param voxelsize     Voxelsize of the grid
+ * @param memoryBudget  Approximate memory budget for a single slab grid in
+ *                      bytes. 0 processes all cells in one slab.
+ * @param mesh          The mesh to add the triangles to
+ */
+void extractMeshInSlabs(
+    std::vector<std::string>& files,
+    lvr2::BoundingBox<lvr2::BaseVector<float>>& bb,
+    float voxelsize,
+    size_t memoryBudget,
+    lvr2::HalfEdgeMesh<lvr2::BaseVector<float>>& mesh
+);
+
+#endif /* SLABEXTRACTION_H_ */
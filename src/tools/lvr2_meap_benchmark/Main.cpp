@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Main.cpp
+ *
+ * Compares the hash map based Meap with the DenseMeap for different heap
+ * arities. The workload mimics the edge collapse: all vertices are inserted
+ * with a random cost, then the minimum is popped repeatedly and the costs of
+ * some keys close to it are updated or erased.
+ *
+ * Usage: lvr2_meap_benchmark [numKeys]
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lvr2/geometry/Handles.hpp"
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/util/DenseMeap.hpp"
+#include "lvr2/util/Meap.hpp"
+
+using namespace lvr2;
+
+/**
+ * @brief Runs the workload on the given queue and returns a checksum of the
+ *        order in which the keys were popped.
+ */
+template<typename QueueT>
+size_t runWorkload(const std::string& name, QueueT& queue, size_t numKeys)
+{
+    std::mt19937 gen(42);
+    // Costs are doubles, so that ties (which could be popped in any order)
+    // practically never happen and the checksums are comparable.
+    std::uniform_real_distribution<double> cost(0.0, 1.0);
+    std::uniform_int_distribution<int> offset(-64, 64);
+
+    Timestamp ts;
+    for (size_t i = 0; i < numKeys; i++)
+    {
+        queue.insert(VertexHandle(i), cost(gen));
+    }
+    auto insertTime = ts.getElapsedTimeInMs();
+
+    ts.resetTimer();
+    size_t checksum = 0;
+    size_t pops = 0;
+    while (!queue.isEmpty())
+    {
+        auto key = queue.popMin().key();
+        checksum = checksum * 31 + key.idx();
+        pops++;
+
+        // Update the costs of some neighbours like an edge collapse does.
+        // Every fourth collapse also removes one of them.
+        for (int i = 0; i < 6; i++)
+        {
+            long neighbour = static_cast<long>(key.idx()) + offset(gen);
+            if (neighbour < 0 || neighbour >= static_cast<long>(numKeys))
+            {
+                continue;
+            }
+
+            VertexHandle handle(neighbour);
+            if (queue.containsKey(handle))
+            {
+                queue.updateValue(handle, cost(gen));
+            }
+        }
+        if (pops % 4 == 0)
+        {
+            long neighbour = static_cast<long>(key.idx()) + offset(gen);
+            if (neighbour >= 0 && neighbour < static_cast<long>(numKeys))
+            {
+                queue.erase(VertexHandle(neighbour));
+            }
+        }
+    }
+    auto popTime = ts.getElapsedTimeInMs();
+
+    std::cout << name << ": insert " << insertTime << " ms, pop/update "
+              << popTime << " ms, " << pops << " pops" << std::endl;
+    return checksum;
+}
+
+int main(int argc, char** argv)
+{
+    size_t numKeys = argc > 1 ? std::stoul(argv[1]) : 4000000;
+
+    std::cout << "Running workload with " << numKeys << " keys" << std::endl;
+
+    std::vector<size_t> checksums;
+    {
+        Meap<VertexHandle, double> queue(numKeys);
+        checksums.push_back(runWorkload("Meap            ", queue, numKeys));
+    }
+    {
+        DenseMeap<VertexHandle, double, 2> queue(numKeys);
+        checksums.push_back(runWorkload("DenseMeap (d=2) ", queue, numKeys));
+    }
+    {
+        DenseMeap<VertexHandle, double, 4> queue(numKeys);
+        checksums.push_back(runWorkload("DenseMeap (d=4) ", queue, numKeys));
+    }
+    {
+        DenseMeap<VertexHandle, double, 8> queue(numKeys);
+        checksums.push_back(runWorkload("DenseMeap (d=8) ", queue, numKeys));
+    }
+
+    for (auto checksum: checksums)
+    {
+        if (checksum != checksums[0])
+        {
+            std::cout << "Warning: the queues popped the keys in different orders!" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
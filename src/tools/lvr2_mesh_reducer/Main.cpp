@@ -90,7 +90,14 @@ int main(int argc, char** argv)
         // Each edge collapse removes two faces in the general case.
         // TODO: maybe we should calculate this differently...
         const auto count = static_cast<size_t>((mesh.numFaces() / 2) * reductionRatio);
-        auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals);
+        if (options.getReductionMethod() == "qem")
+        {
+            quadricMeshReduction(mesh, count, faceNormals);
+        }
+        else
+        {
+            simpleMeshReduction(mesh, count, faceNormals);
+        }
     }
 
     // =======================================================================
@@ -50,6 +50,7 @@ Options::Options(int argc, char** argv)
         ("help", "Produce help message")
         ("inputFile", value< vector<string> >(), "Input file name. Supported formats are .obj and .ply")    
         ("reductionRatio,r", value<float>(&m_edgeCollapseReductionRatio)->default_value(0.0), "Percentage of faces to remove via edge-collapse (0.0 means no reduction, 1.0 means to remove all faces which can be removed)")
+        ("reductionMethod,m", value<string>(&m_reductionMethod)->default_value("simple"), "Edge collapse strategy: simple (curvature based, keeps vertex positions) or qem (quadric error metrics, optimal vertex positions)")
     ;
     setup();
 }
@@ -65,6 +66,11 @@ float Options::getEdgeCollapseReductionRatio() const
     return (m_variables["reductionRatio"].as<float>());
 }
 
+string Options::getReductionMethod() const
+{
+    return (m_variables["reductionMethod"].as<string>());
+}
+
 bool Options::printUsage() const
 {
   if (m_variables.count("help"))
@@ -76,10 +76,16 @@ public:
      */
     float getEdgeCollapseReductionRatio() const;
 
+    /**
+     * @brief Edge collapse strategy for mesh reduction ("simple" or "qem")
+     */
+    string getReductionMethod() const;
+
     bool printUsage() const;
 
 private:
     float m_edgeCollapseReductionRatio;
+    string m_reductionMethod;
 };
 
 
@@ -88,6 +94,7 @@ inline ostream& operator<<(ostream& os, const Options &o)
     if(o.getEdgeCollapseReductionRatio() > 0.0)
     {
         cout << "##### Edge collapse reduction ratio\t: " << o.getEdgeCollapseReductionRatio() << endl;
+        cout << "##### Edge collapse method\t\t: " << o.getReductionMethod() << endl;
     }
 
     return os;
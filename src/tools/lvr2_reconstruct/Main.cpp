@@ -31,6 +31,7 @@
 #include <tuple>
 #include <stdlib.h>
 
+#include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
 #include "lvr2/config/lvropenmp.hpp"
@@ -52,6 +53,7 @@
 #include "lvr2/algorithm/Materializer.hpp"
 #include "lvr2/algorithm/Texturizer.hpp"
 #include "lvr2/algorithm/ImageTexturizer.hpp"
+#include "lvr2/algorithm/raycasting/BVHRaycaster.hpp"
 
 #include "lvr2/reconstruction/AdaptiveKSearchSurface.hpp"
 #include "lvr2/reconstruction/BilinearFastBox.hpp"
@@ -63,10 +65,12 @@
 #include "lvr2/reconstruction/HashGrid.hpp"
 #include "lvr2/reconstruction/PointsetGrid.hpp"
 #include "lvr2/reconstruction/SharpBox.hpp"
+#include "lvr2/reconstruction/TSDFGrid.hpp"
 #include "lvr2/io/PointBuffer.hpp"
 #include "lvr2/io/MeshBuffer.hpp"
 #include "lvr2/io/ModelFactory.hpp"
 #include "lvr2/io/PlutoMapIO.hpp"
+#include "lvr2/io/TimingReport.hpp"
 #include "lvr2/util/Factories.hpp"
 #include "lvr2/algorithm/GeometryAlgorithms.hpp"
 #include "lvr2/algorithm/UtilAlgorithms.hpp"
@@ -203,6 +207,50 @@ PointsetSurfacePtr<BaseVecT> loadPointCloud(const reconstruct::Options& options)
     return surface;
 }
 
+template <typename BoxT>
+std::pair<shared_ptr<GridBase>, unique_ptr<FastReconstructionBase<Vec>>>
+    createFusedGridAndReconstruction(
+        const reconstruct::Options& options,
+        PointsetSurfacePtr<Vec> surface,
+        float voxelsize
+    )
+{
+    string file = options.getFusionGrid();
+
+    shared_ptr<TSDFGrid<Vec, BoxT>> grid;
+    if(boost::filesystem::exists(file))
+    {
+        cout << timestamp << "Fusing scan into grid " << file << endl;
+        grid = std::make_shared<TSDFGrid<Vec, BoxT>>(file, options.extrude());
+
+        // The cells of an existing grid can't be resized, the scan is fused
+        // at the resolution the grid was created with
+        if(grid->getVoxelsize() != voxelsize)
+        {
+            cout << timestamp << "Warning: Voxel size " << voxelsize << " differs from the voxel size "
+                 << grid->getVoxelsize() << " of " << file << ", using " << grid->getVoxelsize() << endl;
+        }
+    }
+    else
+    {
+        cout << timestamp << "Creating new fusion grid " << file << endl;
+        grid = std::make_shared<TSDFGrid<Vec, BoxT>>(voxelsize, surface->getBoundingBox(), options.extrude());
+    }
+    grid->setMaxWeight(options.getFusionMaxWeight());
+    grid->fuse(surface);
+    grid->serialize(file);
+
+    // Only the part of the surface that was changed by the new
+    // scan is reconstructed
+    auto region = grid->extractRegion(grid->getDirtyRegion());
+    cout << timestamp << "Reconstructing " << region->getNumberOfCells() << " of "
+         << grid->getNumberOfCells() << " cells" << endl;
+
+    auto reconstruction = make_unique<FastReconstruction<Vec, BoxT>>(region);
+    reconstruction->setParallelExtraction(options.parallelExtraction());
+    return make_pair(region, std::move(reconstruction));
+}
+
 std::pair<shared_ptr<GridBase>, unique_ptr<FastReconstructionBase<Vec>>>
     createGridAndReconstruction(
         const reconstruct::Options& options,
@@ -223,6 +271,26 @@ std::pair<shared_ptr<GridBase>, unique_ptr<FastReconstructionBase<Vec>>>
         decompositionType = "PMC";
     }
 
+    if(options.getFusionGrid() != "")
+    {
+        if(!useVoxelsize)
+        {
+            resolution = surface->getBoundingBox().getLongestSide() / resolution;
+        }
+
+        if(decompositionType == "MC")
+        {
+            return createFusedGridAndReconstruction<FastBox<Vec>>(options, surface, resolution);
+        }
+        if(decompositionType != "PMC")
+        {
+            cout << "Fusion is not supported for decomposition type " << decompositionType
+                 << ". Defaulting to PMC." << endl;
+        }
+        BilinearFastBox<Vec>::m_surface = surface;
+        return createFusedGridAndReconstruction<BilinearFastBox<Vec>>(options, surface, resolution);
+    }
+
     if(decompositionType == "MC")
     {
         auto grid = std::make_shared<PointsetGrid<Vec, FastBox<Vec>>>(
@@ -234,6 +302,7 @@ std::pair<shared_ptr<GridBase>, unique_ptr<FastReconstructionBase<Vec>>>
         );
         grid->calcDistanceValues();
         auto reconstruction = make_unique<FastReconstruction<Vec, FastBox<Vec>>>(grid);
+        reconstruction->setParallelExtraction(options.parallelExtraction());
         return make_pair(grid, std::move(reconstruction));
     }
     else if(decompositionType == "PMC")
@@ -248,6 +317,7 @@ std::pair<shared_ptr<GridBase>, unique_ptr<FastReconstructionBase<Vec>>>
         );
         grid->calcDistanceValues();
         auto reconstruction = make_unique<FastReconstruction<Vec, BilinearFastBox<Vec>>>(grid);
+        reconstruction->setParallelExtraction(options.parallelExtraction());
         return make_pair(grid, std::move(reconstruction));
     }
     else if(decompositionType == "MT")
@@ -306,6 +376,11 @@ int main(int argc, char** argv)
     // =======================================================================
     OpenMPConfig::setNumThreads(options.getNumThreads());
 
+    if(options.getTimingReport() != "")
+    {
+        TimingReport::enable();
+    }
+
     auto surface = loadPointCloud<Vec>(options);
     if (!surface)
     {
@@ -374,7 +449,19 @@ int main(int argc, char** argv)
         // Each edge collapse removes two faces in the general case.
         // TODO: maybe we should calculate this differently...
         const auto count = static_cast<size_t>((mesh.numFaces() / 2) * reductionRatio);
-        auto collapsedCount = simpleMeshReduction(mesh, count, faceNormals);
+        if (options.getReductionMethod() == "qem")
+        {
+            quadricMeshReduction(mesh, count, faceNormals);
+        }
+        else
+        {
+            simpleMeshReduction(mesh, count, faceNormals);
+        }
+
+        // The collapses leave lots of holes in the mesh storage. Close them,
+        // so that the following passes iterate over dense handles.
+        auto compaction = mesh.compact();
+        remapAttributeMaps(compaction.faces, faceNormals);
     }
 
     ClusterBiMap<FaceHandle> clusterBiMap;
@@ -465,6 +552,9 @@ int main(int argc, char** argv)
         options.getTexMaxClusterSize()
     );
 
+    img_texter.setAtlasPageSize(options.getTexAtlasSize());
+    texturizer.setAtlasPageSize(options.getTexAtlasSize());
+
     // When using textures ...
     if (options.generateTextures())
     {
@@ -487,6 +577,12 @@ int main(int argc, char** argv)
 
             img_texter.set_project(project.get_project());
 
+            // Texels hidden from a camera by other parts of the mesh don't use its image
+            SimpleFinalizer<Vec> meshFinalizer;
+            img_texter.set_raycaster(
+                std::make_shared<BVHRaycaster<Vec, Normal<float>>>(meshFinalizer.apply(mesh))
+            );
+
             materializer.setTexturizer(img_texter);
         }
     }
@@ -534,6 +630,15 @@ int main(int argc, char** argv)
         //map_io.addTextureKeypointsMap(matResult.m_keypoints.get());
     }
 
+    if(options.getTimingReport() != "")
+    {
+        cout << timestamp << "Saving timing report to " << options.getTimingReport() << "." << endl;
+        if(!TimingReport::write(options.getTimingReport()))
+        {
+            cout << timestamp << "Unable to write timing report." << endl;
+        }
+    }
+
     cout << timestamp << "Program end." << endl;
 
     return 0;
@@ -63,9 +63,10 @@ Options::Options(int argc, char** argv)
         ("inputFile", value< vector<string> >(), "Input file name. Supported formats are ASCII (.pts, .xyz) and .ply")
         ("outputFile", value< vector<string> >()->multitoken()->default_value(vector<string>{"triangle_mesh.ply", "triangle_mesh.obj"}), "Output file name. Supported formats are ASCII (.pts, .xyz) and .ply")
         ("voxelsize,v", value<float>(&m_voxelsize)->default_value(10), "Voxelsize of grid used for reconstruction.")
+        ("parallelExtraction", "Triangulate the grid cells in parallel slabs. Only used for the MC and PMC decompositions.")
         ("noExtrusion", "Do not extend grid. Can be used  to avoid artefacts in dense data sets but. Disabling will possibly create additional holes in sparse data sets.")
         ("intersections,i", value<int>(&m_intersections)->default_value(-1), "Number of intersections used for reconstruction. If other than -1, voxelsize will calculated automatically.")
-        ("pcm,p", value<string>(&m_pcm)->default_value("FLANN"), "Point cloud manager used for point handling and normal estimation. Choose from {STANN, PCL, NABO}.")
+        ("pcm,p", value<string>(&m_pcm)->default_value("FLANN"), "Point cloud manager used for point handling and normal estimation. Choose from {FLANN, NANOFLANN, STANN, PCL, NABO}.")
         ("ransac", "Set this flag for RANSAC based normal estimation.")
         ("decomposition,d", value<string>(&m_pcm)->default_value("PMC"), "Defines the type of decomposition that is used for the voxels (Standard Marching Cubes (MC), Planar Marching Cubes (PMC), Standard Marching Cubes with sharp feature detection (SF) or Tetraeder (MT) decomposition. Choose from {MC, PMC, MT, SF}")
         ("optimizePlanes,o", "Shift all triangle vertices of a cluster onto their shared plane")
@@ -81,6 +82,9 @@ Options::Options(int argc, char** argv)
         ("saveGrid,g", "Writes the generated grid to a file called 'fastgrid.grid. The result can be rendered with qviewer.")
         ("saveOriginalData,s", "Save the original points and the estimated normals together with the reconstruction into one file ('triangle_mesh.ply')")
         ("scanPoseFile", value<string>()->default_value(""), "ASCII file containing scan positions that can be used to flip normals")
+        ("timingReport", value<string>()->default_value(""), "Write the elapsed time and throughput of all processing stages to the given CSV file")
+        ("fusionGrid", value<string>()->default_value(""), "Fuse the input scan into the given grid file instead of reconstructing from scratch. The grid is created if it does not exist. Only the region changed by the scan is reconstructed. Requires MC or PMC decomposition.")
+        ("fusionMaxWeight", value<float>()->default_value(0), "Upper limit for the accumulated weight of a grid point in fusion mode. Lower values adapt faster to changes in the scene. 0 means no limit.")
         ("kd", value<int>(&m_kd)->default_value(5), "Number of normals used for distance function evaluation")
         ("ki", value<int>(&m_ki)->default_value(10), "Number of normals used in the normal interpolation process")
         ("kn", value<int>(&m_kn)->default_value(10), "Size of k-neighborhood used for normal estimation")
@@ -90,6 +94,7 @@ Options::Options(int argc, char** argv)
         ("generateTextures", "Generate textures during finalization.")
         ("texMinClusterSize", value<int>(&m_texMinClusterSize)->default_value(100), "Minimum number of faces of a cluster to create a texture from")
         ("texMaxClusterSize", value<int>(&m_texMaxClusterSize)->default_value(0), "Maximum number of faces of a cluster to create a texture from (0 = no limit)")
+        ("texAtlasSize", value<int>(&m_texAtlasSize)->default_value(4096), "Width and height of the texture atlas pages the cluster textures are packed into, between 0 and 65535. The default of 4096 writes atlas pages instead of the one texture per cluster of earlier versions; use 0 to keep that layout.")
         ("textureAnalysis", "Enable texture analysis features for texture matchung.")
         ("texelSize", value<float>(&m_texelSize)->default_value(1), "Texel size that determines texture resolution.")
         ("classifier", value<string>(&m_classifier)->default_value("PlaneSimpsons"),"Classfier object used to color the mesh.")
@@ -98,6 +103,7 @@ Options::Options(int argc, char** argv)
         ("sft", value<float>(&m_sft)->default_value(0.9), "Sharp feature threshold when using sharp feature decomposition")
         ("sct", value<float>(&m_sct)->default_value(0.7), "Sharp corner threshold when using sharp feature decomposition")
         ("reductionRatio", value<float>(&m_edgeCollapseReductionRatio)->default_value(0.0), "Percentage of faces to remove via edge-collapse (0.0 means no reduction, 1.0 means to remove all faces which can be removed)")
+        ("reductionMethod", value<string>(&m_reductionMethod)->default_value("simple"), "Edge collapse strategy: simple (curvature based, keeps vertex positions) or qem (quadric error metrics, optimal vertex positions)")
         ("tp", value<string>(&m_texturePack)->default_value(""), "Path to texture pack")
         ("co", value<string>(&m_statsCoeffs)->default_value(""), "Coefficents file for texture matching based on statistics")
         ("nsc", value<unsigned int>(&m_numStatsColors)->default_value(16), "Number of colors for texture statistics")
@@ -199,11 +205,31 @@ string Options::getScanPoseFile() const
     return (m_variables["scanPoseFile"].as<string>());
 }
 
+string Options::getTimingReport() const
+{
+    return (m_variables["timingReport"].as<string>());
+}
+
+string Options::getFusionGrid() const
+{
+    return (m_variables["fusionGrid"].as<string>());
+}
+
+float Options::getFusionMaxWeight() const
+{
+    return (m_variables["fusionMaxWeight"].as<float>());
+}
+
 float Options::getEdgeCollapseReductionRatio() const
 {
     return (m_variables["reductionRatio"].as<float>());
 }
 
+string Options::getReductionMethod() const
+{
+    return (m_variables["reductionMethod"].as<string>());
+}
+
 int    Options::getDanglingArtifacts() const
 {
     return (m_variables["rda"].as<int> ());
@@ -235,6 +261,13 @@ bool Options::printUsage() const
         cout << m_descr << endl;
         return true;
     }
+  else if (getTexAtlasSize() < 0 || getTexAtlasSize() > 65535)
+    {
+        cout << "Error: --texAtlasSize must be between 0 and 65535." << endl;
+        cout << endl;
+        cout << m_descr << endl;
+        return true;
+    }
   return false;
 }
 
@@ -312,6 +345,11 @@ bool Options::extrude() const
     }
 }
 
+bool Options::parallelExtraction() const
+{
+    return m_variables.count("parallelExtraction");
+}
+
 bool Options::colorRegions() const
 {
     return m_variables.count("colorRegions");
@@ -434,6 +472,11 @@ int Options::getTexMaxClusterSize() const
     return m_variables["texMaxClusterSize"].as<int>();
 }
 
+int Options::getTexAtlasSize() const
+{
+    return m_variables["texAtlasSize"].as<int>();
+}
+
 bool Options::vertexColorsFromPointcloud() const
 {
     return m_variables.count("vcfp");
@@ -207,6 +207,23 @@ public:
      */
     string  getScanPoseFile() const;
 
+    /**
+     * @brief   Returns the name of the CSV file the stage timings are
+     *          written to. Empty if no report is requested.
+     */
+    string  getTimingReport() const;
+
+    /**
+     * @brief   Returns the name of the grid file the input scan is fused
+     *          into. Empty if a full reconstruction is requested.
+     */
+    string  getFusionGrid() const;
+
+    /**
+     * @brief   Returns the upper limit for the fusion weights, 0 for none
+     */
+    float   getFusionMaxWeight() const;
+
     /**
      * @brief   Returns the number of intersections. If the return value
      *          is positive it will be used for reconstruction instead of
@@ -288,11 +305,21 @@ public:
      */
     bool extrude() const;
 
+    /**
+     * @brief   Whether to extract the mesh from the grid in parallel.
+     */
+    bool parallelExtraction() const;
+
     /**
      * @brief Reduction ratio for mesh reduction via edge collapse
      */
     float getEdgeCollapseReductionRatio() const;
 
+    /**
+     * @brief Edge collapse strategy for mesh reduction ("simple" or "qem")
+     */
+    string getReductionMethod() const;
+
 
     unsigned int getNumStatsColors() const;
 
@@ -320,6 +347,8 @@ public:
 
     int getTexMaxClusterSize() const;
 
+    int getTexAtlasSize() const;
+
     bool vertexColorsFromPointcloud() const;
 
     bool useGPU() const;
@@ -407,6 +436,9 @@ private:
     /// Reduction ratio for mesh reduction via edge collapse
     float                           m_edgeCollapseReductionRatio;
 
+    /// Edge collapse strategy for mesh reduction
+    string                          m_reductionMethod;
+
 
     ///Path to texture pack
     string m_texturePack;
@@ -446,6 +478,9 @@ private:
 
     int m_texMaxClusterSize;
 
+    ///Size of the texture atlas pages
+    int m_texAtlasSize;
+
     ///Use pointcloud colors to paint vertices
     bool m_vertexColorsFromPointcloud;
 
@@ -498,6 +533,18 @@ inline ostream& operator<<(ostream& os, const Options &o)
         cout << "##### Sharp feature threshold \t: " << o.getSharpFeatureThreshold() << endl;
         cout << "##### Sharp corner threshold \t: " << o.getSharpCornerThreshold() << endl;
     }
+    if(o.parallelExtraction())
+    {
+        cout << "##### Parallel extraction \t: YES" << endl;
+    }
+    if(o.getTimingReport() != "")
+    {
+        cout << "##### Timing report \t\t: " << o.getTimingReport() << endl;
+    }
+    if(o.getFusionGrid() != "")
+    {
+        cout << "##### Fusion grid \t\t: " << o.getFusionGrid() << endl;
+    }
     if(o.retesselate())
     {
         cout << "##### Retesselate \t\t: YES"     << endl;
@@ -561,6 +608,7 @@ inline ostream& operator<<(ostream& os, const Options &o)
         cout << "##### Texel size \t\t: " << o.getTexelSize() << endl;
         cout << "##### Texture Min#Cluster \t: " << o.getTexMinClusterSize() << endl;
         cout << "##### Texture Max#Cluster \t: " << o.getTexMaxClusterSize() << endl;
+        cout << "##### Texture atlas size \t: " << o.getTexAtlasSize() << endl;
 
         if(o.doTextureAnalysis())
         {
@@ -574,6 +622,7 @@ inline ostream& operator<<(ostream& os, const Options &o)
     if(o.getEdgeCollapseReductionRatio() > 0.0)
     {
         cout << "##### Edge collapse reduction ratio\t: " << o.getEdgeCollapseReductionRatio() << endl;
+        cout << "##### Edge collapse method\t\t: " << o.getReductionMethod() << endl;
     }
 
     if(o.useGPU())
@@ -185,6 +185,17 @@ int main(int argc, char** argv)
 
         ("epsilon", value<double>(&options.epsilon)->default_value(options.epsilon),
          "The epsilon difference between ICP-errors for the stop criterion of ICP.")
+
+        ("icpLevels", value<int>(&options.icpLevels)->default_value(options.icpLevels),
+         "Number of resolution levels for ICP.\n"
+         "ICP starts on the coarsest level and refines the result on the finer ones. Every level doubles the voxel size of the previous one.\n"
+         "1 (default): only use the full resolution.")
+
+        ("icpVoxelSize", value<double>(&options.icpVoxelSize)->default_value(options.icpVoxelSize),
+         "The voxel size of the first reduced ICP level.")
+
+        ("pointToPlane", bool_switch(&options.icpPointToPlane),
+         "Minimize the distance between Points and the tangent planes of their neighbors in ICP instead of the Point-to-Point distance.")
         ;
 
         loopclosing_options.add_options()
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Main.cpp
+ *
+ * Compares the FLANN and nanoflann search tree backends. For each backend
+ * the build time, the time of one kSearch() call per query point and the
+ * time of a single batched kSearchMany() call are measured on a synthetic
+ * point cloud. Each backend runs in its own process to get an unbiased
+ * peak memory value.
+ *
+ * Usage: lvr2_searchtree_benchmark [numPoints] [k]
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/util/Factories.hpp"
+
+using namespace lvr2;
+
+using Vec = BaseVector<float>;
+
+/**
+ * @brief Creates a point buffer with points on a noisy sphere with radius 1
+ */
+PointBufferPtr createPoints(size_t n)
+{
+    std::mt19937 gen(42);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    floatArr points(new float[3 * n]);
+    for(size_t i = 0; i < n; i++)
+    {
+        Vec p(normal(gen), normal(gen), normal(gen));
+        p = p / p.length() * (1.0f + 0.005f * normal(gen));
+        points[3 * i]     = p.x;
+        points[3 * i + 1] = p.y;
+        points[3 * i + 2] = p.z;
+    }
+
+    PointBufferPtr buffer(new PointBuffer);
+    buffer->setPointArray(points, n);
+    return buffer;
+}
+
+/**
+ * @brief Builds the given search tree and runs all queries, once through
+ *        kSearch() and once through kSearchMany(). Returns the sum of the
+ *        distances to the k-th neighbors to cross check the backends.
+ */
+double runSearchTree(const std::string& name, PointBufferPtr buffer, const std::vector<Vec>& queries, int k)
+{
+    Timestamp ts;
+    SearchTreePtr<Vec> tree = getSearchTree<Vec>(name, buffer);
+    std::cout << name << ": build " << ts.getElapsedTimeInMs() << " ms" << std::endl;
+
+    ts.resetTimer();
+    double sum = 0;
+    #pragma omp parallel for reduction(+:sum) schedule(dynamic, 64)
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        std::vector<size_t> indices;
+        std::vector<float> distances;
+        tree->kSearch(queries[i], k, indices, distances);
+        sum += distances.back();
+    }
+    std::cout << name << ": kSearch " << ts.getElapsedTimeInMs() << " ms" << std::endl;
+
+    ts.resetTimer();
+    std::vector<size_t> indices(queries.size() * k);
+    std::vector<float> distances(queries.size() * k);
+    tree->kSearchMany(queries.data(), queries.size(), k, indices.data(), distances.data());
+    std::cout << name << ": kSearchMany " << ts.getElapsedTimeInMs() << " ms" << std::endl;
+
+    double batchSum = 0;
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        batchSum += distances[i * k + k - 1];
+    }
+    if(std::abs(sum - batchSum) > 1e-6 * std::abs(sum))
+    {
+        std::cout << name << ": kSearch and kSearchMany results differ" << std::endl;
+    }
+    return batchSum;
+}
+
+/**
+ * @brief Runs the given benchmark in a child process and prints the
+ *        peak resident memory of the child.
+ */
+template<typename Func>
+void runIsolated(const std::string& name, Func func)
+{
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        double checksum = func();
+        std::cout << name << ": checksum " << checksum << std::endl;
+        _exit(0);
+    }
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    std::cout << name << ": peak memory " << usage.ru_maxrss / 1024 << " MB" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    int k = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    timestamp.setQuiet(true);
+
+    std::cout << "Creating " << numPoints << " points, k = " << k << std::endl;
+    PointBufferPtr buffer = createPoints(numPoints);
+
+    // Query the neighborhood of every point like the normal estimation does
+    std::vector<Vec> queries(numPoints);
+    FloatChannel points = *buffer->getFloatChannel("points");
+    for(size_t i = 0; i < numPoints; i++)
+    {
+        queries[i] = points[i];
+    }
+
+    runIsolated("flann    ", [&]() { return runSearchTree("flann", buffer, queries, k); });
+    runIsolated("nanoflann", [&]() { return runSearchTree("nanoflann", buffer, queries, k); });
+
+    return 0;
+}